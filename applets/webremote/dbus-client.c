@@ -24,59 +24,138 @@
 #include "mex/mex-player-common.h"
 
 static void
-dbus_client_player_uri_changed_cb (GDBusConnection *connection,
-                                   const gchar     *sender_name,
-                                   const gchar     *object_path,
-                                   const gchar     *interface_name,
-                                   const gchar     *signal_name,
-                                   GVariant        *parameters,
-                                   DBusClient      *dbus_client)
+dbus_client_set_uri (DBusClient *dbus_client,
+                     GVariant   *uri)
 {
-  if (dbus_client->current_playing_uri)
+  g_free (dbus_client->current_playing_uri);
+  g_variant_get (uri, "(s)", &dbus_client->current_playing_uri);
+
+  /* the player gives an empty string when there is nothing */
+  if (dbus_client->current_playing_uri[0] == '\0')
     {
       g_free (dbus_client->current_playing_uri);
       dbus_client->current_playing_uri = NULL;
     }
+}
+
+static void
+dbus_client_player_signal_cb (GDBusConnection *connection,
+                              const gchar     *sender_name,
+                              const gchar     *object_path,
+                              const gchar     *interface_name,
+                              const gchar     *signal_name,
+                              GVariant        *parameters,
+                              DBusClient      *dbus_client)
+{
+  if (g_strcmp0 (signal_name, "UriChanged") == 0)
+    dbus_client_set_uri (dbus_client, parameters);
+  else if (g_strcmp0 (signal_name, "PlayingChanged") == 0)
+    g_variant_get (parameters, "(b)", &dbus_client->playing);
+  else if (g_strcmp0 (signal_name, "DurationChanged") == 0)
+    g_variant_get (parameters, "(d)", &dbus_client->duration);
+  else
+    return;
+
+  if (dbus_client->player_changed)
+    dbus_client->player_changed (dbus_client,
+                                 dbus_client->player_changed_data);
+}
+
+/* peer to peer connections (the tests) have no bus to route names */
+static const gchar *
+dbus_client_bus_name (DBusClient  *dbus_client,
+                      const gchar *name)
+{
+  if (g_dbus_connection_get_unique_name (dbus_client->connection))
+    return name;
+
+  return NULL;
+}
+
+/* the signals only tell what changes, mex may be playing already */
+static void
+dbus_player_read_state (DBusClient *dbus_client,
+                        GDBusProxy *proxy)
+{
+  GVariant *result;
+
+  result = g_dbus_proxy_call_sync (proxy, "GetUri", NULL, 0, -1, NULL, NULL);
+  if (result)
+    {
+      dbus_client_set_uri (dbus_client, result);
+      g_variant_unref (result);
+    }
 
-  g_variant_get (parameters, "(s)", &dbus_client->current_playing_uri);
+  result = g_dbus_proxy_call_sync (proxy, "GetPlaying", NULL, 0, -1, NULL,
+                                   NULL);
+  if (result)
+    {
+      g_variant_get (result, "(b)", &dbus_client->playing);
+      g_variant_unref (result);
+    }
+
+  result = g_dbus_proxy_call_sync (proxy, "GetDuration", NULL, 0, -1, NULL,
+                                   NULL);
+  if (result)
+    {
+      g_variant_get (result, "(d)", &dbus_client->duration);
+      g_variant_unref (result);
+    }
 }
 
 static GDBusProxy *
 dbus_player_proxy_new (DBusClient *dbus_client)
 {
+  const gchar *signals[] = { "UriChanged", "PlayingChanged", "DurationChanged" };
   GError *error=NULL;
   GDBusProxy *proxy;
+  guint i;
 
   if (dbus_client->mex_player)
     g_object_unref (dbus_client->mex_player);
 
+  /* the proxy would listen to all the signals of the player */
   proxy = g_dbus_proxy_new_sync (dbus_client->connection,
-                                 G_DBUS_PROXY_FLAGS_NONE,
+                                 G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
                                  NULL,
-                                 MEX_PLAYER_SERVICE_NAME,
+                                 dbus_client_bus_name (dbus_client,
+                                                       MEX_PLAYER_SERVICE_NAME),
                                  MEX_PLAYER_OBJECT_PATH,
                                  MEX_PLAYER_INTERFACE_NAME,
                                  NULL,
                                  &error);
 
-  /* Connect to the uri changed signal */
-  g_dbus_connection_signal_subscribe (dbus_client->connection,
-                                      MEX_PLAYER_SERVICE_NAME,
-                                      MEX_PLAYER_INTERFACE_NAME,
-                                      "UriChanged",
-                                      MEX_PLAYER_OBJECT_PATH,
-                                      NULL,
-                                      G_DBUS_SIGNAL_FLAGS_NONE,
-                                      (GDBusSignalCallback)
-                                      dbus_client_player_uri_changed_cb,
-                                      dbus_client,
-                                      NULL);
+  /* Connect to the signals keeping the state of the web pages up to date,
+   * one by one so that the bus does not send us the ProgressChanged flood */
+  for (i = 0; i < G_N_ELEMENTS (signals); i++)
+    {
+      if (dbus_client->player_signal_ids[i])
+        g_dbus_connection_signal_unsubscribe (dbus_client->connection,
+                                              dbus_client->player_signal_ids[i]);
+
+      dbus_client->player_signal_ids[i] =
+        g_dbus_connection_signal_subscribe (dbus_client->connection,
+                                            dbus_client_bus_name (dbus_client,
+                                                                  MEX_PLAYER_SERVICE_NAME),
+                                            MEX_PLAYER_INTERFACE_NAME,
+                                            signals[i],
+                                            MEX_PLAYER_OBJECT_PATH,
+                                            NULL,
+                                            G_DBUS_SIGNAL_FLAGS_NONE,
+                                            (GDBusSignalCallback)
+                                            dbus_client_player_signal_cb,
+                                            dbus_client,
+                                            NULL);
+    }
 
   if (error)
     {
       g_warning ("Could not create media player proxy: %s", error->message);
       g_error_free (error);
     }
+  else
+    dbus_player_read_state (dbus_client, proxy);
+
   return proxy;
 }
 
@@ -92,7 +171,8 @@ dbus_input_proxy_new (DBusClient *dbus_client)
   proxy = g_dbus_proxy_new_sync (dbus_client->connection,
                                  G_DBUS_PROXY_FLAGS_NONE,
                                  NULL,
-                                 "org.media-explorer.MediaExplorer",
+                                 dbus_client_bus_name (dbus_client,
+                                                       "org.media-explorer.MediaExplorer"),
                                  "/org/MediaExplorer/Input",
                                  "org.MediaExplorer.Input",
                                  NULL,
@@ -348,32 +428,58 @@ fail_out:
 DBusClient *dbus_client_new (void)
 {
   DBusClient *dbus_client;
+  GDBusConnection *connection;
   GError *error = NULL;
 
-  dbus_client = g_new0 (DBusClient, 1);
-
-  dbus_client->mex_input = NULL;
-  dbus_client->mex_player = NULL;
-
-  dbus_client->connection = g_bus_get_sync (G_BUS_TYPE_SESSION,
-                                               NULL, &error);
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (error)
     {
       g_warning ("Failed to connect to dbus %s\n",
                error->message ? error->message : "Unknown");
       g_error_free (error);
+
+      return g_new0 (DBusClient, 1);
     }
-  else
-    {
-      dbus_client->mex_input = dbus_input_proxy_new (dbus_client);
-      dbus_client->mex_player = dbus_player_proxy_new (dbus_client);
-     }
+
+  dbus_client = dbus_client_new_for_connection (connection);
+  g_object_unref (connection);
+
   return dbus_client;
 }
 
+DBusClient *
+dbus_client_new_for_connection (GDBusConnection *connection)
+{
+  DBusClient *dbus_client;
+
+  dbus_client = g_new0 (DBusClient, 1);
+
+  dbus_client->connection = g_object_ref (connection);
+  dbus_client->mex_input = dbus_input_proxy_new (dbus_client);
+  dbus_client->mex_player = dbus_player_proxy_new (dbus_client);
+
+  return dbus_client;
+}
+
+
+void
+dbus_client_set_player_changed_func (DBusClient                  *dbus_client,
+                                     DBusClientPlayerChangedFunc  func,
+                                     gpointer                     user_data)
+{
+  dbus_client->player_changed = func;
+  dbus_client->player_changed_data = user_data;
+}
 
 void dbus_client_free (DBusClient *dbus_client)
 {
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (dbus_client->player_signal_ids); i++)
+    if (dbus_client->player_signal_ids[i])
+      g_dbus_connection_signal_unsubscribe (dbus_client->connection,
+                                            dbus_client->player_signal_ids[i]);
+
   g_object_unref (dbus_client->connection);
   g_object_unref (dbus_client->mex_input);
   g_object_unref (dbus_client->mex_player);
@@ -26,6 +26,10 @@ G_BEGIN_DECLS
 
 typedef struct _DBusClient DBusClient;
 
+/* Called when the player signals a change of uri, playing or duration */
+typedef void (*DBusClientPlayerChangedFunc) (DBusClient *dbus_client,
+                                             gpointer    user_data);
+
 struct _DBusClient
 {
   GDBusConnection *connection;
@@ -33,12 +37,23 @@ struct _DBusClient
   GDBusProxy *mex_player;
 
   gchar *current_playing_uri;
+  gboolean playing;
+  gdouble duration;
+  guint player_signal_ids[3];
+
+  DBusClientPlayerChangedFunc player_changed;
+  gpointer player_changed_data;
 };
 
 DBusClient *dbus_client_new (void);
+DBusClient *dbus_client_new_for_connection (GDBusConnection *connection);
 
 void dbus_client_free (DBusClient *dbus_client);
 
+void dbus_client_set_player_changed_func (DBusClient                  *dbus_client,
+                                          DBusClientPlayerChangedFunc  func,
+                                          gpointer                     user_data);
+
 void dbus_client_input_set_key (DBusClient *dbus_client, gint keyval);
 void dbus_client_input_set_message (DBusClient  *dbus_client,
                                     const gchar *message,
@@ -22,6 +22,7 @@
 #include <glib.h>
 #include <string.h>
 #include <libsoup/soup.h>
+#include <json-glib/json-glib.h>
 
 #include "settings.h"
 
@@ -144,6 +145,123 @@ send_response (SoupServer   *server,
   return;
 }
 
+/* Returns the tracker information on the uri being played, cached until the
+ * uri changes */
+static const gchar *
+lookup_playing_info (MexWebRemote *self)
+{
+  gchar *sparql_request;
+  gchar *result;
+
+  if (self->dbus_client->current_playing_uri &&
+      self->current_playing_info[0] &&
+      g_strcmp0 (self->dbus_client->current_playing_uri,
+                 self->current_playing_info[0]) == 0)
+    {
+      MEX_DEBUG ("using cache: %s %s",
+                 self->dbus_client->current_playing_uri,
+                 self->current_playing_info[0]);
+      return self->current_playing_info[1];
+    }
+
+  g_free (self->current_playing_info[0]);
+  g_free (self->current_playing_info[1]);
+
+  self->current_playing_info[0] =
+    g_strdup (self->dbus_client->current_playing_uri);
+
+  sparql_request =
+    g_strdup_printf ("SELECT "
+                     "?title ?mime ?duration ?filename ?album ?artist "
+                     "WHERE { "
+                     "?urn nie:url '%s' . "
+                     "?urn nfo:fileName ?filename . "
+                     "OPTIONAL { ?urn nie:title ?title . } "
+                     "?urn nie:mimeType ?mime . "
+                     "OPTIONAL { ?urn nfo:duration ?duration . } "
+                     "OPTIONAL { ?urn nmm:musicAlbum "
+                     " [ nie:title ?album ] . } "
+                     "OPTIONAL { ?urn nmm:performer "
+                     "[ nmm:artistName ?artist ] . } "
+                     " }",
+                     self->current_playing_info[0]);
+
+  MEX_DEBUG ("query: %s", sparql_request);
+
+  result = tracker_interface_query (self->tracker_interface, sparql_request);
+  g_free (sparql_request);
+
+  /* We either failed to query or something went wrong with the json
+   * generation so return a empty json set.
+   */
+  if (!result)
+    result = g_strdup ("{}");
+
+  self->current_playing_info[1] = result;
+
+  return result;
+}
+
+/* Builds the state pushed to the web pages, only when the player signals a
+ * change: waiting pages never cause a D-Bus call */
+static void
+player_changed_cb (DBusClient   *dbus_client,
+                   MexWebRemote *self)
+{
+  JsonBuilder *builder;
+  JsonGenerator *generator;
+  JsonNode *root;
+  gchar *state;
+
+  builder = json_builder_new ();
+  json_builder_begin_object (builder);
+
+  json_builder_set_member_name (builder, "uri");
+  if (dbus_client->current_playing_uri)
+    json_builder_add_string_value (builder, dbus_client->current_playing_uri);
+  else
+    json_builder_add_null_value (builder);
+
+  json_builder_set_member_name (builder, "playing");
+  json_builder_add_boolean_value (builder, dbus_client->playing);
+
+  json_builder_set_member_name (builder, "duration");
+  json_builder_add_double_value (builder, dbus_client->duration);
+
+  json_builder_set_member_name (builder, "info");
+  if (dbus_client->current_playing_uri)
+    {
+      JsonParser *parser = json_parser_new ();
+
+      if (json_parser_load_from_data (parser, lookup_playing_info (self), -1,
+                                      NULL))
+        json_builder_add_value (builder,
+                                json_node_copy (json_parser_get_root (parser)));
+      else
+        json_builder_add_null_value (builder);
+
+      g_object_unref (parser);
+    }
+  else
+    json_builder_add_null_value (builder);
+
+  json_builder_end_object (builder);
+
+  root = json_builder_get_root (builder);
+  generator = json_generator_new ();
+  json_generator_set_root (generator, root);
+  state = json_generator_to_data (generator, NULL);
+
+  MEX_DEBUG ("state: %s", state);
+
+  state_channel_set_state (self->state_channel, state);
+
+  g_free (state);
+  json_node_free (root);
+  g_object_unref (generator);
+  g_object_unref (builder);
+}
+
 static void
 http_post (SoupServer   *server,
            SoupMessage  *msg,
@@ -208,63 +326,7 @@ http_post (SoupServer   *server,
     }
   else if (g_str_has_prefix (post_request, "playinginfo"))
     {
-      if (self->dbus_client->current_playing_uri &&
-          self->current_playing_info[0] &&
-          g_strcmp0 (self->dbus_client->current_playing_uri,
-                     self->current_playing_info[0]) == 0)
-        {
-          MEX_DEBUG ("using cache: %s %s",
-                     self->dbus_client->current_playing_uri,
-                     self->current_playing_info[0]);
-          self->data = g_strdup (self->current_playing_info[1]);
-        }
-      else
-        {
-          gchar *sparql_request;
-          gchar *result;
-
-          if (self->current_playing_info)
-            {
-              g_free (self->current_playing_info[0]);
-              g_free (self->current_playing_info[1]);
-            }
-
-          self->current_playing_info[0] =
-            dbus_client_player_get (self->dbus_client, "uri");
-
-          sparql_request =
-            g_strdup_printf ("SELECT "
-                             "?title ?mime ?duration ?filename ?album ?artist "
-                             "WHERE { "
-                             "?urn nie:url '%s' . "
-                             "?urn nfo:fileName ?filename . "
-                             "OPTIONAL { ?urn nie:title ?title . } "
-                             "?urn nie:mimeType ?mime . "
-                             "OPTIONAL { ?urn nfo:duration ?duration . } "
-                             "OPTIONAL { ?urn nmm:musicAlbum "
-                             " [ nie:title ?album ] . } "
-                             "OPTIONAL { ?urn nmm:performer "
-                             "[ nmm:artistName ?artist ] . } "
-                             " }",
-                             self->current_playing_info[0]);
-
-          MEX_DEBUG ("query: %s", sparql_request);
-
-          result = tracker_interface_query (self->tracker_interface,
-                                            sparql_request);
-          g_free (sparql_request);
-
-          /* We either failed to query or something went wrong with the json
-           * generation so return a empty json set (will be freed by libsoup).
-           */
-          if (!result)
-            result = g_strdup ("{}");
-
-          self->current_playing_info[1] = g_strdup (result);
-
-          self->data = result;
-        }
-
+      self->data = g_strdup (lookup_playing_info (self));
 
       MEX_DEBUG ("Search result\n%s", self->data);
 
@@ -338,6 +400,8 @@ server_cb (SoupServer        *server,
 
   if (msg->method == SOUP_METHOD_POST)
     http_post (server, msg, path, self);
+  else if (msg->method == SOUP_METHOD_GET && g_strcmp0 (path, "/state") == 0)
+    state_channel_handle (self->state_channel, msg, query);
   else if (msg->method == SOUP_METHOD_GET || msg->method == SOUP_METHOD_HEAD)
     send_response (server, msg, path, self, NORMAL);
   else
@@ -522,8 +586,9 @@ int main (int argc, char **argv)
   /* Allocate our playing info cache:
    * 0 - uri
    * 1 - json info on uri
+   * and the NULL g_strfreev() needs at the end
    */
-  webremote.current_playing_info = g_malloc0 (2 * sizeof (gchar *));
+  webremote.current_playing_info = g_malloc0 (3 * sizeof (gchar *));
 
   /* Start the our own dbus service for the Quit method and auto activation */
   dbus_service_id = dbus_service_start ();
@@ -568,6 +633,15 @@ int main (int argc, char **argv)
       goto clean_up;
     }
 
+  /* The web pages wait on /state for the player to change, starting from
+   * the state the client read when it connected to the player */
+  webremote.state_channel = state_channel_new (server);
+  dbus_client_set_player_changed_func (webremote.dbus_client,
+                                       (DBusClientPlayerChangedFunc)
+                                       player_changed_cb,
+                                       &webremote);
+  player_changed_cb (webremote.dbus_client, &webremote);
+
   soup_server_run_async (server);
 
   /* Avahi/mdns advertise server */
@@ -661,6 +735,9 @@ clean_up:
   if (webremote.clients)
     g_list_free (webremote.clients);
 
+  if (webremote.state_channel)
+    state_channel_free (webremote.state_channel);
+
   if (webremote.dbus_client)
     dbus_client_free (webremote.dbus_client);
 
@@ -23,6 +23,7 @@
 #include "dbus-client.h"
 #include "tracker-client.h"
 #include "mdns-client.h"
+#include "state-channel.h"
 
 #include "dbus-service.h"
 
@@ -35,6 +36,7 @@ struct _MexWebRemote
   DBusClient *dbus_client;
   TrackerInterface *tracker_interface;
   MdnsServiceInfo *mdns_service;
+  StateChannel *state_channel;
 
   gboolean opt_debug;
   guint opt_port;
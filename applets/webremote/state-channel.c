@@ -0,0 +1,246 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+/* Pushes the state of the player to the web pages with long polling.
+ *
+ * A page asks for /state?since=N, N being the serial of the last state it
+ * got. If the state has changed since, it gets the new one straight away,
+ * else the request is held until the state changes, and the one answer is
+ * then sent to all the waiting pages. Waiting pages cost nothing but a
+ * socket: the state is only computed when the player signals a change.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "state-channel.h"
+
+struct _StateChannel
+{
+  SoupServer *server;
+
+  gchar *state;
+  guint serial;
+  SoupBuffer *response;   /* the answer for the current serial */
+
+  GQueue waiting;         /* Waiters, the oldest first */
+  guint timeout_id;
+};
+
+typedef struct
+{
+  StateChannel *channel;
+  SoupMessage *msg;
+  gint64 deadline;
+  gulong finished_id;
+  GList link;
+} Waiter;
+
+static void
+waiter_free (Waiter *waiter)
+{
+  g_signal_handler_disconnect (waiter->msg, waiter->finished_id);
+  g_object_unref (waiter->msg);
+  g_slice_free (Waiter, waiter);
+}
+
+static void
+respond (StateChannel *channel,
+         SoupMessage  *msg)
+{
+  soup_message_headers_replace (msg->response_headers,
+                                "Cache-Control", "no-cache");
+  soup_message_headers_set_content_type (msg->response_headers,
+                                         "application/json", NULL);
+
+  soup_message_body_truncate (msg->response_body);
+  soup_message_body_append_buffer (msg->response_body, channel->response);
+
+  soup_message_set_status (msg, SOUP_STATUS_OK);
+}
+
+static void
+release (StateChannel *channel,
+         Waiter       *waiter)
+{
+  SoupMessage *msg = waiter->msg;
+
+  g_queue_unlink (&channel->waiting, &waiter->link);
+
+  respond (channel, msg);
+  soup_server_unpause_message (channel->server, msg);
+
+  waiter_free (waiter);
+}
+
+static void
+update_response (StateChannel *channel)
+{
+  gchar *body;
+
+  if (channel->response)
+    soup_buffer_free (channel->response);
+
+  body = g_strdup_printf ("{\"serial\":%u,\"state\":%s}",
+                          channel->serial,
+                          channel->state ? channel->state : "null");
+  channel->response = soup_buffer_new (SOUP_MEMORY_TAKE, body, strlen (body));
+}
+
+static gboolean timeout_cb (StateChannel *channel);
+
+/* wakes up when the oldest waiter times out, and only then */
+static void
+schedule_timeout (StateChannel *channel)
+{
+  Waiter *waiter;
+  gint64 delay;
+
+  if (channel->timeout_id || !(waiter = g_queue_peek_head (&channel->waiting)))
+    return;
+
+  delay = waiter->deadline - g_get_monotonic_time ();
+  channel->timeout_id =
+    g_timeout_add_seconds (MAX (delay, 0) / G_USEC_PER_SEC + 1,
+                           (GSourceFunc) timeout_cb, channel);
+}
+
+static gboolean
+timeout_cb (StateChannel *channel)
+{
+  gint64 now = g_get_monotonic_time ();
+  Waiter *waiter;
+
+  channel->timeout_id = 0;
+
+  /* the oldest waiters are first, they time out first */
+  while ((waiter = g_queue_peek_head (&channel->waiting)) &&
+         waiter->deadline <= now)
+    release (channel, waiter);
+
+  schedule_timeout (channel);
+
+  return FALSE;
+}
+
+static void
+finished_cb (SoupMessage *msg,
+             Waiter      *waiter)
+{
+  /* the page went away before the state changed */
+  g_queue_unlink (&waiter->channel->waiting, &waiter->link);
+  waiter_free (waiter);
+}
+
+StateChannel *
+state_channel_new (SoupServer *server)
+{
+  StateChannel *channel;
+
+  channel = g_new0 (StateChannel, 1);
+  channel->server = g_object_ref (server);
+  g_queue_init (&channel->waiting);
+
+  update_response (channel);
+
+  return channel;
+}
+
+void
+state_channel_free (StateChannel *channel)
+{
+  Waiter *waiter;
+
+  while ((waiter = g_queue_peek_head (&channel->waiting)))
+    release (channel, waiter);
+
+  if (channel->timeout_id)
+    g_source_remove (channel->timeout_id);
+
+  soup_buffer_free (channel->response);
+  g_free (channel->state);
+  g_object_unref (channel->server);
+  g_free (channel);
+}
+
+/* Sets the state, a JSON value, and sends it to the waiting pages if it
+ * changed */
+void
+state_channel_set_state (StateChannel *channel,
+                         const gchar  *state)
+{
+  Waiter *waiter;
+
+  if (g_strcmp0 (channel->state, state) == 0)
+    return;
+
+  g_free (channel->state);
+  channel->state = g_strdup (state);
+  channel->serial++;
+
+  update_response (channel);
+
+  while ((waiter = g_queue_peek_head (&channel->waiting)))
+    release (channel, waiter);
+}
+
+guint
+state_channel_get_serial (StateChannel *channel)
+{
+  return channel->serial;
+}
+
+/* Answers a request for the state, now if the page does not have the
+ * current one yet, or when it changes */
+void
+state_channel_handle (StateChannel *channel,
+                      SoupMessage  *msg,
+                      GHashTable   *query)
+{
+  const gchar *since = NULL;
+  Waiter *waiter;
+
+  if (query)
+    since = g_hash_table_lookup (query, "since");
+
+  if (since == NULL || strtoul (since, NULL, 10) != channel->serial)
+    {
+      respond (channel, msg);
+      return;
+    }
+
+  waiter = g_slice_new0 (Waiter);
+  waiter->channel = channel;
+  waiter->msg = g_object_ref (msg);
+  waiter->deadline = g_get_monotonic_time () +
+                     STATE_CHANNEL_TIMEOUT * G_USEC_PER_SEC;
+  waiter->link.data = waiter;
+  waiter->finished_id = g_signal_connect (msg, "finished",
+                                          G_CALLBACK (finished_cb), waiter);
+
+  g_queue_push_tail_link (&channel->waiting, &waiter->link);
+  soup_server_pause_message (channel->server, msg);
+
+  schedule_timeout (channel);
+}
+
+guint
+state_channel_get_n_waiting (StateChannel *channel)
+{
+  return g_queue_get_length (&channel->waiting);
+}
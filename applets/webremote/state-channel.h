@@ -0,0 +1,48 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __STATE_CHANNEL_H__
+#define __STATE_CHANNEL_H__
+
+#include <glib.h>
+#include <libsoup/soup.h>
+
+G_BEGIN_DECLS
+
+/* how long a client waits for a change before being answered anyway, in
+ * seconds, so that proxies don't give up on the request first */
+#define STATE_CHANNEL_TIMEOUT 30
+
+typedef struct _StateChannel StateChannel;
+
+StateChannel *state_channel_new (SoupServer *server);
+
+void state_channel_free (StateChannel *channel);
+
+void state_channel_set_state (StateChannel *channel, const gchar *state);
+guint state_channel_get_serial (StateChannel *channel);
+
+void state_channel_handle (StateChannel *channel,
+                           SoupMessage  *msg,
+                           GHashTable   *query);
+
+guint state_channel_get_n_waiting (StateChannel *channel);
+
+G_END_DECLS
+
+#endif
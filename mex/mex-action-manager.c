@@ -20,6 +20,7 @@
 
 #include "mex-action-manager.h"
 #include "mex-marshal.h"
+#include "mex-plugin-manager.h"
 
 G_DEFINE_TYPE (MexActionManager, mex_action_manager, G_TYPE_OBJECT)
 
@@ -37,6 +38,7 @@ enum
 struct _MexActionManagerPrivate
 {
   GHashTable  *actions;
+  guint        providers_loaded : 1;
 };
 
 static guint signals[LAST_SIGNAL] = { 0, };
@@ -189,13 +191,25 @@ mex_action_manager_get_actions_for_content (MexActionManager *manager,
 
   g_return_val_if_fail (MEX_IS_ACTION_MANAGER (manager), NULL);
 
+  priv = manager->priv;
+
+  /* Make sure the plugins providing actions have had a chance to register
+   * them, the first time actions are asked for */
+  if (!priv->providers_loaded)
+    {
+      MexPluginManager *plugins = mex_plugin_manager_get_default ();
+
+      mex_plugin_manager_load_capabilities
+        (plugins, MEX_PLUGIN_CAPABILITY_ACTION_PROVIDER);
+      priv->providers_loaded = TRUE;
+    }
+
   mime = mex_content_get_metadata (content, MEX_CONTENT_METADATA_MIMETYPE);
 
   last_position = mex_content_get_metadata (content,
                                             MEX_CONTENT_METADATA_LAST_POSITION);
 
   actions = NULL;
-  priv = manager->priv;
 
   g_hash_table_iter_init (&iter, priv->actions);
   while (g_hash_table_iter_next (&iter, &key, &value))
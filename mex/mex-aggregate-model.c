@@ -118,7 +118,7 @@ mex_aggregate_model_clear_model (MexAggregateModel *self,
                                  MexModel          *model)
 {
   gint i;
-  GList *c, *to_remove;
+  GList *to_remove;
   MexContent *content;
 
   MexAggregateModelPrivate *priv = self->priv;
@@ -139,8 +139,7 @@ mex_aggregate_model_clear_model (MexAggregateModel *self,
   /* Remove the contents after the loop, to avoid modifying what we're
    * iterating over.
    */
-  for (c = to_remove; c; c = c->next)
-    mex_model_remove_content (MEX_MODEL (self), MEX_CONTENT (c->data));
+  mex_model_remove (MEX_MODEL (self), to_remove);
 
   g_list_free (to_remove);
 }
@@ -192,9 +191,11 @@ mex_aggregate_model_controller_changed_cb (GController          *controller,
 
           content = mex_model_get_content (model, content_index);
           g_hash_table_remove (priv->content_to_model, content);
-
-          mex_model_remove_content (MEX_MODEL (self), content);
+          list = g_list_prepend (list, content);
         }
+        mex_model_remove (MEX_MODEL (self), list);
+        g_list_free (list);
+        list = NULL;
       break;
 
     case G_CONTROLLER_UPDATE:
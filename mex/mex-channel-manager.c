@@ -17,7 +17,27 @@
  */
 
 
+#include <string.h>
+
+#include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+
 #include "mex-channel-manager.h"
+#include "mex-generic-model.h"
+
+/*
+ * The logos of the channels are looked up in the background, a few at a
+ * time, the channels shown on screen first: the views showing the model of
+ * the manager (see mex_channel_manager_get_model()) tell it which channels
+ * they show, and mex_channel_manager_prioritize_logos() moves these to the
+ * front of the queue. The logos found are kept in a
+ * cache on disk, per logo provider, so that the next runs have them
+ * straight away without asking the provider again. Channels without a logo
+ * are cached too, with an empty URI.
+ */
+
+#define LOGO_MAX_IN_FLIGHT  2
+#define LOGO_CACHE_SAVE_DELAY 2 /* seconds */
 
 G_DEFINE_TYPE (MexChannelManager, mex_channel_manager, G_TYPE_OBJECT)
 
@@ -29,11 +49,275 @@ G_DEFINE_TYPE (MexChannelManager, mex_channel_manager, G_TYPE_OBJECT)
 struct _MexChannelManagerPrivate
 {
   GPtrArray *channels;
+  GHashTable *positions;          /* MexChannel -> position + 1 */
+  MexModel *model;                /* the channels, for the views */
   MexLogoProvider *logo_provider; /* For now a single logo provider */
+
+  /* logos being looked up */
+  GQueue *logo_queue;
+  GHashTable *logo_pending;       /* MexChannel -> link in logo_queue */
+  guint logo_in_flight;
+  GCancellable *logo_cancellable;
+
+  GKeyFile *logo_cache;
+  gchar *logo_cache_path;
+  guint logo_cache_save_id;
 };
 
+typedef struct
+{
+  MexChannelManager *manager;
+  MexChannel *channel;
+} LogoRequest;
+
+static void logos_dispatch (MexChannelManager *manager);
+
+/*
+ * The model given to the views, the channels they show have their logos
+ * looked up first
+ */
+
+typedef struct
+{
+  MexGenericModel parent;
+
+  MexChannelManager *manager;
+} MexChannelModel;
+
+typedef MexGenericModelClass MexChannelModelClass;
+
+static void mex_channel_model_iface_init (MexModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MexChannelModel, mex_channel_model,
+                         MEX_TYPE_GENERIC_MODEL,
+                         G_IMPLEMENT_INTERFACE (MEX_TYPE_MODEL,
+                                                mex_channel_model_iface_init))
+
+static void
+mex_channel_model_set_visible_contents (MexModel   *model,
+                                        MexContent *first,
+                                        MexContent *last)
+{
+  MexChannelManager *manager = ((MexChannelModel *) model)->manager;
+  gint first_position, last_position;
+
+  first_position =
+    mex_channel_manager_get_channel_position (manager, (MexChannel *) first);
+  last_position =
+    mex_channel_manager_get_channel_position (manager, (MexChannel *) last);
+
+  if (first_position < 0 || last_position < 0)
+    return;
+
+  mex_channel_manager_prioritize_logos (manager,
+                                        MIN (first_position, last_position),
+                                        ABS (last_position - first_position)
+                                        + 1);
+}
+
+static void
+mex_channel_model_iface_init (MexModelIface *iface)
+{
+  iface->set_visible_contents = mex_channel_model_set_visible_contents;
+}
+
+static void
+mex_channel_model_class_init (MexChannelModelClass *klass)
+{
+}
+
+static void
+mex_channel_model_init (MexChannelModel *self)
+{
+}
+
+/*
+ * Logo cache
+ */
+
+static gchar *
+logo_cache_key (MexChannel *channel)
+{
+  const gchar *name = mex_channel_get_name (channel);
+
+  if (name == NULL || *name == '\0')
+    return NULL;
+
+  /* key files don't like '=', '[' and friends in keys */
+  return g_uri_escape_string (name, " ", FALSE);
+}
+
+static void
+logo_cache_ensure (MexChannelManager *manager)
+{
+  MexChannelManagerPrivate *priv = manager->priv;
+
+  if (priv->logo_cache)
+    return;
+
+  priv->logo_cache = g_key_file_new ();
+
+  if (priv->logo_cache_path == NULL)
+    priv->logo_cache_path = g_build_filename (g_get_user_cache_dir (),
+                                              "mex", "channel-logos", NULL);
+
+  g_key_file_load_from_file (priv->logo_cache, priv->logo_cache_path,
+                             G_KEY_FILE_NONE, NULL);
+}
+
+static void
+logo_cache_save (MexChannelManager *manager)
+{
+  MexChannelManagerPrivate *priv = manager->priv;
+  GError *error = NULL;
+  gchar *data, *directory;
+  gsize length;
+
+  if (priv->logo_cache_save_id)
+    {
+      g_source_remove (priv->logo_cache_save_id);
+      priv->logo_cache_save_id = 0;
+    }
+
+  directory = g_path_get_dirname (priv->logo_cache_path);
+  g_mkdir_with_parents (directory, 0755);
+  g_free (directory);
+
+  data = g_key_file_to_data (priv->logo_cache, &length, NULL);
+  if (!g_file_set_contents (priv->logo_cache_path, data, length, &error))
+    {
+      g_warning ("Could not save the channel logos: %s", error->message);
+      g_clear_error (&error);
+    }
+  g_free (data);
+}
+
+static gboolean
+logo_cache_save_cb (MexChannelManager *manager)
+{
+  manager->priv->logo_cache_save_id = 0;
+  logo_cache_save (manager);
+
+  return FALSE;
+}
+
+static void
+logo_cache_store (MexChannelManager *manager,
+                  MexChannel        *channel,
+                  const gchar       *logo_uri)
+{
+  MexChannelManagerPrivate *priv = manager->priv;
+  gchar *key;
+
+  key = logo_cache_key (channel);
+  if (key == NULL)
+    return;
+
+  g_key_file_set_string (priv->logo_cache,
+                         G_OBJECT_TYPE_NAME (priv->logo_provider),
+                         key, logo_uri);
+  g_free (key);
+
+  if (!priv->logo_cache_save_id)
+    priv->logo_cache_save_id =
+      g_timeout_add_seconds (LOGO_CACHE_SAVE_DELAY,
+                             (GSourceFunc) logo_cache_save_cb, manager);
+}
+
+static gchar *
+logo_cache_lookup (MexChannelManager *manager,
+                   MexChannel        *channel)
+{
+  MexChannelManagerPrivate *priv = manager->priv;
+  gchar *key, *logo_uri;
+
+  key = logo_cache_key (channel);
+  if (key == NULL)
+    return NULL;
+
+  logo_uri = g_key_file_get_string (priv->logo_cache,
+                                    G_OBJECT_TYPE_NAME (priv->logo_provider),
+                                    key, NULL);
+  g_free (key);
+
+  return logo_uri;
+}
+
+/*
+ * Logo lookups
+ */
+
 static void
-ensure_logos (MexChannelManager *manager)
+on_logo_ready (GObject      *provider,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  LogoRequest *req = user_data;
+  MexChannelManager *manager = req->manager;
+  MexChannelManagerPrivate *priv = manager->priv;
+  GError *error = NULL;
+  gchar *logo_uri;
+
+  priv->logo_in_flight--;
+
+  logo_uri = mex_logo_provider_get_channel_logo_finish (MEX_LOGO_PROVIDER (provider),
+                                                        res, &error);
+
+  if (error)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Could not get the logo of %s: %s",
+                   mex_channel_get_name (req->channel), error->message);
+      g_clear_error (&error);
+    }
+  else if ((MexLogoProvider *) provider == priv->logo_provider)
+    {
+      if (logo_uri)
+        mex_channel_set_logo_uri (req->channel, logo_uri);
+      logo_cache_store (manager, req->channel, logo_uri ? logo_uri : "");
+    }
+
+  g_free (logo_uri);
+
+  logos_dispatch (manager);
+
+  g_object_unref (req->channel);
+  g_object_unref (req->manager);
+  g_slice_free (LogoRequest, req);
+}
+
+static void
+logos_dispatch (MexChannelManager *manager)
+{
+  MexChannelManagerPrivate *priv = manager->priv;
+
+  if (priv->logo_provider == NULL)
+    return;
+
+  while (priv->logo_in_flight < LOGO_MAX_IN_FLIGHT &&
+         !g_queue_is_empty (priv->logo_queue))
+    {
+      LogoRequest *req;
+      MexChannel *channel;
+
+      channel = g_queue_pop_head (priv->logo_queue);
+      g_hash_table_remove (priv->logo_pending, channel);
+
+      req = g_slice_new (LogoRequest);
+      req->manager = g_object_ref (manager);
+      req->channel = g_object_ref (channel);
+
+      priv->logo_in_flight++;
+      mex_logo_provider_get_channel_logo_async (priv->logo_provider, channel,
+                                                priv->logo_cancellable,
+                                                on_logo_ready, req);
+    }
+}
+
+/* sets the logos that are in the cache and queues the other channels */
+static void
+ensure_logos (MexChannelManager *manager,
+              guint              first)
 {
   MexChannelManagerPrivate *priv = manager->priv;
   guint i;
@@ -45,16 +329,31 @@ ensure_logos (MexChannelManager *manager)
   if (priv->logo_provider == NULL)
     return;
 
-  for (i = 0; i < priv->channels->len; i++)
+  logo_cache_ensure (manager);
+
+  for (i = first; i < priv->channels->len; i++)
     {
       MexChannel *channel = g_ptr_array_index (priv->channels, i);
       gchar *logo_uri;
 
-      logo_uri = mex_logo_provider_get_channel_logo (priv->logo_provider,
-                                                     channel);
-      mex_channel_set_logo_uri (channel, logo_uri);
-      g_free (logo_uri);
+      logo_uri = logo_cache_lookup (manager, channel);
+      if (logo_uri)
+        {
+          if (*logo_uri)
+            mex_channel_set_logo_uri (channel, logo_uri);
+          g_free (logo_uri);
+          continue;
+        }
+
+      if (g_hash_table_lookup (priv->logo_pending, channel))
+        continue;
+
+      g_queue_push_tail (priv->logo_queue, channel);
+      g_hash_table_insert (priv->logo_pending, channel,
+                           g_queue_peek_tail_link (priv->logo_queue));
     }
+
+  logos_dispatch (manager);
 }
 
 /*
@@ -93,12 +392,28 @@ mex_channel_manager_dispose (GObject *object)
   MexChannelManager *manager = MEX_CHANNEL_MANAGER (object);
   MexChannelManagerPrivate *priv = manager->priv;
 
+  if (priv->logo_cache_save_id)
+    logo_cache_save (manager);
+
+  if (priv->logo_cancellable)
+    {
+      g_cancellable_cancel (priv->logo_cancellable);
+      g_object_unref (priv->logo_cancellable);
+      priv->logo_cancellable = NULL;
+    }
+
   if (priv->logo_provider)
     {
       g_object_unref (priv->logo_provider);
       priv->logo_provider = NULL;
     }
 
+  if (priv->model)
+    {
+      g_object_unref (priv->model);
+      priv->model = NULL;
+    }
+
   G_OBJECT_CLASS (mex_channel_manager_parent_class)->dispose (object);
 }
 
@@ -108,8 +423,15 @@ mex_channel_manager_finalize (GObject *object)
   MexChannelManager *manager = MEX_CHANNEL_MANAGER (object);
   MexChannelManagerPrivate *priv = manager->priv;
 
+  g_queue_free (priv->logo_queue);
+  g_hash_table_unref (priv->logo_pending);
+  g_hash_table_unref (priv->positions);
   g_ptr_array_free (priv->channels, TRUE);
 
+  if (priv->logo_cache)
+    g_key_file_free (priv->logo_cache);
+  g_free (priv->logo_cache_path);
+
   G_OBJECT_CLASS (mex_channel_manager_parent_class)->finalize (object);
 }
 
@@ -134,6 +456,14 @@ mex_channel_manager_init (MexChannelManager *self)
   self->priv = priv = CHANNEL_MANAGER_PRIVATE (self);
 
   priv->channels = g_ptr_array_new_with_free_func (g_object_unref);
+  priv->positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->logo_queue = g_queue_new ();
+  priv->logo_pending = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  priv->model = g_object_new (mex_channel_model_get_type (),
+                              "title", _("Channels"),
+                              NULL);
+  ((MexChannelModel *) priv->model)->manager = self;
 }
 
 MexChannelManager *
@@ -156,12 +486,30 @@ mex_channel_manager_get_channels (MexChannelManager *manager)
   return manager->priv->channels;
 }
 
+/**
+ * mex_channel_manager_get_model:
+ * @manager: a #MexChannelManager
+ *
+ * Gets a model of the channels of @manager, in the same order. The views
+ * showing it have the logos of the channels they show looked up first.
+ *
+ * Return value: (transfer none): the model of the channels
+ */
+MexModel *
+mex_channel_manager_get_model (MexChannelManager *manager)
+{
+  g_return_val_if_fail (MEX_IS_CHANNEL_MANAGER (manager), NULL);
+
+  return manager->priv->model;
+}
+
 void
 mex_channel_manager_add_provider (MexChannelManager  *manager,
                                   MexChannelProvider *provider)
 {
   MexChannelManagerPrivate *priv;
   const GPtrArray *channels;
+  GList *new_channels = NULL;
   guint previous_len;
   guint i;
 
@@ -179,9 +527,22 @@ mex_channel_manager_add_provider (MexChannelManager  *manager,
       MexChannel *channel = g_ptr_array_index (channels, i);
 
       priv->channels->pdata[previous_len + i] = g_object_ref (channel);
+
+      /* a channel given twice keeps its first position, and is only shown
+       * there */
+      if (!g_hash_table_lookup (priv->positions, channel))
+        {
+          g_hash_table_insert (priv->positions, channel,
+                               GUINT_TO_POINTER (previous_len + i + 1));
+          new_channels = g_list_prepend (new_channels, channel);
+        }
     }
 
-  ensure_logos (manager);
+  new_channels = g_list_reverse (new_channels);
+  mex_model_add (priv->model, new_channels);
+  g_list_free (new_channels);
+
+  ensure_logos (manager, previous_len);
 }
 
 guint
@@ -196,22 +557,13 @@ gint
 mex_channel_manager_get_channel_position (MexChannelManager *manager,
                                           MexChannel        *channel)
 {
-  MexChannelManagerPrivate *priv;
-  MexChannel *c;
-  guint i;
+  gpointer position;
 
   g_return_val_if_fail (MEX_IS_CHANNEL_MANAGER (manager), -1);
-  priv = manager->priv;
-
-  for (i = 0; i < priv->channels->len; i++)
-    {
-      c = g_ptr_array_index (priv->channels, i);
 
-      if (c == channel)
-        return i;
-    }
+  position = g_hash_table_lookup (manager->priv->positions, channel);
 
-  return -1;
+  return GPOINTER_TO_INT (position) - 1;
 }
 
 void
@@ -224,7 +576,270 @@ mex_channel_manager_add_logo_provider (MexChannelManager *manager,
   g_return_if_fail (MEX_IS_LOGO_PROVIDER (provider));
   priv = manager->priv;
 
+  /* forget about the lookups of the previous provider */
+  if (priv->logo_cancellable)
+    {
+      g_cancellable_cancel (priv->logo_cancellable);
+      g_object_unref (priv->logo_cancellable);
+    }
+  priv->logo_cancellable = g_cancellable_new ();
+
+  g_queue_clear (priv->logo_queue);
+  g_hash_table_remove_all (priv->logo_pending);
+
+  if (priv->logo_provider)
+    g_object_unref (priv->logo_provider);
   priv->logo_provider = g_object_ref (provider);
 
-  ensure_logos (manager);
+  ensure_logos (manager, 0);
+}
+
+/**
+ * mex_channel_manager_prioritize_logos:
+ * @manager: a #MexChannelManager
+ * @first: the position of the first channel
+ * @n_channels: the number of channels
+ *
+ * Looks up the logos of the channels from @first to @first + @n_channels
+ * before the other ones, typically the channels on screen.
+ */
+void
+mex_channel_manager_prioritize_logos (MexChannelManager *manager,
+                                      guint              first,
+                                      guint              n_channels)
+{
+  MexChannelManagerPrivate *priv;
+  guint i;
+
+  g_return_if_fail (MEX_IS_CHANNEL_MANAGER (manager));
+  priv = manager->priv;
+
+  if (first >= priv->channels->len)
+    return;
+
+  n_channels = MIN (n_channels, priv->channels->len - first);
+
+  for (i = first + n_channels; i > first; i--)
+    {
+      MexChannel *channel = g_ptr_array_index (priv->channels, i - 1);
+      GList *link;
+
+      link = g_hash_table_lookup (priv->logo_pending, channel);
+      if (link == NULL)
+        continue;
+
+      g_queue_unlink (priv->logo_queue, link);
+      g_queue_push_head_link (priv->logo_queue, link);
+    }
+
+  logos_dispatch (manager);
+}
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-test-internal.h"
+
+#define N_TEST_CHANNELS 50
+
+/* a channel provider with N_TEST_CHANNELS channels */
+
+typedef GObject StubChannels;
+typedef GObjectClass StubChannelsClass;
+
+static void stub_channels_iface_init (MexChannelProviderInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (StubChannels, stub_channels, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (MEX_TYPE_CHANNEL_PROVIDER,
+                                                stub_channels_iface_init))
+
+static const GPtrArray *
+stub_channels_get_channels (MexChannelProvider *provider)
+{
+  return g_object_get_data (G_OBJECT (provider), "channels");
+}
+
+static void
+stub_channels_iface_init (MexChannelProviderInterface *iface)
+{
+  iface->get_channels = stub_channels_get_channels;
+}
+
+static void
+stub_channels_class_init (StubChannelsClass *klass)
+{
+}
+
+static void
+stub_channels_init (StubChannels *self)
+{
+  GPtrArray *channels;
+  guint i;
+
+  channels = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < N_TEST_CHANNELS; i++)
+    {
+      MexChannel *channel = mex_channel_new ();
+      gchar *name = g_strdup_printf ("Channel=%02u", i);
+
+      mex_channel_set_name (channel, name);
+      g_ptr_array_add (channels, channel);
+      g_free (name);
+    }
+
+  g_object_set_data_full (G_OBJECT (self), "channels", channels,
+                          (GDestroyNotify) g_ptr_array_unref);
+}
+
+/* a logo provider with a synchronous lookup, run from the main loop by
+ * MexLogoProvider, recording the order of the lookups */
+
+typedef GObject StubLogos;
+typedef GObjectClass StubLogosClass;
+
+static void stub_logos_iface_init (MexLogoProviderInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (StubLogos, stub_logos, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (MEX_TYPE_LOGO_PROVIDER,
+                                                stub_logos_iface_init))
+
+static GPtrArray *stub_logos_lookups;
+
+static gchar *
+stub_logos_get_channel_logo (MexLogoProvider *provider,
+                             MexChannel      *channel)
+{
+  const gchar *name = mex_channel_get_name (channel);
+
+  g_ptr_array_add (stub_logos_lookups, g_strdup (name));
+
+  /* channel 13 has no logo */
+  if (g_str_has_suffix (name, "13"))
+    return NULL;
+
+  return g_strdup_printf ("file:///logos/%s.png", name);
+}
+
+static void
+stub_logos_iface_init (MexLogoProviderInterface *iface)
+{
+  iface->get_channel_logo = stub_logos_get_channel_logo;
+}
+
+static void
+stub_logos_class_init (StubLogosClass *klass)
+{
+}
+
+static void
+stub_logos_init (StubLogos *self)
+{
+}
+
+static guint
+count_logos (MexChannelManager *manager)
+{
+  const GPtrArray *channels = manager->priv->channels;
+  guint i, n = 0;
+
+  for (i = 0; i < channels->len; i++)
+    if (mex_channel_get_logo_uri (g_ptr_array_index (channels, i)))
+      n++;
+
+  return n;
 }
+
+void
+mex_test_channel_manager_logos (void)
+{
+  MexChannelManager *manager;
+  MexChannelProvider *channels;
+  MexLogoProvider *logos;
+  MexModel *model;
+  gchar *directory, *path;
+  guint i, n_visible = 0;
+
+  directory = g_dir_make_tmp ("mex-logos-XXXXXX", NULL);
+  g_assert (directory);
+  path = g_build_filename (directory, "channel-logos", NULL);
+
+  stub_logos_lookups = g_ptr_array_new_with_free_func (g_free);
+
+  channels = g_object_new (stub_channels_get_type (), NULL);
+  logos = g_object_new (stub_logos_get_type (), NULL);
+
+  manager = g_object_new (MEX_TYPE_CHANNEL_MANAGER, NULL);
+  manager->priv->logo_cache_path = g_strdup (path);
+
+  mex_channel_manager_add_provider (manager, channels);
+
+  /* positions */
+  for (i = 0; i < N_TEST_CHANNELS; i++)
+    g_assert_cmpint (mex_channel_manager_get_channel_position (manager,
+                       g_ptr_array_index (manager->priv->channels, i)),
+                     ==, i);
+  g_assert_cmpint (mex_channel_manager_get_channel_position (manager, NULL),
+                   ==, -1);
+
+  /* the views show the channels in the same order */
+  model = mex_channel_manager_get_model (manager);
+  g_assert_cmpuint (mex_model_get_length (model), ==, N_TEST_CHANNELS);
+  g_assert (mex_model_get_content (model, 7) ==
+            g_ptr_array_index (manager->priv->channels, 7));
+
+  /* the lookups start straight away, a view then shows channels 40 to 44:
+   * they come next */
+  mex_channel_manager_add_logo_provider (manager, logos);
+  mex_model_set_visible_contents (model,
+                                  mex_model_get_content (model, 40),
+                                  mex_model_get_content (model, 44));
+
+  while (manager->priv->logo_in_flight ||
+         !g_queue_is_empty (manager->priv->logo_queue))
+    g_main_context_iteration (NULL, TRUE);
+
+  /* only the lookups started before could get ahead of them */
+  g_assert_cmpuint (stub_logos_lookups->len, ==, N_TEST_CHANNELS);
+  for (i = 0; i < LOGO_MAX_IN_FLIGHT + 5; i++)
+    {
+      const gchar *name = g_ptr_array_index (stub_logos_lookups, i);
+
+      if (g_str_has_prefix (name, "Channel=4"))
+        n_visible++;
+    }
+  g_assert_cmpuint (n_visible, ==, 5);
+
+  g_assert_cmpuint (count_logos (manager), ==, N_TEST_CHANNELS - 1);
+  g_assert_cmpstr (mex_channel_get_logo_uri (g_ptr_array_index (
+                     manager->priv->channels, 7)),
+                   ==, "file:///logos/Channel=07.png");
+
+  g_object_unref (manager);
+
+  /* the next run has the logos without asking the provider */
+  g_object_unref (channels);
+  channels = g_object_new (stub_channels_get_type (), NULL);
+  g_ptr_array_set_size (stub_logos_lookups, 0);
+
+  manager = g_object_new (MEX_TYPE_CHANNEL_MANAGER, NULL);
+  manager->priv->logo_cache_path = g_strdup (path);
+
+  mex_channel_manager_add_provider (manager, channels);
+  mex_channel_manager_add_logo_provider (manager, logos);
+
+  g_assert_cmpuint (count_logos (manager), ==, N_TEST_CHANNELS - 1);
+  g_assert_cmpuint (manager->priv->logo_in_flight, ==, 0);
+
+  g_object_unref (manager);
+  g_assert_cmpuint (stub_logos_lookups->len, ==, 0);
+
+  g_object_unref (logos);
+  g_object_unref (channels);
+  g_ptr_array_unref (stub_logos_lookups);
+
+  g_unlink (path);
+  g_rmdir (directory);
+  g_free (path);
+  g_free (directory);
+}
+
+#endif /* ENABLE_TESTS */
@@ -25,6 +25,7 @@
 #include <mex/mex-channel.h>
 #include <mex/mex-channel-provider.h>
 #include <mex/mex-logo-provider.h>
+#include <mex/mex-model.h>
 
 G_BEGIN_DECLS
 
@@ -71,6 +72,7 @@ GType mex_channel_manager_get_type (void) G_GNUC_CONST;
 MexChannelManager * mex_channel_manager_get_default           (void);
 
 const GPtrArray *   mex_channel_manager_get_channels          (MexChannelManager *manager);
+MexModel *          mex_channel_manager_get_model             (MexChannelManager *manager);
 void                mex_channel_manager_add_provider          (MexChannelManager  *manager,
                                                                MexChannelProvider *provider);
 void                mex_channel_manager_add_logo_provider     (MexChannelManager *manager,
@@ -79,6 +81,9 @@ void                mex_channel_manager_add_logo_provider     (MexChannelManager
 guint               mex_channel_manager_get_n_channels        (MexChannelManager *manager);
 gint                mex_channel_manager_get_channel_position  (MexChannelManager *manager,
                                                                MexChannel        *channel);
+void                mex_channel_manager_prioritize_logos      (MexChannelManager *manager,
+                                                               guint              first,
+                                                               guint              n_channels);
 G_END_DECLS
 
 #endif /* __MEX_CHANNEL_MANAGER_H__ */
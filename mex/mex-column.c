@@ -21,10 +21,13 @@
 #include "mex-column-view.h"
 #include "mex-content-box.h"
 #include "mex-content-view.h"
+#include "mex-frame-profiler.h"
 #include "mex-scroll-view.h"
 #include "mex-tile.h"
 #include "mex-scrollable-container.h"
 
+#include <string.h>
+
 #define SPACING 6
 
 
@@ -43,8 +46,13 @@ struct _MexColumnPrivate
 
   ClutterActor *current_focus;
 
-  GList        *children;
-  guint         n_items;
+  /* One box per row of the model. With an adjustment, boxes are only
+   * created for the rows that scroll into view and the others are NULL */
+  GPtrArray    *children;
+  GArray       *offsets;
+  gfloat        row_height;
+  guint         ensure_rows_id;
+  guchar        child_opacity;
   gint          open_boxes;
 
   MxAdjustment *adjustment;
@@ -58,6 +66,8 @@ static void mx_focusable_iface_init (MxFocusableIface *iface);
 static void mx_stylable_iface_init (MxStylableIface *iface);
 static void mex_scrollable_iface_init (MexScrollableContainerInterface *iface);
 
+static void mex_column_queue_ensure_rows (MexColumn *column);
+
 #define GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), MEX_TYPE_COLUMN, MexColumnPrivate))
 G_DEFINE_TYPE_WITH_CODE (MexColumn, mex_column, MX_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE (MX_TYPE_SCROLLABLE,
@@ -69,6 +79,20 @@ G_DEFINE_TYPE_WITH_CODE (MexColumn, mex_column, MX_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE (MEX_TYPE_SCROLLABLE_CONTAINER,
                                                 mex_scrollable_iface_init))
 
+static gint
+mex_column_get_child_index (MexColumn    *column,
+                            ClutterActor *child)
+{
+  GPtrArray *children = column->priv->children;
+  guint i;
+
+  for (i = 0; i < children->len; i++)
+    if (g_ptr_array_index (children, i) == child)
+      return i;
+
+  return -1;
+}
+
 /* MexScrollableContainerInterface */
 static void
 mex_column_get_allocation (MexScrollableContainer *self,
@@ -82,11 +106,11 @@ mex_column_get_allocation (MexScrollableContainer *self,
 
   box->y1 = 0;
 
-  if (!priv->children)
+  if (!priv->children->len)
     return;
 
-  child_height = clutter_actor_get_height (priv->children->data);
-  i = g_list_index (priv->children, child);
+  child_height = priv->row_height;
+  i = mex_column_get_child_index (MEX_COLUMN (self), child);
 
   if (i >= 0)
     box->y1 += child_height * i;
@@ -111,14 +135,16 @@ content_box_open_notify (MexContentBox *box,
                          MexColumn     *column)
 {
   MexColumnPrivate *priv = MEX_COLUMN (column)->priv;
-  GList *l;
+  ClutterActor *child;
+  guint i;
 
   if (mex_content_box_get_open (box))
     {
-      for (l = priv->children; l; l = l->next)
+      for (i = 0; i < priv->children->len; i++)
         {
-          if (l->data != box)
-            clutter_actor_animate (l->data, CLUTTER_EASE_IN_OUT_QUAD, 200,
+          child = g_ptr_array_index (priv->children, i);
+          if (child && child != (ClutterActor *) box)
+            clutter_actor_animate (child, CLUTTER_EASE_IN_OUT_QUAD, 200,
                                    "opacity", 56, NULL);
         }
 
@@ -136,10 +162,12 @@ content_box_open_notify (MexContentBox *box,
   if (priv->open_boxes == 0)
     {
       /* restore all children to full opacity */
-      for (l = priv->children; l; l = l->next)
+      for (i = 0; i < priv->children->len; i++)
         {
-          clutter_actor_animate (l->data, CLUTTER_EASE_IN_OUT_QUAD, 200,
-                                 "opacity", 255, NULL);
+          child = g_ptr_array_index (priv->children, i);
+          if (child)
+            clutter_actor_animate (child, CLUTTER_EASE_IN_OUT_QUAD, 200,
+                                   "opacity", 255, NULL);
         }
     }
 
@@ -147,27 +175,25 @@ content_box_open_notify (MexContentBox *box,
 }
 
 /**
- * mex_column_add_content:
+ * mex_column_create_box:
  *
- * Add an item to the column for the specified content at the specified
- * position.
+ * Create the box of the row at the specified position.
  */
-static void
-mex_column_add_content (MexColumn  *column,
-                        MexContent *content,
-                        guint       position)
+static ClutterActor *
+mex_column_create_box (MexColumn *column,
+                       guint      position)
 {
   MexColumnPrivate *priv = column->priv;
   ClutterActor *box;
-  GList *sibling;
+  MexContent *content;
+
+  content = mex_model_get_content (priv->model, position);
 
   box = mex_content_box_new ();
   mex_content_view_set_content (MEX_CONTENT_VIEW (box), content);
   mex_content_view_set_context (MEX_CONTENT_VIEW (box), priv->model);
 
-  sibling = g_list_nth (priv->children, position);
-  priv->children = g_list_insert_before (priv->children, sibling, box);
-  priv->n_items ++;
+  g_ptr_array_index (priv->children, position) = box;
 
   g_signal_connect (box, "notify::open",
                     G_CALLBACK (content_box_open_notify), column);
@@ -175,7 +201,275 @@ mex_column_add_content (MexColumn  *column,
   /* set important if the column has focus */
   mex_content_box_set_important (MEX_CONTENT_BOX (box), TRUE);
 
+  /* match the boxes that are already there */
+  if (priv->open_boxes)
+    clutter_actor_set_opacity (box, 56);
+  else
+    clutter_actor_set_opacity (box, priv->child_opacity);
+
   clutter_actor_set_parent (box, CLUTTER_ACTOR (column));
+
+  if (priv->row_height == 0)
+    clutter_actor_get_preferred_height (box, -1, NULL, &priv->row_height);
+
+  return box;
+}
+
+/**
+ * mex_column_get_child:
+ *
+ * Get the box of the row at the specified position, creating it if needed.
+ */
+static ClutterActor *
+mex_column_get_child (MexColumn *column,
+                      guint      position)
+{
+  MexColumnPrivate *priv = column->priv;
+  ClutterActor *box;
+
+  if (position >= priv->children->len)
+    return NULL;
+
+  box = g_ptr_array_index (priv->children, position);
+  if (!box)
+    box = mex_column_create_box (column, position);
+
+  return box;
+}
+
+/**
+ * mex_column_get_row_at:
+ *
+ * Get the row at the specified vertical position in the column.
+ */
+static guint
+mex_column_get_row_at (MexColumn *column,
+                       gfloat     y)
+{
+  MexColumnPrivate *priv = column->priv;
+  guint low, high;
+
+  if (priv->children->len == 0)
+    return 0;
+
+  /* the offsets are updated when the column is allocated, guess from the
+   * height of a row until then */
+  if (priv->offsets->len != priv->children->len)
+    {
+      if (priv->row_height <= 0)
+        return 0;
+
+      return CLAMP (y / (priv->row_height + SPACING),
+                    0, priv->children->len - 1);
+    }
+
+  /* find the last row starting before y */
+  low = 0;
+  high = priv->offsets->len;
+  while (high - low > 1)
+    {
+      guint mid = (low + high) / 2;
+
+      if (g_array_index (priv->offsets, gfloat, mid) <= y)
+        low = mid;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+/**
+ * mex_column_get_visible_rows:
+ *
+ * Get the first and last rows between the specified vertical positions.
+ * Returns %FALSE if the column is empty.
+ */
+static gboolean
+mex_column_get_visible_rows (MexColumn *column,
+                             gfloat     y1,
+                             gfloat     y2,
+                             guint     *first,
+                             guint     *last)
+{
+  MexColumnPrivate *priv = column->priv;
+
+  if (priv->children->len == 0)
+    return FALSE;
+
+  if (!priv->adjustment)
+    {
+      *first = 0;
+      *last = priv->children->len - 1;
+      return TRUE;
+    }
+
+  *first = mex_column_get_row_at (column, y1);
+  *last = mex_column_get_row_at (column, y2);
+
+  return TRUE;
+}
+
+/**
+ * mex_column_ensure_rows:
+ *
+ * Create the boxes of the rows that are in view, or about to be.
+ * Returns %TRUE if any box was created.
+ */
+static gboolean
+mex_column_ensure_rows (MexColumn *column)
+{
+  MexColumnPrivate *priv = column->priv;
+  gdouble page_size = 0;
+  guint i, first, last;
+  gboolean created = FALSE;
+
+  if (!priv->model)
+    return FALSE;
+
+  /* half a page either side of the view so that scrolling doesn't show
+   * empty rows */
+  if (priv->adjustment)
+    page_size = mx_adjustment_get_page_size (priv->adjustment);
+
+  if (!mex_column_get_visible_rows (column,
+                                    priv->adjustment_value - page_size / 2,
+                                    priv->adjustment_value + page_size * 1.5,
+                                    &first, &last))
+    return FALSE;
+
+  for (i = first; i <= last; i++)
+    {
+      if (!g_ptr_array_index (priv->children, i))
+        {
+          mex_column_create_box (column, i);
+          created = TRUE;
+        }
+    }
+
+  return created;
+}
+
+/* Models that fetch their contents on demand need to know what is shown */
+static void
+mex_column_update_visible_contents (MexColumn *column)
+{
+  MexColumnPrivate *priv = column->priv;
+  guint first, last;
+
+  /* without an adjustment the column does not scroll */
+  if (!priv->model || !priv->adjustment)
+    return;
+
+  if (!mex_column_get_visible_rows (column,
+                                    priv->adjustment_value,
+                                    priv->adjustment_value +
+                                    mx_adjustment_get_page_size (priv->adjustment),
+                                    &first, &last))
+    return;
+
+  mex_model_set_visible_contents (priv->model,
+                                  mex_model_get_content (priv->model, first),
+                                  mex_model_get_content (priv->model, last));
+}
+
+static gboolean
+mex_column_ensure_rows_cb (MexColumn *column)
+{
+  column->priv->ensure_rows_id = 0;
+
+  if (mex_column_ensure_rows (column))
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (column));
+
+  mex_column_update_visible_contents (column);
+
+  return FALSE;
+}
+
+static void
+mex_column_queue_ensure_rows (MexColumn *column)
+{
+  MexColumnPrivate *priv = column->priv;
+
+  if (priv->ensure_rows_id)
+    return;
+
+  /* run before the next relayout */
+  priv->ensure_rows_id =
+    g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                     (GSourceFunc) mex_column_ensure_rows_cb,
+                     column, NULL);
+}
+
+/**
+ * mex_column_add_content:
+ *
+ * Add an item to the column for the specified content at the specified
+ * position.
+ */
+static void
+mex_column_add_content (MexColumn  *column,
+                        MexContent *content,
+                        guint       position)
+{
+  MexColumnPrivate *priv = column->priv;
+  gfloat offset;
+
+  position = MIN (position, priv->children->len);
+
+  /* keep the offsets in step with the rows until the next allocation */
+  if (priv->offsets->len == priv->children->len)
+    {
+      offset = (position < priv->offsets->len) ?
+        g_array_index (priv->offsets, gfloat, position) : 0;
+      g_array_insert_val (priv->offsets, position, offset);
+    }
+
+  g_ptr_array_add (priv->children, NULL);
+  if (position < priv->children->len - 1)
+    {
+      memmove (priv->children->pdata + position + 1,
+               priv->children->pdata + position,
+               (priv->children->len - position - 1) * sizeof (gpointer));
+      g_ptr_array_index (priv->children, position) = NULL;
+    }
+
+  /* without an adjustment all the rows are visible */
+  if (!priv->adjustment)
+    mex_column_create_box (column, position);
+  else
+    mex_column_queue_ensure_rows (column);
+}
+
+/**
+ * mex_column_remove_content:
+ *
+ * Remove the item at the specified position.
+ */
+static void
+mex_column_remove_content (MexColumn *column,
+                           guint      position)
+{
+  MexColumnPrivate *priv = column->priv;
+  ClutterActor *box;
+
+  if (position >= priv->children->len)
+    return;
+
+  box = g_ptr_array_index (priv->children, position);
+
+  if (priv->offsets->len == priv->children->len)
+    g_array_remove_index (priv->offsets, position);
+
+  g_ptr_array_remove_index (priv->children, position);
+
+  if (box)
+    {
+      if (box == priv->current_focus)
+        priv->current_focus = NULL;
+
+      clutter_actor_destroy (box);
+    }
 }
 
 
@@ -188,6 +482,8 @@ mex_column_adjustment_changed_cb (MexColumn *self)
 
   priv->adjustment_value = mx_adjustment_get_value (priv->adjustment);
   clutter_actor_queue_redraw (CLUTTER_ACTOR (self));
+
+  mex_column_queue_ensure_rows (self);
 }
 
 static void
@@ -220,6 +516,7 @@ mex_column_set_adjustments (MxScrollable *scrollable,
       priv->adjustment_value = mx_adjustment_get_value (priv->adjustment);
     }
 
+  mex_column_queue_ensure_rows (MEX_COLUMN (scrollable));
   clutter_actor_queue_relayout (CLUTTER_ACTOR (scrollable));
 }
 
@@ -261,15 +558,16 @@ mex_column_move_focus (MxFocusable      *focusable,
                        MxFocusable      *from)
 {
   MxFocusHint hint;
+  ClutterActor *child;
+  gint i;
 
-  GList *link_ = NULL;
   MexColumn *self = MEX_COLUMN (focusable);
   MexColumnPrivate *priv = self->priv;
 
   focusable = NULL;
 
-  link_ = g_list_find (priv->children, from);
-  if (!link_)
+  i = mex_column_get_child_index (self, CLUTTER_ACTOR (from));
+  if (i < 0)
     return NULL;
 
   switch (direction)
@@ -278,21 +576,19 @@ mex_column_move_focus (MxFocusable      *focusable,
     case MX_FOCUS_DIRECTION_UP:
       hint = (direction == MX_FOCUS_DIRECTION_PREVIOUS) ?
         MX_FOCUS_HINT_LAST : MX_FOCUS_HINT_FROM_BELOW;
-      link_ = g_list_previous (link_);
-      if (link_)
-        focusable = mx_focusable_accept_focus (
-                       MX_FOCUSABLE (link_->data), hint);
+      child = (i > 0) ? mex_column_get_child (self, i - 1) : NULL;
+      if (child)
+        focusable = mx_focusable_accept_focus (MX_FOCUSABLE (child), hint);
       break;
 
     case MX_FOCUS_DIRECTION_NEXT:
     case MX_FOCUS_DIRECTION_DOWN:
       hint = (direction == MX_FOCUS_DIRECTION_NEXT) ?
         MX_FOCUS_HINT_FIRST : MX_FOCUS_HINT_FROM_ABOVE;
-      link_ = g_list_next (link_);
+      child = mex_column_get_child (self, i + 1);
 
-      if (link_)
-        focusable = mx_focusable_accept_focus (
-                       MX_FOCUSABLE (link_->data), hint);
+      if (child)
+        focusable = mx_focusable_accept_focus (MX_FOCUSABLE (child), hint);
       break;
 
     case MX_FOCUS_DIRECTION_OUT:
@@ -313,7 +609,7 @@ static MxFocusable *
 mex_column_accept_focus (MxFocusable *focusable,
                          MxFocusHint  hint)
 {
-  GList *link_;
+  ClutterActor *child;
 
   MexColumn *self = MEX_COLUMN (focusable);
   MexColumnPrivate *priv = self->priv;
@@ -335,17 +631,18 @@ mex_column_accept_focus (MxFocusable *focusable,
 
     case MX_FOCUS_HINT_FIRST:
     case MX_FOCUS_HINT_FROM_ABOVE:
-      if (priv->n_items)
-        focusable = mx_focusable_accept_focus (
-                       MX_FOCUSABLE (priv->children->data), hint);
+      child = mex_column_get_child (self, 0);
+      if (child)
+        focusable = mx_focusable_accept_focus (MX_FOCUSABLE (child), hint);
       break;
 
     case MX_FOCUS_HINT_LAST:
     case MX_FOCUS_HINT_FROM_BELOW:
-      link_ = g_list_last (priv->children);
-      if (link_)
-        focusable = mx_focusable_accept_focus (
-                       MX_FOCUSABLE (link_->data), hint);
+      if (priv->children->len)
+        {
+          child = mex_column_get_child (self, priv->children->len - 1);
+          focusable = mx_focusable_accept_focus (MX_FOCUSABLE (child), hint);
+        }
       break;
     }
 
@@ -447,6 +744,11 @@ mex_column_get_property (GObject    *object,
 static void
 mex_column_finalize (GObject *object)
 {
+  MexColumnPrivate *priv = MEX_COLUMN (object)->priv;
+
+  g_ptr_array_free (priv->children, TRUE);
+  g_array_free (priv->offsets, TRUE);
+
   G_OBJECT_CLASS (mex_column_parent_class)->finalize (object);
 }
 
@@ -468,6 +770,12 @@ mex_column_dispose (GObject *object)
   /* unset the model and remove children */
   mex_column_set_model (MEX_COLUMN (object), NULL);
 
+  if (priv->ensure_rows_id)
+    {
+      g_source_remove (priv->ensure_rows_id);
+      priv->ensure_rows_id = 0;
+    }
+
   G_OBJECT_CLASS (mex_column_parent_class)->dispose (object);
 }
 
@@ -477,7 +785,7 @@ mex_column_get_preferred_width (ClutterActor *actor,
                                 gfloat       *min_width_p,
                                 gfloat       *nat_width_p)
 {
-  GList *c;
+  guint i;
   MxPadding padding;
   gfloat min_width = 0, nat_width = 0;
 
@@ -486,15 +794,18 @@ mex_column_get_preferred_width (ClutterActor *actor,
 
   for_height = -1;
 
-  if (priv->n_items > 0)
+  if (priv->children->len > 0)
     {
       min_width = nat_width = 0;
-      for_height /= (gfloat)priv->n_items;
+      for_height /= (gfloat)priv->children->len;
 
-      for (c = priv->children; c; c = c->next)
+      for (i = 0; i < priv->children->len; i++)
         {
           gfloat child_min_width, child_nat_width;
-          ClutterActor *child = c->data;
+          ClutterActor *child = g_ptr_array_index (priv->children, i);
+
+          if (!child)
+            continue;
 
           clutter_actor_get_preferred_width (child, for_height,
                                              &child_min_width,
@@ -521,7 +832,7 @@ mex_column_get_preferred_height (ClutterActor *actor,
                                  gfloat       *min_height_p,
                                  gfloat       *nat_height_p)
 {
-  GList *c;
+  guint i, n_items;
   gfloat min_height = 0, nat_height = 0;
   MxPadding padding;
 
@@ -533,13 +844,18 @@ mex_column_get_preferred_height (ClutterActor *actor,
   if (for_width >= 0)
     for_width = MAX (0, for_width - padding.left - padding.right);
 
-  if (priv->n_items > 0)
+  n_items = priv->children->len;
+
+  if (n_items > 0)
     {
       gfloat child_min_height, child_nat_height;
 
-      for (c = priv->children; c; c = c->next)
+      for (i = 0; i < n_items; i++)
         {
-          ClutterActor *child = c->data;
+          ClutterActor *child = g_ptr_array_index (priv->children, i);
+
+          if (!child)
+            continue;
 
           clutter_actor_get_preferred_height (child, for_width,
                                               &child_min_height,
@@ -555,10 +871,10 @@ mex_column_get_preferred_height (ClutterActor *actor,
 
   if (min_height_p)
     *min_height_p = min_height + padding.top + padding.bottom
-      + (priv->n_items > 0) ? (SPACING * priv->n_items - 1) : 0;
+      + (n_items > 0) ? (SPACING * n_items - 1) : 0;
   if (nat_height_p)
     *nat_height_p += nat_height + padding.top + padding.bottom
-      + (priv->n_items > 0) ? (SPACING * priv->n_items - 1) : 0;
+      + (n_items > 0) ? (SPACING * n_items - 1) : 0;
 }
 
 static void
@@ -568,11 +884,13 @@ mex_column_allocate (ClutterActor          *actor,
 {
   ClutterActorBox child_box;
   MxPadding padding;
-  GList *c;
+  guint i, first, last;
 
   MexColumn *column = MEX_COLUMN (actor);
   MexColumnPrivate *priv = column->priv;
 
+  mex_frame_profiler_begin_actor (actor);
+
   CLUTTER_ACTOR_CLASS (mex_column_parent_class)->allocate (actor, box, flags);
 
   mx_widget_get_padding (MX_WIDGET (actor), &padding);
@@ -582,7 +900,9 @@ mex_column_allocate (ClutterActor          *actor,
   child_box.y1 = padding.top;
   child_box.y2 = box->y2 - box->y1 - padding.bottom;
 
-  if (priv->n_items)
+  g_array_set_size (priv->offsets, priv->children->len);
+
+  if (priv->children->len)
     {
       /* Calculate child height multiplier */
       gfloat width, pref_height, avail_height, ratio, remainder;
@@ -607,13 +927,18 @@ mex_column_allocate (ClutterActor          *actor,
       remainder = 0;
       width = child_box.x2 - child_box.x1;
 
-      for (c = priv->children; c; c = c->next)
+      for (i = 0; i < priv->children->len; i++)
         {
           gfloat min_height, nat_height, height;
-          ClutterActor *child = c->data;
+          ClutterActor *child = g_ptr_array_index (priv->children, i);
 
-          clutter_actor_get_preferred_height (child, width,
-                                              &min_height, &nat_height);
+          /* rows that haven't been shown yet take the height of a
+           * closed box */
+          if (child)
+            clutter_actor_get_preferred_height (child, width,
+                                                &min_height, &nat_height);
+          else
+            min_height = nat_height = priv->row_height;
 
           /* Calculate the allocatable height and keep an accumulator so
            * when we round to a pixel, we don't end up with a lot of
@@ -631,7 +956,9 @@ mex_column_allocate (ClutterActor          *actor,
 
           /* Allocate the child */
           child_box.y2 = child_box.y1 + height;
-          clutter_actor_allocate (child, &child_box, flags);
+          g_array_index (priv->offsets, gfloat, i) = child_box.y1;
+          if (child)
+            clutter_actor_allocate (child, &child_box, flags);
 
           /* Set the top position of the next child box */
           child_box.y1 = child_box.y2 + SPACING;
@@ -649,7 +976,23 @@ mex_column_allocate (ClutterActor          *actor,
                                 1.0,
                                 page_size,
                                 page_size);
+
+      /* Create the boxes that have scrolled into view */
+      if (mex_column_get_visible_rows (column,
+                                       priv->adjustment_value,
+                                       priv->adjustment_value + page_size,
+                                       &first, &last))
+        {
+          for (i = first; i <= last; i++)
+            if (!g_ptr_array_index (priv->children, i))
+              {
+                mex_column_queue_ensure_rows (column);
+                break;
+              }
+        }
     }
+
+  mex_frame_profiler_end_actor (actor);
 }
 
 static void
@@ -669,13 +1012,15 @@ mex_column_apply_transform (ClutterActor *actor,
 static void
 mex_column_paint (ClutterActor *actor)
 {
-  GList *c;
+  guint i, first, last;
   MxPadding padding;
   ClutterActorBox box;
 
   MexColumn *self = MEX_COLUMN (actor);
   MexColumnPrivate *priv = self->priv;
 
+  mex_frame_profiler_begin_actor (actor);
+
   CLUTTER_ACTOR_CLASS (mex_column_parent_class)->paint (actor);
 
   mx_widget_get_padding (MX_WIDGET (actor), &padding);
@@ -687,11 +1032,20 @@ mex_column_paint (ClutterActor *actor)
                             box.y2 - box.y1 - padding.bottom +
                             priv->adjustment_value);
 
-  for (c = priv->children; c; c = c->next)
+  if (mex_column_get_visible_rows (self,
+                                   padding.top + priv->adjustment_value,
+                                   box.y2 - box.y1 - padding.bottom +
+                                   priv->adjustment_value,
+                                   &first, &last))
     {
-      /* skip the current focus and paint it last*/
-      if (priv->current_focus != c->data)
-        clutter_actor_paint (c->data);
+      for (i = first; i <= last; i++)
+        {
+          ClutterActor *child = g_ptr_array_index (priv->children, i);
+
+          /* skip the current focus and paint it last*/
+          if (child && priv->current_focus != child)
+            clutter_actor_paint (child);
+        }
     }
 
   /* paint the current focused actor last to ensure it is drawn on top of other
@@ -700,12 +1054,14 @@ mex_column_paint (ClutterActor *actor)
     clutter_actor_paint (priv->current_focus);
 
   cogl_clip_pop ();
+
+  mex_frame_profiler_end_actor (actor);
 }
 
 static void
 mex_column_pick (ClutterActor *actor, const ClutterColor *color)
 {
-  GList *c;
+  guint i, first, last;
   gdouble value;
   MxPadding padding;
   ClutterActorBox box;
@@ -727,8 +1083,19 @@ mex_column_pick (ClutterActor *actor, const ClutterColor *color)
                             box.x2 - box.x1 - padding.right,
                             box.y2 - box.y1 - padding.bottom + value);
 
-  for (c = priv->children; c; c = c->next)
-    clutter_actor_paint (c->data);
+  if (mex_column_get_visible_rows (self,
+                                   padding.top + value,
+                                   box.y2 - box.y1 - padding.bottom + value,
+                                   &first, &last))
+    {
+      for (i = first; i <= last; i++)
+        {
+          ClutterActor *child = g_ptr_array_index (priv->children, i);
+
+          if (child)
+            clutter_actor_paint (child);
+        }
+    }
 
   cogl_clip_pop ();
 }
@@ -880,7 +1247,11 @@ mex_column_class_init (MexColumnClass *klass)
 static void
 mex_column_init (MexColumn *self)
 {
-  self->priv = GET_PRIVATE (self);
+  MexColumnPrivate *priv = self->priv = GET_PRIVATE (self);
+
+  priv->children = g_ptr_array_new ();
+  priv->offsets = g_array_new (FALSE, FALSE, sizeof (gfloat));
+  priv->child_opacity = 255;
 
   clutter_actor_set_reactive (CLUTTER_ACTOR (self), TRUE);
 }
@@ -893,13 +1264,24 @@ mex_column_init (MexColumn *self)
 static void
 mex_column_populate (MexColumn *column)
 {
-  MexContent *content;
-  gint i = 0;
+  MexColumnPrivate *priv = column->priv;
+  guint i, length;
+
+  g_return_if_fail (priv->model != NULL);
 
-  g_return_if_fail (column->priv->model != NULL);
+  /* the rows are appended so the boxes can be created afterwards in one
+   * go */
+  length = mex_model_get_length (priv->model);
+  g_ptr_array_set_size (priv->children, length);
+  g_array_set_size (priv->offsets, 0);
 
-  while ((content = mex_model_get_content (column->priv->model, i)))
-    mex_column_add_content (column, content, i++);
+  if (!priv->adjustment)
+    {
+      for (i = 0; i < length; i++)
+        mex_column_create_box (column, i);
+    }
+  else
+    mex_column_ensure_rows (column);
 }
 
 /**
@@ -911,13 +1293,19 @@ static void
 mex_column_clear (MexColumn *column)
 {
   MexColumnPrivate *priv = column->priv;
+  guint i;
 
-  while (priv->children)
+  for (i = 0; i < priv->children->len; i++)
     {
-      clutter_actor_destroy (CLUTTER_ACTOR (priv->children->data));
-      priv->children = g_list_delete_link (priv->children, priv->children);
+      ClutterActor *child = g_ptr_array_index (priv->children, i);
+
+      if (child)
+        clutter_actor_destroy (child);
     }
 
+  g_ptr_array_set_size (priv->children, 0);
+  g_array_set_size (priv->offsets, 0);
+
   priv->current_focus = NULL;
 }
 
@@ -958,17 +1346,9 @@ mex_column_controller_changed (GController          *controller,
     case G_CONTROLLER_REMOVE:
       for (i = 0; i < n_indices; i++)
         {
-          GList *lnk;
-
           gint content_index = g_controller_reference_get_index_uint (ref, i);
 
-          lnk = g_list_nth (priv->children, content_index);
-
-          if (lnk->data == priv->current_focus)
-            priv->current_focus = NULL;
-
-          clutter_actor_destroy (lnk->data);
-          priv->children = g_list_delete_link (priv->children, lnk);
+          mex_column_remove_content (column, content_index);
         }
       is_empty = mex_column_is_empty (column);
       break;
@@ -1014,7 +1394,7 @@ gboolean
 mex_column_is_empty (MexColumn *column)
 {
   g_return_val_if_fail (MEX_IS_COLUMN (column), TRUE);
-  return (column->priv->children == NULL);
+  return (column->priv->children->len == 0);
 }
 
 gboolean
@@ -1103,8 +1483,104 @@ void
 mex_column_set_child_opacity (MexColumn *column,
                               guchar     opacity)
 {
-  GList *l;
+  MexColumnPrivate *priv = column->priv;
+  guint i;
 
-  for (l = column->priv->children; l; l = g_list_next (l))
-    clutter_actor_set_opacity (l->data, opacity);
+  priv->child_opacity = opacity;
+
+  for (i = 0; i < priv->children->len; i++)
+    {
+      ClutterActor *child = g_ptr_array_index (priv->children, i);
+
+      if (child)
+        clutter_actor_set_opacity (child, opacity);
+    }
 }
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-generic-model.h"
+#include "mex-program.h"
+#include "mex-test-internal.h"
+
+static guint column_lengths[] = { 100, 1000, 10000, 50000 };
+
+static guint
+_test_column_n_boxes (MexColumn *column)
+{
+  GPtrArray *children = column->priv->children;
+  guint i, n_boxes = 0;
+
+  for (i = 0; i < children->len; i++)
+    if (g_ptr_array_index (children, i))
+      n_boxes++;
+
+  return n_boxes;
+}
+
+void
+mex_test_column_populate (void)
+{
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (column_lengths); n++)
+    {
+      ClutterActor *column;
+      MxAdjustment *adjustment;
+      MexModel *model;
+      gdouble populate_time, remove_time;
+      guint i, length = column_lengths[n];
+
+      /* only the smallest column is checked without -m perf */
+      if (n > 0 && !g_test_perf ())
+        break;
+
+      model = mex_generic_model_new ("column", NULL);
+      for (i = 0; i < length; i++)
+        {
+          MexProgram *program = mex_program_new (NULL);
+          mex_model_add_content (model, MEX_CONTENT (program));
+        }
+
+      column = mex_column_new ();
+      g_object_ref_sink (column);
+      adjustment = mx_adjustment_new ();
+      mx_scrollable_set_adjustments (MX_SCROLLABLE (column), NULL, adjustment);
+
+      g_test_timer_start ();
+      mex_column_set_model (MEX_COLUMN (column), model);
+      populate_time = g_test_timer_elapsed ();
+
+      /* boxes are only created for the rows in view */
+      g_assert_cmpuint (MEX_COLUMN (column)->priv->children->len, ==, length);
+      g_assert_cmpuint (_test_column_n_boxes (MEX_COLUMN (column)), <, length);
+
+      /* remove every other row, then the rest from the top */
+      g_test_timer_start ();
+      for (i = 0; i < length / 2; i++)
+        {
+          MexContent *content = mex_model_get_content (model, i);
+          mex_model_remove_content (model, content);
+        }
+      while (mex_model_get_length (model))
+        {
+          MexContent *content = mex_model_get_content (model, 0);
+          mex_model_remove_content (model, content);
+        }
+      remove_time = g_test_timer_elapsed ();
+
+      g_assert (mex_column_is_empty (MEX_COLUMN (column)));
+
+      g_test_minimized_result (populate_time, "populating %u rows in %f s",
+                               length, populate_time);
+      g_test_minimized_result (remove_time, "removing %u rows in %f s",
+                               length, remove_time);
+
+      mex_column_set_model (MEX_COLUMN (column), NULL);
+      g_object_unref (adjustment);
+      g_object_unref (column);
+      g_object_unref (model);
+    }
+}
+
+#endif /* ENABLE_TESTS */
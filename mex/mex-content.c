@@ -318,7 +318,6 @@ mex_content_set_last_used_metadatas (MexContent *content)
   guint count;
   gchar str[20], *nstr;
   const gchar *play_count;
-  GDateTime *datetime;
   GTimeVal tv;
 
   play_count = mex_content_get_metadata (content,
@@ -331,20 +330,13 @@ mex_content_set_last_used_metadatas (MexContent *content)
   snprintf (str, sizeof (str), "%u", count);
   mex_content_set_metadata (content, MEX_CONTENT_METADATA_PLAY_COUNT, str);
 
-  datetime = g_date_time_new_now_local ();
-  if (datetime) {
-    if (g_date_time_to_timeval (datetime, &tv)) {
-      tv.tv_usec = 0;
-      nstr = g_time_val_to_iso8601 (&tv);
-      if (nstr) {
-        mex_content_set_metadata (content,
-                                  MEX_CONTENT_METADATA_LAST_PLAYED_DATE,
-                                  nstr);
-        g_free (nstr);
-      }
-    }
-    g_date_time_unref (datetime);
-  }
+  /* no need for a GDateTime to get the current time in UTC */
+  g_get_current_time (&tv);
+  tv.tv_usec = 0;
+  nstr = g_time_val_to_iso8601 (&tv);
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_LAST_PLAYED_DATE,
+                            nstr);
+  g_free (nstr);
 }
 
 const gchar *
@@ -16,6 +16,8 @@
  * along with this program; if not, see <http://www.gnu.org/licenses>
  */
 
+#include <string.h>
+
 #include "mex-epg-manager.h"
 
 #include "mex-log.h"
@@ -23,6 +25,18 @@
 #define MEX_LOG_DOMAIN_DEFAULT  epg_log_domain
 MEX_LOG_DOMAIN_EXTERN(epg_log_domain);
 
+/*
+ * With several providers, a query is sent to all of them at once and their
+ * answers are merged: an event overlapping an event of a provider added
+ * before it is the same broadcast if both have the same title or if they
+ * overlap for more than half of the shorter one, and the event of the
+ * first provider is kept. The merged events are delivered once every
+ * provider has answered, or when EPG_PROVIDER_TIMEOUT expires, without
+ * the events of the providers that are late.
+ */
+
+#define EPG_PROVIDER_TIMEOUT  5000  /* ms */
+
 G_DEFINE_TYPE (MexEpgManager, mex_epg_manager, G_TYPE_OBJECT)
 
 #define EPG_MANAGER_PRIVATE(o)				      \
@@ -46,13 +60,42 @@ typedef struct _Request
   gpointer user_data;
 } Request;
 
+typedef struct _FanOut
+{
+  gint ref_count;
+  MexEpgManager *manager;
+  MexChannel *channel;
+  MexEpgManagerReply callback;
+  gpointer user_data;
+
+  GPtrArray *providers;
+  GPtrArray **events;       /* the answer of each provider */
+  guint n_pending;
+  guint timeout_id;
+  guint replied : 1;
+} FanOut;
+
+typedef struct
+{
+  FanOut *fan_out;
+  guint   index;
+} FanOutSlot;
+
 struct _MexEpgManagerPrivate
 {
   gint wait_for_providers;
   GPtrArray *providers;
   GQueue *requests;
+  guint provider_timeout;
 };
 
+static void mex_epg_manager_fan_out (MexEpgManager      *manager,
+                                     MexChannel         *channel,
+                                     GDateTime          *start_date,
+                                     GDateTime          *end_date,
+                                     MexEpgManagerReply  reply,
+                                     gpointer            user_data);
+
 static guint signals[LAST_SIGNAL] = { 0, };
 
 static gboolean
@@ -81,29 +124,337 @@ on_manager_ready (MexEpgManager *manager,
                   gpointer       user_data)
 {
   MexEpgManagerPrivate *priv = manager->priv;
-  MexEpgProvider *provider;
   Request *req;
 
   req = g_queue_pop_tail (priv->requests);
   while (req)
     {
-      if (priv->providers->len > 1)
+      mex_epg_manager_fan_out (manager, req->channel,
+                               req->start_date, req->end_date,
+                               req->callback, req->user_data);
+
+      free_request (req, NULL);
+      req = g_queue_pop_tail (priv->requests);
+    }
+}
+
+/*
+ * Merging the events of several providers
+ */
+
+static gchar *
+event_dup_title (MexEpgEvent *event)
+{
+  MexProgram *program;
+  const gchar *title;
+
+  program = mex_epg_event_get_program (event);
+  if (program == NULL)
+    return NULL;
+
+  title = mex_content_get_metadata (MEX_CONTENT (program),
+                                    MEX_CONTENT_METADATA_TITLE);
+  if (title == NULL)
+    return NULL;
+
+  return g_utf8_casefold (title, -1);
+}
+
+typedef struct
+{
+  MexEpgEvent *event;
+  guint        rank;        /* index of the provider */
+  gint64       start, end;  /* in seconds since the epoch */
+  gchar       *title;       /* casefolded */
+} MergeItem;
+
+static gint
+merge_item_compare (gconstpointer a,
+                    gconstpointer b)
+{
+  const MergeItem *item_a = a, *item_b = b;
+
+  if (item_a->start != item_b->start)
+    return item_a->start < item_b->start ? -1 : 1;
+
+  return (gint) item_a->rank - (gint) item_b->rank;
+}
+
+static gboolean
+merge_item_same_broadcast (const MergeItem *a,
+                           const MergeItem *b)
+{
+  gint64 overlap, shortest;
+
+  overlap = MIN (a->end, b->end) - MAX (a->start, b->start);
+  if (overlap <= 0)
+    return FALSE;
+
+  if (a->title && b->title && strcmp (a->title, b->title) == 0)
+    return TRUE;
+
+  shortest = MIN (a->end - a->start, b->end - b->start);
+
+  return overlap * 2 > shortest;
+}
+
+/* transfer full */
+static GPtrArray *
+mex_epg_manager_merge_events (GPtrArray **events,
+                              guint       n_providers)
+{
+  GArray *items, *kept;
+  GPtrArray *merged;
+  guint i, j;
+
+  items = g_array_new (FALSE, FALSE, sizeof (MergeItem));
+
+  for (i = 0; i < n_providers; i++)
+    {
+      if (events[i] == NULL)
+        continue;
+
+      for (j = 0; j < events[i]->len; j++)
         {
-          MEX_WARNING ("Having more than 1 EPG provider but don't know how "
-                       "to merge the results for multiple providers just yet. "
-                       "Using the first one");
+          MergeItem item;
+          GDateTime *start;
+
+          item.event = g_ptr_array_index (events[i], j);
+          item.rank = i;
+
+          start = mex_epg_event_get_start_date (item.event);
+          if (start == NULL)
+            continue;
+
+          item.start = g_date_time_to_unix (start);
+          item.end = item.start + mex_epg_event_get_duration (item.event);
+          item.title = event_dup_title (item.event);
+
+          g_array_append_val (items, item);
         }
+    }
 
-      provider = g_ptr_array_index (priv->providers, 0);
-      mex_epg_provider_get_events (provider, req->channel,
-                                   req->start_date, req->end_date,
-                                   req->callback, req->user_data);
+  g_array_sort (items, merge_item_compare);
 
-      free_request (req, NULL);
-      req = g_queue_pop_tail (priv->requests);
+  kept = g_array_sized_new (FALSE, FALSE, sizeof (MergeItem), items->len);
+
+  for (i = 0; i < items->len; i++)
+    {
+      MergeItem *item = &g_array_index (items, MergeItem, i);
+      gboolean duplicate = FALSE;
+
+      /* the kept events are sorted by start date, only the last ones can
+       * overlap with this one */
+      for (j = kept->len; j > 0; j--)
+        {
+          MergeItem *other = &g_array_index (kept, MergeItem, j - 1);
+
+          if (item->start - other->start > 24 * 60 * 60)
+            break;
+
+          if (!merge_item_same_broadcast (item, other))
+            continue;
+
+          duplicate = TRUE;
+
+          /* the first providers have the last word */
+          if (item->rank < other->rank)
+            {
+              g_free (other->title);
+              *other = *item;
+              item->title = NULL;
+            }
+          break;
+        }
+
+      if (duplicate)
+        g_free (item->title);
+      else
+        g_array_append_val (kept, *item);
     }
 
+  g_array_sort (kept, merge_item_compare);
+
+  merged = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < kept->len; i++)
+    {
+      MergeItem *item = &g_array_index (kept, MergeItem, i);
+
+      g_ptr_array_add (merged, g_object_ref (item->event));
+      g_free (item->title);
+    }
 
+  g_array_free (kept, TRUE);
+  g_array_free (items, TRUE);
+
+  return merged;
+}
+
+/*
+ * Fan out
+ */
+
+static void
+fan_out_unref (FanOut *fan_out)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&fan_out->ref_count))
+    return;
+
+  for (i = 0; i < fan_out->providers->len; i++)
+    if (fan_out->events[i])
+      g_ptr_array_unref (fan_out->events[i]);
+  g_free (fan_out->events);
+
+  g_ptr_array_unref (fan_out->providers);
+  g_object_unref (fan_out->manager);
+  g_slice_free (FanOut, fan_out);
+}
+
+static void
+fan_out_reply (FanOut *fan_out)
+{
+  MexEpgProvider *provider = NULL;
+  GPtrArray *merged;
+  guint i, n_answers = 0;
+
+  if (fan_out->replied)
+    return;
+
+  fan_out->replied = TRUE;
+
+  if (fan_out->timeout_id)
+    {
+      g_source_remove (fan_out->timeout_id);
+      fan_out->timeout_id = 0;
+    }
+
+  for (i = 0; i < fan_out->providers->len; i++)
+    {
+      if (fan_out->events[i] == NULL || fan_out->events[i]->len == 0)
+        continue;
+
+      provider = g_ptr_array_index (fan_out->providers, i);
+      n_answers++;
+    }
+
+  merged = mex_epg_manager_merge_events (fan_out->events,
+                                         fan_out->providers->len);
+
+  /* there's no single provider for merged events */
+  fan_out->callback (n_answers == 1 ? provider : NULL,
+                     fan_out->channel, merged, fan_out->user_data);
+
+  g_ptr_array_unref (merged);
+
+  /* the reference held for the reply */
+  fan_out_unref (fan_out);
+}
+
+static gboolean
+on_fan_out_timeout (FanOut *fan_out)
+{
+  guint i;
+
+  fan_out->timeout_id = 0;
+
+  for (i = 0; i < fan_out->providers->len; i++)
+    if (fan_out->events[i] == NULL)
+      MEX_WARNING ("EPG provider %s did not answer in time, skipping it",
+                   G_OBJECT_TYPE_NAME (g_ptr_array_index (fan_out->providers,
+                                                          i)));
+
+  fan_out_reply (fan_out);
+
+  return FALSE;
+}
+
+static void
+on_fan_out_provider_reply (MexEpgProvider *provider,
+                           MexChannel     *channel,
+                           GPtrArray      *events,
+                           gpointer        user_data)
+{
+  FanOutSlot *slot = user_data;
+  FanOut *fan_out = slot->fan_out;
+
+  if (!fan_out->replied)
+    {
+      /* the events are only lent to us */
+      fan_out->events[slot->index] = events ?
+        g_ptr_array_ref (events) :
+        g_ptr_array_new_with_free_func (g_object_unref);
+
+      fan_out->n_pending--;
+      if (fan_out->n_pending == 0)
+        fan_out_reply (fan_out);
+    }
+
+  g_slice_free (FanOutSlot, slot);
+  fan_out_unref (fan_out);
+}
+
+static void
+mex_epg_manager_fan_out (MexEpgManager      *manager,
+                         MexChannel         *channel,
+                         GDateTime          *start_date,
+                         GDateTime          *end_date,
+                         MexEpgManagerReply  reply,
+                         gpointer            user_data)
+{
+  MexEpgManagerPrivate *priv = manager->priv;
+  FanOut *fan_out;
+  guint i;
+
+  /* nothing to merge */
+  if (priv->providers->len == 1)
+    {
+      mex_epg_provider_get_events (g_ptr_array_index (priv->providers, 0),
+                                   channel, start_date, end_date,
+                                   reply, user_data);
+      return;
+    }
+
+  fan_out = g_slice_new0 (FanOut);
+  fan_out->ref_count = 1;
+  fan_out->manager = g_object_ref (manager);
+  fan_out->channel = channel;
+  fan_out->callback = reply;
+  fan_out->user_data = user_data;
+  fan_out->providers = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < priv->providers->len; i++)
+    g_ptr_array_add (fan_out->providers,
+                     g_object_ref (g_ptr_array_index (priv->providers, i)));
+  fan_out->events = g_new0 (GPtrArray *, priv->providers->len);
+  fan_out->n_pending = priv->providers->len;
+
+  fan_out->timeout_id =
+    g_timeout_add (priv->provider_timeout,
+                   (GSourceFunc) on_fan_out_timeout, fan_out);
+
+  /* one reference is dropped with the reply, each provider holds one until
+   * it answers (a provider that never answers leaks this small structure)
+   * and one is held while sending the requests, some providers answer
+   * straight away */
+  g_atomic_int_inc (&fan_out->ref_count);
+
+  for (i = 0; i < fan_out->providers->len; i++)
+    {
+      FanOutSlot *slot;
+
+      slot = g_slice_new (FanOutSlot);
+      slot->fan_out = fan_out;
+      slot->index = i;
+
+      g_atomic_int_inc (&fan_out->ref_count);
+
+      mex_epg_provider_get_events (g_ptr_array_index (fan_out->providers, i),
+                                   channel, start_date, end_date,
+                                   on_fan_out_provider_reply, slot);
+    }
+
+  fan_out_unref (fan_out);
 }
 
 /*
@@ -178,6 +529,7 @@ mex_epg_manager_init (MexEpgManager *self)
 
   priv->providers = g_ptr_array_new_with_free_func (g_object_unref);
   priv->requests = g_queue_new ();
+  priv->provider_timeout = EPG_PROVIDER_TIMEOUT;
 
   g_signal_connect (self, "ready",
                     G_CALLBACK (on_manager_ready), NULL);
@@ -241,7 +593,10 @@ mex_epg_manager_add_provider (MexEpgManager  *manager,
  * @reply: a callback to call when the data is ready
  *
  * Query the @manager for EPG events between @start_data and @end_date. The
- * query is asynchronous and @reply is called with the results.
+ * query is asynchronous and @reply is called with the results. When there
+ * are several providers, they are all queried and @reply is called once
+ * with their merged events, and a %NULL provider if more than one of them
+ * had events.
  *
  * <note>The resulting array of #MexEpgEvents is owned by the library,
  * you need to take a reference to the array and/or some or all of the elements
@@ -258,7 +613,6 @@ mex_epg_manager_get_events (MexEpgManager      *manager,
                             gpointer            user_data)
 {
   MexEpgManagerPrivate *priv;
-  MexEpgProvider *provider;
   Request *req;
 
   g_return_if_fail (MEX_IS_EPG_MANAGER (manager));
@@ -266,16 +620,8 @@ mex_epg_manager_get_events (MexEpgManager      *manager,
 
   if (mex_epg_manager_ready (manager))
     {
-      if (priv->providers->len > 1)
-        {
-          MEX_WARNING ("Having more than 1 EPG provider but don't know how "
-                       "to merge the results for multiple providers just yet. "
-                       "Using the first one");
-        }
-
-      provider = g_ptr_array_index (priv->providers, 0);
-      mex_epg_provider_get_events (provider, channel, start_date, end_date,
-                                   reply, user_data);
+      mex_epg_manager_fan_out (manager, channel, start_date, end_date,
+                               reply, user_data);
     }
   else
     {
@@ -306,3 +652,260 @@ mex_epg_manager_get_event_now (MexEpgManager      *manager,
   mex_epg_manager_get_events (manager, channel, now, now, reply, user_data);
   g_date_time_unref (now);
 }
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-test-internal.h"
+
+/* in-process providers answering from the main loop after @delay ms with
+ * a fixed list of events, or never answering */
+
+typedef struct
+{
+  const gchar *title;
+  gint         hour, minute;
+  gint         duration;    /* minutes */
+} StubEvent;
+
+typedef struct
+{
+  GObject parent;
+
+  const StubEvent *events;
+  guint            n_events;
+  gint             delay;   /* ms, -1 never answers */
+} StubProvider;
+
+typedef GObjectClass StubProviderClass;
+
+static void stub_provider_iface_init (MexEpgProviderInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (StubProvider, stub_provider, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (MEX_TYPE_EPG_PROVIDER,
+                                                stub_provider_iface_init))
+
+typedef struct
+{
+  StubProvider        *provider;
+  MexChannel          *channel;
+  MexEpgProviderReply  reply;
+  gpointer             user_data;
+} StubRequest;
+
+static gboolean
+stub_provider_reply_cb (StubRequest *req)
+{
+  GPtrArray *events;
+  guint i;
+
+  events = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < req->provider->n_events; i++)
+    {
+      const StubEvent *stub = &req->provider->events[i];
+      MexEpgEvent *event;
+      MexProgram *program;
+
+      event = mex_epg_event_new_local (2011, 6, 1, stub->hour, stub->minute,
+                                       0, stub->duration * 60);
+      program = g_object_new (MEX_TYPE_PROGRAM, NULL);
+      mex_content_set_metadata (MEX_CONTENT (program),
+                                MEX_CONTENT_METADATA_TITLE, stub->title);
+      mex_epg_event_set_program (event, program);
+      g_object_unref (program);
+
+      g_ptr_array_add (events, event);
+    }
+
+  req->reply (MEX_EPG_PROVIDER (req->provider), req->channel, events,
+              req->user_data);
+
+  /* the events only belong to the provider */
+  g_ptr_array_unref (events);
+  g_slice_free (StubRequest, req);
+
+  return FALSE;
+}
+
+static gboolean
+stub_provider_is_ready (MexEpgProvider *provider)
+{
+  return TRUE;
+}
+
+static void
+stub_provider_get_events (MexEpgProvider      *provider,
+                          MexChannel          *channel,
+                          GDateTime           *start_date,
+                          GDateTime           *end_date,
+                          MexEpgProviderReply  reply,
+                          gpointer             user_data)
+{
+  StubProvider *stub = (StubProvider *) provider;
+  StubRequest *req;
+
+  if (stub->delay < 0)
+    return;
+
+  req = g_slice_new (StubRequest);
+  req->provider = stub;
+  req->channel = channel;
+  req->reply = reply;
+  req->user_data = user_data;
+
+  g_timeout_add (stub->delay, (GSourceFunc) stub_provider_reply_cb, req);
+}
+
+static void
+stub_provider_iface_init (MexEpgProviderInterface *iface)
+{
+  iface->is_ready = stub_provider_is_ready;
+  iface->get_events = stub_provider_get_events;
+}
+
+static void
+stub_provider_class_init (StubProviderClass *klass)
+{
+}
+
+static void
+stub_provider_init (StubProvider *self)
+{
+}
+
+static MexEpgProvider *
+stub_provider_new (const StubEvent *events,
+                   guint            n_events,
+                   gint             delay)
+{
+  StubProvider *stub;
+
+  stub = g_object_new (stub_provider_get_type (), NULL);
+  stub->events = events;
+  stub->n_events = n_events;
+  stub->delay = delay;
+
+  return MEX_EPG_PROVIDER (stub);
+}
+
+/* EIT data, accurate but with short titles */
+static const StubEvent dvb_events[] =
+{
+  { "News", 20, 0, 30 },
+  { "Film", 20, 30, 120 },
+  { "Weather", 22, 30, 5 },
+};
+
+/* listings, with a few more programs and slightly different schedules */
+static const StubEvent listings_events[] =
+{
+  { "news", 20, 2, 28 },
+  { "Film: The Director's Cut", 20, 35, 115 },
+  { "Late Show", 22, 35, 60 },
+  { "Night Film", 23, 35, 90 },
+};
+
+static const gchar *expected_titles[] =
+{
+  "News", "Film", "Weather", "Late Show", "Night Film"
+};
+
+typedef struct
+{
+  GMainLoop *loop;
+  GPtrArray *events;
+  MexEpgProvider *provider;
+  guint n_replies;
+} TestReply;
+
+static void
+on_merged_events (MexEpgProvider *provider,
+                  MexChannel     *channel,
+                  GPtrArray      *events,
+                  gpointer        user_data)
+{
+  TestReply *reply = user_data;
+
+  reply->n_replies++;
+  reply->provider = provider;
+  reply->events = g_ptr_array_ref (events);
+
+  g_main_loop_quit (reply->loop);
+}
+
+static gboolean
+test_quit_cb (GMainLoop *loop)
+{
+  g_main_loop_quit (loop);
+
+  return FALSE;
+}
+
+void
+mex_test_epg_manager_merge (void)
+{
+  MexEpgManager *manager;
+  MexChannel *channel;
+  GDateTime *start, *end;
+  TestReply reply = { 0, };
+  guint i;
+
+  manager = g_object_new (MEX_TYPE_EPG_MANAGER, NULL);
+  manager->priv->provider_timeout = 500;
+
+  /* the first provider has the last word, but answers last */
+  mex_epg_manager_add_provider (manager,
+                                stub_provider_new (dvb_events,
+                                                   G_N_ELEMENTS (dvb_events),
+                                                   50));
+  mex_epg_manager_add_provider (manager,
+                                stub_provider_new (listings_events,
+                                                   G_N_ELEMENTS (listings_events),
+                                                   10));
+  /* and a third one never answers */
+  mex_epg_manager_add_provider (manager, stub_provider_new (NULL, 0, -1));
+
+  channel = mex_channel_new ();
+  start = g_date_time_new_local (2011, 6, 1, 20, 0, 0);
+  end = g_date_time_new_local (2011, 6, 2, 1, 0, 0);
+
+  reply.loop = g_main_loop_new (NULL, FALSE);
+  mex_epg_manager_get_events (manager, channel, start, end,
+                              on_merged_events, &reply);
+
+  /* the guide is not held back by the silent provider forever */
+  g_main_loop_run (reply.loop);
+
+  g_assert_cmpuint (reply.n_replies, ==, 1);
+  g_assert (reply.provider == NULL);
+  g_assert_cmpuint (reply.events->len, ==, G_N_ELEMENTS (expected_titles));
+
+  for (i = 0; i < reply.events->len; i++)
+    {
+      MexEpgEvent *event = g_ptr_array_index (reply.events, i);
+      MexProgram *program = mex_epg_event_get_program (event);
+
+      g_assert_cmpstr (mex_content_get_metadata (MEX_CONTENT (program),
+                                                 MEX_CONTENT_METADATA_TITLE),
+                       ==, expected_titles[i]);
+    }
+
+  /* the DVB schedule wins */
+  g_assert_cmpint (g_date_time_get_minute (mex_epg_event_get_start_date (
+                     g_ptr_array_index (reply.events, 0))), ==, 0);
+
+  g_ptr_array_unref (reply.events);
+
+  /* nothing else comes */
+  g_timeout_add (100, (GSourceFunc) test_quit_cb, reply.loop);
+  g_main_loop_run (reply.loop);
+  g_assert_cmpuint (reply.n_replies, ==, 1);
+
+  g_main_loop_unref (reply.loop);
+  g_date_time_unref (start);
+  g_date_time_unref (end);
+  g_object_unref (channel);
+  g_object_unref (manager);
+}
+
+#endif /* ENABLE_TESTS */
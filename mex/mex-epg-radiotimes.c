@@ -579,7 +579,10 @@ mex_epg_radiotimes_get_events (MexEpgProvider      *provider,
   name = mex_channel_get_name (channel);
   id = g_hash_table_lookup (priv->channel2id, name);
   if (id == NULL)
-    reply (provider, channel, NULL, user_data);
+    {
+      reply (provider, channel, NULL, user_data);
+      return;
+    }
 
   req = g_slice_new (Request);
   req->provider = provider;
@@ -19,6 +19,7 @@
 #include "mex-feed.h"
 #include "mex-program.h"
 #include "mex-model.h"
+#include "mex-string-pool.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -98,11 +99,15 @@ index_content (MexFeed    *feed,
   g_free (index_str);
   g_strfreev (idx_strs);
 
-  /* Add to id table */
+  /* Add to id table, the feeds holding the same media share their ids */
   index_str = mex_program_get_id (MEX_PROGRAM (content));
 
-  if (index_str)
-    g_hash_table_insert (priv->id_to_programs, index_str, content);
+  if (index_str) {
+    g_hash_table_insert (priv->id_to_programs,
+                         (gpointer) mex_string_pool_intern (index_str),
+                         content);
+    g_free (index_str);
+  }
 }
 
 static void
@@ -428,7 +433,8 @@ mex_feed_init (MexFeed *self)
      (GDestroyNotify) g_hash_table_destroy);
   priv->id_to_programs = g_hash_table_new_full (g_str_hash,
                                                 g_str_equal,
-                                                g_free,
+                                                (GDestroyNotify)
+                                                mex_string_pool_release,
                                                 NULL);
 }
 
@@ -0,0 +1,1054 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "mex-frame-profiler.h"
+
+/*
+ * The profiler keeps the last n_frames frames in a ring allocated up front,
+ * so recording a frame is a handful of clock reads and a copy. Picks and
+ * stalls happen between frames and are accounted to the next frame painted.
+ *
+ * Containers bracket their allocate and paint implementations with
+ * mex_frame_profiler_begin_actor() and mex_frame_profiler_end_actor(); the
+ * self time (time not spent in a nested bracketed actor) is summed per
+ * class and the class with the most self time is kept as the culprit of
+ * the frame. Those calls are a single pointer test when no profiler runs.
+ */
+
+#define N_PHASES            (MEX_FRAME_PHASE_STALL + 1)
+#define MAX_ACTOR_DEPTH     64
+#define MAX_CLASSES         32
+
+#define HEARTBEAT_INTERVAL  50  /* ms */
+#define HEARTBEAT_SLACK     10  /* ms */
+
+G_DEFINE_TYPE (MexFrameProfiler, mex_frame_profiler, G_TYPE_OBJECT)
+
+#define FRAME_PROFILER_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_FRAME_PROFILER, \
+                                MexFrameProfilerPrivate))
+
+enum
+{
+  PROP_0,
+
+  PROP_N_FRAMES,
+  PROP_LONG_FRAME
+};
+
+typedef struct
+{
+  gint64 start;
+  gint64 durations[N_PHASES];
+  GType  culprit;
+  gint64 culprit_time;
+} FrameRecord;
+
+typedef struct
+{
+  GType  type;
+  gint64 start;
+  gint64 children;
+} ActorRecord;
+
+typedef struct
+{
+  GType  type;
+  gint64 time;
+} ClassTime;
+
+struct _MexFrameProfilerPrivate
+{
+  MexFrameProfilerClock clock;
+  gint64                long_frame;
+
+  /* the ring */
+  FrameRecord *frames;
+  guint        n_frames;
+  guint        next;
+  guint        n_recorded;
+
+  /* the frame being measured */
+  FrameRecord  current;
+  gint64       phase_start[N_PHASES];
+  guint        in_frame : 1;
+  guint        painted : 1;
+  guint        phases;
+
+  ActorRecord  actors[MAX_ACTOR_DEPTH];
+  guint        depth;
+  ClassTime    classes[MAX_CLASSES];
+  guint        n_classes;
+
+  /* stage hooks */
+  ClutterStage *stage;
+  guint         pre_paint_id;
+  guint         post_paint_id;
+  gulong        paint_id;
+  gulong        paint_after_id;
+  gulong        pick_id;
+  gulong        pick_after_id;
+  guint         heartbeat_id;
+  gint64        last_beat;
+};
+
+static const gchar *phase_names[N_PHASES] =
+  { "frame", "layout", "paint", "pick", "stall" };
+
+/* The profiler the actors report to, there is at most one running */
+static MexFrameProfiler *running = NULL;
+
+static void
+_class_time_add (ClassTime *classes,
+                 guint     *n_classes,
+                 GType      type,
+                 gint64     time)
+{
+  guint i;
+
+  for (i = 0; i < *n_classes; i++)
+    if (classes[i].type == type)
+      {
+        classes[i].time += time;
+        return;
+      }
+
+  if (*n_classes < MAX_CLASSES)
+    {
+      classes[i].type = type;
+      classes[i].time = time;
+      (*n_classes)++;
+    }
+}
+
+static ClassTime *
+_class_time_max (ClassTime *classes,
+                 guint      n_classes)
+{
+  ClassTime *max = NULL;
+  guint i;
+
+  for (i = 0; i < n_classes; i++)
+    if (!max || classes[i].time > max->time)
+      max = &classes[i];
+
+  return max;
+}
+
+static gint
+_gint64_cmp (gconstpointer a,
+             gconstpointer b)
+{
+  gint64 va = *(const gint64 *) a;
+  gint64 vb = *(const gint64 *) b;
+
+  return (va > vb) - (va < vb);
+}
+
+/*
+ * GObject implementation
+ */
+
+static void
+mex_frame_profiler_get_property (GObject    *object,
+                                 guint       property_id,
+                                 GValue     *value,
+                                 GParamSpec *pspec)
+{
+  MexFrameProfilerPrivate *priv = MEX_FRAME_PROFILER (object)->priv;
+
+  switch (property_id)
+    {
+    case PROP_N_FRAMES:
+      g_value_set_uint (value, priv->n_frames);
+      break;
+
+    case PROP_LONG_FRAME:
+      g_value_set_int64 (value, priv->long_frame);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_frame_profiler_set_property (GObject      *object,
+                                 guint         property_id,
+                                 const GValue *value,
+                                 GParamSpec   *pspec)
+{
+  MexFrameProfiler *profiler = MEX_FRAME_PROFILER (object);
+
+  switch (property_id)
+    {
+    case PROP_N_FRAMES:
+      profiler->priv->n_frames = g_value_get_uint (value);
+      break;
+
+    case PROP_LONG_FRAME:
+      mex_frame_profiler_set_long_frame (profiler,
+                                         g_value_get_int64 (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_frame_profiler_constructed (GObject *object)
+{
+  MexFrameProfilerPrivate *priv = MEX_FRAME_PROFILER (object)->priv;
+
+  priv->frames = g_new0 (FrameRecord, priv->n_frames);
+
+  if (G_OBJECT_CLASS (mex_frame_profiler_parent_class)->constructed)
+    G_OBJECT_CLASS (mex_frame_profiler_parent_class)->constructed (object);
+}
+
+static void
+mex_frame_profiler_finalize (GObject *object)
+{
+  MexFrameProfiler *profiler = MEX_FRAME_PROFILER (object);
+
+  mex_frame_profiler_stop (profiler);
+  g_free (profiler->priv->frames);
+
+  G_OBJECT_CLASS (mex_frame_profiler_parent_class)->finalize (object);
+}
+
+static void
+mex_frame_profiler_class_init (MexFrameProfilerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GParamSpec *pspec;
+
+  g_type_class_add_private (klass, sizeof (MexFrameProfilerPrivate));
+
+  object_class->get_property = mex_frame_profiler_get_property;
+  object_class->set_property = mex_frame_profiler_set_property;
+  object_class->constructed = mex_frame_profiler_constructed;
+  object_class->finalize = mex_frame_profiler_finalize;
+
+  pspec = g_param_spec_uint ("n-frames",
+                             "Frames",
+                             "Number of frames kept",
+                             1, G_MAXUINT, 1024,
+                             G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                             G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_N_FRAMES, pspec);
+
+  pspec = g_param_spec_int64 ("long-frame",
+                              "Long frame",
+                              "Duration from which a frame is too long, "
+                              "in microseconds",
+                              1, G_MAXINT64, G_USEC_PER_SEC / 60,
+                              G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_LONG_FRAME, pspec);
+}
+
+static void
+mex_frame_profiler_init (MexFrameProfiler *self)
+{
+  MexFrameProfilerPrivate *priv;
+
+  self->priv = priv = FRAME_PROFILER_PRIVATE (self);
+
+  priv->clock = g_get_monotonic_time;
+  priv->long_frame = G_USEC_PER_SEC / 60;
+}
+
+/*
+ * Stage hooks
+ */
+
+static gboolean
+mex_frame_profiler_pre_paint_cb (gpointer user_data)
+{
+  MexFrameProfiler *profiler = user_data;
+
+  mex_frame_profiler_begin_frame (profiler);
+  profiler->priv->painted = FALSE;
+  mex_frame_profiler_begin_phase (profiler, MEX_FRAME_PHASE_LAYOUT);
+
+  return TRUE;
+}
+
+static gboolean
+mex_frame_profiler_post_paint_cb (gpointer user_data)
+{
+  MexFrameProfiler *profiler = user_data;
+  MexFrameProfilerPrivate *priv = profiler->priv;
+
+  /* the master clock ran but had nothing to paint, keep accumulating */
+  if (priv->painted)
+    mex_frame_profiler_end_frame (profiler);
+  else
+    {
+      mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_LAYOUT);
+      priv->in_frame = FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+mex_frame_profiler_paint_cb (ClutterActor     *stage,
+                             MexFrameProfiler *profiler)
+{
+  mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_LAYOUT);
+  profiler->priv->painted = TRUE;
+  mex_frame_profiler_begin_phase (profiler, MEX_FRAME_PHASE_PAINT);
+}
+
+static void
+mex_frame_profiler_paint_after_cb (ClutterActor     *stage,
+                                   MexFrameProfiler *profiler)
+{
+  mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_PAINT);
+}
+
+static void
+mex_frame_profiler_pick_cb (ClutterActor       *stage,
+                            const ClutterColor *color,
+                            MexFrameProfiler   *profiler)
+{
+  mex_frame_profiler_begin_phase (profiler, MEX_FRAME_PHASE_PICK);
+}
+
+static void
+mex_frame_profiler_pick_after_cb (ClutterActor       *stage,
+                                  const ClutterColor *color,
+                                  MexFrameProfiler   *profiler)
+{
+  mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_PICK);
+}
+
+static gboolean
+mex_frame_profiler_heartbeat_cb (gpointer user_data)
+{
+  MexFrameProfiler *profiler = user_data;
+  MexFrameProfilerPrivate *priv = profiler->priv;
+  gint64 now, late;
+
+  /* anything that kept the main loop from running the heartbeat on time
+   * is a stall */
+  now = priv->clock ();
+  late = now - priv->last_beat - HEARTBEAT_INTERVAL * 1000;
+  if (late > HEARTBEAT_SLACK * 1000)
+    mex_frame_profiler_add_stall (profiler, late);
+  priv->last_beat = now;
+
+  return TRUE;
+}
+
+/**
+ * mex_frame_profiler_new:
+ * @n_frames: the number of frames to keep
+ *
+ * Creates a profiler keeping the timings of the last @n_frames frames.
+ *
+ * Return value: a new #MexFrameProfiler
+ */
+MexFrameProfiler *
+mex_frame_profiler_new (guint n_frames)
+{
+  return g_object_new (MEX_TYPE_FRAME_PROFILER, "n-frames", n_frames, NULL);
+}
+
+/**
+ * mex_frame_profiler_set_clock:
+ * @profiler: a #MexFrameProfiler
+ * @clock: the function giving the time, or %NULL
+ *
+ * Replaces the clock used to time the frames, g_get_monotonic_time() by
+ * default.
+ */
+void
+mex_frame_profiler_set_clock (MexFrameProfiler      *profiler,
+                              MexFrameProfilerClock  clock)
+{
+  g_return_if_fail (MEX_IS_FRAME_PROFILER (profiler));
+
+  profiler->priv->clock = clock ? clock : g_get_monotonic_time;
+}
+
+/**
+ * mex_frame_profiler_set_long_frame:
+ * @profiler: a #MexFrameProfiler
+ * @threshold: a duration, in microseconds
+ *
+ * Sets the duration from which a frame is too long, a 60Hz frame by
+ * default.
+ */
+void
+mex_frame_profiler_set_long_frame (MexFrameProfiler *profiler,
+                                   gint64            threshold)
+{
+  g_return_if_fail (MEX_IS_FRAME_PROFILER (profiler));
+  g_return_if_fail (threshold > 0);
+
+  if (profiler->priv->long_frame == threshold)
+    return;
+
+  profiler->priv->long_frame = threshold;
+  g_object_notify (G_OBJECT (profiler), "long-frame");
+}
+
+gint64
+mex_frame_profiler_get_long_frame (MexFrameProfiler *profiler)
+{
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), 0);
+
+  return profiler->priv->long_frame;
+}
+
+/**
+ * mex_frame_profiler_start:
+ * @profiler: a #MexFrameProfiler
+ * @stage: the stage to measure, or %NULL
+ *
+ * Makes @profiler the profiler the actors report to. When @stage is not
+ * %NULL, its frames are timed from the master clock, otherwise the frames
+ * have to be delimited with mex_frame_profiler_begin_frame() and
+ * mex_frame_profiler_end_frame().
+ */
+void
+mex_frame_profiler_start (MexFrameProfiler *profiler,
+                          ClutterStage     *stage)
+{
+  MexFrameProfilerPrivate *priv;
+
+  g_return_if_fail (MEX_IS_FRAME_PROFILER (profiler));
+  g_return_if_fail (!stage || CLUTTER_IS_STAGE (stage));
+
+  priv = profiler->priv;
+
+  if (running == profiler)
+    return;
+  if (running)
+    mex_frame_profiler_stop (running);
+
+  running = profiler;
+  priv->depth = 0;
+
+  if (!stage)
+    return;
+
+  priv->stage = g_object_ref (stage);
+
+  priv->pre_paint_id =
+    clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                           mex_frame_profiler_pre_paint_cb,
+                                           profiler, NULL);
+  priv->post_paint_id =
+    clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_POST_PAINT,
+                                           mex_frame_profiler_post_paint_cb,
+                                           profiler, NULL);
+
+  priv->paint_id =
+    g_signal_connect (stage, "paint",
+                      G_CALLBACK (mex_frame_profiler_paint_cb), profiler);
+  priv->paint_after_id =
+    g_signal_connect_after (stage, "paint",
+                            G_CALLBACK (mex_frame_profiler_paint_after_cb),
+                            profiler);
+  priv->pick_id =
+    g_signal_connect (stage, "pick",
+                      G_CALLBACK (mex_frame_profiler_pick_cb), profiler);
+  priv->pick_after_id =
+    g_signal_connect_after (stage, "pick",
+                            G_CALLBACK (mex_frame_profiler_pick_after_cb),
+                            profiler);
+
+  priv->last_beat = priv->clock ();
+  priv->heartbeat_id = g_timeout_add (HEARTBEAT_INTERVAL,
+                                      mex_frame_profiler_heartbeat_cb,
+                                      profiler);
+}
+
+/**
+ * mex_frame_profiler_stop:
+ * @profiler: a #MexFrameProfiler
+ *
+ * Stops measuring. The frames recorded so far are kept.
+ */
+void
+mex_frame_profiler_stop (MexFrameProfiler *profiler)
+{
+  MexFrameProfilerPrivate *priv;
+
+  g_return_if_fail (MEX_IS_FRAME_PROFILER (profiler));
+
+  priv = profiler->priv;
+
+  if (running == profiler)
+    running = NULL;
+
+  priv->in_frame = FALSE;
+  priv->phases = 0;
+  priv->depth = 0;
+
+  if (!priv->stage)
+    return;
+
+  clutter_threads_remove_repaint_func (priv->pre_paint_id);
+  clutter_threads_remove_repaint_func (priv->post_paint_id);
+  g_signal_handler_disconnect (priv->stage, priv->paint_id);
+  g_signal_handler_disconnect (priv->stage, priv->paint_after_id);
+  g_signal_handler_disconnect (priv->stage, priv->pick_id);
+  g_signal_handler_disconnect (priv->stage, priv->pick_after_id);
+  g_source_remove (priv->heartbeat_id);
+
+  priv->pre_paint_id = priv->post_paint_id = priv->heartbeat_id = 0;
+  priv->paint_id = priv->paint_after_id = 0;
+  priv->pick_id = priv->pick_after_id = 0;
+
+  g_object_unref (priv->stage);
+  priv->stage = NULL;
+}
+
+gboolean
+mex_frame_profiler_is_running (MexFrameProfiler *profiler)
+{
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), FALSE);
+
+  return (running == profiler);
+}
+
+/**
+ * mex_frame_profiler_reset:
+ * @profiler: a #MexFrameProfiler
+ *
+ * Forgets the frames recorded so far.
+ */
+void
+mex_frame_profiler_reset (MexFrameProfiler *profiler)
+{
+  MexFrameProfilerPrivate *priv;
+
+  g_return_if_fail (MEX_IS_FRAME_PROFILER (profiler));
+
+  priv = profiler->priv;
+
+  priv->next = 0;
+  priv->n_recorded = 0;
+  priv->n_classes = 0;
+  memset (&priv->current, 0, sizeof (FrameRecord));
+}
+
+/*
+ * Recording
+ */
+
+void
+mex_frame_profiler_begin_frame (MexFrameProfiler *profiler)
+{
+  MexFrameProfilerPrivate *priv = profiler->priv;
+
+  priv->current.start = priv->clock ();
+  priv->in_frame = TRUE;
+}
+
+void
+mex_frame_profiler_end_frame (MexFrameProfiler *profiler)
+{
+  MexFrameProfilerPrivate *priv = profiler->priv;
+  ClassTime *culprit;
+
+  if (!priv->in_frame)
+    return;
+
+  priv->current.durations[MEX_FRAME_PHASE_FRAME] =
+    priv->clock () - priv->current.start;
+
+  culprit = _class_time_max (priv->classes, priv->n_classes);
+  if (culprit)
+    {
+      priv->current.culprit = culprit->type;
+      priv->current.culprit_time = culprit->time;
+    }
+
+  priv->frames[priv->next] = priv->current;
+  priv->next = (priv->next + 1) % priv->n_frames;
+  if (priv->n_recorded < priv->n_frames)
+    priv->n_recorded++;
+
+  memset (&priv->current, 0, sizeof (FrameRecord));
+  priv->n_classes = 0;
+  priv->in_frame = FALSE;
+}
+
+void
+mex_frame_profiler_begin_phase (MexFrameProfiler *profiler,
+                                MexFramePhase     phase)
+{
+  MexFrameProfilerPrivate *priv = profiler->priv;
+
+  priv->phase_start[phase] = priv->clock ();
+  priv->phases |= 1 << phase;
+}
+
+void
+mex_frame_profiler_end_phase (MexFrameProfiler *profiler,
+                              MexFramePhase     phase)
+{
+  MexFrameProfilerPrivate *priv = profiler->priv;
+
+  if (!(priv->phases & (1 << phase)))
+    return;
+
+  priv->current.durations[phase] += priv->clock () - priv->phase_start[phase];
+  priv->phases &= ~(1 << phase);
+}
+
+void
+mex_frame_profiler_add_stall (MexFrameProfiler *profiler,
+                              gint64            duration)
+{
+  profiler->priv->current.durations[MEX_FRAME_PHASE_STALL] += duration;
+}
+
+/**
+ * mex_frame_profiler_begin_actor:
+ * @actor: a #ClutterActor
+ *
+ * Marks the start of some work done by @actor, usually its allocation or
+ * its paint. Has to be balanced by mex_frame_profiler_end_actor().
+ */
+void
+mex_frame_profiler_begin_actor (ClutterActor *actor)
+{
+  MexFrameProfilerPrivate *priv;
+  ActorRecord *record;
+
+  if (G_LIKELY (!running))
+    return;
+
+  priv = running->priv;
+
+  if (priv->depth < MAX_ACTOR_DEPTH)
+    {
+      record = &priv->actors[priv->depth];
+      record->type = G_OBJECT_TYPE (actor);
+      record->children = 0;
+      record->start = priv->clock ();
+    }
+
+  priv->depth++;
+}
+
+void
+mex_frame_profiler_end_actor (ClutterActor *actor)
+{
+  MexFrameProfilerPrivate *priv;
+  ActorRecord *record;
+  gint64 elapsed;
+
+  if (G_LIKELY (!running))
+    return;
+
+  priv = running->priv;
+
+  /* begun before the profiler started */
+  if (priv->depth == 0)
+    return;
+
+  priv->depth--;
+  if (priv->depth >= MAX_ACTOR_DEPTH)
+    return;
+
+  record = &priv->actors[priv->depth];
+  elapsed = priv->clock () - record->start;
+
+  if (priv->depth > 0)
+    priv->actors[priv->depth - 1].children += elapsed;
+
+  _class_time_add (priv->classes, &priv->n_classes, record->type,
+                   elapsed - record->children);
+}
+
+/*
+ * Queries
+ */
+
+guint
+mex_frame_profiler_get_n_frames (MexFrameProfiler *profiler)
+{
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), 0);
+
+  return profiler->priv->n_recorded;
+}
+
+guint
+mex_frame_profiler_get_n_long_frames (MexFrameProfiler *profiler)
+{
+  MexFrameProfilerPrivate *priv;
+  guint i, n_long = 0;
+
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), 0);
+
+  priv = profiler->priv;
+
+  for (i = 0; i < priv->n_recorded; i++)
+    if (priv->frames[i].durations[MEX_FRAME_PHASE_FRAME] >= priv->long_frame)
+      n_long++;
+
+  return n_long;
+}
+
+/**
+ * mex_frame_profiler_get_percentile:
+ * @profiler: a #MexFrameProfiler
+ * @phase: a #MexFramePhase
+ * @percentile: a percentile, between 0 and 100
+ *
+ * Gets the duration of @phase that @percentile percents of the recorded
+ * frames don't exceed (nearest rank).
+ *
+ * Return value: a duration in microseconds, 0 if no frame was recorded
+ */
+gint64
+mex_frame_profiler_get_percentile (MexFrameProfiler *profiler,
+                                   MexFramePhase     phase,
+                                   gdouble           percentile)
+{
+  MexFrameProfilerPrivate *priv;
+  gint64 *values, value;
+  guint i, rank;
+
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), 0);
+  g_return_val_if_fail (phase < N_PHASES, 0);
+
+  priv = profiler->priv;
+
+  if (!priv->n_recorded)
+    return 0;
+
+  values = g_new (gint64, priv->n_recorded);
+  for (i = 0; i < priv->n_recorded; i++)
+    values[i] = priv->frames[i].durations[phase];
+  qsort (values, priv->n_recorded, sizeof (gint64), _gint64_cmp);
+
+  rank = (guint) ceil (CLAMP (percentile, 0, 100) / 100.0 * priv->n_recorded);
+  rank = CLAMP (rank, 1, priv->n_recorded);
+  value = values[rank - 1];
+
+  g_free (values);
+
+  return value;
+}
+
+/**
+ * mex_frame_profiler_get_slowest_class:
+ * @profiler: a #MexFrameProfiler
+ * @time: return location for the time spent by the class, or %NULL
+ *
+ * Gets the actor class that most often made the recorded frames long, that
+ * is the one whose time adds up the highest over the long frames it was
+ * the culprit of.
+ *
+ * Return value: the name of the class, or %NULL
+ */
+const gchar *
+mex_frame_profiler_get_slowest_class (MexFrameProfiler *profiler,
+                                      gint64           *time)
+{
+  MexFrameProfilerPrivate *priv;
+  ClassTime classes[MAX_CLASSES], *slowest;
+  guint i, n_classes = 0;
+
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), NULL);
+
+  priv = profiler->priv;
+
+  for (i = 0; i < priv->n_recorded; i++)
+    {
+      FrameRecord *frame = &priv->frames[i];
+
+      if (frame->culprit &&
+          frame->durations[MEX_FRAME_PHASE_FRAME] >= priv->long_frame)
+        _class_time_add (classes, &n_classes, frame->culprit,
+                         frame->culprit_time);
+    }
+
+  slowest = _class_time_max (classes, n_classes);
+
+  if (time)
+    *time = slowest ? slowest->time : 0;
+
+  return slowest ? g_type_name (slowest->type) : NULL;
+}
+
+/**
+ * mex_frame_profiler_get_summary:
+ * @profiler: a #MexFrameProfiler
+ *
+ * Describes the recorded frames in a few lines of text.
+ *
+ * Return value: a newly allocated string
+ */
+gchar *
+mex_frame_profiler_get_summary (MexFrameProfiler *profiler)
+{
+  MexFrameProfilerPrivate *priv;
+  const gchar *slowest;
+  GString *summary;
+  gint64 time;
+  gint phase;
+
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), NULL);
+
+  priv = profiler->priv;
+  summary = g_string_new (NULL);
+
+  g_string_append_printf (summary, "%u frames, %u over %.1fms\n",
+                          priv->n_recorded,
+                          mex_frame_profiler_get_n_long_frames (profiler),
+                          priv->long_frame / 1000.0);
+
+  for (phase = 0; phase < N_PHASES; phase++)
+    g_string_append_printf (summary,
+                            "%-6s p50 %.1fms p95 %.1fms p99 %.1fms\n",
+                            phase_names[phase],
+                            mex_frame_profiler_get_percentile (profiler,
+                                                               phase, 50)
+                            / 1000.0,
+                            mex_frame_profiler_get_percentile (profiler,
+                                                               phase, 95)
+                            / 1000.0,
+                            mex_frame_profiler_get_percentile (profiler,
+                                                               phase, 99)
+                            / 1000.0);
+
+  slowest = mex_frame_profiler_get_slowest_class (profiler, &time);
+  if (slowest)
+    g_string_append_printf (summary, "slowest %s (%.1fms)\n",
+                            slowest, time / 1000.0);
+
+  return g_string_free (summary, FALSE);
+}
+
+/**
+ * mex_frame_profiler_dump:
+ * @profiler: a #MexFrameProfiler
+ * @path: the file to write to
+ * @error: return location for a #GError, or %NULL
+ *
+ * Writes the summary and then the recorded frames, oldest first, one per
+ * line, to @path.
+ *
+ * Return value: %TRUE on success
+ */
+gboolean
+mex_frame_profiler_dump (MexFrameProfiler  *profiler,
+                         const gchar       *path,
+                         GError           **error)
+{
+  MexFrameProfilerPrivate *priv;
+  gchar *summary, **lines;
+  GString *data;
+  gboolean success;
+  guint i, first;
+  gint phase;
+
+  g_return_val_if_fail (MEX_IS_FRAME_PROFILER (profiler), FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+
+  priv = profiler->priv;
+  data = g_string_new (NULL);
+
+  summary = mex_frame_profiler_get_summary (profiler);
+  lines = g_strsplit (summary, "\n", -1);
+  for (i = 0; lines[i] && *lines[i]; i++)
+    g_string_append_printf (data, "# %s\n", lines[i]);
+  g_strfreev (lines);
+  g_free (summary);
+
+  g_string_append (data, "# start");
+  for (phase = 0; phase < N_PHASES; phase++)
+    g_string_append_printf (data, " %s", phase_names[phase]);
+  g_string_append (data, " culprit culprit-time (us)\n");
+
+  first = (priv->n_recorded < priv->n_frames) ? 0 : priv->next;
+  for (i = 0; i < priv->n_recorded; i++)
+    {
+      FrameRecord *frame = &priv->frames[(first + i) % priv->n_frames];
+
+      g_string_append_printf (data, "%" G_GINT64_FORMAT, frame->start);
+      for (phase = 0; phase < N_PHASES; phase++)
+        g_string_append_printf (data, " %" G_GINT64_FORMAT,
+                                frame->durations[phase]);
+      g_string_append_printf (data, " %s %" G_GINT64_FORMAT "\n",
+                              frame->culprit ?
+                                g_type_name (frame->culprit) : "-",
+                              frame->culprit_time);
+    }
+
+  success = g_file_set_contents (path, data->str, data->len, error);
+  g_string_free (data, TRUE);
+
+  return success;
+}
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-test-internal.h"
+
+static gint64 fake_now = 0;
+
+static gint64
+_fake_clock (void)
+{
+  return fake_now;
+}
+
+static void
+_fake_frame (MexFrameProfiler *profiler,
+             gint64            layout,
+             gint64            paint)
+{
+  mex_frame_profiler_begin_frame (profiler);
+  mex_frame_profiler_begin_phase (profiler, MEX_FRAME_PHASE_LAYOUT);
+  fake_now += layout;
+  mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_LAYOUT);
+  mex_frame_profiler_begin_phase (profiler, MEX_FRAME_PHASE_PAINT);
+  fake_now += paint;
+  mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_PAINT);
+  mex_frame_profiler_end_frame (profiler);
+}
+
+void
+mex_test_frame_profiler (void)
+{
+  MexFrameProfiler *profiler;
+  ClutterActor *outer, *inner;
+  gchar *directory, *path, *data;
+  gint64 time;
+  gint i;
+
+  profiler = mex_frame_profiler_new (16);
+  mex_frame_profiler_set_clock (profiler, _fake_clock);
+  mex_frame_profiler_start (profiler, NULL);
+
+  /* frames of 1ms to 20ms, only the last 16 are kept */
+  for (i = 1; i <= 20; i++)
+    _fake_frame (profiler, 500, i * 1000 - 500);
+
+  g_assert_cmpuint (mex_frame_profiler_get_n_frames (profiler), ==, 16);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_FRAME,
+                                                      50), ==, 12000);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_FRAME,
+                                                      95), ==, 20000);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_FRAME,
+                                                      99), ==, 20000);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_LAYOUT,
+                                                      99), ==, 500);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_PICK,
+                                                      99), ==, 0);
+  /* 17ms to 20ms */
+  g_assert_cmpuint (mex_frame_profiler_get_n_long_frames (profiler), ==, 4);
+
+  /* a pick and a stall between two frames land in the second one */
+  mex_frame_profiler_reset (profiler);
+  mex_frame_profiler_begin_phase (profiler, MEX_FRAME_PHASE_PICK);
+  fake_now += 3000;
+  mex_frame_profiler_end_phase (profiler, MEX_FRAME_PHASE_PICK);
+  mex_frame_profiler_add_stall (profiler, 100000);
+  _fake_frame (profiler, 1000, 1000);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_PICK,
+                                                      50), ==, 3000);
+  g_assert_cmpint (mex_frame_profiler_get_percentile (profiler,
+                                                      MEX_FRAME_PHASE_STALL,
+                                                      50), ==, 100000);
+
+  /* a long frame is blamed on the class with the most self time: the
+   * inner actor takes 25ms of the 30ms of the outer one */
+  mex_frame_profiler_reset (profiler);
+  outer = clutter_actor_new ();
+  inner = clutter_text_new ();
+  g_object_ref_sink (outer);
+  g_object_ref_sink (inner);
+
+  mex_frame_profiler_begin_frame (profiler);
+  mex_frame_profiler_begin_actor (outer);
+  fake_now += 2000;
+  mex_frame_profiler_begin_actor (inner);
+  fake_now += 25000;
+  mex_frame_profiler_end_actor (inner);
+  fake_now += 3000;
+  mex_frame_profiler_end_actor (outer);
+  mex_frame_profiler_end_frame (profiler);
+
+  /* short frames don't count */
+  mex_frame_profiler_begin_frame (profiler);
+  mex_frame_profiler_begin_actor (outer);
+  fake_now += 10000;
+  mex_frame_profiler_end_actor (outer);
+  mex_frame_profiler_end_frame (profiler);
+
+  g_assert_cmpstr (mex_frame_profiler_get_slowest_class (profiler, &time),
+                   ==, "ClutterText");
+  g_assert_cmpint (time, ==, 25000);
+
+  /* nothing is attributed once stopped */
+  mex_frame_profiler_stop (profiler);
+  g_assert (!mex_frame_profiler_is_running (profiler));
+  mex_frame_profiler_begin_actor (outer);
+  fake_now += 50000;
+  mex_frame_profiler_end_actor (outer);
+  g_assert_cmpuint (profiler->priv->n_classes, ==, 0);
+
+  directory = g_dir_make_tmp ("mex-frames-XXXXXX", NULL);
+  g_assert (directory);
+  path = g_build_filename (directory, "frames", NULL);
+
+  g_assert (mex_frame_profiler_dump (profiler, path, NULL));
+  g_assert (g_file_get_contents (path, &data, NULL, NULL));
+  g_assert (strstr (data, "# slowest ClutterText (25.0ms)\n"));
+  g_assert (g_str_has_suffix (data, " ClutterActor 10000\n"));
+  g_free (data);
+
+  g_unlink (path);
+  g_rmdir (directory);
+  g_free (path);
+  g_free (directory);
+
+  g_object_unref (inner);
+  g_object_unref (outer);
+  g_object_unref (profiler);
+}
+
+#endif /* ENABLE_TESTS */
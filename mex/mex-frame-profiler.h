@@ -0,0 +1,135 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+
+#ifndef __MEX_FRAME_PROFILER_H__
+#define __MEX_FRAME_PROFILER_H__
+
+#include <glib-object.h>
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_FRAME_PROFILER mex_frame_profiler_get_type()
+
+#define MEX_FRAME_PROFILER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MEX_TYPE_FRAME_PROFILER, \
+                               MexFrameProfiler))
+
+#define MEX_FRAME_PROFILER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), MEX_TYPE_FRAME_PROFILER, \
+                            MexFrameProfilerClass))
+
+#define MEX_IS_FRAME_PROFILER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MEX_TYPE_FRAME_PROFILER))
+
+#define MEX_IS_FRAME_PROFILER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), MEX_TYPE_FRAME_PROFILER))
+
+#define MEX_FRAME_PROFILER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), MEX_TYPE_FRAME_PROFILER, \
+                              MexFrameProfilerClass))
+
+typedef struct _MexFrameProfiler MexFrameProfiler;
+typedef struct _MexFrameProfilerClass MexFrameProfilerClass;
+typedef struct _MexFrameProfilerPrivate MexFrameProfilerPrivate;
+
+/**
+ * MexFramePhase:
+ * @MEX_FRAME_PHASE_FRAME: the whole frame
+ * @MEX_FRAME_PHASE_LAYOUT: the relayout of the stage
+ * @MEX_FRAME_PHASE_PAINT: the paint of the stage
+ * @MEX_FRAME_PHASE_PICK: the picks since the previous frame
+ * @MEX_FRAME_PHASE_STALL: the main loop stalls since the previous frame
+ *
+ * The parts of a frame a #MexFrameProfiler measures.
+ */
+typedef enum
+{
+  MEX_FRAME_PHASE_FRAME,
+  MEX_FRAME_PHASE_LAYOUT,
+  MEX_FRAME_PHASE_PAINT,
+  MEX_FRAME_PHASE_PICK,
+  MEX_FRAME_PHASE_STALL
+} MexFramePhase;
+
+/**
+ * MexFrameProfilerClock:
+ *
+ * Returns the current time in microseconds, see g_get_monotonic_time().
+ */
+typedef gint64 (*MexFrameProfilerClock) (void);
+
+struct _MexFrameProfiler
+{
+  GObject parent;
+
+  MexFrameProfilerPrivate *priv;
+};
+
+struct _MexFrameProfilerClass
+{
+  GObjectClass parent_class;
+};
+
+GType              mex_frame_profiler_get_type       (void) G_GNUC_CONST;
+
+MexFrameProfiler * mex_frame_profiler_new            (guint             n_frames);
+
+void               mex_frame_profiler_set_clock      (MexFrameProfiler *profiler,
+                                                      MexFrameProfilerClock clock);
+void               mex_frame_profiler_set_long_frame (MexFrameProfiler *profiler,
+                                                      gint64            threshold);
+gint64             mex_frame_profiler_get_long_frame (MexFrameProfiler *profiler);
+
+void               mex_frame_profiler_start          (MexFrameProfiler *profiler,
+                                                      ClutterStage     *stage);
+void               mex_frame_profiler_stop           (MexFrameProfiler *profiler);
+gboolean           mex_frame_profiler_is_running     (MexFrameProfiler *profiler);
+void               mex_frame_profiler_reset          (MexFrameProfiler *profiler);
+
+void               mex_frame_profiler_begin_frame    (MexFrameProfiler *profiler);
+void               mex_frame_profiler_end_frame      (MexFrameProfiler *profiler);
+void               mex_frame_profiler_begin_phase    (MexFrameProfiler *profiler,
+                                                      MexFramePhase     phase);
+void               mex_frame_profiler_end_phase      (MexFrameProfiler *profiler,
+                                                      MexFramePhase     phase);
+void               mex_frame_profiler_add_stall      (MexFrameProfiler *profiler,
+                                                      gint64            duration);
+
+void               mex_frame_profiler_begin_actor    (ClutterActor     *actor);
+void               mex_frame_profiler_end_actor      (ClutterActor     *actor);
+
+guint              mex_frame_profiler_get_n_frames   (MexFrameProfiler *profiler);
+guint              mex_frame_profiler_get_n_long_frames
+                                                     (MexFrameProfiler *profiler);
+gint64             mex_frame_profiler_get_percentile (MexFrameProfiler *profiler,
+                                                      MexFramePhase     phase,
+                                                      gdouble           percentile);
+const gchar *      mex_frame_profiler_get_slowest_class
+                                                     (MexFrameProfiler *profiler,
+                                                      gint64           *time);
+
+gchar *            mex_frame_profiler_get_summary    (MexFrameProfiler *profiler);
+gboolean           mex_frame_profiler_dump           (MexFrameProfiler *profiler,
+                                                      const gchar      *path,
+                                                      GError          **error);
+
+G_END_DECLS
+
+#endif /* __MEX_FRAME_PROFILER_H__ */
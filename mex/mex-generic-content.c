@@ -19,6 +19,7 @@
 #include "mex-generic-content.h"
 #include "mex-content.h"
 #include "mex-enum-types.h"
+#include "mex-string-pool.h"
 
 enum {
   PROP_0 = MEX_CONTENT_METADATA_LAST_ID,
@@ -43,6 +44,50 @@ G_DEFINE_TYPE_WITH_CODE (MexGenericContent, mex_generic_content, G_TYPE_INITIALL
                          G_IMPLEMENT_INTERFACE (MEX_TYPE_CONTENT,
                                                 mex_content_iface_init));
 
+/*
+ * Metadata values
+ *
+ * The ids, mime types and URLs are shared by the contents of the different
+ * feeds showing the same media, those are kept in the string pool.
+ */
+
+static gboolean
+metadata_is_pooled (MexContentMetadata key)
+{
+  switch (key)
+    {
+    case MEX_CONTENT_METADATA_ID:
+    case MEX_CONTENT_METADATA_MIMETYPE:
+    case MEX_CONTENT_METADATA_STILL:
+    case MEX_CONTENT_METADATA_STREAM:
+    case MEX_CONTENT_METADATA_URL:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+static gchar *
+metadata_value_new (MexContentMetadata  key,
+                    const gchar        *value)
+{
+  if (metadata_is_pooled (key))
+    return (gchar *) mex_string_pool_intern (value);
+
+  return g_strdup (value);
+}
+
+static void
+metadata_value_free (MexContentMetadata  key,
+                     gchar              *value)
+{
+  if (metadata_is_pooled (key))
+    mex_string_pool_release (value);
+  else
+    g_free (value);
+}
+
 /*
  * MexContent implementation
  */
@@ -74,13 +119,24 @@ content_set_metadata (MexContent         *content,
   const char *property;
   MexGenericContent *gc = (MexGenericContent *) content;
   MexGenericContentPrivate *priv = gc->priv;
+  gchar *old_value;
+
+  old_value = g_hash_table_lookup (priv->metadata, GUINT_TO_POINTER (key));
+
+  /* refreshing a content from its source sets the same values again, the
+   * views only need to know what changed */
+  if (g_strcmp0 (old_value, value) == 0)
+    return;
 
   if (value)
     g_hash_table_insert (priv->metadata, GUINT_TO_POINTER (key),
-                         g_strdup (value));
+                         metadata_value_new (key, value));
   else
     g_hash_table_remove (priv->metadata, GUINT_TO_POINTER (key));
 
+  if (old_value)
+    metadata_value_free (key, old_value);
+
   property = mex_content_get_property_name (content, key);
   g_object_notify (G_OBJECT (content), property);
 }
@@ -169,6 +225,13 @@ mex_generic_content_dispose (GObject *object)
 
   if (priv->metadata)
     {
+      GHashTableIter iter;
+      gpointer key, value;
+
+      g_hash_table_iter_init (&iter, priv->metadata);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        metadata_value_free (GPOINTER_TO_UINT (key), value);
+
       g_hash_table_unref (priv->metadata);
       priv->metadata = NULL;
     }
@@ -270,7 +333,8 @@ mex_generic_content_init (MexGenericContent *self)
 
   self->priv = priv = GET_PRIVATE (self);
 
-  priv->metadata = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  /* the values are freed according to their key */
+  priv->metadata = g_hash_table_new (NULL, NULL);
 
   priv->last_position_start = TRUE;
 }
@@ -247,6 +247,59 @@ mex_generic_model_remove_content (MexModel   *model,
   g_object_notify (G_OBJECT (model), "length");
 }
 
+static void
+mex_generic_model_remove (MexModel *model,
+                          GList    *content_list)
+{
+  MexGenericModel *gm = (MexGenericModel *) model;
+  MexGenericModelPrivate *priv = gm->priv;
+  GControllerReference *ref;
+  GHashTable *to_remove;
+  GList *l;
+  guint i, j;
+
+  if (!content_list)
+    return;
+
+  to_remove = g_hash_table_new (NULL, NULL);
+  for (l = content_list; l; l = l->next)
+    g_hash_table_insert (to_remove, l->data, l->data);
+
+  /* from the last index, so that the views removing them one after the
+   * other do not see the following ones move */
+  ref = g_controller_create_reference (priv->controller, G_CONTROLLER_REMOVE,
+                                       G_TYPE_UINT, 0);
+  for (i = priv->items->len; i > 0; i--)
+    if (g_hash_table_lookup (to_remove,
+                             g_array_index (priv->items, MexContent *, i - 1)))
+      g_controller_reference_add_index (ref, i - 1);
+
+  if (g_controller_reference_get_n_indices (ref) == 0)
+    {
+      g_object_unref (ref);
+      g_hash_table_unref (to_remove);
+      return;
+    }
+
+  g_controller_emit_changed (priv->controller, ref);
+  g_object_unref (ref);
+
+  for (i = 0, j = 0; i < priv->items->len; i++)
+    {
+      MexContent *content = g_array_index (priv->items, MexContent *, i);
+
+      if (g_hash_table_lookup (to_remove, content))
+        g_object_unref (content);
+      else
+        g_array_index (priv->items, MexContent *, j++) = content;
+    }
+  g_array_set_size (priv->items, j);
+
+  g_hash_table_unref (to_remove);
+
+  g_object_notify (G_OBJECT (model), "length");
+}
+
 static void
 mex_generic_model_clear (MexModel *model)
 {
@@ -380,6 +433,7 @@ mex_model_iface_init (MexModelIface *iface)
   iface->add = mex_generic_model_add;
   iface->add_content = mex_generic_model_add_content;
   iface->remove_content = mex_generic_model_remove_content;
+  iface->remove = mex_generic_model_remove;
   iface->clear = mex_generic_model_clear;
   iface->set_sort_func = mex_generic_model_set_sort_func;
   iface->is_sorted = mex_generic_model_is_sorted;
@@ -20,6 +20,7 @@
 #include "mex-grid.h"
 #include "mex-content-box.h"
 #include "mex-content-view.h"
+#include "mex-frame-profiler.h"
 #include "mex-scrollable-container.h"
 #include "mex-content-tile.h"
 #include <math.h>
@@ -95,6 +96,7 @@ enum
 };
 
 static void mex_grid_start_animation (MexGrid *self);
+static void mex_grid_update_visible_contents (MexGrid *self);
 
 
 /* MxScrollableIface */
@@ -734,12 +736,17 @@ mex_grid_allocate (ClutterActor           *actor,
   MexGrid *self = MEX_GRID (actor);
   MexGridPrivate *priv = self->priv;
 
+  mex_frame_profiler_begin_actor (actor);
+
   CLUTTER_ACTOR_CLASS (mex_grid_parent_class)->allocate (actor, box, flags);
 
   /* Bail out if we have no children */
   priv->first_visible = priv->last_visible = -1;
   if (!priv->children->len)
-    return;
+    {
+      mex_frame_profiler_end_actor (actor);
+      return;
+    }
 
   mx_widget_get_padding (MX_WIDGET (actor), &padding);
   avail_width = box->x2 - box->x1 - padding.left - padding.right;
@@ -841,6 +848,10 @@ mex_grid_allocate (ClutterActor           *actor,
                     "page-size", (gdouble)avail_height,
                     NULL);
     }
+
+  mex_grid_update_visible_contents (self);
+
+  mex_frame_profiler_end_actor (actor);
 }
 
 static void
@@ -869,10 +880,15 @@ mex_grid_paint (ClutterActor *actor)
   MexGrid *self = MEX_GRID (actor);
   MexGridPrivate *priv = self->priv;
 
+  mex_frame_profiler_begin_actor (actor);
+
   CLUTTER_ACTOR_CLASS (mex_grid_parent_class)->paint (actor);
 
   if (priv->first_visible == -1)
-    return;
+    {
+      mex_frame_profiler_end_actor (actor);
+      return;
+    }
 
   clutter_actor_get_allocation_box (actor, &box);
   mx_widget_get_padding (MX_WIDGET (actor), &padding);
@@ -944,6 +960,8 @@ mex_grid_paint (ClutterActor *actor)
       priv->tile_height_changed = FALSE;
       g_object_notify (G_OBJECT (actor), "tile-height");
     }
+
+  mex_frame_profiler_end_actor (actor);
 }
 
 static void
@@ -1325,6 +1343,22 @@ mex_grid_add_content (MexGrid    *grid,
   g_array_insert_val (priv->children, position, box);
 }
 
+/* Models that fetch their contents on demand need to know what is shown */
+static void
+mex_grid_update_visible_contents (MexGrid *self)
+{
+  MexGridPrivate *priv = self->priv;
+
+  if (!priv->model || priv->first_visible < 0)
+    return;
+
+  mex_model_set_visible_contents (priv->model,
+                                  mex_model_get_content (priv->model,
+                                                         priv->first_visible),
+                                  mex_model_get_content (priv->model,
+                                                         priv->last_visible));
+}
+
 /**
  * mex_grid_clear:
  *
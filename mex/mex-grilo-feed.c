@@ -30,7 +30,10 @@ enum {
   PROP_ROOT,
   PROP_QUERY_KEYS,
   PROP_METADATA_KEYS,
-  PROP_COMPLETED
+  PROP_COMPLETED,
+  PROP_PAGE_SIZE,
+  PROP_MAX_PAGES,
+  PROP_SNAPSHOT
 };
 
 struct _MexGriloFeedPrivate {
@@ -42,20 +45,52 @@ struct _MexGriloFeedPrivate {
   GList *metadata_keys;
 
   guint        completed : 1;
+  guint        end_reached : 1;
+  guint        snapshot_pending : 1;
+  guint        reconciling : 1;
 
   MexGriloFeedOpenCb open_callback;
 
   GList *items_to_add;
+
+  /* Paged mode: the results of the operation are fetched page_size items
+   * at a time and at most max_pages (+ the one being fetched) are kept */
+  guint       page_size;
+  guint       max_pages;
+  GPtrArray  *pages;         /* page number -> GPtrArray of programs */
+  GHashTable *page_of;       /* program -> page number + 1 */
+  guint       first_page;    /* resident pages are [first_page, last_page] */
+  guint       last_page;
+  gint        fetching_page;
+  guint       page_count;
+  guint       visible_first;
+  guint       visible_last;
+  guint       pages_idle_id;
+
+  /* Warm start: the contents of the last run are loaded from a snapshot
+   * and the next operation only adds and removes what changed since */
+  gchar      *snapshot;
+  GHashTable *stale;         /* snapshot contents not seen again yet */
+  guint       snapshot_save_id;
 };
 
 #define BROWSE_LIMIT 100
+#define DEFAULT_MAX_PAGES 5
 #define BROWSE_FLAGS (GRL_RESOLVE_IDLE_RELAY | GRL_RESOLVE_FULL)
 
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_DELAY 5 /* seconds */
+#define SNAPSHOT_TYPE "(uasa(ysa(qv)))"
+
 #define GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj),           \
                                                        MEX_TYPE_GRILO_FEED, \
                                                        MexGriloFeedPrivate))
 
-G_DEFINE_TYPE (MexGriloFeed, mex_grilo_feed, MEX_TYPE_FEED)
+static void mex_model_iface_init (MexModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (MexGriloFeed, mex_grilo_feed, MEX_TYPE_FEED,
+                         G_IMPLEMENT_INTERFACE (MEX_TYPE_MODEL,
+                                                mex_model_iface_init))
 
 static void update_source (MexGriloFeed *feed, GrlSource *new_source);
 
@@ -63,6 +98,16 @@ static void mex_grilo_feed_stop_op (MexGriloFeed *feed);
 static void mex_grilo_feed_start_op (MexGriloFeed *feed);
 static void mex_grilo_feed_free_op (MexGriloFeed *feed);
 static void mex_grilo_feed_init_op (MexGriloFeed *feed);
+static void mex_grilo_feed_reset_pages (MexGriloFeed *feed);
+static void mex_grilo_feed_queue_update_pages (MexGriloFeed *feed);
+static void mex_grilo_feed_add_to_page (MexGriloFeed *feed,
+                                        MexContent   *content);
+static void mex_grilo_feed_load_snapshot (MexGriloFeed *feed);
+static void mex_grilo_feed_controller_changed_cb (GController          *controller,
+                                                  GControllerAction     action,
+                                                  GControllerReference *ref,
+                                                  MexGriloFeed         *feed);
+static void mex_grilo_feed_queue_save_snapshot (MexGriloFeed *feed);
 
 static guint _mex_grilo_feed_browse (MexGriloFeed      *feed,
                                      int                offset,
@@ -88,6 +133,13 @@ static void _mex_grilo_feed_content_updated (GrlSource           *source,
 static void mex_grilo_feed_open_default (MexGriloProgram *program,
                                          MexGriloFeed    *feed);
 
+static void
+mex_grilo_feed_free_page (gpointer page)
+{
+  if (page)
+    g_ptr_array_unref (page);
+}
+
 static void
 mex_grilo_feed_finalize (GObject *object)
 {
@@ -109,6 +161,11 @@ mex_grilo_feed_finalize (GObject *object)
     priv->metadata_keys = NULL;
   }
 
+  g_ptr_array_unref (priv->pages);
+  g_hash_table_destroy (priv->page_of);
+  g_hash_table_destroy (priv->stale);
+  g_free (priv->snapshot);
+
   G_OBJECT_CLASS (mex_grilo_feed_parent_class)->finalize (object);
 }
 
@@ -117,8 +174,22 @@ mex_grilo_feed_dispose (GObject *object)
 {
   MexGriloFeed *self = (MexGriloFeed *) object;
   MexGriloFeedPrivate *priv = self->priv;
+  GController *controller;
 
   mex_grilo_feed_free_op (self);
+  mex_grilo_feed_reset_pages (self);
+
+  if (priv->snapshot_save_id) {
+    g_source_remove (priv->snapshot_save_id);
+    priv->snapshot_save_id = 0;
+  }
+  g_hash_table_remove_all (priv->stale);
+
+  controller = mex_model_get_controller (MEX_MODEL (self));
+  if (controller)
+    g_signal_handlers_disconnect_by_func (controller,
+                                          mex_grilo_feed_controller_changed_cb,
+                                          self);
 
   if (priv->source) {
     update_source (self, NULL);
@@ -158,6 +229,21 @@ mex_grilo_feed_set_property (GObject      *object,
     priv->root = g_value_dup_object (value);
     break;
 
+  case PROP_PAGE_SIZE:
+    priv->page_size = g_value_get_uint (value);
+    break;
+
+  case PROP_MAX_PAGES:
+    priv->max_pages = g_value_get_uint (value);
+    break;
+
+  case PROP_SNAPSHOT:
+    g_free (priv->snapshot);
+    priv->snapshot = g_value_dup_string (value);
+    if (priv->snapshot)
+      mex_grilo_feed_load_snapshot (self);
+    break;
+
   default:
     break;
   }
@@ -193,6 +279,18 @@ mex_grilo_feed_get_property (GObject    *object,
     g_value_set_boolean (value, priv->completed);
     break;
 
+  case PROP_PAGE_SIZE:
+    g_value_set_uint (value, priv->page_size);
+    break;
+
+  case PROP_MAX_PAGES:
+    g_value_set_uint (value, priv->max_pages);
+    break;
+
+  case PROP_SNAPSHOT:
+    g_value_set_string (value, priv->snapshot);
+    break;
+
   default:
     break;
   }
@@ -294,6 +392,30 @@ mex_grilo_feed_class_init (MexGriloFeedClass *klass)
                                 FALSE,
                                 G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
   g_object_class_install_property (o_class, PROP_COMPLETED, pspec);
+
+  pspec = g_param_spec_uint ("page-size", "Page size",
+                             "Number of items fetched at a time, 0 to fetch "
+                             "all the results of an operation at once.",
+                             0, G_MAXUINT, 0,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (o_class, PROP_PAGE_SIZE, pspec);
+
+  pspec = g_param_spec_uint ("max-pages", "Maximum pages",
+                             "Number of pages kept in the feed when paged, "
+                             "the pages the furthest from the ones shown "
+                             "are dropped.",
+                             3, G_MAXUINT, DEFAULT_MAX_PAGES,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (o_class, PROP_MAX_PAGES, pspec);
+
+  pspec = g_param_spec_string ("snapshot", "Snapshot",
+                               "File the contents of the feed are saved to "
+                               "once they settle and loaded from before the "
+                               "first operation, so they show straight away "
+                               "on the next start.",
+                               NULL,
+                               G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (o_class, PROP_SNAPSHOT, pspec);
 }
 
 static void
@@ -304,6 +426,15 @@ mex_grilo_feed_init (MexGriloFeed *self)
   self->priv = priv;
 
   priv->open_callback = mex_grilo_feed_open_default;
+
+  priv->max_pages = DEFAULT_MAX_PAGES;
+  priv->pages = g_ptr_array_new_with_free_func (mex_grilo_feed_free_page);
+  priv->page_of = g_hash_table_new (NULL, NULL);
+  priv->fetching_page = -1;
+  priv->stale = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+
+  g_signal_connect (mex_model_get_controller (MEX_MODEL (self)), "changed",
+                    G_CALLBACK (mex_grilo_feed_controller_changed_cb), self);
 }
 
 MexFeed *
@@ -320,20 +451,29 @@ mex_grilo_feed_new (GrlSource   *source,
                        NULL);
 }
 
-static gboolean
-emit_media_added_finished (MexGriloFeed *feed)
+static void
+flush_media_added (MexGriloFeed *feed)
 {
+  if (!feed->priv->items_to_add)
+    return;
+
   mex_model_add (MEX_MODEL (feed), feed->priv->items_to_add);
 
   g_list_free (feed->priv->items_to_add);
   feed->priv->items_to_add = NULL;
+}
+
+static gboolean
+emit_media_added_finished (MexGriloFeed *feed)
+{
+  flush_media_added (feed);
 
   g_object_unref (feed);
 
   return FALSE;
 }
 
-static void
+static MexProgram *
 emit_media_added (MexGriloFeed *feed, GrlMedia *media)
 {
   MexProgram *program;
@@ -346,6 +486,456 @@ emit_media_added (MexGriloFeed *feed, GrlMedia *media)
   program = mex_grilo_program_new (feed, media);
   _mex_program_complete (program);
   feed->priv->items_to_add = g_list_prepend (feed->priv->items_to_add, program);
+
+  return program;
+}
+
+/*
+ * Snapshots
+ *
+ * Every start used to wait for the sources to answer before showing
+ * anything. Once an operation has completed and the contents stopped
+ * changing for SNAPSHOT_DELAY, the items and the values of the query keys
+ * are written to the file given in the "snapshot" property, as one
+ * serialised GVariant (written in a thread). When the property is set, the
+ * file is mapped and the model filled from it in one go.
+ *
+ * The contents loaded are marked as stale. The next operation does not
+ * clear the model: the items it returns are looked up and updated in
+ * place (which only notifies the metadata that differ) and the new ones
+ * added as usual. When it completes, the contents that are still stale are
+ * removed. Paged feeds only keep their first page in the snapshot, and
+ * reconcile it when that page has been fetched.
+ */
+
+typedef struct
+{
+  gchar    *filename;
+  GVariant *snapshot;
+} SnapshotJob;
+
+static GVariant *
+mex_grilo_feed_value_to_variant (const GValue *value)
+{
+  switch (G_VALUE_TYPE (value)) {
+  case G_TYPE_STRING:
+    if (!g_value_get_string (value))
+      return NULL;
+    return g_variant_new_string (g_value_get_string (value));
+
+  case G_TYPE_INT:
+    return g_variant_new_int32 (g_value_get_int (value));
+
+  case G_TYPE_INT64:
+    return g_variant_new_int64 (g_value_get_int64 (value));
+
+  case G_TYPE_FLOAT:
+    return g_variant_new_double (g_value_get_float (value));
+
+  case G_TYPE_BOOLEAN:
+    return g_variant_new_boolean (g_value_get_boolean (value));
+
+  default:
+    if (G_VALUE_HOLDS (value, G_TYPE_DATE_TIME) && g_value_get_boxed (value))
+      return g_variant_new_int64 (g_date_time_to_unix (g_value_get_boxed (value)));
+    return NULL;
+  }
+}
+
+static gboolean
+mex_grilo_feed_variant_to_value (GVariant *variant,
+                                 GType     type,
+                                 GValue   *value)
+{
+  if (type == G_TYPE_STRING &&
+      g_variant_is_of_type (variant, G_VARIANT_TYPE_STRING)) {
+    g_value_init (value, type);
+    g_value_set_string (value, g_variant_get_string (variant, NULL));
+  } else if (type == G_TYPE_INT &&
+             g_variant_is_of_type (variant, G_VARIANT_TYPE_INT32)) {
+    g_value_init (value, type);
+    g_value_set_int (value, g_variant_get_int32 (variant));
+  } else if (type == G_TYPE_INT64 &&
+             g_variant_is_of_type (variant, G_VARIANT_TYPE_INT64)) {
+    g_value_init (value, type);
+    g_value_set_int64 (value, g_variant_get_int64 (variant));
+  } else if (type == G_TYPE_FLOAT &&
+             g_variant_is_of_type (variant, G_VARIANT_TYPE_DOUBLE)) {
+    g_value_init (value, type);
+    g_value_set_float (value, g_variant_get_double (variant));
+  } else if (type == G_TYPE_BOOLEAN &&
+             g_variant_is_of_type (variant, G_VARIANT_TYPE_BOOLEAN)) {
+    g_value_init (value, type);
+    g_value_set_boolean (value, g_variant_get_boolean (variant));
+  } else if (type == G_TYPE_DATE_TIME &&
+             g_variant_is_of_type (variant, G_VARIANT_TYPE_INT64)) {
+    g_value_init (value, type);
+    g_value_take_boxed (value,
+                        g_date_time_new_from_unix_utc (g_variant_get_int64 (variant)));
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static guchar
+mex_grilo_feed_media_type (GrlMedia *media)
+{
+  if (GRL_IS_MEDIA_BOX (media))
+    return 'b';
+  if (GRL_IS_MEDIA_VIDEO (media))
+    return 'v';
+  if (GRL_IS_MEDIA_AUDIO (media))
+    return 'a';
+  if (GRL_IS_MEDIA_IMAGE (media))
+    return 'i';
+  return 'm';
+}
+
+static GrlMedia *
+mex_grilo_feed_new_media (guchar type)
+{
+  switch (type) {
+  case 'b':
+    return grl_media_box_new ();
+  case 'v':
+    return grl_media_video_new ();
+  case 'a':
+    return grl_media_audio_new ();
+  case 'i':
+    return grl_media_image_new ();
+  default:
+    return grl_media_new ();
+  }
+}
+
+static GVariant *
+mex_grilo_feed_build_snapshot (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  GVariantBuilder keys, items;
+  GPtrArray *page = NULL;
+  GList *l;
+  guint i, n_contents;
+
+  if (priv->page_size) {
+    /* the first page is the one shown on start */
+    if (priv->first_page != 0 || priv->pages->len == 0 ||
+        !(page = g_ptr_array_index (priv->pages, 0)))
+      return NULL;
+    n_contents = page->len;
+  } else {
+    n_contents = mex_model_get_length (MEX_MODEL (feed));
+  }
+
+  g_variant_builder_init (&keys, G_VARIANT_TYPE_STRING_ARRAY);
+  for (l = priv->query_keys; l; l = l->next)
+    g_variant_builder_add (&keys, "s",
+                           grl_metadata_key_get_name (GRLPOINTER_TO_KEYID (l->data)));
+
+  g_variant_builder_init (&items, G_VARIANT_TYPE ("a(ysa(qv))"));
+  for (i = 0; i < n_contents; i++) {
+    MexContent *content;
+    GrlMedia *media;
+    guint16 key_index;
+
+    if (page)
+      content = g_ptr_array_index (page, i);
+    else
+      content = mex_model_get_content (MEX_MODEL (feed), i);
+
+    if (!MEX_IS_GRILO_PROGRAM (content))
+      continue;
+
+    media = mex_grilo_program_get_grilo_media (MEX_GRILO_PROGRAM (content));
+    if (!media || !grl_media_get_id (media))
+      continue;
+
+    g_variant_builder_open (&items, G_VARIANT_TYPE ("(ysa(qv))"));
+    g_variant_builder_add (&items, "y", mex_grilo_feed_media_type (media));
+    g_variant_builder_add (&items, "s", grl_media_get_id (media));
+
+    g_variant_builder_open (&items, G_VARIANT_TYPE ("a(qv)"));
+    for (l = priv->query_keys, key_index = 0; l; l = l->next, key_index++) {
+      GrlKeyID key = GRLPOINTER_TO_KEYID (l->data);
+      const GValue *value;
+      GVariant *variant;
+
+      if (key == GRL_METADATA_KEY_ID)
+        continue;
+
+      value = grl_data_get (GRL_DATA (media), key);
+      if (value && (variant = mex_grilo_feed_value_to_variant (value)))
+        g_variant_builder_add (&items, "(qv)", key_index, variant);
+    }
+    g_variant_builder_close (&items);
+
+    g_variant_builder_close (&items);
+  }
+
+  return g_variant_ref_sink (g_variant_new (SNAPSHOT_TYPE,
+                                            SNAPSHOT_VERSION, &keys, &items));
+}
+
+static gboolean
+mex_grilo_feed_write_snapshot (const gchar  *filename,
+                               GVariant     *snapshot,
+                               GError      **error)
+{
+  gchar *dirname;
+
+  dirname = g_path_get_dirname (filename);
+  g_mkdir_with_parents (dirname, 0755);
+  g_free (dirname);
+
+  /* serialising happens here, out of the main thread */
+  return g_file_set_contents (filename,
+                              g_variant_get_data (snapshot),
+                              g_variant_get_size (snapshot),
+                              error);
+}
+
+static void
+snapshot_job_free (SnapshotJob *job)
+{
+  g_free (job->filename);
+  g_variant_unref (job->snapshot);
+  g_slice_free (SnapshotJob, job);
+}
+
+static void
+snapshot_save_thread (GSimpleAsyncResult *res,
+                      GObject            *object,
+                      GCancellable       *cancellable)
+{
+  SnapshotJob *job = g_simple_async_result_get_op_res_gpointer (res);
+  GError *error = NULL;
+
+  if (!mex_grilo_feed_write_snapshot (job->filename, job->snapshot, &error))
+    {
+      g_warning (G_STRLOC ": Could not save the snapshot of a feed: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+}
+
+static gboolean
+mex_grilo_feed_save_snapshot_cb (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  GSimpleAsyncResult *res;
+  SnapshotJob *job;
+  GVariant *snapshot;
+
+  priv->snapshot_save_id = 0;
+
+  /* wait for the operation, it queues a save when it completes */
+  if (!priv->completed || priv->reconciling)
+    return FALSE;
+
+  snapshot = mex_grilo_feed_build_snapshot (feed);
+  if (!snapshot)
+    return FALSE;
+
+  job = g_slice_new0 (SnapshotJob);
+  job->filename = g_strdup (priv->snapshot);
+  job->snapshot = snapshot;
+
+  res = g_simple_async_result_new (G_OBJECT (feed), NULL, NULL,
+                                   mex_grilo_feed_save_snapshot_cb);
+  g_simple_async_result_set_op_res_gpointer (res, job,
+                                             (GDestroyNotify) snapshot_job_free);
+  g_simple_async_result_run_in_thread (res, snapshot_save_thread,
+                                       G_PRIORITY_LOW, NULL);
+  g_object_unref (res);
+
+  return FALSE;
+}
+
+static void
+mex_grilo_feed_queue_save_snapshot (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+
+  if (!priv->snapshot)
+    return;
+
+  if (priv->snapshot_save_id)
+    g_source_remove (priv->snapshot_save_id);
+
+  priv->snapshot_save_id =
+    g_timeout_add_seconds (SNAPSHOT_DELAY,
+                           (GSourceFunc) mex_grilo_feed_save_snapshot_cb,
+                           feed);
+}
+
+static void
+mex_grilo_feed_load_snapshot (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  GrlRegistry *registry = grl_registry_get_default ();
+  GVariant *snapshot, *names, *items, *values, *variant;
+  const gchar *source_id = NULL, *id;
+  GVariantIter iter, value_iter;
+  GList *contents = NULL;
+  GMappedFile *mapped;
+  GError *error = NULL;
+  GrlKeyID *keys;
+  guint32 version;
+  guint16 key_index;
+  gsize n_keys, i;
+  guchar type;
+
+  mapped = g_mapped_file_new (priv->snapshot, FALSE, &error);
+  if (!mapped) {
+    if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      g_warning (G_STRLOC ": Could not load the snapshot of a feed: %s",
+                 error->message);
+    g_clear_error (&error);
+    return;
+  }
+
+  snapshot = g_variant_new_from_data (G_VARIANT_TYPE (SNAPSHOT_TYPE),
+                                      g_mapped_file_get_contents (mapped),
+                                      g_mapped_file_get_length (mapped),
+                                      FALSE,
+                                      (GDestroyNotify) g_mapped_file_unref,
+                                      mapped);
+  g_variant_ref_sink (snapshot);
+
+  g_variant_get (snapshot, "(u@as@a(ysa(qv)))", &version, &names, &items);
+  if (version != SNAPSHOT_VERSION)
+    goto out;
+
+  n_keys = g_variant_n_children (names);
+  keys = g_new (GrlKeyID, n_keys);
+  for (i = 0; i < n_keys; i++) {
+    const gchar *name;
+
+    g_variant_get_child (names, i, "&s", &name);
+    keys[i] = grl_registry_lookup_metadata_key (registry, name);
+  }
+
+  if (priv->source)
+    source_id = grl_source_get_id (priv->source);
+
+  g_variant_iter_init (&iter, items);
+  while (g_variant_iter_next (&iter, "(y&s@a(qv))", &type, &id, &values)) {
+    MexProgram *program;
+    GrlMedia *media;
+
+    media = mex_grilo_feed_new_media (type);
+    grl_media_set_id (media, id);
+    if (source_id)
+      grl_media_set_source (media, source_id);
+
+    g_variant_iter_init (&value_iter, values);
+    while (g_variant_iter_next (&value_iter, "(qv)", &key_index, &variant)) {
+      GValue value = { 0, };
+
+      if (key_index < n_keys &&
+          keys[key_index] != GRL_METADATA_KEY_INVALID &&
+          mex_grilo_feed_variant_to_value (variant,
+                                           grl_metadata_key_get_type (keys[key_index]),
+                                           &value)) {
+        grl_data_set (GRL_DATA (media), keys[key_index], &value);
+        g_value_unset (&value);
+      }
+      g_variant_unref (variant);
+    }
+    g_variant_unref (values);
+
+    program = mex_grilo_program_new (feed, media);
+    _mex_program_complete (program);
+    g_object_unref (media);
+
+    g_hash_table_insert (priv->stale, g_object_ref (program), program);
+    contents = g_list_prepend (contents, program);
+  }
+
+  g_free (keys);
+
+  if (contents) {
+    contents = g_list_reverse (contents);
+    mex_model_add (MEX_MODEL (feed), contents);
+    g_list_free (contents);
+
+    priv->snapshot_pending = TRUE;
+  }
+
+out:
+  g_variant_unref (names);
+  g_variant_unref (items);
+  g_variant_unref (snapshot);
+}
+
+static void
+mex_grilo_feed_reconcile (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  GHashTable *stale = priv->stale;
+  GHashTableIter iter;
+  gpointer content;
+
+  priv->reconciling = FALSE;
+
+  /* the new items join the ones kept straight away */
+  flush_media_added (feed);
+
+  /* removing contents updates priv->stale, start from a fresh one */
+  priv->stale = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
+
+  g_hash_table_iter_init (&iter, stale);
+  while (g_hash_table_iter_next (&iter, &content, NULL))
+    mex_model_remove_content (MEX_MODEL (feed), content);
+
+  g_hash_table_destroy (stale);
+}
+
+static void
+mex_grilo_feed_clear (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+
+  /* the first operation after loading a snapshot reconciles it */
+  if (priv->snapshot_pending) {
+    priv->snapshot_pending = FALSE;
+    priv->reconciling = TRUE;
+    return;
+  }
+
+  priv->reconciling = FALSE;
+  g_hash_table_remove_all (priv->stale);
+  mex_model_clear (MEX_MODEL (feed));
+}
+
+static void
+mex_grilo_feed_controller_changed_cb (GController          *controller,
+                                      GControllerAction     action,
+                                      GControllerReference *ref,
+                                      MexGriloFeed         *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  guint i, n_indices;
+
+  /* contents removed by the source while reconciling are not stale */
+  if (g_hash_table_size (priv->stale)) {
+    if (action == G_CONTROLLER_CLEAR) {
+      g_hash_table_remove_all (priv->stale);
+    } else if (action == G_CONTROLLER_REMOVE && ref) {
+      n_indices = g_controller_reference_get_n_indices (ref);
+      for (i = 0; i < n_indices; i++) {
+        MexContent *content =
+          mex_model_get_content (MEX_MODEL (feed),
+                                 g_controller_reference_get_index_uint (ref, i));
+
+        g_hash_table_remove (priv->stale, content);
+      }
+    }
+  }
+
+  mex_grilo_feed_queue_save_snapshot (feed);
 }
 
 static void
@@ -394,11 +984,14 @@ browse_cb (GrlSource    *source,
                                                   grl_media_get_id (media)));
     if (program != NULL) {
       mex_grilo_program_set_grilo_media (program, media);
-      return;
+      g_hash_table_remove (priv->stale, program);
     } else {
-      emit_media_added (feed, media);
-      g_object_unref (media);
+      program = (MexGriloProgram *) emit_media_added (feed, media);
     }
+    g_object_unref (media);
+
+    if (priv->fetching_page >= 0)
+      mex_grilo_feed_add_to_page (feed, MEX_CONTENT (program));
   }
 
   priv->op->count++;
@@ -406,9 +999,27 @@ browse_cb (GrlSource    *source,
   if (remaining == 0) {
     priv->op->op_id = 0;
 
+    if (priv->fetching_page >= 0) {
+      /* a short page is the last one */
+      if (priv->page_count < priv->page_size)
+        priv->end_reached = TRUE;
+      priv->fetching_page = -1;
+
+      /* show the page now rather than waiting for more items */
+      flush_media_added (feed);
+
+      /* the view may have moved while we were fetching */
+      mex_grilo_feed_queue_update_pages (feed);
+    }
+
+    if (priv->reconciling)
+      mex_grilo_feed_reconcile (feed);
+
     /* Emit completed signal */
     priv->completed = TRUE;
     g_object_notify (G_OBJECT (feed), "completed");
+
+    mex_grilo_feed_queue_save_snapshot (feed);
   }
 }
 
@@ -425,6 +1036,7 @@ mex_grilo_feed_stop_op (MexGriloFeed *feed)
 
   grl_operation_cancel (priv->op->op_id);
   priv->op->op_id = 0;
+  priv->fetching_page = -1;
 
   if (priv->completed) {
     priv->completed = FALSE;
@@ -432,46 +1044,199 @@ mex_grilo_feed_stop_op (MexGriloFeed *feed)
   }
 }
 
-static void
-mex_grilo_feed_start_op (MexGriloFeed *feed)
+static guint
+mex_grilo_feed_run_op (MexGriloFeed *feed,
+                       guint         offset,
+                       guint         limit)
 {
   MexGriloFeedPrivate *priv = feed->priv;
   MexGriloFeedClass *klass = MEX_GRILO_FEED_GET_CLASS (feed);
 
-  if (!priv->op)
-    return;
-
-  if (priv->op->op_id) {
-    mex_grilo_feed_stop_op (feed);
-  }
-
   switch (priv->op->type) {
   case MEX_GRILO_FEED_OPERATION_NONE:
     g_assert_not_reached ();
     break;
 
   case MEX_GRILO_FEED_OPERATION_BROWSE:
-    priv->op->op_id = klass->browse (feed,
-                                     priv->op->offset,
-                                     priv->op->limit,
-                                     browse_cb);
-    break;
+    return klass->browse (feed, offset, limit, browse_cb);
 
   case MEX_GRILO_FEED_OPERATION_QUERY:
-    priv->op->op_id = klass->query (feed,
-                                    priv->op->text,
-                                    priv->op->offset,
-                                    priv->op->limit,
-                                    browse_cb);
-    break;
+    return klass->query (feed, priv->op->text, offset, limit, browse_cb);
 
   case MEX_GRILO_FEED_OPERATION_SEARCH:
-    priv->op->op_id = klass->search (feed,
-                                     priv->op->text,
-                                     priv->op->offset,
-                                     priv->op->limit,
-                                     browse_cb);
-    break;
+    return klass->search (feed, priv->op->text, offset, limit, browse_cb);
+  }
+
+  return 0;
+}
+
+static void
+mex_grilo_feed_fetch_page (MexGriloFeed *feed,
+                           guint         page)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  guint offset = page * priv->page_size;
+
+  if (offset >= priv->op->limit) {
+    priv->end_reached = TRUE;
+    return;
+  }
+
+  if (page >= priv->pages->len)
+    g_ptr_array_set_size (priv->pages, page + 1);
+  if (g_ptr_array_index (priv->pages, page) == NULL)
+    g_ptr_array_index (priv->pages, page) =
+      g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (page < priv->first_page)
+    priv->first_page = page;
+  if (page > priv->last_page)
+    priv->last_page = page;
+
+  priv->fetching_page = page;
+  priv->page_count = 0;
+
+  priv->op->op_id =
+    mex_grilo_feed_run_op (feed,
+                           priv->op->offset + offset,
+                           MIN (priv->page_size, priv->op->limit - offset));
+}
+
+static void
+mex_grilo_feed_evict_page (MexGriloFeed *feed,
+                           guint         page)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  GPtrArray *programs = g_ptr_array_index (priv->pages, page);
+  guint i;
+
+  if (!programs)
+    return;
+
+  for (i = 0; i < programs->len; i++) {
+    MexContent *content = g_ptr_array_index (programs, i);
+    GList *pending = g_list_find (priv->items_to_add, content);
+
+    g_hash_table_remove (priv->page_of, content);
+
+    if (pending) {
+      /* not in the model yet, drop the floating reference */
+      priv->items_to_add = g_list_delete_link (priv->items_to_add, pending);
+      g_object_ref_sink (content);
+      g_object_unref (content);
+    } else if (mex_model_index (MEX_MODEL (feed), content) >= 0) {
+      mex_model_remove_content (MEX_MODEL (feed), content);
+    }
+  }
+
+  g_ptr_array_index (priv->pages, page) = NULL;
+  g_ptr_array_unref (programs);
+}
+
+static void
+mex_grilo_feed_add_to_page (MexGriloFeed *feed,
+                            MexContent   *content)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+  GPtrArray *programs;
+
+  priv->page_count++;
+
+  if (g_hash_table_lookup (priv->page_of, content))
+    return;
+
+  programs = g_ptr_array_index (priv->pages, priv->fetching_page);
+  g_ptr_array_add (programs, g_object_ref (content));
+  g_hash_table_insert (priv->page_of, content,
+                       GUINT_TO_POINTER (priv->fetching_page + 1));
+}
+
+static gboolean
+mex_grilo_feed_update_pages_cb (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+
+  priv->pages_idle_id = 0;
+
+  if (!priv->page_size || !priv->op || priv->fetching_page >= 0 ||
+      priv->pages->len == 0)
+    return FALSE;
+
+  priv->visible_first = CLAMP (priv->visible_first,
+                               priv->first_page, priv->last_page);
+  priv->visible_last = CLAMP (priv->visible_last,
+                              priv->visible_first, priv->last_page);
+
+  /* drop the pages the furthest away from the ones shown */
+  while (priv->last_page - priv->first_page + 1 > priv->max_pages) {
+    if (priv->visible_first - priv->first_page >
+        priv->last_page - priv->visible_last) {
+      mex_grilo_feed_evict_page (feed, priv->first_page);
+      priv->first_page++;
+    } else {
+      mex_grilo_feed_evict_page (feed, priv->last_page);
+      priv->last_page--;
+      priv->end_reached = FALSE;
+    }
+  }
+
+  /* and fetch the next ones if the view is getting close */
+  if (priv->visible_last >= priv->last_page && !priv->end_reached)
+    mex_grilo_feed_fetch_page (feed, priv->last_page + 1);
+  else if (priv->visible_first <= priv->first_page && priv->first_page > 0)
+    mex_grilo_feed_fetch_page (feed, priv->first_page - 1);
+
+  return FALSE;
+}
+
+static void
+mex_grilo_feed_queue_update_pages (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+
+  if (!priv->pages_idle_id)
+    priv->pages_idle_id =
+      g_idle_add ((GSourceFunc) mex_grilo_feed_update_pages_cb, feed);
+}
+
+static void
+mex_grilo_feed_reset_pages (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+
+  if (priv->pages_idle_id) {
+    g_source_remove (priv->pages_idle_id);
+    priv->pages_idle_id = 0;
+  }
+
+  g_ptr_array_set_size (priv->pages, 0);
+  g_hash_table_remove_all (priv->page_of);
+
+  priv->first_page = priv->last_page = 0;
+  priv->visible_first = priv->visible_last = 0;
+  priv->fetching_page = -1;
+  priv->end_reached = FALSE;
+}
+
+static void
+mex_grilo_feed_start_op (MexGriloFeed *feed)
+{
+  MexGriloFeedPrivate *priv = feed->priv;
+
+  if (!priv->op)
+    return;
+
+  if (priv->op->op_id) {
+    mex_grilo_feed_stop_op (feed);
+  }
+
+  if (priv->page_size) {
+    mex_grilo_feed_reset_pages (feed);
+    mex_grilo_feed_fetch_page (feed, 0);
+  } else {
+    priv->op->op_id = mex_grilo_feed_run_op (feed,
+                                             priv->op->offset,
+                                             priv->op->limit);
   }
 }
 
@@ -526,8 +1291,8 @@ _mex_grilo_feed_browse (MexGriloFeed      *feed,
 
   options = grl_operation_options_new (NULL);
   grl_operation_options_set_flags (options, BROWSE_FLAGS);
-  grl_operation_options_set_skip (options, priv->op->offset);
-  grl_operation_options_set_count (options, priv->op->limit);
+  grl_operation_options_set_skip (options, offset);
+  grl_operation_options_set_count (options, limit);
 
 
   op_id = grl_source_browse (priv->source, priv->root,
@@ -553,8 +1318,8 @@ _mex_grilo_feed_query (MexGriloFeed      *feed,
 
   options = grl_operation_options_new (NULL);
   grl_operation_options_set_flags (options, BROWSE_FLAGS);
-  grl_operation_options_set_skip (options, priv->op->offset);
-  grl_operation_options_set_count (options, priv->op->limit);
+  grl_operation_options_set_skip (options, offset);
+  grl_operation_options_set_count (options, limit);
 
   op_id = grl_source_query (priv->source, priv->op->text,
                             priv->query_keys,
@@ -579,8 +1344,8 @@ _mex_grilo_feed_search (MexGriloFeed      *feed,
 
   options = grl_operation_options_new (NULL);
   grl_operation_options_set_flags (options, BROWSE_FLAGS);
-  grl_operation_options_set_skip (options, priv->op->offset);
-  grl_operation_options_set_count (options, priv->op->limit);
+  grl_operation_options_set_skip (options, offset);
+  grl_operation_options_set_count (options, limit);
 
   op_id = grl_source_search (priv->source, priv->op->text,
                              priv->query_keys,
@@ -604,7 +1369,7 @@ mex_grilo_feed_browse (MexGriloFeed *feed,
   priv = feed->priv;
 
   mex_grilo_feed_init_op (feed);
-  mex_model_clear (MEX_MODEL (feed));
+  mex_grilo_feed_clear (feed);
 
   priv->op->type = MEX_GRILO_FEED_OPERATION_BROWSE;
   priv->op->offset = offset;
@@ -627,7 +1392,7 @@ mex_grilo_feed_search (MexGriloFeed *feed,
   priv = feed->priv;
 
   mex_grilo_feed_init_op (feed);
-  mex_model_clear (MEX_MODEL (feed));
+  mex_grilo_feed_clear (feed);
 
   priv->op->type = MEX_GRILO_FEED_OPERATION_SEARCH;
   priv->op->offset = offset;
@@ -651,7 +1416,7 @@ mex_grilo_feed_query (MexGriloFeed *feed,
   priv = feed->priv;
 
   mex_grilo_feed_init_op (feed);
-  mex_model_clear (MEX_MODEL (feed));
+  mex_grilo_feed_clear (feed);
 
   priv->op->type = MEX_GRILO_FEED_OPERATION_QUERY;
   priv->op->offset = offset;
@@ -681,6 +1446,73 @@ mex_grilo_feed_get_completed (MexGriloFeed *feed)
   return feed->priv->completed;
 }
 
+/* A paged feed (see #MexGriloFeed:page-size) fetches the next pages before
+ * the view reaches its end, and drops the pages that are far away */
+static void
+mex_grilo_feed_set_visible_contents (MexModel   *model,
+                                     MexContent *first,
+                                     MexContent *last)
+{
+  MexGriloFeed *feed = MEX_GRILO_FEED (model);
+  MexGriloFeedPrivate *priv = feed->priv;
+  guint first_page, last_page;
+
+  if (!priv->page_size)
+    return;
+
+  first_page = GPOINTER_TO_UINT (g_hash_table_lookup (priv->page_of, first));
+  last_page = GPOINTER_TO_UINT (g_hash_table_lookup (priv->page_of, last));
+
+  /* contents that did not come from a page (eg. content-changed) */
+  if (!first_page || !last_page)
+    return;
+
+  priv->visible_first = MIN (first_page, last_page) - 1;
+  priv->visible_last = MAX (first_page, last_page) - 1;
+
+  mex_grilo_feed_queue_update_pages (feed);
+}
+
+static void
+mex_model_iface_init (MexModelIface *iface)
+{
+  /* the rest is inherited from MexGenericModel */
+  iface->set_visible_contents = mex_grilo_feed_set_visible_contents;
+}
+
+/**
+ * mex_grilo_feed_build_snapshot_filename:
+ * @source: the source of the feed
+ * @name: what the feed shows of @source
+ *
+ * Builds a file name in the cache directory for the #MexGriloFeed:snapshot
+ * of a feed.
+ *
+ * Returns: a newly allocated file name
+ */
+gchar *
+mex_grilo_feed_build_snapshot_filename (GrlSource   *source,
+                                        const gchar *name)
+{
+  gchar *basename, *filename;
+
+  g_return_val_if_fail (GRL_IS_SOURCE (source), NULL);
+  g_return_val_if_fail (name != NULL, NULL);
+
+  basename = g_strdup_printf ("%s-%s", grl_source_get_id (source), name);
+  g_strcanon (basename, G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS "-_.", '_');
+
+  filename = g_build_filename (g_get_user_cache_dir (), "mex", "feeds",
+                               basename, NULL);
+  g_free (basename);
+
+  return filename;
+}
+
+/* sources signal the changes in batches (a whole directory being renamed
+ * or deleted can be thousands of them), each batch is applied as one bulk
+ * remove and one bulk add, and the notifications of the contents are held
+ * until the end of the batch */
 static void
 _mex_grilo_feed_content_updated (GrlSource *source,
                                  GPtrArray *changed_medias,
@@ -692,38 +1524,64 @@ _mex_grilo_feed_content_updated (GrlSource *source,
   GrlMedia *media;
   const gchar *id;
   MexGriloProgram *program;
+  GList *added = NULL, *removed = NULL, *frozen = NULL, *l;
+
+  /* the contents still waiting to be added can't be looked up */
+  flush_media_added (feed);
+
+  g_object_freeze_notify (G_OBJECT (feed));
 
   for (i = 0 ; i < changed_medias->len ; i++)
     {
       media =  g_ptr_array_index (changed_medias, i);
       id = grl_media_get_id (media);
+      if (!id)
+        continue;
+
+      program = MEX_GRILO_PROGRAM (mex_feed_lookup (MEX_FEED (feed), id));
+
       switch (change_type)
         {
         case GRL_CONTENT_CHANGED:
-          program = MEX_GRILO_PROGRAM (mex_feed_lookup (MEX_FEED (feed), id));
+        case GRL_CONTENT_ADDED:
           /* The policy might be slightly different here... */
           if (program != NULL) {
+            g_object_freeze_notify (G_OBJECT (program));
+            frozen = g_list_prepend (frozen, g_object_ref (program));
             mex_grilo_program_set_grilo_media (program, media);
-          }
-          break;
+          } else if (change_type == GRL_CONTENT_ADDED) {
+            MexProgram *new_program = mex_grilo_program_new (feed, media);
 
-        case GRL_CONTENT_ADDED:
-          program = MEX_GRILO_PROGRAM (mex_feed_lookup (MEX_FEED (feed), id));
-          if (program != NULL) {
-            mex_grilo_program_set_grilo_media (program, media);
-          } else {
-            emit_media_added (feed, media);
+            _mex_program_complete (new_program);
+            added = g_list_prepend (added, new_program);
           }
           break;
 
         case GRL_CONTENT_REMOVED:
-          program = MEX_GRILO_PROGRAM (mex_feed_lookup (MEX_FEED (feed), id));
-          if (program != NULL) {
-            mex_model_remove_content (MEX_MODEL (feed), MEX_CONTENT (program));
-          }
+          if (program != NULL)
+            removed = g_list_prepend (removed, program);
           break;
         }
     }
+
+  if (removed) {
+    mex_model_remove (MEX_MODEL (feed), removed);
+    g_list_free (removed);
+  }
+
+  if (added) {
+    added = g_list_reverse (added);
+    mex_model_add (MEX_MODEL (feed), added);
+    g_list_free (added);
+  }
+
+  for (l = frozen; l; l = l->next) {
+    g_object_thaw_notify (l->data);
+    g_object_unref (l->data);
+  }
+  g_list_free (frozen);
+
+  g_object_thaw_notify (G_OBJECT (feed));
 }
 
 static void
@@ -800,3 +1658,539 @@ mex_grilo_feed_open (MexGriloFeed    *feed,
   if (priv->open_callback)
     priv->open_callback (program, feed);
 }
+
+#if defined (ENABLE_TESTS)
+
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "mex-string-pool.h"
+#include "mex-test-internal.h"
+
+/* A stand-in for Tracker: a source with TEST_SOURCE_N_ITEMS videos */
+
+#define TEST_SOURCE_N_ITEMS 100000
+
+typedef struct
+{
+  GrlSource parent;
+
+  guint n_browses;
+  guint n_items;
+  guint first;     /* the id of the first item */
+  gboolean with_uris;
+} MexTestSource;
+
+typedef struct
+{
+  GrlSourceClass parent_class;
+} MexTestSourceClass;
+
+G_DEFINE_TYPE (MexTestSource, mex_test_source, GRL_TYPE_SOURCE)
+
+static const GList *
+mex_test_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (!keys)
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                      GRL_METADATA_KEY_TITLE,
+                                      NULL);
+
+  return keys;
+}
+
+static void
+mex_test_source_browse (GrlSource           *source,
+                        GrlSourceBrowseSpec *bs)
+{
+  MexTestSource *self = (MexTestSource *) source;
+  guint64 skip, end, i;
+
+  self->n_browses++;
+
+  skip = grl_operation_options_get_skip (bs->options);
+  end = MIN (self->n_items,
+             skip + grl_operation_options_get_count (bs->options));
+
+  if (skip >= end) {
+    bs->callback (source, bs->operation_id, NULL, 0, bs->user_data, NULL);
+    return;
+  }
+
+  for (i = skip; i < end; i++) {
+    GrlMedia *media = grl_media_video_new ();
+    gchar *id = g_strdup_printf ("%" G_GUINT64_FORMAT, self->first + i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, id);
+    if (self->with_uris) {
+      gchar *url = g_strdup_printf ("file:///home/user/Videos/"
+                                    "Holidays/%s.mp4", id);
+
+      grl_media_set_url (media, url);
+      grl_media_set_mime (media, "video/mp4");
+      g_free (url);
+    }
+    g_free (id);
+
+    bs->callback (source, bs->operation_id, media, end - i - 1,
+                  bs->user_data, NULL);
+  }
+}
+
+static void
+mex_test_source_class_init (MexTestSourceClass *klass)
+{
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (klass);
+
+  source_class->supported_keys = mex_test_source_supported_keys;
+  source_class->browse = mex_test_source_browse;
+}
+
+static void
+mex_test_source_init (MexTestSource *self)
+{
+  self->n_items = TEST_SOURCE_N_ITEMS;
+}
+
+static void
+_test_wait_for_pages (MexGriloFeed *feed)
+{
+  while (feed->priv->fetching_page >= 0 || feed->priv->pages_idle_id)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+_test_show_page (MexGriloFeed *feed,
+                 guint         page,
+                 guint         page_size)
+{
+  gchar *first_id, *last_id;
+
+  first_id = g_strdup_printf ("%u", page * page_size);
+  last_id = g_strdup_printf ("%u", (page + 1) * page_size - 1);
+
+  mex_model_set_visible_contents (MEX_MODEL (feed),
+                                  mex_feed_lookup (MEX_FEED (feed), first_id),
+                                  mex_feed_lookup (MEX_FEED (feed), last_id));
+  _test_wait_for_pages (feed);
+
+  g_free (first_id);
+  g_free (last_id);
+}
+
+void
+mex_test_grilo_feed_paged (void)
+{
+  const guint page_size = 500, max_pages = 4;
+  MexTestSource *source;
+  MexGriloFeed *feed;
+  GList *keys;
+  guint page;
+
+  source = g_object_new (mex_test_source_get_type (),
+                         "source-id", "mex-test-source",
+                         "source-name", "Test source",
+                         NULL);
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                    GRL_METADATA_KEY_TITLE,
+                                    NULL);
+
+  feed = MEX_GRILO_FEED (mex_grilo_feed_new (GRL_SOURCE (source),
+                                             keys, keys, NULL));
+  g_object_set (feed,
+                "page-size", page_size,
+                "max-pages", max_pages,
+                NULL);
+
+  /* the first page and the next one are fetched straight away */
+  mex_grilo_feed_browse (feed, 0, G_MAXINT);
+  _test_wait_for_pages (feed);
+  g_assert (mex_grilo_feed_get_completed (feed));
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==,
+                    2 * page_size);
+  g_assert_cmpuint (source->n_browses, ==, 2);
+
+  /* scrolling down fetches one page at a time and keeps memory bounded */
+  for (page = 1; page < 40; page++) {
+    _test_show_page (feed, page, page_size);
+
+    g_assert_cmpuint (source->n_browses, ==, page + 2);
+    g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), <=,
+                      (max_pages + 1) * page_size);
+  }
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "0") == NULL);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "19999") != NULL);
+
+  /* scrolling back up fetches the pages that have been dropped */
+  page = feed->priv->first_page;
+  _test_show_page (feed, page, page_size);
+  g_assert (feed->priv->first_page == page - 1);
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), <=,
+                    (max_pages + 1) * page_size);
+
+  g_object_unref (feed);
+  g_object_unref (source);
+  g_list_free (keys);
+}
+
+
+typedef struct
+{
+  guint n_signals;
+  guint n_added;
+  guint n_removed;
+  guint n_cleared;
+  guint n_notifies;
+} TestChanges;
+
+static void
+_test_controller_changed_cb (GController          *controller,
+                             GControllerAction     action,
+                             GControllerReference *ref,
+                             TestChanges          *changes)
+{
+  guint n_indices = ref ? g_controller_reference_get_n_indices (ref) : 0;
+
+  changes->n_signals++;
+
+  if (action == G_CONTROLLER_ADD)
+    changes->n_added += n_indices;
+  else if (action == G_CONTROLLER_REMOVE)
+    changes->n_removed += n_indices;
+  else if (action == G_CONTROLLER_CLEAR)
+    changes->n_cleared++;
+}
+
+static void
+_test_notify_cb (GObject     *object,
+                 GParamSpec  *pspec,
+                 TestChanges *changes)
+{
+  changes->n_notifies++;
+}
+
+static void
+_test_wait_for_completion (MexGriloFeed *feed)
+{
+  while (!feed->priv->completed || feed->priv->items_to_add)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+void
+mex_test_grilo_feed_snapshot (void)
+{
+  const guint n_items = 2000, shift = 100;
+  TestChanges changes = { 0, };
+  MexTestSource *source;
+  MexGriloFeed *feed;
+  MexContent *content;
+  GController *controller;
+  GVariant *snapshot;
+  GError *error = NULL;
+  gint64 start, live_time, snapshot_time;
+  gchar *filename;
+  GList *keys;
+  gint fd;
+
+  source = g_object_new (mex_test_source_get_type (),
+                         "source-id", "mex-test-source",
+                         "source-name", "Test source",
+                         NULL);
+  source->n_items = n_items;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                    GRL_METADATA_KEY_TITLE,
+                                    NULL);
+
+  fd = g_file_open_tmp ("mex-test-snapshot-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  /* a cold start waits for the source */
+  feed = MEX_GRILO_FEED (mex_grilo_feed_new (GRL_SOURCE (source),
+                                             keys, keys, NULL));
+  start = g_get_monotonic_time ();
+  mex_grilo_feed_browse (feed, 0, G_MAXINT);
+  while (mex_model_get_length (MEX_MODEL (feed)) == 0)
+    g_main_context_iteration (NULL, TRUE);
+  live_time = g_get_monotonic_time () - start;
+
+  _test_wait_for_completion (feed);
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==, n_items);
+
+  snapshot = mex_grilo_feed_build_snapshot (feed);
+  mex_grilo_feed_write_snapshot (filename, snapshot, &error);
+  g_assert_no_error (error);
+  g_variant_unref (snapshot);
+  g_object_unref (feed);
+
+  /* the source lost its first items and gained as many while we were
+   * away, a warm start shows the old ones straight away */
+  source->first = shift;
+
+  feed = MEX_GRILO_FEED (mex_grilo_feed_new (GRL_SOURCE (source),
+                                             keys, keys, NULL));
+  start = g_get_monotonic_time ();
+  g_object_set (feed, "snapshot", filename, NULL);
+  snapshot_time = g_get_monotonic_time () - start;
+
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==, n_items);
+  content = MEX_CONTENT (mex_feed_lookup (MEX_FEED (feed), "0"));
+  g_assert (content != NULL);
+  g_assert_cmpstr (mex_content_get_metadata (content,
+                                             MEX_CONTENT_METADATA_TITLE),
+                   ==, "0");
+
+  g_test_message ("first column populated in %.1f ms from the snapshot, "
+                  "%.1f ms from the source",
+                  snapshot_time / 1000.0, live_time / 1000.0);
+  g_assert_cmpint (snapshot_time, <, live_time);
+
+  /* and only the differences are signalled when the source answers */
+  controller = mex_model_get_controller (MEX_MODEL (feed));
+  g_signal_connect (controller, "changed",
+                    G_CALLBACK (_test_controller_changed_cb), &changes);
+  content = MEX_CONTENT (mex_feed_lookup (MEX_FEED (feed), "500"));
+  g_signal_connect (content, "notify", G_CALLBACK (_test_notify_cb), &changes);
+
+  mex_grilo_feed_browse (feed, 0, G_MAXINT);
+  _test_wait_for_completion (feed);
+
+  g_assert_cmpuint (changes.n_added, ==, shift);
+  g_assert_cmpuint (changes.n_removed, ==, shift);
+  g_assert_cmpuint (changes.n_cleared, ==, 0);
+  g_assert_cmpuint (changes.n_notifies, ==, 0);
+
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==, n_items);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "0") == NULL);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "99") == NULL);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "500") == (MexProgram *) content);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "2099") != NULL);
+  g_assert_cmpuint (g_hash_table_size (feed->priv->stale), ==, 0);
+
+  g_signal_handlers_disconnect_by_func (content, _test_notify_cb, &changes);
+
+  /* the operations after that start from scratch */
+  changes.n_cleared = 0;
+  mex_grilo_feed_browse (feed, 0, G_MAXINT);
+  g_assert_cmpuint (changes.n_cleared, ==, 1);
+  _test_wait_for_completion (feed);
+
+  g_signal_handlers_disconnect_by_func (controller,
+                                        _test_controller_changed_cb,
+                                        &changes);
+  g_object_unref (feed);
+  g_object_unref (source);
+  g_list_free (keys);
+
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static GPtrArray *
+_test_build_changes (guint        first,
+                     guint        n_items,
+                     guint        step,
+                     const gchar *title_format)
+{
+  GPtrArray *medias = g_ptr_array_new_with_free_func (g_object_unref);
+  guint i;
+
+  for (i = first; i < first + n_items; i += step) {
+    GrlMedia *media = grl_media_video_new ();
+    gchar *id = g_strdup_printf ("%u", i);
+    gchar *title = g_strdup_printf (title_format, i);
+
+    grl_media_set_id (media, id);
+    grl_media_set_title (media, title);
+    g_ptr_array_add (medias, media);
+
+    g_free (title);
+    g_free (id);
+  }
+
+  return medias;
+}
+
+static gdouble
+_test_apply_changes (MexGriloFeed        *feed,
+                     GPtrArray           *medias,
+                     GrlSourceChangeType  change_type)
+{
+  MexGriloFeedClass *klass = MEX_GRILO_FEED_GET_CLASS (feed);
+
+  g_test_timer_start ();
+  klass->content_updated (feed->priv->source, medias, change_type, FALSE,
+                          feed);
+
+  return g_test_timer_elapsed () * 1000;
+}
+
+void
+mex_test_grilo_feed_content_updated (void)
+{
+  const guint n_items = 5000;
+  TestChanges changes = { 0, };
+  MexTestSource *source;
+  MexGriloFeed *feed;
+  MexContent *content;
+  GController *controller;
+  GPtrArray *medias;
+  gdouble elapsed;
+  GList *keys;
+
+  source = g_object_new (mex_test_source_get_type (),
+                         "source-id", "mex-test-source",
+                         "source-name", "Test source",
+                         NULL);
+  source->n_items = n_items;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                    GRL_METADATA_KEY_TITLE,
+                                    NULL);
+
+  feed = MEX_GRILO_FEED (mex_grilo_feed_new (GRL_SOURCE (source),
+                                             keys, keys, NULL));
+  mex_grilo_feed_browse (feed, 0, G_MAXINT);
+  _test_wait_for_completion (feed);
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==, n_items);
+
+  controller = mex_model_get_controller (MEX_MODEL (feed));
+  g_signal_connect (controller, "changed",
+                    G_CALLBACK (_test_controller_changed_cb), &changes);
+  content = MEX_CONTENT (mex_feed_lookup (MEX_FEED (feed), "42"));
+  g_signal_connect (content, "notify", G_CALLBACK (_test_notify_cb), &changes);
+
+  /* everything renamed, the model itself does not change */
+  medias = _test_build_changes (0, n_items, 1, "renamed %u");
+  elapsed = _test_apply_changes (feed, medias, GRL_CONTENT_CHANGED);
+  g_ptr_array_unref (medias);
+  g_test_message ("%u changes applied in %.1f ms", n_items, elapsed);
+
+  g_assert_cmpuint (changes.n_signals, ==, 0);
+  g_assert_cmpuint (changes.n_notifies, ==, 1);
+  g_assert_cmpstr (mex_content_get_metadata (content,
+                                             MEX_CONTENT_METADATA_TITLE),
+                   ==, "renamed 42");
+
+  g_signal_handlers_disconnect_by_func (content, _test_notify_cb, &changes);
+
+  /* every other item deleted, in one go */
+  medias = _test_build_changes (0, n_items, 2, "%u");
+  elapsed = _test_apply_changes (feed, medias, GRL_CONTENT_REMOVED);
+  g_ptr_array_unref (medias);
+  g_test_message ("%u removals applied in %.1f ms", n_items / 2, elapsed);
+
+  g_assert_cmpuint (changes.n_signals, ==, 1);
+  g_assert_cmpuint (changes.n_removed, ==, n_items / 2);
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==,
+                    n_items / 2);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "42") == NULL);
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "43") != NULL);
+
+  /* all of them back, the ones still there are only updated */
+  medias = _test_build_changes (0, n_items, 1, "added %u");
+  elapsed = _test_apply_changes (feed, medias, GRL_CONTENT_ADDED);
+  g_ptr_array_unref (medias);
+  g_test_message ("%u additions applied in %.1f ms", n_items, elapsed);
+
+  g_assert_cmpuint (changes.n_signals, ==, 2);
+  g_assert_cmpuint (changes.n_added, ==, n_items / 2);
+  g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feed)), ==, n_items);
+  content = MEX_CONTENT (mex_feed_lookup (MEX_FEED (feed), "4001"));
+  g_assert_cmpstr (mex_content_get_metadata (content,
+                                             MEX_CONTENT_METADATA_TITLE),
+                   ==, "added 4001");
+  g_assert (mex_feed_lookup (MEX_FEED (feed), "4000") != NULL);
+
+  g_signal_handlers_disconnect_by_func (controller,
+                                        _test_controller_changed_cb,
+                                        &changes);
+  g_object_unref (feed);
+  g_object_unref (source);
+  g_list_free (keys);
+}
+
+void
+mex_test_grilo_feed_shared_strings (void)
+{
+  MexGriloFeed *feeds[3];
+  const guint n_items = 5000, n_feeds = G_N_ELEMENTS (feeds);
+  MexStringPoolStats before, after;
+  MexContent *first, *content;
+  MexTestSource *source;
+  GList *keys;
+  guint i;
+
+  mex_string_pool_get_stats (&before);
+
+  /* the same videos in the library, the search results and a filtered
+   * feed */
+  source = g_object_new (mex_test_source_get_type (),
+                         "source-id", "mex-test-source",
+                         "source-name", "Test source",
+                         NULL);
+  source->n_items = n_items;
+  source->first = 1000000; /* ids no other test used */
+  source->with_uris = TRUE;
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_ID,
+                                    GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_URL,
+                                    GRL_METADATA_KEY_MIME,
+                                    NULL);
+
+  for (i = 0; i < n_feeds; i++) {
+    feeds[i] = MEX_GRILO_FEED (mex_grilo_feed_new (GRL_SOURCE (source),
+                                                   keys, keys, NULL));
+    mex_grilo_feed_browse (feeds[i], 0, G_MAXINT);
+    _test_wait_for_completion (feeds[i]);
+    g_assert_cmpuint (mex_model_get_length (MEX_MODEL (feeds[i])), ==,
+                      n_items);
+  }
+
+  /* one copy of each id, URL and mime type for all the feeds */
+  first = MEX_CONTENT (mex_feed_lookup (MEX_FEED (feeds[0]), "1001234"));
+  g_assert (first != NULL);
+  for (i = 1; i < n_feeds; i++) {
+    content = MEX_CONTENT (mex_feed_lookup (MEX_FEED (feeds[i]),
+                                            "1001234"));
+
+    g_assert (content != first);
+    g_assert (mex_content_get_metadata (content,
+                                        MEX_CONTENT_METADATA_STREAM) ==
+              mex_content_get_metadata (first,
+                                        MEX_CONTENT_METADATA_STREAM));
+    g_assert (mex_content_get_metadata (content,
+                                        MEX_CONTENT_METADATA_MIMETYPE) ==
+              mex_content_get_metadata (first,
+                                        MEX_CONTENT_METADATA_MIMETYPE));
+  }
+
+  mex_string_pool_get_stats (&after);
+  g_test_message ("%u contents in %u feeds: %u pooled strings taking "
+                  "%" G_GSIZE_FORMAT " bytes, "
+                  "%" G_GSIZE_FORMAT " bytes saved",
+                  n_items * n_feeds, n_feeds,
+                  after.n_strings - before.n_strings,
+                  after.n_bytes - before.n_bytes,
+                  after.n_bytes_saved - before.n_bytes_saved);
+
+  /* an id and a URL per video, and the mime type */
+  g_assert_cmpuint (after.n_strings - before.n_strings, ==, 2 * n_items + 1);
+  g_assert_cmpuint (after.n_bytes_saved - before.n_bytes_saved, >,
+                    (n_feeds - 1) * (after.n_bytes - before.n_bytes));
+
+  /* and they go away with the last feed */
+  for (i = 0; i < n_feeds; i++)
+    g_object_unref (feeds[i]);
+
+  mex_string_pool_get_stats (&after);
+  g_assert_cmpuint (after.n_strings, ==, before.n_strings);
+  g_assert_cmpuint (after.n_references, ==, before.n_references);
+
+  g_object_unref (source);
+  g_list_free (keys);
+}
+
+#endif
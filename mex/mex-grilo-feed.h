@@ -134,6 +134,9 @@ const MexGriloOperation *mex_grilo_feed_get_operation (MexGriloFeed *feed);
 
 gboolean mex_grilo_feed_get_completed (MexGriloFeed *feed);
 
+gchar *mex_grilo_feed_build_snapshot_filename (GrlSource   *source,
+                                               const gchar *name);
+
 void mex_grilo_feed_set_open_callback (MexGriloFeed       *feed,
                                        MexGriloFeedOpenCb  callback);
 
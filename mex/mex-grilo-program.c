@@ -23,6 +23,7 @@
 
 #include "mex-grilo.h"
 #include "mex-grilo-program.h"
+#include "mex-metadata-queue.h"
 #include "mex-thumbnailer.h"
 #include "mex-utils.h"
 
@@ -48,6 +49,7 @@ enum
 struct _MexGriloProgramPrivate
 {
   GrlMedia *media;
+  guint64   dirty_keys;
   guint     completed : 1;
   guint     in_update : 1;
   GPid      pid;
@@ -354,7 +356,10 @@ mex_grilo_program_set_metadata (MexContent         *content,
   MexContentIface        *iface, *parent_iface;
 
   if (!priv->in_update && key != MEX_CONTENT_METADATA_QUEUED)
-    mex_grilo_set_media_content_metadata (priv->media, key, value);
+    {
+      mex_grilo_set_media_content_metadata (priv->media, key, value);
+      priv->dirty_keys |= MEX_METADATA_KEY_MASK (key);
+    }
 
 
   iface = MEX_CONTENT_GET_IFACE (content);
@@ -363,36 +368,135 @@ mex_grilo_program_set_metadata (MexContent         *content,
   /* mex_grilo_program_set_metadata (content, key, value); */
 }
 
+typedef struct
+{
+  MexMetadataQueue *queue;
+  MexContent       *content;
+  guint64           keys;
+} StoreClosure;
+
 static void
-mex_grilo_program_save_metadata (MexContent *content)
+mex_grilo_program_store_cb (GrlSource    *source,
+                            GrlMedia     *media,
+                            GList        *failed_keys,
+                            gpointer      user_data,
+                            const GError *error)
+{
+  StoreClosure *closure = user_data;
+  guint64 failed = 0;
+  gint key;
+
+  if (error)
+    g_warning ("Could not save the metadata of %s: %s",
+               grl_media_get_id (media), error->message);
+
+  for (key = 0; key < MEX_CONTENT_METADATA_LAST_ID; key++)
+    {
+      GrlKeyID grl_key;
+
+      if (!(closure->keys & MEX_METADATA_KEY_MASK (key)))
+        continue;
+
+      grl_key = mex_grilo_get_grl_key (key);
+      if (g_list_find (failed_keys, GRLKEYID_TO_POINTER (grl_key)))
+        failed |= MEX_METADATA_KEY_MASK (key);
+    }
+
+  /* some sources don't say which keys failed */
+  if (error && !failed_keys)
+    failed = closure->keys;
+
+  mex_metadata_queue_write_done (closure->queue, closure->content, failed);
+
+  g_object_unref (closure->content);
+  g_slice_free (StoreClosure, closure);
+}
+
+/* Called by the metadata queue, with the keys changed since the last
+ * write: only the keys the source can write are sent to it */
+static void
+mex_grilo_program_write_metadata (MexMetadataQueue *queue,
+                                  MexContent       *content,
+                                  guint64           keys,
+                                  gpointer          user_data)
 {
   MexGriloProgram        *program = MEX_GRILO_PROGRAM (content);
   MexGriloProgramPrivate *priv    = program->priv;
+  StoreClosure           *closure;
   GrlSource              *source;
-  const GList *ckeys;
-  GList *keys;
+  const GList *writable;
+  GList *grl_keys = NULL;
+  guint64 written = 0;
+  gint key;
 
   g_object_get (G_OBJECT (mex_program_get_feed (MEX_PROGRAM (program))),
                 "grilo-source", &source,
                 NULL);
 
-  if (!(grl_source_supported_operations (GRL_SOURCE (source))
-        & GRL_OP_STORE_METADATA))
-    goto goout;
+  if (!source ||
+      !(grl_source_supported_operations (source) & GRL_OP_STORE_METADATA))
+    goto done;
 
-  ckeys = grl_source_writable_keys (GRL_SOURCE (source));
-  keys = g_list_copy ((GList *) ckeys);
+  writable = grl_source_writable_keys (source);
 
-  grl_source_store_metadata (GRL_SOURCE (source),
+  for (key = 0; key < MEX_CONTENT_METADATA_LAST_ID; key++)
+    {
+      gpointer grl_key;
+
+      if (!(keys & MEX_METADATA_KEY_MASK (key)))
+        continue;
+
+      grl_key = GRLKEYID_TO_POINTER (mex_grilo_get_grl_key (key));
+      if (!g_list_find ((GList *) writable, grl_key))
+        continue;
+
+      written |= MEX_METADATA_KEY_MASK (key);
+      if (!g_list_find (grl_keys, grl_key))
+        grl_keys = g_list_prepend (grl_keys, grl_key);
+    }
+
+  if (!grl_keys)
+    goto done;
+
+  closure = g_slice_new (StoreClosure);
+  closure->queue = queue;
+  closure->content = g_object_ref (content);
+  closure->keys = written;
+
+  grl_source_store_metadata (source,
                              priv->media,
-                             keys,
+                             grl_keys,
                              GRL_WRITE_NORMAL,
-                             NULL, NULL);
-
-  g_list_free (keys);
+                             mex_grilo_program_store_cb,
+                             closure);
 
- goout:
+  g_list_free (grl_keys);
   g_object_unref (source);
+  return;
+
+ done:
+  /* nothing this source can write */
+  mex_metadata_queue_write_done (queue, content, 0);
+
+  if (source)
+    g_object_unref (source);
+}
+
+static void
+mex_grilo_program_save_metadata (MexContent *content)
+{
+  MexGriloProgram        *program = MEX_GRILO_PROGRAM (content);
+  MexGriloProgramPrivate *priv    = program->priv;
+
+  if (!priv->dirty_keys)
+    return;
+
+  mex_metadata_queue_save (mex_metadata_queue_get_default (),
+                           content,
+                           priv->dirty_keys,
+                           mex_grilo_program_write_metadata,
+                           NULL);
+  priv->dirty_keys = 0;
 }
 
 static void
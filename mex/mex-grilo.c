@@ -1,6 +1,7 @@
 #include "mex-grilo.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include "mex-metadata-utils.h"
 
 #include <glib/gi18n.h>
@@ -87,6 +88,12 @@ _get_grl_key_from_mex (MexContentMetadata mex_key)
                                                           GSIZE_TO_POINTER (mex_key)));
 }
 
+GrlKeyID
+mex_grilo_get_grl_key (MexContentMetadata mex_key)
+{
+  return _get_grl_key_from_mex (mex_key);
+}
+
 /* static MexContentMetadata */
 /* _get_mex_key_from_grl (GrlKeyID grl_key) */
 /* { */
@@ -116,8 +123,8 @@ set_metadata_from_media (MexContent          *content,
       {
         if (mex_key == MEX_CONTENT_METADATA_TITLE)
           {
-            gchar *showname = NULL, *title, *season_str;
-            gint season, episode;
+            gchar *showname = NULL, *season_str;
+            gint season = 0, episode = 0;
             gchar *replacement;
             const gchar *mimetype;
 
@@ -129,7 +136,7 @@ set_metadata_from_media (MexContent          *content,
 
             if (g_str_has_prefix (mimetype, "video/"))
               {
-                mex_metadata_from_uri (cstring, &title, &showname, &year,
+                mex_metadata_from_uri (cstring, NULL, &showname, &year,
                                        &season, &episode);
               }
 
@@ -139,25 +146,26 @@ set_metadata_from_media (MexContent          *content,
               }
             else
               {
-                GRegex *regex;
-
-                /* strip off any file extensions */
-                regex = g_regex_new ("\\.....?$", 0, 0, NULL);
-                replacement = g_regex_replace (regex, cstring, -1, 0, "", 0, NULL);
-
-                g_regex_unref (regex);
+                gsize len = strlen (cstring);
+
+                /* strip off any 3 or 4 characters file extension */
+                if (len > 4 && cstring[len - 5] == '.')
+                  replacement = g_strndup (cstring, len - 5);
+                else if (len > 3 && cstring[len - 4] == '.')
+                  replacement = g_strndup (cstring, len - 4);
+                else
+                  replacement = g_strdup (cstring);
               }
 
-            if (!replacement)
-              replacement = g_strdup (cstring);
-
             mex_content_set_metadata (content, mex_key, replacement);
+            g_free (replacement);
             mex_content_set_metadata (content, MEX_CONTENT_METADATA_SERIES_NAME,
                                       showname);
             season_str = g_strdup_printf (_("Season %d"), season);
             mex_content_set_metadata (content, MEX_CONTENT_METADATA_SEASON,
                                       season_str);
             g_free (season_str);
+            g_free (showname);
 
             if (year)
               {
@@ -9,6 +9,8 @@ G_BEGIN_DECLS
 
 void mex_grilo_init (int *p_argc, char **p_argv[]);
 
+GrlKeyID mex_grilo_get_grl_key (MexContentMetadata mex_key);
+
 void mex_grilo_set_media_content_metadata (GrlMedia           *media,
                                            MexContentMetadata  mex_key,
                                            const gchar        *value);
@@ -0,0 +1,542 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <clutter/clutter.h>
+
+#include "mex-key-coalescer.h"
+
+/*
+ * Keys coming from a remote (LIRC, the D-Bus input interface) are not
+ * delivered as they arrive: they wait for an idle running once the input
+ * of the main loop iteration has been read, just before the stage is
+ * redrawn. A held button or a burst of the web remote then reaches the UI
+ * as runs of the same key, and a run of a navigation key is delivered in
+ * one go, its moves ending up in a single relayout and paint instead of
+ * one frame each.
+ *
+ * When the UI is too slow to keep up, the repeats of a navigation key that
+ * waited longer than the stale delay are dropped, the first press of the
+ * run is kept: focus stops moving soon after the button is released
+ * rather than catching up with every repeat the remote sent.
+ */
+
+#define KEY_COALESCER_STALE_DELAY  (200 * 1000)  /* us */
+
+G_DEFINE_TYPE (MexKeyCoalescer, mex_key_coalescer, G_TYPE_OBJECT)
+
+#define KEY_COALESCER_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_KEY_COALESCER, \
+                                MexKeyCoalescerPrivate))
+
+typedef struct
+{
+  guint  keyval;
+  gint64 time;    /* when it was pushed */
+} PendingKey;
+
+struct _MexKeyCoalescerPrivate
+{
+  GArray *pending;    /* PendingKeys, the oldest first */
+  guint   flush_id;
+
+  MexKeyCoalescerFunc  func;
+  gpointer             user_data;
+  GDestroyNotify       notify;
+
+  MexKeyCoalescerClock clock;
+  gint64               stale_delay;
+
+  MexKeyCoalescerStats stats;
+};
+
+static void
+mex_key_coalescer_dispose (GObject *object)
+{
+  MexKeyCoalescerPrivate *priv = MEX_KEY_COALESCER (object)->priv;
+
+  if (priv->flush_id)
+    {
+      g_source_remove (priv->flush_id);
+      priv->flush_id = 0;
+    }
+
+  if (priv->notify)
+    {
+      priv->notify (priv->user_data);
+      priv->notify = NULL;
+    }
+
+  G_OBJECT_CLASS (mex_key_coalescer_parent_class)->dispose (object);
+}
+
+static void
+mex_key_coalescer_finalize (GObject *object)
+{
+  MexKeyCoalescerPrivate *priv = MEX_KEY_COALESCER (object)->priv;
+
+  g_array_free (priv->pending, TRUE);
+
+  G_OBJECT_CLASS (mex_key_coalescer_parent_class)->finalize (object);
+}
+
+static void
+mex_key_coalescer_class_init (MexKeyCoalescerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MexKeyCoalescerPrivate));
+
+  object_class->dispose = mex_key_coalescer_dispose;
+  object_class->finalize = mex_key_coalescer_finalize;
+}
+
+static void
+mex_key_coalescer_init (MexKeyCoalescer *self)
+{
+  MexKeyCoalescerPrivate *priv = self->priv = KEY_COALESCER_PRIVATE (self);
+
+  priv->pending = g_array_new (FALSE, FALSE, sizeof (PendingKey));
+  priv->clock = g_get_monotonic_time;
+  priv->stale_delay = KEY_COALESCER_STALE_DELAY;
+}
+
+static gboolean
+is_navigation (guint keyval)
+{
+  switch (keyval)
+    {
+    case CLUTTER_KEY_Up:
+    case CLUTTER_KEY_Down:
+    case CLUTTER_KEY_Left:
+    case CLUTTER_KEY_Right:
+    case CLUTTER_KEY_Page_Up:
+    case CLUTTER_KEY_Page_Down:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+static void
+create_key_event (ClutterKeyEvent *event,
+                  ClutterEventType type,
+                  guint            keyval)
+{
+  ClutterDeviceManager *manager = clutter_device_manager_get_default ();
+
+  /* Event synthesis inspired/copied from Clutter X11 backend */
+  event->type = type;
+  event->flags = CLUTTER_EVENT_FLAG_SYNTHETIC;
+  event->time = 0L; /* Matches X11 CurrentTime */
+  event->keyval = keyval;
+  event->unicode_value = clutter_keysym_to_unicode (event->keyval);
+  event->device =
+    clutter_device_manager_get_core_device (manager, CLUTTER_KEYBOARD_DEVICE);
+}
+
+/* sends the presses and a release to the focused actor of the stages */
+static void
+deliver_keys (guint keyval,
+              guint count)
+{
+  ClutterStageManager *stage_manager = clutter_stage_manager_get_default ();
+  const GSList *s;
+
+  /* FIXME: We should probably check if the stage has focus via X */
+  for (s = clutter_stage_manager_peek_stages (stage_manager); s; s = s->next)
+    {
+      ClutterStage *stage = s->data;
+      ClutterEvent event = { 0, };
+      guint i;
+
+      for (i = 0; i < count; i++)
+        {
+          /* the focus moves with each press */
+          ClutterActor *actor = clutter_stage_get_key_focus (stage);
+
+          if (!actor)
+            break;
+
+          create_key_event (&event.key, CLUTTER_KEY_PRESS, keyval);
+          event.any.stage = stage;
+          event.any.source = actor;
+          clutter_do_event (&event);
+        }
+
+      if (i)
+        {
+          create_key_event (&event.key, CLUTTER_KEY_RELEASE, keyval);
+          event.any.stage = stage;
+          event.any.source = clutter_stage_get_key_focus (stage);
+          clutter_do_event (&event);
+        }
+    }
+}
+
+static void
+dispatch (MexKeyCoalescer *coalescer,
+          guint            keyval,
+          guint            count)
+{
+  MexKeyCoalescerPrivate *priv = coalescer->priv;
+
+  priv->stats.n_dispatches++;
+
+  if (priv->func)
+    priv->func (keyval, count, priv->user_data);
+  else
+    deliver_keys (keyval, count);
+}
+
+static gboolean
+flush_cb (MexKeyCoalescer *coalescer)
+{
+  coalescer->priv->flush_id = 0;
+
+  mex_key_coalescer_flush (coalescer);
+
+  return FALSE;
+}
+
+/**
+ * mex_key_coalescer_get_default:
+ *
+ * Returns: (transfer none): the coalescer of the remote controls
+ */
+MexKeyCoalescer *
+mex_key_coalescer_get_default (void)
+{
+  static MexKeyCoalescer *singleton = NULL;
+
+  if (G_LIKELY (singleton))
+    return singleton;
+
+  singleton = g_object_new (MEX_TYPE_KEY_COALESCER, NULL);
+  return singleton;
+}
+
+/**
+ * mex_key_coalescer_new:
+ *
+ * Most users want mex_key_coalescer_get_default().
+ *
+ * Returns: a new #MexKeyCoalescer
+ */
+MexKeyCoalescer *
+mex_key_coalescer_new (void)
+{
+  return g_object_new (MEX_TYPE_KEY_COALESCER, NULL);
+}
+
+/**
+ * mex_key_coalescer_set_func:
+ * @coalescer: a #MexKeyCoalescer
+ * @func: (allow-none): the function delivering the keys
+ * @user_data: data for @func
+ * @notify: (allow-none): frees @user_data
+ *
+ * Replaces the delivery of the keys to the focused actor of the stages.
+ */
+void
+mex_key_coalescer_set_func (MexKeyCoalescer     *coalescer,
+                            MexKeyCoalescerFunc  func,
+                            gpointer             user_data,
+                            GDestroyNotify       notify)
+{
+  MexKeyCoalescerPrivate *priv;
+
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+
+  priv = coalescer->priv;
+
+  if (priv->notify)
+    priv->notify (priv->user_data);
+
+  priv->func = func;
+  priv->user_data = user_data;
+  priv->notify = notify;
+}
+
+/**
+ * mex_key_coalescer_set_clock:
+ * @coalescer: a #MexKeyCoalescer
+ * @clock: the function giving the time, or %NULL
+ *
+ * Replaces the clock used to date the keys, g_get_monotonic_time() by
+ * default.
+ */
+void
+mex_key_coalescer_set_clock (MexKeyCoalescer      *coalescer,
+                             MexKeyCoalescerClock  clock)
+{
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+
+  coalescer->priv->clock = clock ? clock : g_get_monotonic_time;
+}
+
+/**
+ * mex_key_coalescer_set_stale_delay:
+ * @coalescer: a #MexKeyCoalescer
+ * @delay: a duration, in microseconds
+ *
+ * Sets how long the repeat of a navigation key can wait before being
+ * dropped, 200ms by default.
+ */
+void
+mex_key_coalescer_set_stale_delay (MexKeyCoalescer *coalescer,
+                                   gint64           delay)
+{
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+
+  coalescer->priv->stale_delay = delay;
+}
+
+gint64
+mex_key_coalescer_get_stale_delay (MexKeyCoalescer *coalescer)
+{
+  g_return_val_if_fail (MEX_IS_KEY_COALESCER (coalescer), 0);
+
+  return coalescer->priv->stale_delay;
+}
+
+/**
+ * mex_key_coalescer_push:
+ * @coalescer: a #MexKeyCoalescer
+ * @keyval: a key, see clutter-keysyms.h
+ *
+ * Queues a press of @keyval, delivered with the other keys pushed before
+ * the next redraw.
+ */
+void
+mex_key_coalescer_push (MexKeyCoalescer *coalescer,
+                        guint            keyval)
+{
+  MexKeyCoalescerPrivate *priv;
+  PendingKey key;
+
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+
+  priv = coalescer->priv;
+
+  key.keyval = keyval;
+  key.time = priv->clock ();
+  g_array_append_val (priv->pending, key);
+
+  priv->stats.n_keys++;
+
+  /* after the input sources of this iteration, before the redraw */
+  if (!priv->flush_id)
+    priv->flush_id = g_idle_add_full (CLUTTER_PRIORITY_REDRAW - 1,
+                                      (GSourceFunc) flush_cb, coalescer,
+                                      NULL);
+}
+
+/**
+ * mex_key_coalescer_flush:
+ * @coalescer: a #MexKeyCoalescer
+ *
+ * Delivers the keys pushed so far.
+ */
+void
+mex_key_coalescer_flush (MexKeyCoalescer *coalescer)
+{
+  MexKeyCoalescerPrivate *priv;
+  guint i, run_keyval = 0, run_count = 0;
+  GArray *keys;
+  gint64 now;
+
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+
+  priv = coalescer->priv;
+
+  if (priv->flush_id)
+    {
+      g_source_remove (priv->flush_id);
+      priv->flush_id = 0;
+    }
+
+  if (priv->pending->len == 0)
+    return;
+
+  /* the delivery can push more keys, they wait for the next flush */
+  keys = priv->pending;
+  priv->pending = g_array_new (FALSE, FALSE, sizeof (PendingKey));
+
+  now = priv->clock ();
+  priv->stats.n_flushes++;
+
+  for (i = 0; i < keys->len; i++)
+    {
+      PendingKey *key = &g_array_index (keys, PendingKey, i);
+      gint64 latency = now - key->time;
+
+      if (run_count && key->keyval == run_keyval && is_navigation (run_keyval))
+        {
+          if (latency > priv->stale_delay)
+            {
+              priv->stats.n_dropped++;
+              continue;
+            }
+
+          run_count++;
+        }
+      else
+        {
+          if (run_count)
+            dispatch (coalescer, run_keyval, run_count);
+
+          run_keyval = key->keyval;
+          run_count = 1;
+        }
+
+      priv->stats.total_latency += latency;
+      priv->stats.max_latency = MAX (priv->stats.max_latency, latency);
+    }
+
+  dispatch (coalescer, run_keyval, run_count);
+
+  g_array_free (keys, TRUE);
+}
+
+/**
+ * mex_key_coalescer_get_stats:
+ * @coalescer: a #MexKeyCoalescer
+ * @stats: (out caller-allocates): the counters of @coalescer
+ *
+ * Gets the counters of @coalescer. The mean latency of the delivered keys
+ * is @stats->total_latency / (@stats->n_keys - @stats->n_dropped), once
+ * the keys pushed have been flushed.
+ */
+void
+mex_key_coalescer_get_stats (MexKeyCoalescer      *coalescer,
+                             MexKeyCoalescerStats *stats)
+{
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+  g_return_if_fail (stats != NULL);
+
+  *stats = coalescer->priv->stats;
+}
+
+void
+mex_key_coalescer_reset_stats (MexKeyCoalescer *coalescer)
+{
+  g_return_if_fail (MEX_IS_KEY_COALESCER (coalescer));
+
+  memset (&coalescer->priv->stats, 0, sizeof (MexKeyCoalescerStats));
+}
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-test-internal.h"
+
+static gint64 fake_now = 0;
+
+static gint64
+_fake_clock (void)
+{
+  return fake_now;
+}
+
+static void
+_record_keys (guint    keyval,
+              guint    count,
+              GString *log)
+{
+  g_string_append_printf (log, "%s%s:%u", log->len ? " " : "",
+                          keyval == CLUTTER_KEY_Down ? "Down" :
+                          keyval == CLUTTER_KEY_Left ? "Left" :
+                          keyval == CLUTTER_KEY_Return ? "Return" : "?",
+                          count);
+}
+
+void
+mex_test_key_coalescer (void)
+{
+  MexKeyCoalescer *coalescer;
+  MexKeyCoalescerStats stats;
+  GString *log;
+  guint i;
+
+  log = g_string_new (NULL);
+  coalescer = mex_key_coalescer_new ();
+  mex_key_coalescer_set_clock (coalescer, _fake_clock);
+  mex_key_coalescer_set_func (coalescer, (MexKeyCoalescerFunc) _record_keys,
+                              log, NULL);
+
+  /* a burst reaches the UI as runs of the navigation keys, in order */
+  for (i = 0; i < 5; i++)
+    mex_key_coalescer_push (coalescer, CLUTTER_KEY_Down);
+  mex_key_coalescer_push (coalescer, CLUTTER_KEY_Return);
+  mex_key_coalescer_push (coalescer, CLUTTER_KEY_Return);
+  mex_key_coalescer_push (coalescer, CLUTTER_KEY_Down);
+  mex_key_coalescer_push (coalescer, CLUTTER_KEY_Left);
+  mex_key_coalescer_push (coalescer, CLUTTER_KEY_Left);
+  g_assert_cmpstr (log->str, ==, "");
+
+  /* once the main loop has read its input */
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+
+  g_assert_cmpstr (log->str, ==,
+                   "Down:5 Return:1 Return:1 Down:1 Left:2");
+  mex_key_coalescer_get_stats (coalescer, &stats);
+  g_assert_cmpuint (stats.n_keys, ==, 10);
+  g_assert_cmpuint (stats.n_dispatches, ==, 5);
+  g_assert_cmpuint (stats.n_flushes, ==, 1);
+  g_assert_cmpuint (stats.n_dropped, ==, 0);
+  g_assert_cmpint (stats.max_latency, ==, 0);
+
+  /* a button held while the UI was busy: a repeat every 20ms, delivered
+   * 300ms after the first one, only the repeats of the last 200ms go */
+  g_string_truncate (log, 0);
+  mex_key_coalescer_reset_stats (coalescer);
+
+  for (i = 0; i < 15; i++)
+    {
+      mex_key_coalescer_push (coalescer, CLUTTER_KEY_Down);
+      fake_now += 20 * 1000;
+    }
+  fake_now += 20 * 1000;
+  mex_key_coalescer_flush (coalescer);
+
+  g_assert_cmpstr (log->str, ==, "Down:10");
+  mex_key_coalescer_get_stats (coalescer, &stats);
+  g_assert_cmpuint (stats.n_keys, ==, 15);
+  g_assert_cmpuint (stats.n_dropped, ==, 5);
+  g_assert_cmpint (stats.max_latency, ==, 320 * 1000);
+  /* the kept press waited 320ms, the repeats 200ms down to 40ms */
+  g_assert_cmpint (stats.total_latency, ==, (320 + 1080) * 1000);
+
+  /* nothing is left to deliver */
+  g_string_truncate (log, 0);
+  mex_key_coalescer_flush (coalescer);
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+  g_assert_cmpstr (log->str, ==, "");
+
+  g_object_unref (coalescer);
+  g_string_free (log, TRUE);
+}
+
+#endif /* ENABLE_TESTS */
@@ -0,0 +1,124 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __MEX_KEY_COALESCER_H__
+#define __MEX_KEY_COALESCER_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_KEY_COALESCER mex_key_coalescer_get_type()
+
+#define MEX_KEY_COALESCER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MEX_TYPE_KEY_COALESCER, MexKeyCoalescer))
+
+#define MEX_KEY_COALESCER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), MEX_TYPE_KEY_COALESCER, MexKeyCoalescerClass))
+
+#define MEX_IS_KEY_COALESCER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MEX_TYPE_KEY_COALESCER))
+
+#define MEX_IS_KEY_COALESCER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), MEX_TYPE_KEY_COALESCER))
+
+#define MEX_KEY_COALESCER_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), MEX_TYPE_KEY_COALESCER, MexKeyCoalescerClass))
+
+typedef struct _MexKeyCoalescer MexKeyCoalescer;
+typedef struct _MexKeyCoalescerClass MexKeyCoalescerClass;
+typedef struct _MexKeyCoalescerPrivate MexKeyCoalescerPrivate;
+
+struct _MexKeyCoalescer
+{
+  GObject parent;
+
+  MexKeyCoalescerPrivate *priv;
+};
+
+struct _MexKeyCoalescerClass
+{
+  GObjectClass parent_class;
+};
+
+/**
+ * MexKeyCoalescerStats:
+ * @n_keys: the keys pushed
+ * @n_dropped: the repeats dropped for having waited too long
+ * @n_dispatches: the runs of keys delivered
+ * @n_flushes: the times the waiting keys were delivered
+ * @total_latency: the time the delivered keys waited, in microseconds
+ * @max_latency: the longest time a delivered key waited, in microseconds
+ *
+ * What a #MexKeyCoalescer did since it was created or its counters reset.
+ */
+typedef struct
+{
+  guint  n_keys;
+  guint  n_dropped;
+  guint  n_dispatches;
+  guint  n_flushes;
+  gint64 total_latency;
+  gint64 max_latency;
+} MexKeyCoalescerStats;
+
+/**
+ * MexKeyCoalescerClock:
+ *
+ * Returns the current time in microseconds, see g_get_monotonic_time().
+ */
+typedef gint64 (*MexKeyCoalescerClock) (void);
+
+/**
+ * MexKeyCoalescerFunc:
+ * @keyval: the key
+ * @count: how many times in a row it was pushed
+ * @user_data: the data given to mex_key_coalescer_set_func()
+ *
+ * Delivers @count presses of @keyval.
+ */
+typedef void (*MexKeyCoalescerFunc) (guint    keyval,
+                                     guint    count,
+                                     gpointer user_data);
+
+GType             mex_key_coalescer_get_type        (void) G_GNUC_CONST;
+
+MexKeyCoalescer * mex_key_coalescer_get_default     (void);
+MexKeyCoalescer * mex_key_coalescer_new             (void);
+
+void              mex_key_coalescer_set_func        (MexKeyCoalescer      *coalescer,
+                                                     MexKeyCoalescerFunc   func,
+                                                     gpointer              user_data,
+                                                     GDestroyNotify        notify);
+void              mex_key_coalescer_set_clock       (MexKeyCoalescer      *coalescer,
+                                                     MexKeyCoalescerClock  clock);
+void              mex_key_coalescer_set_stale_delay (MexKeyCoalescer      *coalescer,
+                                                     gint64                delay);
+gint64            mex_key_coalescer_get_stale_delay (MexKeyCoalescer      *coalescer);
+
+void              mex_key_coalescer_push            (MexKeyCoalescer      *coalescer,
+                                                     guint                 keyval);
+void              mex_key_coalescer_flush           (MexKeyCoalescer      *coalescer);
+
+void              mex_key_coalescer_get_stats       (MexKeyCoalescer      *coalescer,
+                                                     MexKeyCoalescerStats *stats);
+void              mex_key_coalescer_reset_stats     (MexKeyCoalescer      *coalescer);
+
+G_END_DECLS
+
+#endif /* __MEX_KEY_COALESCER_H__ */
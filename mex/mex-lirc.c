@@ -27,75 +27,17 @@
 
 #include "mex-log.h"
 #include "mex-utils.h"
+#include "mex-key-coalescer.h"
 #include "mex-lirc.h"
 
 static struct lirc_config *mex_lirc_config = NULL;
 
-static void
-mex_lirc_do_event (ClutterEvent *event)
-{
-  const GSList *s;
-
-  ClutterStageManager *stage_manager = clutter_stage_manager_get_default ();
-  const GSList *stages = clutter_stage_manager_peek_stages (stage_manager);
-
-  /* FIXME: We should probably check if the stage has focus via X */
-  for (s = stages; s; s = s->next)
-    {
-      ClutterStage *stage = s->data;
-      ClutterActor *actor = clutter_stage_get_key_focus (stage);
-
-      if (!actor)
-        continue;
-
-      event->any.stage = stage;
-      event->any.source = actor;
-
-      clutter_do_event (event);
-    }
-}
-
-static void
-mex_lirc_create_key_event (ClutterKeyEvent *event, guint keyval)
-{
-  ClutterDeviceManager *manager = clutter_device_manager_get_default ();
-
-  /* Event synthesis inspired/copied from Clutter X11 backend */
-  event->flags = CLUTTER_EVENT_FLAG_SYNTHETIC;
-  event->time = 0L; /* Matches X11 CurrentTime */
-  event->keyval = keyval;
-  event->unicode_value = clutter_keysym_to_unicode (event->keyval);
-  event->device =
-    clutter_device_manager_get_core_device (manager, CLUTTER_KEYBOARD_DEVICE);
-}
-
-static gboolean
-mex_lirc_key_release_cb (gpointer keyval_p)
-{
-  ClutterEvent release = { 0, };
-  guint keyval = GPOINTER_TO_UINT (keyval_p);
-
-  mex_lirc_create_key_event ((ClutterKeyEvent *)&release.key, keyval);
-  release.type = release.key.type = CLUTTER_KEY_RELEASE;
-
-  mex_lirc_do_event (&release);
-
-  return FALSE;
-}
-
+/* held buttons repeat, the coalescer delivers the repeats as runs and
+ * drops the ones the UI could not keep up with */
 static void
 mex_lirc_do_key_event (guint keyval)
 {
-  ClutterEvent press = { 0, };
-
-  mex_lirc_create_key_event ((ClutterKeyEvent *)&press.key, keyval);
-  press.type = press.key.type = CLUTTER_KEY_PRESS;
-
-  mex_lirc_do_event ((ClutterEvent *)&press);
-
-  g_timeout_add (50,
-                 (GSourceFunc)mex_lirc_key_release_cb,
-                 GUINT_TO_POINTER (keyval));
+  mex_key_coalescer_push (mex_key_coalescer_get_default (), keyval);
 }
 
 static gboolean
@@ -328,8 +328,10 @@ _mex_log_init_core_domains (void)
   DOMAIN_INIT (applet_manager_log_domain, "applet-manager");
   DOMAIN_INIT (channel_log_domain, "channel");
   DOMAIN_INIT (download_queue_log_domain, "download-queue");
+  DOMAIN_INIT (metadata_queue_log_domain, "metadata-queue");
   DOMAIN_INIT (surface_player_log_domain, "surface-player");
   DOMAIN_INIT (player_log_domain, "player");
+  DOMAIN_INIT (startup_log_domain, "startup");
 
   /* Retrieve the MEX_DEBUG environment variable, initialize core domains from
    * it if applicable and keep it for mex_log_domain_new(). Plugins are using
@@ -361,6 +363,8 @@ _mex_log_free_core_domains (void)
   DOMAIN_FREE (applet_manager_log_domain);
   DOMAIN_FREE (channel_log_domain);
   DOMAIN_FREE (download_queue_log_domain);
+  DOMAIN_FREE (metadata_queue_log_domain);
+  DOMAIN_FREE (startup_log_domain);
 
   g_strfreev (mex_log_env);
 }
@@ -35,9 +35,20 @@ G_DEFINE_INTERFACE (MexLogoProvider,
                     mex_logo_provider,
                     G_TYPE_INVALID);
 
+static void     mex_logo_provider_real_get_channel_logo_async  (MexLogoProvider     *provider,
+                                                                MexChannel          *channel,
+                                                                GCancellable        *cancellable,
+                                                                GAsyncReadyCallback  callback,
+                                                                gpointer             user_data);
+static gchar *  mex_logo_provider_real_get_channel_logo_finish (MexLogoProvider  *provider,
+                                                                GAsyncResult     *result,
+                                                                GError          **error);
+
 static void
 mex_logo_provider_default_init (MexLogoProviderInterface *klass)
 {
+  klass->get_channel_logo_async = mex_logo_provider_real_get_channel_logo_async;
+  klass->get_channel_logo_finish = mex_logo_provider_real_get_channel_logo_finish;
 }
 
 /**
@@ -67,3 +78,121 @@ mex_logo_provider_get_channel_logo (MexLogoProvider *provider,
 
   return NULL;
 }
+
+/* by default, call get_channel_logo() from the main loop: the providers
+ * were written for it and need not be thread-safe, the lookups are only
+ * spread over several iterations */
+
+static gboolean
+get_channel_logo_idle (GSimpleAsyncResult *result)
+{
+  GObject *provider;
+  MexChannel *channel;
+  GCancellable *cancellable;
+  gchar *logo;
+
+  cancellable = g_object_get_data (G_OBJECT (result), "cancellable");
+  if (cancellable == NULL || !g_cancellable_is_cancelled (cancellable))
+    {
+      provider = g_async_result_get_source_object (G_ASYNC_RESULT (result));
+      channel = g_object_get_data (G_OBJECT (result), "channel");
+      logo = mex_logo_provider_get_channel_logo (MEX_LOGO_PROVIDER (provider),
+                                                 channel);
+      g_object_unref (provider);
+
+      g_simple_async_result_set_op_res_gpointer (result, logo, g_free);
+    }
+
+  /* reports the cancellation, if any */
+  g_simple_async_result_complete (result);
+
+  return FALSE;
+}
+
+static void
+mex_logo_provider_real_get_channel_logo_async (MexLogoProvider     *provider,
+                                               MexChannel          *channel,
+                                               GCancellable        *cancellable,
+                                               GAsyncReadyCallback  callback,
+                                               gpointer             user_data)
+{
+  GSimpleAsyncResult *result;
+
+  result = g_simple_async_result_new (G_OBJECT (provider), callback, user_data,
+                                      mex_logo_provider_real_get_channel_logo_async);
+  g_simple_async_result_set_check_cancellable (result, cancellable);
+  g_object_set_data_full (G_OBJECT (result), "channel",
+                          g_object_ref (channel), g_object_unref);
+  if (cancellable)
+    g_object_set_data_full (G_OBJECT (result), "cancellable",
+                            g_object_ref (cancellable), g_object_unref);
+
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                   (GSourceFunc) get_channel_logo_idle,
+                   result, g_object_unref);
+}
+
+static gchar *
+mex_logo_provider_real_get_channel_logo_finish (MexLogoProvider  *provider,
+                                                GAsyncResult     *result,
+                                                GError          **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return NULL;
+
+  return g_strdup (g_simple_async_result_get_op_res_gpointer (simple));
+}
+
+/**
+ * mex_logo_provider_get_channel_logo_async:
+ * @provider: a #MexLogoProvider
+ * @channel: a #MexChannel
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called with the logo of @channel
+ * @user_data: data to give to @callback
+ *
+ * Looks for the logo of @channel without blocking. Providers that don't
+ * implement it have their get_channel_logo() called from an idle of the
+ * main loop, one channel at a time.
+ */
+void
+mex_logo_provider_get_channel_logo_async (MexLogoProvider     *provider,
+                                          MexChannel          *channel,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data)
+{
+  MexLogoProviderInterface *iface;
+
+  g_return_if_fail (MEX_IS_LOGO_PROVIDER (provider));
+  g_return_if_fail (MEX_IS_CHANNEL (channel));
+
+  iface = MEX_LOGO_PROVIDER_GET_IFACE (provider);
+
+  iface->get_channel_logo_async (provider, channel, cancellable,
+                                 callback, user_data);
+}
+
+/**
+ * mex_logo_provider_get_channel_logo_finish:
+ * @provider: a #MexLogoProvider
+ * @result: the #GAsyncResult given to the callback
+ * @error: return location for a #GError, or %NULL
+ *
+ * Returns: the URI of the logo, or %NULL
+ */
+gchar *
+mex_logo_provider_get_channel_logo_finish (MexLogoProvider  *provider,
+                                           GAsyncResult     *result,
+                                           GError          **error)
+{
+  MexLogoProviderInterface *iface;
+
+  g_return_val_if_fail (MEX_IS_LOGO_PROVIDER (provider), NULL);
+
+  iface = MEX_LOGO_PROVIDER_GET_IFACE (provider);
+
+  return iface->get_channel_logo_finish (provider, result, error);
+}
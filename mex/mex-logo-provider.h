@@ -21,6 +21,7 @@
 #define __MEX_LOGO_PROVIDER_H__
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include <mex/mex-channel.h>
 
@@ -54,8 +55,18 @@ struct _MexLogoProviderInterface
 {
   GTypeInterface g_iface;
 
+  /* called from the main loop, also by the default get_channel_logo_async */
   gchar * (*get_channel_logo) (MexLogoProvider *provider,
                                MexChannel      *channel);
+
+  void    (*get_channel_logo_async)  (MexLogoProvider     *provider,
+                                      MexChannel          *channel,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data);
+  gchar * (*get_channel_logo_finish) (MexLogoProvider  *provider,
+                                      GAsyncResult     *result,
+                                      GError          **error);
 };
 
 GType       mex_logo_provider_get_type          (void) G_GNUC_CONST;
@@ -63,6 +74,15 @@ GType       mex_logo_provider_get_type          (void) G_GNUC_CONST;
 gchar *     mex_logo_provider_get_channel_logo  (MexLogoProvider *provider,
                                                  MexChannel      *channel);
 
+void        mex_logo_provider_get_channel_logo_async  (MexLogoProvider     *provider,
+                                                       MexChannel          *channel,
+                                                       GCancellable        *cancellable,
+                                                       GAsyncReadyCallback  callback,
+                                                       gpointer             user_data);
+gchar *     mex_logo_provider_get_channel_logo_finish (MexLogoProvider  *provider,
+                                                       GAsyncResult     *result,
+                                                       GError          **error);
+
 G_END_DECLS
 
 #endif /* __MEX_LOGO_PROVIDER_H__ */
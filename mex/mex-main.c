@@ -30,7 +30,9 @@
 #include "mex-content.h"
 #include "mex-settings.h"
 #include "mex-log-private.h"
+#include "mex-metadata-queue.h"
 #include "mex-model-manager.h"
+#include "mex-private.h"
 #include "mex-grilo.h"
 #include "mex-vt-manager.h"
 
@@ -82,27 +84,90 @@ mex_init_default_categories (void)
 }
 
 
+static const gchar *grilo_default_plugins[] =
+{
+  "grl-tracker",
+  "grl-upnp",
+  "grl-filesystem",
+  "grl-lastfm-albumart",
+  NULL
+};
+
+/* Grilo plugins left to load and the idle source loading them */
+static gchar **grilo_pending_plugins = NULL;
+static guint   grilo_next_plugin = 0;
+static guint   grilo_load_id = 0;
+
 static void
-grilo_load_default_plugins (GrlRegistry *registry)
+mex_grilo_load_next_plugin (void)
 {
-  grl_registry_load_plugin_by_id (registry, "grl-tracker", NULL);
+  GrlRegistry *registry;
+  const gchar *plugin_id;
+  GError *error = NULL;
+  gint64 start;
+
+  registry = grl_registry_get_default ();
+  plugin_id = grilo_pending_plugins[grilo_next_plugin++];
 
-  grl_registry_load_plugin_by_id (registry, "grl-upnp", NULL);
-  grl_registry_load_plugin_by_id (registry, "grl-filesystem", NULL);
+  start = g_get_monotonic_time ();
+
+  if (!grl_registry_load_plugin_by_id (registry, plugin_id, &error))
+    {
+      g_warning ("Tried to load specified grilo plugin: %s but failed: %s",
+                 plugin_id, (error) ? error->message : "");
 
-  grl_registry_load_plugin_by_id (registry, "grl-lastfm-albumart", NULL);
+      if (error)
+        g_clear_error (&error);
+    }
+  else
+    {
+      MEX_DEBUG ("Loaded grilo plugin: %s plugin", plugin_id);
+    }
+
+  _mex_startup_timeline_add (plugin_id, "grilo", start);
+}
+
+static gboolean
+mex_grilo_load_plugins_idle_cb (gpointer data)
+{
+  if (grilo_pending_plugins && grilo_pending_plugins[grilo_next_plugin])
+    {
+      mex_grilo_load_next_plugin ();
+      return TRUE;
+    }
+
+  g_strfreev (grilo_pending_plugins);
+  grilo_pending_plugins = NULL;
+  grilo_load_id = 0;
+
+  return FALSE;
+}
+
+/*
+ * _mex_grilo_plugins_ensure_loaded:
+ *
+ * Finishes loading the Grilo plugins queued by mex_init(), for code that
+ * needs the Grilo sources to be registered right now.
+ */
+void
+_mex_grilo_plugins_ensure_loaded (void)
+{
+  while (grilo_pending_plugins && grilo_pending_plugins[grilo_next_plugin])
+    mex_grilo_load_next_plugin ();
 }
 
 /**
  * mex_init_load_plugins:
  *
- * Load the Grilo plugins.
+ * Queue the Grilo plugins to load. Loading some of them (tracker, upnp, ...)
+ * is expensive, so it's done one plugin per main loop iteration, the sources
+ * being announced with GrlRegistry::source-added as usual.
  */
 static void
 mex_init_load_grilo_plugins (void)
 {
   GrlRegistry *registry;
-  GError *error = NULL;
+  gchar **enabled_plugins = NULL;
   gchar *settings;
 
   registry = grl_registry_get_default ();
@@ -121,7 +186,6 @@ mex_init_load_grilo_plugins (void)
   if (settings)
     {
       GKeyFile *mex_conf;
-      gchar **enabled_plugins;
 
       mex_conf = g_key_file_new ();
 
@@ -137,44 +201,22 @@ mex_init_load_grilo_plugins (void)
                                                     NULL);
       g_key_file_free (mex_conf);
 
-      if (enabled_plugins)
-        {
-          gint i;
-
-          for (i=0; enabled_plugins[i]; i++)
-            {
-              if (!grl_registry_load_plugin_by_id (registry,
-                                                   enabled_plugins[i],
-                                                   &error))
-                {
-                  g_warning ("Tried to load specified grilo plugin: %s but failed: %s",
-                             enabled_plugins[i],
-                             (error) ? error->message : "");
-
-                  if (error)
-                    g_clear_error (&error);
-                }
-              else
-                {
-                  MEX_DEBUG ("Loaded grilo plugin: %s plugin",
-                             enabled_plugins[i]);
-                }
-            }
-          g_strfreev (enabled_plugins);
-        }
-      else
-        {
-          MEX_DEBUG ("No enabled plugins in mex.conf, loading default plugins");
-          grilo_load_default_plugins (registry);
-        }
+      if (!enabled_plugins)
+        MEX_DEBUG ("No enabled plugins in mex.conf, loading default plugins");
+
       g_free (settings);
     }
   else
     {
       MEX_DEBUG ("No mex.conf found, loading default plugins");
-      grilo_load_default_plugins (registry);
     }
 
+  if (!enabled_plugins)
+    enabled_plugins = g_strdupv ((gchar **) grilo_default_plugins);
+
+  grilo_pending_plugins = enabled_plugins;
+  grilo_next_plugin = 0;
+  grilo_load_id = g_idle_add (mex_grilo_load_plugins_idle_cb, NULL);
 }
 
 /**
@@ -312,6 +354,18 @@ mex_init (int    *argc,
 void
 mex_deinit (void)
 {
+  if (grilo_load_id)
+    {
+      g_source_remove (grilo_load_id);
+      grilo_load_id = 0;
+    }
+  g_strfreev (grilo_pending_plugins);
+  grilo_pending_plugins = NULL;
+  grilo_next_plugin = 0;
+
+  /* don't lose the play counts and positions of the last contents */
+  mex_metadata_queue_flush (mex_metadata_queue_get_default ());
+
   mex_set_main_window (NULL);
   mex_vt_manager_deinit ();
 }
@@ -21,7 +21,7 @@
 #endif
 
 #include "mex-media-controls.h"
-#include "mex-view-model.h"
+#include "mex-generic-model.h"
 #include "mex-proxy.h"
 #include "mex-content-tile.h"
 #include "mex-queue-model.h"
@@ -38,6 +38,9 @@
 #include <glib/gi18n-lib.h>
 
 static void mx_focusable_iface_init (MxFocusableIface *iface);
+static void mex_media_controls_set_context (MexMediaControls *self,
+                                            MexModel         *context);
+static void mex_media_controls_update_window (MexMediaControls *self);
 
 G_DEFINE_TYPE_WITH_CODE (MexMediaControls, mex_media_controls, MX_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE (MX_TYPE_FOCUSABLE,
@@ -84,9 +87,13 @@ struct _MexMediaControlsPrivate
   guint show_description : 1;
 
   MexModel   *model;
-  MexViewModel *proxy_model;
+  MexModel   *window;
+  guint       update_window_id;
 };
 
+/* Number of related items shown, starting from the current content */
+#define RELATED_WINDOW_SIZE 24
+
 enum
 {
   STOPPED,
@@ -183,11 +190,7 @@ mex_media_controls_dispose (GObject *object)
       priv->content = NULL;
     }
 
-  if (priv->model)
-    {
-      g_object_unref (priv->model);
-      priv->model = NULL;
-    }
+  mex_media_controls_set_context (self, NULL);
 
   if (priv->proxy)
     {
@@ -195,10 +198,10 @@ mex_media_controls_dispose (GObject *object)
       priv->proxy = NULL;
     }
 
-  if (priv->proxy_model)
+  if (priv->window)
     {
-      g_object_unref (priv->proxy_model);
-      priv->proxy_model = NULL;
+      g_object_unref (priv->window);
+      priv->window = NULL;
     }
 
   if (priv->script)
@@ -314,6 +317,8 @@ mex_media_controls_map (ClutterActor *actor)
   CLUTTER_ACTOR_CLASS (mex_media_controls_parent_class)->map (actor);
 
   clutter_actor_map (priv->vbox);
+
+  mex_proxy_set_priority (priv->proxy, MEX_PROXY_PRIORITY_VISIBLE);
 }
 
 static void
@@ -324,17 +329,15 @@ mex_media_controls_unmap (ClutterActor *actor)
   CLUTTER_ACTOR_CLASS (mex_media_controls_parent_class)->unmap (actor);
 
   clutter_actor_unmap (priv->vbox);
-  g_object_set (G_OBJECT (priv->proxy_model), "model", NULL, NULL);
+  if (priv->proxy)
+    mex_proxy_set_priority (priv->proxy, MEX_PROXY_PRIORITY_HIDDEN);
+  mex_model_clear (priv->window);
   if (priv->content)
     {
       g_object_unref (priv->content);
       priv->content = NULL;
     }
-  if (priv->model)
-    {
-      g_object_unref (priv->model);
-      priv->model = NULL;
-    }
+  mex_media_controls_set_context (MEX_MEDIA_CONTROLS (actor), NULL);
 }
 
 static void
@@ -508,6 +511,148 @@ mex_media_controls_update_header (MexMediaControls *self)
                                                MEX_CONTENT_METADATA_SYNOPSIS));
 }
 
+/**
+ * mex_media_controls_sync_window:
+ *
+ * Fill @window with @size contents of @context, starting at @start and
+ * wrapping around. When the window only moves forward, the contents it
+ * already has are kept so that their tiles are not created again.
+ */
+static void
+mex_media_controls_sync_window (MexModel *window,
+                                MexModel *context,
+                                guint     start,
+                                guint     size)
+{
+  guint i, length, n_kept = 0;
+  MexContent *content;
+  gint first;
+
+  length = context ? mex_model_get_length (context) : 0;
+  size = MIN (size, length);
+
+  if (size == 0)
+    {
+      mex_model_clear (window);
+      return;
+    }
+
+  start %= length;
+
+  /* find how much of the window is still in place */
+  content = mex_model_get_content (context, start);
+  first = mex_model_index (window, content);
+  if (first >= 0)
+    {
+      guint window_length = mex_model_get_length (window);
+
+      while (first + n_kept < window_length && n_kept < size)
+        {
+          content = mex_model_get_content (context,
+                                           (start + n_kept) % length);
+          if (mex_model_get_content (window, first + n_kept) != content)
+            break;
+
+          n_kept++;
+        }
+    }
+
+  if (n_kept == 0)
+    mex_model_clear (window);
+  else
+    {
+      while (mex_model_get_length (window) > (guint) first + n_kept)
+        {
+          content = mex_model_get_content (window, first + n_kept);
+          mex_model_remove_content (window, content);
+        }
+
+      for (i = 0; i < (guint) first; i++)
+        {
+          content = mex_model_get_content (window, 0);
+          mex_model_remove_content (window, content);
+        }
+    }
+
+  for (i = n_kept; i < size; i++)
+    {
+      content = mex_model_get_content (context, (start + i) % length);
+      mex_model_add_content (window, content);
+    }
+}
+
+static void
+mex_media_controls_update_window (MexMediaControls *self)
+{
+  MexMediaControlsPrivate *priv = self->priv;
+  gint start = -1;
+
+  if (priv->model && priv->content)
+    start = mex_model_index (priv->model, priv->content);
+
+  if (start < 0)
+    mex_model_clear (priv->window);
+  else
+    mex_media_controls_sync_window (priv->window, priv->model, start,
+                                    RELATED_WINDOW_SIZE);
+}
+
+static gboolean
+mex_media_controls_update_window_cb (MexMediaControls *self)
+{
+  self->priv->update_window_id = 0;
+  mex_media_controls_update_window (self);
+
+  return FALSE;
+}
+
+static void
+mex_media_controls_context_changed_cb (GController          *controller,
+                                       GControllerAction     action,
+                                       GControllerReference *ref,
+                                       MexMediaControls     *self)
+{
+  MexMediaControlsPrivate *priv = self->priv;
+
+  /* removed contents are still in the context when the signal is emitted,
+   * and contents tend to come in bursts, so wait for things to settle */
+  if (action != G_CONTROLLER_UPDATE && !priv->update_window_id)
+    priv->update_window_id =
+      g_idle_add ((GSourceFunc) mex_media_controls_update_window_cb, self);
+}
+
+static void
+mex_media_controls_set_context (MexMediaControls *self,
+                                MexModel         *context)
+{
+  MexMediaControlsPrivate *priv = self->priv;
+
+  if (priv->model)
+    {
+      g_signal_handlers_disconnect_by_func (
+        mex_model_get_controller (priv->model),
+        mex_media_controls_context_changed_cb,
+        self);
+      g_object_unref (priv->model);
+      priv->model = NULL;
+    }
+
+  if (priv->update_window_id)
+    {
+      g_source_remove (priv->update_window_id);
+      priv->update_window_id = 0;
+    }
+
+  if (context)
+    {
+      priv->model = g_object_ref_sink (context);
+      g_signal_connect_after (mex_model_get_controller (priv->model),
+                              "changed",
+                              G_CALLBACK (mex_media_controls_context_changed_cb),
+                              self);
+    }
+}
+
 static void
 mex_media_controls_replace_content (MexMediaControls *self,
                                     MexContent       *content)
@@ -527,6 +672,7 @@ mex_media_controls_replace_content (MexMediaControls *self,
     g_object_unref (priv->content);
   priv->content = g_object_ref_sink (content);
   mex_media_controls_update_header (self);
+  mex_media_controls_update_window (self);
 
   mex_push_focus ((MxFocusable*) clutter_script_get_object (priv->script,
                                               "play-pause-button"));
@@ -725,17 +871,17 @@ mex_media_controls_init (MexMediaControls *self)
 
   /* proxy setup */
 
-  priv->proxy_model = MEX_VIEW_MODEL (mex_view_model_new (NULL));
-  /* FIXME: Set an arbitrary 200-item limit as we can't handle large
-   *        amounts of actors without massive slow-down.
+  /* Only a window of the context is shown, as creating a tile for every
+   * item of a large context is far too slow.
    */
-  mex_view_model_set_limit (priv->proxy_model, 200);
+  priv->window = mex_generic_model_new (NULL, NULL);
 
   related_box = (ClutterActor *) clutter_script_get_object (priv->script,
                                                             "related-box");
-  priv->proxy = mex_content_proxy_new (MEX_MODEL (priv->proxy_model),
+  priv->proxy = mex_content_proxy_new (priv->window,
                                        CLUTTER_CONTAINER (related_box),
                                        MEX_TYPE_CONTENT_TILE);
+  mex_proxy_set_priority (priv->proxy, MEX_PROXY_PRIORITY_HIDDEN);
 
   g_signal_connect (priv->proxy, "object-created", G_CALLBACK (tile_created_cb),
                     self);
@@ -1086,18 +1232,13 @@ mex_media_controls_set_content (MexMediaControls *self,
       if (content)
         priv->content = g_object_ref_sink (content);
 
+      mex_media_controls_update_window (self);
       mex_media_controls_focus_content (self, priv->content);
       mex_media_controls_update_header (self);
       return;
     }
 
-  if (priv->model)
-    {
-      g_object_unref (priv->model);
-      priv->model = NULL;
-    }
-  if (context)
-    priv->model = g_object_ref_sink (context);
+  mex_media_controls_set_context (self, context);
   if (priv->content)
     {
       g_object_unref (priv->content);
@@ -1108,25 +1249,13 @@ mex_media_controls_set_content (MexMediaControls *self,
   priv->is_queue_model = FALSE;
 
   mex_media_controls_update_header (self);
-
+  mex_media_controls_update_window (self);
 
   /* We may not have a context if we're launched by something like SetUri*/
   if (context)
     {
       MexModel *orig_model = NULL;
 
-      /* disconnect the proxy while the view model sorts it's data, since the
-       * proxy cannot re-sort */
-      mex_proxy_set_model (priv->proxy, NULL);
-
-      g_object_set (G_OBJECT (priv->proxy_model), "model", context, NULL);
-
-      mex_view_model_set_start_content (priv->proxy_model, priv->content);
-      mex_view_model_set_loop (priv->proxy_model, TRUE);
-
-      /* reset the model on proxy to ensure all items are in the correct order */
-      mex_proxy_set_model (priv->proxy, MEX_MODEL (priv->proxy_model));
-
       if (g_str_has_prefix (mex_content_get_metadata (priv->content,
                                                       MEX_CONTENT_METADATA_MIMETYPE),
                             "audio/"))
@@ -1289,3 +1418,115 @@ mex_media_controls_set_disabled (MexMediaControls *self,
 
   priv->is_disabled = disabled;
 }
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-program.h"
+#include "mex-test-internal.h"
+
+static guint window_context_lengths[] = { 5, 100, 20000 };
+
+static void
+_test_window_tile_created_cb (MexProxy *proxy,
+                              GObject  *content,
+                              GObject  *object,
+                              guint    *n_tiles)
+{
+  (*n_tiles)++;
+}
+
+static guint
+_test_window_n_tiles_shown (MexMediaControls *controls)
+{
+  GList *children;
+  guint n_tiles;
+
+  children = clutter_container_get_children (
+    CLUTTER_CONTAINER (clutter_script_get_object (controls->priv->script,
+                                                  "related-box")));
+  n_tiles = g_list_length (children);
+  g_list_free (children);
+
+  return n_tiles;
+}
+
+static void
+_test_window_run_proxy (void)
+{
+  while (g_main_context_pending (NULL))
+    g_main_context_iteration (NULL, FALSE);
+}
+
+void
+mex_test_media_controls_window (void)
+{
+  MexMediaControls *controls;
+  guint n;
+
+  controls = MEX_MEDIA_CONTROLS (mex_media_controls_new ());
+  g_object_ref_sink (controls);
+  mex_proxy_set_priority (controls->priv->proxy, MEX_PROXY_PRIORITY_VISIBLE);
+
+  for (n = 0; n < G_N_ELEMENTS (window_context_lengths); n++)
+    {
+      MexModel *context;
+      guint i, size, n_tiles = 0, length = window_context_lengths[n];
+      gulong handler;
+
+      context = mex_generic_model_new ("context", NULL);
+      for (i = 0; i < length; i++)
+        {
+          MexProgram *program = mex_program_new (NULL);
+          mex_content_set_metadata (MEX_CONTENT (program),
+                                    MEX_CONTENT_METADATA_TITLE, "title");
+          mex_content_set_metadata (MEX_CONTENT (program),
+                                    MEX_CONTENT_METADATA_MIMETYPE,
+                                    "video/mp4");
+          mex_model_add_content (context, MEX_CONTENT (program));
+        }
+
+      handler = g_signal_connect (controls->priv->proxy, "object-created",
+                                  G_CALLBACK (_test_window_tile_created_cb),
+                                  &n_tiles);
+
+      size = MIN (length, RELATED_WINDOW_SIZE);
+
+      /* the same number of tiles is created whatever the size of the
+       * context */
+      mex_media_controls_set_content (controls,
+                                      mex_model_get_content (context, 0),
+                                      context);
+      _test_window_run_proxy ();
+      g_assert_cmpuint (n_tiles, ==, size);
+      g_assert_cmpuint (_test_window_n_tiles_shown (controls), ==, size);
+
+      /* moving to the next item only creates the tile coming into view */
+      n_tiles = 0;
+      mex_media_controls_set_content (controls,
+                                      mex_model_get_content (context, 1),
+                                      context);
+      _test_window_run_proxy ();
+      g_assert_cmpuint (n_tiles, ==, 1);
+      g_assert_cmpuint (_test_window_n_tiles_shown (controls), ==, size);
+
+      /* the window wraps around at the end of the context */
+      mex_media_controls_set_content (controls,
+                                      mex_model_get_content (context,
+                                                             length - 1),
+                                      context);
+      _test_window_run_proxy ();
+      g_assert_cmpuint (_test_window_n_tiles_shown (controls), ==, size);
+      g_assert (mex_model_get_content (controls->priv->window, 0) ==
+                mex_model_get_content (context, length - 1));
+      if (size > 1)
+        g_assert (mex_model_get_content (controls->priv->window, 1) ==
+                  mex_model_get_content (context, 0));
+
+      g_signal_handler_disconnect (controls->priv->proxy, handler);
+      g_object_unref (context);
+    }
+
+  g_object_unref (controls);
+}
+
+#endif /* ENABLE_TESTS */
@@ -0,0 +1,622 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mex-metadata-queue.h"
+#include "mex-log-private.h"
+
+#define MEX_LOG_DOMAIN_DEFAULT  metadata_queue_log_domain
+MEX_LOG_DOMAIN(metadata_queue_log_domain);
+
+/*
+ * Contents saving their metadata are not written straight away: the keys
+ * they changed are accumulated for a couple of seconds, so that a play
+ * followed by a stop, or a few track changes, end up as one write of the
+ * keys that actually changed. Only one write per content is in flight at
+ * any time, saves happening meanwhile are written once it completes.
+ *
+ * Keys a backend could not write are retried later, with a delay doubling
+ * at each failure, until they are dropped after METADATA_MAX_ATTEMPTS.
+ * mex_metadata_queue_flush() writes everything that is left, retrying
+ * straight away, and waits for the writes to complete.
+ */
+
+#define METADATA_WRITE_DELAY    2000  /* ms */
+#define METADATA_RETRY_DELAY    4000  /* ms, doubled at each failure */
+#define METADATA_MAX_ATTEMPTS   5
+#define METADATA_FLUSH_TIMEOUT  5     /* seconds */
+
+G_DEFINE_TYPE (MexMetadataQueue, mex_metadata_queue, G_TYPE_OBJECT)
+
+#define METADATA_QUEUE_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_METADATA_QUEUE, \
+                                MexMetadataQueuePrivate))
+
+typedef struct
+{
+  MexContent           *content;
+  MexMetadataWriteFunc  write;
+  gpointer              user_data;
+
+  guint64  dirty;     /* keys waiting to be written */
+  guint64  writing;   /* keys of the write in flight */
+  guint    attempts;
+  gint64   due;       /* monotonic time of the next write */
+} QueueEntry;
+
+struct _MexMetadataQueuePrivate
+{
+  GHashTable *entries;      /* MexContent -> QueueEntry */
+  guint       write_id;
+  guint       flushing : 1;
+};
+
+static void
+queue_entry_free (QueueEntry *entry)
+{
+  g_object_unref (entry->content);
+  g_slice_free (QueueEntry, entry);
+}
+
+static void mex_metadata_queue_schedule (MexMetadataQueue *queue);
+
+/*
+ * GObject implementation
+ */
+
+static void
+mex_metadata_queue_finalize (GObject *object)
+{
+  MexMetadataQueuePrivate *priv = MEX_METADATA_QUEUE (object)->priv;
+
+  if (priv->write_id)
+    g_source_remove (priv->write_id);
+
+  if (g_hash_table_size (priv->entries))
+    MEX_WARNING ("Dropping the unsaved metadata of %u contents",
+                 g_hash_table_size (priv->entries));
+
+  g_hash_table_unref (priv->entries);
+
+  G_OBJECT_CLASS (mex_metadata_queue_parent_class)->finalize (object);
+}
+
+static void
+mex_metadata_queue_class_init (MexMetadataQueueClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MexMetadataQueuePrivate));
+
+  object_class->finalize = mex_metadata_queue_finalize;
+}
+
+static void
+mex_metadata_queue_init (MexMetadataQueue *self)
+{
+  MexMetadataQueuePrivate *priv;
+
+  priv = self->priv = METADATA_QUEUE_PRIVATE (self);
+
+  priv->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                         NULL,
+                                         (GDestroyNotify) queue_entry_free);
+}
+
+/*
+ * Writing
+ */
+
+/* starts the writes that are due, or all of them */
+static void
+mex_metadata_queue_dispatch (MexMetadataQueue *queue,
+                             gboolean          all)
+{
+  MexMetadataQueuePrivate *priv = queue->priv;
+  GHashTableIter iter;
+  QueueEntry *entry;
+  GList *ready = NULL, *l;
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+
+  g_hash_table_iter_init (&iter, priv->entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      if (entry->dirty && !entry->writing && (all || entry->due <= now))
+        ready = g_list_prepend (ready, g_object_ref (entry->content));
+    }
+
+  /* writers may complete straight away and remove their entry */
+  for (l = ready; l; l = l->next)
+    {
+      entry = g_hash_table_lookup (priv->entries, l->data);
+
+      if (entry && entry->dirty && !entry->writing)
+        {
+          entry->writing = entry->dirty;
+          entry->dirty = 0;
+
+          MEX_DEBUG ("writing %" G_GINT64_MODIFIER "x of %p (attempt %u)",
+                     entry->writing, entry->content, entry->attempts + 1);
+
+          entry->write (queue, entry->content, entry->writing,
+                        entry->user_data);
+        }
+
+      g_object_unref (l->data);
+    }
+
+  g_list_free (ready);
+}
+
+static gboolean
+mex_metadata_queue_write_cb (MexMetadataQueue *queue)
+{
+  queue->priv->write_id = 0;
+
+  mex_metadata_queue_dispatch (queue, FALSE);
+  mex_metadata_queue_schedule (queue);
+
+  return FALSE;
+}
+
+/* arms the timeout for the next write that is due */
+static void
+mex_metadata_queue_schedule (MexMetadataQueue *queue)
+{
+  MexMetadataQueuePrivate *priv = queue->priv;
+  GHashTableIter iter;
+  QueueEntry *entry;
+  gint64 next = G_MAXINT64, now;
+
+  if (priv->flushing)
+    return;
+
+  if (priv->write_id)
+    {
+      g_source_remove (priv->write_id);
+      priv->write_id = 0;
+    }
+
+  g_hash_table_iter_init (&iter, priv->entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      if (entry->dirty && !entry->writing && entry->due < next)
+        next = entry->due;
+    }
+
+  if (next == G_MAXINT64)
+    return;
+
+  now = g_get_monotonic_time ();
+  priv->write_id =
+    g_timeout_add (next > now ? (next - now + 999) / 1000 : 0,
+                   (GSourceFunc) mex_metadata_queue_write_cb,
+                   queue);
+}
+
+/*
+ * Public API
+ */
+
+/**
+ * mex_metadata_queue_get_default:
+ *
+ * Returns: (transfer none): the queue used by the contents of libmex
+ */
+MexMetadataQueue *
+mex_metadata_queue_get_default (void)
+{
+  static MexMetadataQueue *singleton = NULL;
+
+  if (G_LIKELY (singleton))
+    return singleton;
+
+  singleton = g_object_new (MEX_TYPE_METADATA_QUEUE, NULL);
+  return singleton;
+}
+
+/**
+ * mex_metadata_queue_new:
+ *
+ * Most users want mex_metadata_queue_get_default().
+ *
+ * Returns: a new #MexMetadataQueue
+ */
+MexMetadataQueue *
+mex_metadata_queue_new (void)
+{
+  return g_object_new (MEX_TYPE_METADATA_QUEUE, NULL);
+}
+
+/**
+ * mex_metadata_queue_save:
+ * @queue: a #MexMetadataQueue
+ * @content: the content to save
+ * @keys: the mask of the keys that changed, see MEX_METADATA_KEY_MASK()
+ * @write: (scope notified): the function writing the keys of @content
+ * @user_data: data to give to @write
+ *
+ * Queues a write of @keys. Saves of the same content made before the
+ * write starts are merged into it.
+ */
+void
+mex_metadata_queue_save (MexMetadataQueue     *queue,
+                         MexContent           *content,
+                         guint64               keys,
+                         MexMetadataWriteFunc  write,
+                         gpointer              user_data)
+{
+  MexMetadataQueuePrivate *priv;
+  QueueEntry *entry;
+
+  g_return_if_fail (MEX_IS_METADATA_QUEUE (queue));
+  g_return_if_fail (MEX_IS_CONTENT (content));
+  g_return_if_fail (write != NULL);
+
+  priv = queue->priv;
+
+  if (!keys)
+    return;
+
+  entry = g_hash_table_lookup (priv->entries, content);
+  if (!entry)
+    {
+      entry = g_slice_new0 (QueueEntry);
+      entry->content = g_object_ref (content);
+      g_hash_table_insert (priv->entries, content, entry);
+    }
+
+  entry->write = write;
+  entry->user_data = user_data;
+
+  /* the first save starts the delay, the next ones don't postpone it */
+  if (!entry->dirty)
+    entry->due = g_get_monotonic_time () + METADATA_WRITE_DELAY * 1000;
+
+  entry->dirty |= keys;
+
+  mex_metadata_queue_schedule (queue);
+}
+
+/**
+ * mex_metadata_queue_write_done:
+ * @queue: a #MexMetadataQueue
+ * @content: the content that was written
+ * @failed_keys: the mask of the keys that could not be written
+ *
+ * Completes the write started by the #MexMetadataWriteFunc of @content.
+ * @failed_keys are retried later.
+ */
+void
+mex_metadata_queue_write_done (MexMetadataQueue *queue,
+                               MexContent       *content,
+                               guint64           failed_keys)
+{
+  MexMetadataQueuePrivate *priv;
+  QueueEntry *entry;
+
+  g_return_if_fail (MEX_IS_METADATA_QUEUE (queue));
+
+  priv = queue->priv;
+
+  entry = g_hash_table_lookup (priv->entries, content);
+  if (!entry || !entry->writing)
+    {
+      g_warning ("No metadata write in progress for %p", content);
+      return;
+    }
+
+  failed_keys &= entry->writing;
+  entry->writing = 0;
+
+  if (failed_keys)
+    {
+      entry->attempts++;
+
+      if (entry->attempts >= METADATA_MAX_ATTEMPTS)
+        {
+          MEX_WARNING ("Could not save the metadata of %p, giving up",
+                       content);
+          entry->attempts = 0;
+        }
+      else
+        {
+          entry->dirty |= failed_keys;
+          entry->due = g_get_monotonic_time () +
+            (gint64) (METADATA_RETRY_DELAY << (entry->attempts - 1)) * 1000;
+        }
+    }
+  else
+    entry->attempts = 0;
+
+  if (!entry->dirty)
+    g_hash_table_remove (priv->entries, content);
+
+  mex_metadata_queue_schedule (queue);
+}
+
+/**
+ * mex_metadata_queue_get_n_pending:
+ * @queue: a #MexMetadataQueue
+ *
+ * Returns: the number of contents with metadata waiting to be written
+ */
+guint
+mex_metadata_queue_get_n_pending (MexMetadataQueue *queue)
+{
+  g_return_val_if_fail (MEX_IS_METADATA_QUEUE (queue), 0);
+
+  return g_hash_table_size (queue->priv->entries);
+}
+
+static gboolean
+mex_metadata_queue_flush_timeout_cb (gboolean *timed_out)
+{
+  *timed_out = TRUE;
+
+  return FALSE;
+}
+
+/**
+ * mex_metadata_queue_flush:
+ * @queue: a #MexMetadataQueue
+ *
+ * Writes all the pending metadata and runs the main context until the
+ * writes complete, or for a few seconds at most. To be called before
+ * exiting.
+ */
+void
+mex_metadata_queue_flush (MexMetadataQueue *queue)
+{
+  MexMetadataQueuePrivate *priv;
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  g_return_if_fail (MEX_IS_METADATA_QUEUE (queue));
+
+  priv = queue->priv;
+
+  if (priv->flushing || !g_hash_table_size (priv->entries))
+    return;
+
+  if (priv->write_id)
+    {
+      g_source_remove (priv->write_id);
+      priv->write_id = 0;
+    }
+
+  priv->flushing = TRUE;
+
+  timeout_id =
+    g_timeout_add_seconds (METADATA_FLUSH_TIMEOUT,
+                           (GSourceFunc) mex_metadata_queue_flush_timeout_cb,
+                           &timed_out);
+
+  while (g_hash_table_size (priv->entries) && !timed_out)
+    {
+      mex_metadata_queue_dispatch (queue, TRUE);
+
+      if (g_hash_table_size (priv->entries))
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+  if (timed_out)
+    MEX_WARNING ("Timed out saving the metadata of %u contents",
+                 g_hash_table_size (priv->entries));
+  else
+    g_source_remove (timeout_id);
+
+  priv->flushing = FALSE;
+
+  mex_metadata_queue_schedule (queue);
+}
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-program.h"
+#include "mex-test-internal.h"
+
+/* a backend completing its writes from the main loop, failing the keys
+ * it is told to fail a number of times */
+typedef struct
+{
+  guint   n_writes;
+  guint64 written[2];
+  guint64 fail_keys;
+  guint   n_failures;
+} FakeBackend;
+
+typedef struct
+{
+  MexMetadataQueue *queue;
+  MexContent       *content;
+  guint64           failed;
+} FakeWrite;
+
+static MexContent *fake_contents[2];
+
+static gboolean
+fake_write_complete_cb (FakeWrite *write)
+{
+  mex_metadata_queue_write_done (write->queue, write->content, write->failed);
+
+  g_object_unref (write->content);
+  g_slice_free (FakeWrite, write);
+
+  return FALSE;
+}
+
+static void
+fake_backend_write (MexMetadataQueue *queue,
+                    MexContent       *content,
+                    guint64           keys,
+                    FakeBackend      *backend)
+{
+  FakeWrite *write;
+
+  write = g_slice_new (FakeWrite);
+  write->queue = queue;
+  write->content = g_object_ref (content);
+  write->failed = 0;
+
+  if (backend->n_failures && (keys & backend->fail_keys))
+    {
+      write->failed = keys & backend->fail_keys;
+      backend->n_failures--;
+    }
+
+  backend->n_writes++;
+  backend->written[content == fake_contents[1]] |= keys & ~write->failed;
+
+  g_idle_add ((GSourceFunc) fake_write_complete_cb, write);
+}
+
+#define KEY(k) MEX_METADATA_KEY_MASK (MEX_CONTENT_METADATA_##k)
+
+void
+mex_test_metadata_queue_coalesce (void)
+{
+  FakeBackend backend = { 0, };
+  MexMetadataQueue *queue;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (fake_contents); i++)
+    fake_contents[i] = g_object_ref_sink (g_object_new (MEX_TYPE_PROGRAM,
+                                                        NULL));
+
+  queue = mex_metadata_queue_new ();
+
+  /* play, stop, play again: one write of the keys that changed */
+  for (i = 0; i < 3; i++)
+    {
+      mex_metadata_queue_save (queue, fake_contents[0],
+                               KEY (PLAY_COUNT) | KEY (LAST_PLAYED_DATE),
+                               (MexMetadataWriteFunc) fake_backend_write,
+                               &backend);
+      mex_metadata_queue_save (queue, fake_contents[0], KEY (LAST_POSITION),
+                               (MexMetadataWriteFunc) fake_backend_write,
+                               &backend);
+    }
+  mex_metadata_queue_save (queue, fake_contents[1], KEY (PLAY_COUNT),
+                           (MexMetadataWriteFunc) fake_backend_write,
+                           &backend);
+
+  g_assert_cmpuint (backend.n_writes, ==, 0);
+  g_assert_cmpuint (mex_metadata_queue_get_n_pending (queue), ==, 2);
+
+  mex_metadata_queue_flush (queue);
+
+  g_assert_cmpuint (backend.n_writes, ==, 2);
+  g_assert_cmpuint (backend.written[0], ==,
+                    KEY (PLAY_COUNT) | KEY (LAST_PLAYED_DATE) |
+                    KEY (LAST_POSITION));
+  g_assert_cmpuint (backend.written[1], ==, KEY (PLAY_COUNT));
+  g_assert_cmpuint (mex_metadata_queue_get_n_pending (queue), ==, 0);
+
+  /* a failed key is retried on its own */
+  backend.n_writes = 0;
+  backend.written[0] = 0;
+  backend.fail_keys = KEY (LAST_POSITION);
+  backend.n_failures = 1;
+
+  mex_metadata_queue_save (queue, fake_contents[0],
+                           KEY (PLAY_COUNT) | KEY (LAST_POSITION),
+                           (MexMetadataWriteFunc) fake_backend_write,
+                           &backend);
+  mex_metadata_queue_flush (queue);
+
+  g_assert_cmpuint (backend.n_writes, ==, 2);
+  g_assert_cmpuint (backend.written[0], ==,
+                    KEY (PLAY_COUNT) | KEY (LAST_POSITION));
+
+  /* a backend that never manages to write is given up on */
+  backend.n_writes = 0;
+  backend.n_failures = G_MAXUINT;
+
+  mex_metadata_queue_save (queue, fake_contents[0], KEY (LAST_POSITION),
+                           (MexMetadataWriteFunc) fake_backend_write,
+                           &backend);
+  mex_metadata_queue_flush (queue);
+
+  g_assert_cmpuint (backend.n_writes, ==, METADATA_MAX_ATTEMPTS);
+  g_assert_cmpuint (mex_metadata_queue_get_n_pending (queue), ==, 0);
+
+  g_object_unref (queue);
+
+  for (i = 0; i < G_N_ELEMENTS (fake_contents); i++)
+    g_object_unref (fake_contents[i]);
+}
+
+static gboolean
+save_during_write_cb (MexMetadataQueue *queue)
+{
+  mex_metadata_queue_save (queue, fake_contents[1], KEY (LAST_POSITION),
+                           (MexMetadataWriteFunc) fake_backend_write,
+                           g_object_get_data (G_OBJECT (queue), "backend"));
+
+  return FALSE;
+}
+
+void
+mex_test_metadata_queue_flush (void)
+{
+  FakeBackend backend = { 0, };
+  MexMetadataQueue *queue;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (fake_contents); i++)
+    fake_contents[i] = g_object_ref_sink (g_object_new (MEX_TYPE_PROGRAM,
+                                                        NULL));
+
+  queue = mex_metadata_queue_new ();
+  g_object_set_data (G_OBJECT (queue), "backend", &backend);
+
+  mex_metadata_queue_save (queue, fake_contents[0], KEY (PLAY_COUNT),
+                           (MexMetadataWriteFunc) fake_backend_write,
+                           &backend);
+  mex_metadata_queue_save (queue, fake_contents[1], KEY (PLAY_COUNT),
+                           (MexMetadataWriteFunc) fake_backend_write,
+                           &backend);
+
+  /* a save lands while the write of the same content is in flight, and
+   * the first attempt of the other content fails */
+  backend.fail_keys = KEY (PLAY_COUNT);
+  backend.n_failures = 1;
+  g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                   (GSourceFunc) save_during_write_cb, queue, NULL);
+
+  mex_metadata_queue_flush (queue);
+
+  /* nothing is lost */
+  g_assert_cmpuint (mex_metadata_queue_get_n_pending (queue), ==, 0);
+  g_assert_cmpuint (backend.written[0], ==, KEY (PLAY_COUNT));
+  g_assert_cmpuint (backend.written[1], ==,
+                    KEY (PLAY_COUNT) | KEY (LAST_POSITION));
+
+  g_object_unref (queue);
+
+  for (i = 0; i < G_N_ELEMENTS (fake_contents); i++)
+    g_object_unref (fake_contents[i]);
+}
+
+#endif /* ENABLE_TESTS */
@@ -0,0 +1,102 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __MEX_METADATA_QUEUE_H__
+#define __MEX_METADATA_QUEUE_H__
+
+#include <glib-object.h>
+#include <mex/mex-content.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_METADATA_QUEUE mex_metadata_queue_get_type()
+
+#define MEX_METADATA_QUEUE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MEX_TYPE_METADATA_QUEUE, MexMetadataQueue))
+
+#define MEX_METADATA_QUEUE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), MEX_TYPE_METADATA_QUEUE, MexMetadataQueueClass))
+
+#define MEX_IS_METADATA_QUEUE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MEX_TYPE_METADATA_QUEUE))
+
+#define MEX_IS_METADATA_QUEUE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), MEX_TYPE_METADATA_QUEUE))
+
+#define MEX_METADATA_QUEUE_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), MEX_TYPE_METADATA_QUEUE, MexMetadataQueueClass))
+
+typedef struct _MexMetadataQueue MexMetadataQueue;
+typedef struct _MexMetadataQueueClass MexMetadataQueueClass;
+typedef struct _MexMetadataQueuePrivate MexMetadataQueuePrivate;
+
+struct _MexMetadataQueue
+{
+  GObject parent;
+
+  MexMetadataQueuePrivate *priv;
+};
+
+struct _MexMetadataQueueClass
+{
+  GObjectClass parent_class;
+};
+
+/**
+ * MEX_METADATA_KEY_MASK:
+ * @key: a #MexContentMetadata
+ *
+ * The bit of @key in a mask of metadata keys.
+ */
+#define MEX_METADATA_KEY_MASK(key) (G_GUINT64_CONSTANT (1) << (key))
+
+/**
+ * MexMetadataWriteFunc:
+ * @queue: the #MexMetadataQueue
+ * @content: the content to write
+ * @keys: the mask of the keys to write
+ * @user_data: the data given to mex_metadata_queue_save()
+ *
+ * Starts writing @keys of @content to its backend. The write must be
+ * completed with mex_metadata_queue_write_done(), from the main loop.
+ */
+typedef void (*MexMetadataWriteFunc) (MexMetadataQueue *queue,
+                                      MexContent       *content,
+                                      guint64           keys,
+                                      gpointer          user_data);
+
+GType              mex_metadata_queue_get_type    (void) G_GNUC_CONST;
+
+MexMetadataQueue * mex_metadata_queue_get_default (void);
+MexMetadataQueue * mex_metadata_queue_new         (void);
+
+void               mex_metadata_queue_save        (MexMetadataQueue     *queue,
+                                                   MexContent           *content,
+                                                   guint64               keys,
+                                                   MexMetadataWriteFunc  write,
+                                                   gpointer              user_data);
+void               mex_metadata_queue_write_done  (MexMetadataQueue     *queue,
+                                                   MexContent           *content,
+                                                   guint64               failed_keys);
+guint              mex_metadata_queue_get_n_pending
+                                                  (MexMetadataQueue     *queue);
+void               mex_metadata_queue_flush       (MexMetadataQueue     *queue);
+
+G_END_DECLS
+
+#endif /* __MEX_METADATA_QUEUE_H__ */
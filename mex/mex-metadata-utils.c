@@ -23,211 +23,340 @@
 #include <time.h>
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 
 #include "mex-metadata-utils.h"
 
-#define TV_REGEX "(?<showname>.*)\\.(?<season>(?:\\d{1,2})|(?:[sS]\\K\\d{1,2}))(?<episode>(?:x?\\d{2}[^px0-9])|(?:[eE]\\K\\d{1,2}))\\.?(?<name>.*)?"
-#define MOVIE_REGEX "(?<name>.*)\\.?[\\(\\[](?<year>[12][90]\\d{2})[\\)\\]]"
+/*
+ * Metadata from file names
+ *
+ * This used to be done with two regular expressions, compiled for every
+ * file name:
+ *
+ *   movies:   (?<name>.*)\.?[\(\[](?<year>[12][90]\d{2})[\)\]]
+ *   TV shows: (?<showname>.*)\.(?<season>(?:\d{1,2})|(?:[sS]\K\d{1,2}))
+ *             (?<episode>(?:x?\d{2}[^px0-9])|(?:[eE]\K\d{1,2}))\.?(?<name>.*)?
+ *
+ * The scanners below match the same file names, trying the alternatives in
+ * the same order the regular expressions would. They don't allocate nor use
+ * any global state so they can be used from any thread.
+ */
 
 const gchar *blacklisted_prefix[] = {
     "tpz-", NULL
 };
 
-/* Blacklisted are words that we ignore everything after */
+/* Blacklisted are words that we ignore everything after, they are matched
+ * case insensitively on word boundaries */
 const char *blacklist[] = {
-    "ws", "WS", "proper", "PROPER",
-    "repack", "real.repack",
-    "hdtv", "HDTV", "pdtv", "PDTV", "notv", "NOTV",
-    "dsr", "DSR", "DVDRip", "divx", "DIVX", "xvid", "Xvid",
+    "ws", "proper", "repack", "real.repack",
+    "hdtv", "pdtv", "notv", "dsr", "dvdrip", "divx", "xvid",
     NULL
 };
 
+#define IS_WORD_BOUNDARY(c) ((c) == '\0' || !g_ascii_isalnum (c))
 
-static gchar *
-sanitise_string (const gchar *str)
+/* Returns the length of @str to keep, everything from the first blacklisted
+ * word is ignored */
+static gsize
+sanitised_length (const gchar *str)
 {
-    int i;
-    gchar *line;
+    gsize i;
 
-    line = (gchar *) str;
-    for (i = 0; blacklisted_prefix[i]; i++) {
-        if (g_str_has_prefix (str, blacklisted_prefix[i])) {
-            int len = strlen (blacklisted_prefix[i]);
+    for (i = 0; str[i]; i++) {
+        int j;
 
-            line = (gchar *) str + len;
-        }
-    }
+        if (i > 0 && !IS_WORD_BOUNDARY (str[i - 1]))
+            continue;
 
-    for (i = 0; blacklist[i]; i++) {
-        gchar *end;
+        for (j = 0; blacklist[j]; j++) {
+            gsize len = strlen (blacklist[j]);
 
-        end = strstr (line, blacklist[i]);
-        if (end) {
-            return g_strndup (line, end - line);
+            if (g_ascii_strncasecmp (str + i, blacklist[j], len) == 0 &&
+                IS_WORD_BOUNDARY (str[i + len]))
+                return i;
         }
     }
-    return g_strdup (line);
+
+    return i;
 }
 
-/* tidies strings before we run them through the regexes */
+/* tidies strings before we scan them */
 static gchar *
 uri_to_metadata (const gchar *uri)
 {
-    gchar *ext, *base_name, *name, *whitelisted;
+    const gchar *base_name, *ext, *line;
+    gsize len;
+    gchar *name;
+    int i;
+
+    base_name = strrchr (uri, '/');
+    base_name = base_name ? base_name + 1 : uri;
 
-    base_name = g_path_get_basename (uri);
     ext = strrchr (base_name, '.');
-    if (ext) {
-        name = g_strndup (base_name, ext - base_name);
-        g_free (base_name);
-    } else {
-        name = base_name;
+    len = ext ? (gsize) (ext - base_name) : strlen (base_name);
+
+    line = base_name;
+    for (i = 0; blacklisted_prefix[i]; i++) {
+        gsize prefix_len = strlen (blacklisted_prefix[i]);
+
+        if (len >= prefix_len &&
+            strncmp (line, blacklisted_prefix[i], prefix_len) == 0) {
+            line += prefix_len;
+            len -= prefix_len;
+        }
     }
 
+    name = g_strndup (line, len);
+
     /* Replace _ <space> with . */
     g_strdelimit (name, "_ ", '.');
-    whitelisted = sanitise_string (name);
-    g_free (name);
+    name[sanitised_length (name)] = '\0';
 
-    return whitelisted;
+    return name;
 }
 
-void
-mex_metadata_from_uri (const gchar *uri,
-                       gchar      **title,
-                       gchar      **showname,
-                       gint        *year,
-                       gint        *season,
-                       gint        *episode)
+/* [(\[][12][90]\d{2}[)\]] */
+static gboolean
+scan_year (const gchar *p,
+           gint        *year)
 {
-    gchar *metadata;
-    GRegex *regex;
-    GMatchInfo *info;
-
-    metadata = uri_to_metadata (uri);
-
-    regex = g_regex_new (MOVIE_REGEX, 0, 0, NULL);
-    g_regex_match (regex, metadata, 0, &info);
-    if (g_match_info_matches (info)) {
-        if (title) {
-            *title= g_match_info_fetch_named (info, "name");
-            /* Replace "." with <space> */
-            g_strdelimit (*title, ".", ' ');
-        }
+    if ((p[0] == '(' || p[0] == '[') &&
+        (p[1] == '1' || p[1] == '2') &&
+        (p[2] == '9' || p[2] == '0') &&
+        g_ascii_isdigit (p[3]) && g_ascii_isdigit (p[4]) &&
+        (p[5] == ')' || p[5] == ']')) {
+        *year = (p[1] - '0') * 1000 + (p[2] - '0') * 100 +
+                (p[3] - '0') * 10 + (p[4] - '0');
+        return TRUE;
+    }
 
-        if (year) {
-            gchar *year_str = g_match_info_fetch_named (info, "year");
+    return FALSE;
+}
 
-            *year = atoi (year_str);
+/* The name being greedy, the last year in the string is the one */
+static gboolean
+scan_movie (const gchar *str,
+            gsize        len,
+            gsize       *name_len,
+            gint        *year)
+{
+    gssize i;
 
-            g_free (year_str);
+    for (i = (gssize) len - 6; i >= 0; i--) {
+        if (scan_year (str + i, year)) {
+            *name_len = i;
+            return TRUE;
         }
+    }
 
-        if (showname) {
-            *showname = NULL;
-        }
+    return FALSE;
+}
 
-        if (season) {
-            *season = 0;
-        }
+/* x?\d{2}[^px0-9] | [eE]\d{1,2}, sets @end after the episode */
+static gboolean
+scan_episode (const gchar  *p,
+              gint         *episode,
+              const gchar **end)
+{
+    const gchar *q = (*p == 'x') ? p + 1 : p;
+
+    if (g_ascii_isdigit (q[0]) && g_ascii_isdigit (q[1]) &&
+        q[2] != '\0' && q[2] != 'p' && q[2] != 'x' &&
+        !g_ascii_isdigit (q[2])) {
+        *episode = (q[0] - '0') * 10 + (q[1] - '0');
+        *end = q + 3;
+        return TRUE;
+    }
 
-        if (episode) {
-            *episode = 0;
+    if ((*p == 'e' || *p == 'E') && g_ascii_isdigit (p[1])) {
+        if (g_ascii_isdigit (p[2])) {
+            *episode = (p[1] - '0') * 10 + (p[2] - '0');
+            *end = p + 3;
+        } else {
+            *episode = p[1] - '0';
+            *end = p + 2;
         }
+        return TRUE;
+    }
 
-        g_regex_unref (regex);
-        g_match_info_free (info);
-        g_free (metadata);
+    return FALSE;
+}
 
-        return;
+/* (\d{1,2} | [sS]\d{1,2}) followed by an episode */
+static gboolean
+scan_season_episode (const gchar  *p,
+                     gint         *season,
+                     gint         *episode,
+                     const gchar **end)
+{
+    if (*p == 's' || *p == 'S')
+        p++;
+    else if (!g_ascii_isdigit (*p))
+        return FALSE;
+
+    if (!g_ascii_isdigit (p[0]))
+        return FALSE;
+
+    /* two digits season first */
+    if (g_ascii_isdigit (p[1]) && scan_episode (p + 2, episode, end)) {
+        *season = (p[0] - '0') * 10 + (p[1] - '0');
+        return TRUE;
     }
 
-    g_regex_unref (regex);
-    g_match_info_free (info);
+    if (scan_episode (p + 1, episode, end)) {
+        *season = p[0] - '0';
+        return TRUE;
+    }
 
-    regex = g_regex_new (TV_REGEX, 0, 0, NULL);
-    g_regex_match (regex, metadata, 0, &info);
+    return FALSE;
+}
 
-    if (g_match_info_matches (info)) {
-        if (title) {
-            *title = g_match_info_fetch_named (info, "name");
-            g_strdelimit (*title, ".", ' ');
-        }
+/* The show name being greedy, we try from the last '.' */
+static gboolean
+scan_tv_show (const gchar  *str,
+              gsize         len,
+              gsize        *showname_len,
+              gint         *season,
+              gint         *episode,
+              const gchar **name)
+{
+    gssize i;
 
-        if (showname) {
-            *showname = g_match_info_fetch_named (info, "showname");
-            g_strdelimit (*showname, ".", ' ');
-        }
+    for (i = (gssize) len - 1; i >= 0; i--) {
+        const gchar *end;
 
-        if (season) {
-            gchar *s = g_match_info_fetch_named (info, "season");
-            if (s) {
-                if (*s == 's' || *s == 'S') {
-                    *season = atoi (s + 1);
-                } else {
-                    *season = atoi (s);
-                }
-            } else {
-                *season = 0;
-            }
-
-            g_free (s);
-        }
+        if (str[i] != '.')
+            continue;
 
-        if (episode) {
-            gchar *e = g_match_info_fetch_named (info, "episode");
-            if (e) {
-                if (*e == 'e' || *e == 'E') {
-                    *episode = atoi (e + 1);
-                } else {
-                    *episode = atoi (e);
-                }
-            } else {
-                *episode = 0;
-            }
-
-            g_free (e);
+        if (scan_season_episode (str + i + 1, season, episode, &end)) {
+            *showname_len = i;
+            *name = (*end == '.') ? end + 1 : end;
+            return TRUE;
         }
+    }
 
-        if (year) {
-            *year = 0;
-        }
+    return FALSE;
+}
 
-        g_regex_unref (regex);
-        g_match_info_free (info);
-        g_free (metadata);
-        return;
+static void
+metadata_from_filename (const gchar         *uri,
+                        MexFilenameMetadata *metadata)
+{
+    gchar *str;
+    gsize len, name_len;
+    const gchar *name;
+
+    memset (metadata, 0, sizeof (MexFilenameMetadata));
+
+    str = uri_to_metadata (uri);
+    len = strlen (str);
+
+    if (scan_movie (str, len, &name_len, &metadata->year)) {
+        metadata->title = g_strndup (str, name_len);
+    } else if (scan_tv_show (str, len, &name_len,
+                             &metadata->season, &metadata->episode, &name)) {
+        metadata->showname = g_strndup (str, name_len);
+        metadata->title = g_strdup (name);
+        g_strdelimit (metadata->showname, ".", ' ');
+    } else {
+        /* The filename doesn't look like a movie or a TV show, just use the
+           filename without extension as the title */
+        metadata->title = str;
+        str = NULL;
     }
 
-    /* The filename doesn't look like a movie or a TV show, just use the
-       filename without extension as the title */
-    if (title) {
-        *title = g_strdelimit (metadata, ".", ' ');
-    }
+    /* Replace "." with <space>, the separators around the matched parts
+     * would otherwise end up as trailing spaces */
+    g_strstrip (g_strdelimit (metadata->title, ".", ' '));
+    if (metadata->showname)
+        g_strstrip (metadata->showname);
 
-    if (showname) {
-        *showname = NULL;
-    }
+    g_free (str);
+}
 
-    if (year) {
-        *year = 0;
-    }
+/**
+ * mex_metadata_from_uri:
+ * @uri: the URI or path of a file
+ * @title: (out) (allow-none): return location for the title
+ * @showname: (out) (allow-none): return location for the show name
+ * @year: (out) (allow-none): return location for the year
+ * @season: (out) (allow-none): return location for the season
+ * @episode: (out) (allow-none): return location for the episode
+ *
+ * Guesses metadata from the file name of a movie or episode of a TV show.
+ * This function is thread safe. See mex_metadata_from_uris() to process
+ * many files at once.
+ */
+void
+mex_metadata_from_uri (const gchar *uri,
+                       gchar      **title,
+                       gchar      **showname,
+                       gint        *year,
+                       gint        *season,
+                       gint        *episode)
+{
+    MexFilenameMetadata metadata;
+
+    metadata_from_filename (uri, &metadata);
+
+    if (title)
+        *title = metadata.title;
+    else
+        g_free (metadata.title);
+
+    if (showname)
+        *showname = metadata.showname;
+    else
+        g_free (metadata.showname);
+
+    if (year)
+        *year = metadata.year;
+    if (season)
+        *season = metadata.season;
+    if (episode)
+        *episode = metadata.episode;
+}
 
-    if (season) {
-        *season = 0;
-    }
-    if (episode) {
-        *episode = 0;
-    }
+/**
+ * mex_metadata_from_uris:
+ * @uris: an array of URIs or paths
+ * @n_uris: the number of elements of @uris
+ * @metadata: (out caller-allocates) (array length=n_uris): an array of
+ *   @n_uris #MexFilenameMetadata to fill
+ *
+ * Batch version of mex_metadata_from_uri(). Free the results with
+ * mex_filename_metadata_clear(). This function is thread safe.
+ */
+void
+mex_metadata_from_uris (const gchar * const *uris,
+                        guint                n_uris,
+                        MexFilenameMetadata *metadata)
+{
+    guint i;
 
-    g_regex_unref (regex);
-    g_match_info_free (info);
-    g_free (metadata);
+    g_return_if_fail (uris != NULL || n_uris == 0);
+    g_return_if_fail (metadata != NULL || n_uris == 0);
 
-    return;
+    for (i = 0; i < n_uris; i++)
+        metadata_from_filename (uris[i], &metadata[i]);
+}
+
+/**
+ * mex_filename_metadata_clear:
+ * @metadata: a #MexFilenameMetadata
+ *
+ * Frees the strings held by @metadata.
+ */
+void
+mex_filename_metadata_clear (MexFilenameMetadata *metadata)
+{
+    g_free (metadata->title);
+    g_free (metadata->showname);
+    metadata->title = metadata->showname = NULL;
 }
 
 /**
@@ -470,6 +599,119 @@ mex_test_metadata_humanise_date (void)
   g_assert (human == NULL);
 }
 
+typedef struct
+{
+  const gchar *uri;
+  const gchar *title;
+  const gchar *showname;
+  gint year, season, episode;
+} MetadataFromUriTest;
+
+static const MetadataFromUriTest metadata_corpus[] =
+{
+  /* movies */
+  { "file:///media/Videos/Inception.(2010).mkv", "Inception", NULL, 2010 },
+  { "/media/Videos/The.Matrix.[1999].DVDRip.XviD.avi", "The Matrix", NULL,
+    1999 },
+  { "/media/Videos/Blade Runner (1982).mp4", "Blade Runner", NULL, 1982 },
+  { "/media/Videos/2001.A.Space.Odyssey.(1968).avi", "2001 A Space Odyssey",
+    NULL, 1968 },
+
+  /* TV shows */
+  { "/tv/Lost.S01E02.HDTV.XviD-LOL.avi", "", "Lost", 0, 1, 2 },
+  { "/tv/lost.s01e02.hdtv.xvid-lol.avi", "", "lost", 0, 1, 2 },
+  { "/tv/The_Wire_1x05_The_Pager.avi", "The Pager", "The Wire", 0, 1, 5 },
+  { "/tv/House.M.D.3x07.Son.of.Coma.Guy.avi", "Son of Coma Guy",
+    "House M D", 0, 3, 7 },
+  { "/tv/Dexter.S03E12.Do.You.Take.Dexter.Morgan.720p.HDTV.x264.mkv",
+    "Do You Take Dexter Morgan 720p", "Dexter", 0, 3, 12 },
+  { "/tv/Fringe.101.Pilot.avi", "Pilot", "Fringe", 0, 1, 1 },
+  { "/tv/Heroes.S02E1.avi", "", "Heroes", 0, 2, 1 },
+  { "/tv/24.S07E01.avi", "", "24", 0, 7, 1 },
+  { "/tv/The.Office.US.S05E14.Lecture.Circuit.Part.1.WS.PDTV.avi",
+    "Lecture Circuit Part 1", "The Office US", 0, 5, 14 },
+  { "/tv/Chuck.S02E03.PROPER.HDTV.avi", "", "Chuck", 0, 2, 3 },
+  { "/tv/Californication.S01E01.Pilot.Real.Repack.avi", "Pilot",
+    "Californication", 0, 1, 1 },
+
+  /* neither, blacklisted words must not match inside other words */
+  { "/videos/holiday.mov", "holiday" },
+  { "/videos/Firewall.mp4", "Firewall" },
+  { "/videos/Evening.News.ogv", "Evening News" },
+  { "/videos/Showreel.1080p.mkv", "Showreel 1080p" },
+  { "/tv/tpz-simpsons2001.avi", "simpsons2001" },
+  { "noext", "noext" },
+};
+
+void
+mex_test_metadata_from_uri (void)
+{
+  MexFilenameMetadata results[G_N_ELEMENTS (metadata_corpus)];
+  const gchar *uris[G_N_ELEMENTS (metadata_corpus)];
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (metadata_corpus); i++)
+    uris[i] = metadata_corpus[i].uri;
+
+  mex_metadata_from_uris (uris, G_N_ELEMENTS (metadata_corpus), results);
+
+  for (i = 0; i < G_N_ELEMENTS (metadata_corpus); i++)
+    {
+      const MetadataFromUriTest *test = &metadata_corpus[i];
+      gchar *title, *showname;
+      gint year, season, episode;
+
+      g_assert_cmpstr (results[i].title, ==, test->title);
+      g_assert_cmpstr (results[i].showname, ==, test->showname);
+      g_assert_cmpint (results[i].year, ==, test->year);
+      g_assert_cmpint (results[i].season, ==, test->season);
+      g_assert_cmpint (results[i].episode, ==, test->episode);
+      mex_filename_metadata_clear (&results[i]);
+
+      /* and the single URI version gives the same answers */
+      mex_metadata_from_uri (test->uri, &title, &showname,
+                             &year, &season, &episode);
+      g_assert_cmpstr (title, ==, test->title);
+      g_assert_cmpstr (showname, ==, test->showname);
+      g_assert_cmpint (year, ==, test->year);
+      g_assert_cmpint (season, ==, test->season);
+      g_assert_cmpint (episode, ==, test->episode);
+      g_free (title);
+      g_free (showname);
+    }
+}
+
+#define METADATA_PERF_N_URIS 30000
+
+void
+mex_test_metadata_from_uris_perf (void)
+{
+  MexFilenameMetadata *results;
+  const gchar **uris;
+  gdouble elapsed;
+  guint i;
+
+  if (!g_test_perf ())
+    return;
+
+  uris = g_new (const gchar *, METADATA_PERF_N_URIS);
+  results = g_new (MexFilenameMetadata, METADATA_PERF_N_URIS);
+  for (i = 0; i < METADATA_PERF_N_URIS; i++)
+    uris[i] = metadata_corpus[i % G_N_ELEMENTS (metadata_corpus)].uri;
+
+  g_test_timer_start ();
+  mex_metadata_from_uris (uris, METADATA_PERF_N_URIS, results);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (elapsed, "%d file names in %f s",
+                           METADATA_PERF_N_URIS, elapsed);
+
+  for (i = 0; i < METADATA_PERF_N_URIS; i++)
+    mex_filename_metadata_clear (&results[i]);
+  g_free (results);
+  g_free (uris);
+}
+
 #endif
 
 gchar *
@@ -37,6 +37,25 @@ typedef struct
   gpointer                  visible_data;
 } MexMetadataInfo;
 
+/**
+ * MexFilenameMetadata:
+ * @title: the title of the movie or episode
+ * @showname: the name of the TV show, or %NULL for movies
+ * @year: the year of a movie, or 0
+ * @season: the season of an episode, or 0
+ * @episode: the episode number, or 0
+ *
+ * Metadata guessed from a file name by mex_metadata_from_uris().
+ */
+typedef struct
+{
+  gchar *title;
+  gchar *showname;
+  gint   year;
+  gint   season;
+  gint   episode;
+} MexFilenameMetadata;
+
 void mex_metadata_from_uri (const gchar *uri,
                             gchar      **title,
                             gchar      **showname,
@@ -44,6 +63,12 @@ void mex_metadata_from_uri (const gchar *uri,
                             gint        *season,
                             gint        *episode);
 
+void mex_metadata_from_uris (const gchar * const *uris,
+                             guint                n_uris,
+                             MexFilenameMetadata *metadata);
+
+void mex_filename_metadata_clear (MexFilenameMetadata *metadata);
+
 gchar * mex_metadata_humanise_duration (const gchar *duration);
 
 gchar *mex_metadata_humanise_date (const gchar *iso8601_date);
@@ -268,6 +268,62 @@ mex_model_remove_content (MexModel   *model,
              g_type_name (G_OBJECT_TYPE (model)));
 }
 
+/**
+ * mex_model_remove:
+ * @model: a #MexModel
+ * @content: (element-type MexContent): the contents to remove
+ *
+ * Removes several contents at once. Models implementing it give all the
+ * indices in a single #G_CONTROLLER_REMOVE reference, from the last one
+ * to the first, the other ones remove the contents one after the other.
+ */
+void
+mex_model_remove (MexModel *model,
+                  GList    *content)
+{
+  MexModelIface *iface;
+
+  g_return_if_fail (MEX_IS_MODEL (model));
+
+  iface = MEX_MODEL_GET_IFACE (model);
+
+  if (iface->remove)
+    {
+      iface->remove (model, content);
+      return;
+    }
+
+  for (; content; content = content->next)
+    mex_model_remove_content (model, content->data);
+}
+
+/**
+ * mex_model_set_visible_contents:
+ * @model: a #MexModel
+ * @first: the first content shown by the view
+ * @last: the last content shown by the view
+ *
+ * Views call this when the part of @model they show changes. Models that
+ * fetch their contents on demand (see #MexGriloFeed:page-size) use it to
+ * fetch what comes next and drop what is far away, the others ignore it.
+ */
+void
+mex_model_set_visible_contents (MexModel   *model,
+                                MexContent *first,
+                                MexContent *last)
+{
+  MexModelIface *iface;
+
+  g_return_if_fail (MEX_IS_MODEL (model));
+  g_return_if_fail (MEX_IS_CONTENT (first));
+  g_return_if_fail (MEX_IS_CONTENT (last));
+
+  iface = MEX_MODEL_GET_IFACE (model);
+
+  if (iface->set_visible_contents)
+    iface->set_visible_contents (model, first, last);
+}
+
 void
 mex_model_clear (MexModel *model)
 {
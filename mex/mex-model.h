@@ -65,6 +65,13 @@ struct _MexModelIface
   gint  (*index)      (MexModel *model, MexContent *content);
 
   MexModel *(*get_model) (MexModel *model);
+
+  void (*remove) (MexModel *model,
+                  GList    *content_list);
+
+  void (*set_visible_contents) (MexModel   *model,
+                                MexContent *first,
+                                MexContent *last);
 };
 
 GType         mex_model_get_type         (void) G_GNUC_CONST;
@@ -78,7 +85,12 @@ void mex_model_add_content (MexModel   *model,
                             MexContent *content);
 void mex_model_remove_content (MexModel   *model,
                                MexContent *content);
+void mex_model_remove (MexModel *model,
+                       GList    *content);
 void mex_model_clear (MexModel *model);
+void mex_model_set_visible_contents (MexModel   *model,
+                                     MexContent *first,
+                                     MexContent *last);
 void mex_model_set_sort_func (MexModel         *model,
                               MexModelSortFunc  sort_func,
                               gpointer          user_data);
@@ -46,6 +46,13 @@ static void mex_music_player_shuffle_toggled (MexMusicPlayer *player,
 static void mex_music_player_slider_notify (MxSlider       *slider,
                                             GParamSpec     *pspec,
                                             MexMusicPlayer *priv);
+static void mex_music_player_prepare_next (MexMusicPlayer *player);
+static void mex_music_player_about_to_finish_cb (GstElement     *pipeline,
+                                                 MexMusicPlayer *player);
+static void mex_music_player_stream_start_cb (GstBus         *bus,
+                                              GstMessage     *message,
+                                              MexMusicPlayer *player);
+static void mex_music_player_shuffle (MexMusicPlayer *player);
 
 G_DEFINE_TYPE_WITH_CODE (MexMusicPlayer, mex_music_player, MX_TYPE_WIDGET,
                          G_IMPLEMENT_INTERFACE (MEX_TYPE_CONTENT_VIEW,
@@ -75,7 +82,18 @@ struct _MexMusicPlayerPrivate
 
   gboolean repeat;
 
+  /* shuffled order of the tracks and, for each track, its position in
+   * that order */
   GArray *shuffle;
+  GArray *shuffle_positions;
+
+  /* gapless playback: the next track is given to playbin when it's about
+   * to finish the current one, from its streaming thread */
+  GstElement *pipeline;
+  GMutex      next_lock;
+  gchar      *next_uri;
+  gint        next_index;
+  gboolean    next_queued;
 };
 
 enum
@@ -116,13 +134,14 @@ mex_music_player_focusable_iface_init (MxFocusableIface *iface)
 
 
 /* content view */
+/* Updates the labels and the track list for the current content */
 static void
-mex_music_player_set_content (MexContentView *player,
-                              MexContent     *content)
+mex_music_player_show_content (MexMusicPlayer *player,
+                               MexContent     *content)
 {
-  MexMusicPlayerPrivate *priv = MEX_MUSIC_PLAYER (player)->priv;
+  MexMusicPlayerPrivate *priv = player->priv;
   gchar *album_artist;
-  const gchar *uri, *album, *artist, *title;
+  const gchar *album, *artist, *title;
   ClutterActorIter iter;
   ClutterActor *child, *container;
 
@@ -149,10 +168,6 @@ mex_music_player_set_content (MexContentView *player,
   mx_label_set_text (MX_LABEL (priv->subtitle_label), album_artist);
   g_free (album_artist);
 
-  /* uri */
-  uri = mex_content_get_metadata (content, MEX_CONTENT_METADATA_STREAM);
-  clutter_media_set_uri (priv->player, uri);
-
   /* find the item in the list */
   container = mex_script_get_actor (priv->script, "tracks");
   clutter_actor_iter_init (&iter, container);
@@ -166,6 +181,43 @@ mex_music_player_set_content (MexContentView *player,
     }
 }
 
+static void
+mex_music_player_set_content (MexContentView *view,
+                              MexContent     *content)
+{
+  MexMusicPlayer *player = MEX_MUSIC_PLAYER (view);
+  MexMusicPlayerPrivate *priv = player->priv;
+  const gchar *uri;
+  gint content_index;
+
+  mex_music_player_show_content (player, content);
+
+  if (!content)
+    return;
+
+  /* keep the current index in sync when the content is set directly */
+  if (priv->model &&
+      (content_index = mex_model_index (priv->model, content)) >= 0)
+    {
+      if (priv->shuffle)
+        priv->current_index = g_array_index (priv->shuffle_positions, gint,
+                                             content_index);
+      else
+        priv->current_index = content_index;
+    }
+
+  /* uri */
+  uri = mex_content_get_metadata (content, MEX_CONTENT_METADATA_STREAM);
+  clutter_media_set_uri (priv->player, uri);
+
+  /* and forget about the track playbin may have queued */
+  g_mutex_lock (&priv->next_lock);
+  priv->next_queued = FALSE;
+  g_mutex_unlock (&priv->next_lock);
+
+  mex_music_player_prepare_next (player);
+}
+
 static MexContent *
 mex_music_player_get_content (MexContentView *player)
 {
@@ -220,6 +272,11 @@ mex_music_player_set_context (MexContentView *player,
 
       clutter_actor_add_child (box, button);
     }
+
+  if (priv->shuffle)
+    mex_music_player_shuffle (MEX_MUSIC_PLAYER (player));
+
+  mex_music_player_prepare_next (MEX_MUSIC_PLAYER (player));
 }
 
 static MexModel*
@@ -280,9 +337,14 @@ mex_music_player_finalize (GObject *object)
   if (priv->shuffle)
     {
       g_array_free (priv->shuffle, TRUE);
+      g_array_free (priv->shuffle_positions, TRUE);
       priv->shuffle = NULL;
+      priv->shuffle_positions = NULL;
     }
 
+  g_free (priv->next_uri);
+  g_mutex_clear (&priv->next_lock);
+
   G_OBJECT_CLASS (mex_music_player_parent_class)->finalize (object);
 }
 
@@ -390,6 +452,7 @@ mex_music_player_init (MexMusicPlayer *self)
   ClutterActor *box;
   MexMusicPlayerPrivate *priv;
   ClutterActor *button;
+  GstBus *bus;
 
   priv = self->priv = MUSIC_PLAYER_PRIVATE (self);
 
@@ -452,6 +515,17 @@ mex_music_player_init (MexMusicPlayer *self)
   g_signal_connect (priv->player, "eos",
                     G_CALLBACK (mex_music_player_eos_cb), self);
 
+  g_mutex_init (&priv->next_lock);
+  priv->next_index = -1;
+  priv->pipeline =
+    clutter_gst_video_texture_get_pipeline (CLUTTER_GST_VIDEO_TEXTURE (priv->player));
+  g_signal_connect (priv->pipeline, "about-to-finish",
+                    G_CALLBACK (mex_music_player_about_to_finish_cb), self);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (priv->pipeline));
+  g_signal_connect (bus, "message::stream-start",
+                    G_CALLBACK (mex_music_player_stream_start_cb), self);
+  gst_object_unref (bus);
+
   /* slider */
   priv->slider = mex_script_get_actor (priv->script, "progress-slider");
   priv->slider_notify_id = g_signal_connect (priv->slider, "notify::value",
@@ -566,13 +640,13 @@ mex_music_player_quit (MexMusicPlayer *player)
   g_signal_emit (player, signals[CLOSE_REQUEST], 0);
 }
 
-static void
-mex_music_player_update_index (MexMusicPlayer *player,
-                               gint            new_index)
+/* Wraps or clamps @new_index depending on the repeat mode */
+static gint
+mex_music_player_get_index (MexMusicPlayer *player,
+                            gint            new_index)
 {
   MexMusicPlayerPrivate *priv = player->priv;
-  gint content_index, length;
-  MexContent *new_content;
+  gint length;
 
   length = mex_model_get_length (priv->model);
 
@@ -591,18 +665,109 @@ mex_music_player_update_index (MexMusicPlayer *player,
         new_index = 0;
     }
 
-  priv->current_index = new_index;
+  return new_index;
+}
+
+static MexContent *
+mex_music_player_get_content_at (MexMusicPlayer *player,
+                                 gint            index_)
+{
+  MexMusicPlayerPrivate *priv = player->priv;
 
   if (priv->shuffle)
-    content_index = g_array_index (priv->shuffle, gint, priv->current_index);
-  else
-    content_index = priv->current_index;
+    index_ = g_array_index (priv->shuffle, gint, index_);
+
+  return mex_model_get_content (priv->model, index_);
+}
+
+static void
+mex_music_player_update_index (MexMusicPlayer *player,
+                               gint            new_index)
+{
+  MexMusicPlayerPrivate *priv = player->priv;
+  MexContent *new_content;
+
+  priv->current_index = mex_music_player_get_index (player, new_index);
 
-  new_content = mex_model_get_content (priv->model, content_index);
+  new_content = mex_music_player_get_content_at (player, priv->current_index);
 
   mex_music_player_set_content (MEX_CONTENT_VIEW (player), new_content);
 }
 
+/* Works out the track to queue for gapless playback, there's none when
+ * we'd stop at the end of the list */
+static void
+mex_music_player_prepare_next (MexMusicPlayer *player)
+{
+  MexMusicPlayerPrivate *priv = player->priv;
+  MexContent *next_content = NULL;
+  gint next_index = -1;
+
+  if (priv->model && priv->content)
+    {
+      next_index = mex_music_player_get_index (player,
+                                               priv->current_index + 1);
+      if (next_index != priv->current_index || priv->repeat)
+        next_content = mex_music_player_get_content_at (player, next_index);
+    }
+
+  g_mutex_lock (&priv->next_lock);
+  g_free (priv->next_uri);
+  priv->next_uri = NULL;
+  priv->next_index = -1;
+  if (next_content)
+    {
+      priv->next_uri =
+        g_strdup (mex_content_get_metadata (next_content,
+                                            MEX_CONTENT_METADATA_STREAM));
+      priv->next_index = next_index;
+    }
+  g_mutex_unlock (&priv->next_lock);
+}
+
+/* Called from a streaming thread, playbin prerolls the uri we give it so
+ * the next track starts without a gap */
+static void
+mex_music_player_about_to_finish_cb (GstElement     *pipeline,
+                                     MexMusicPlayer *player)
+{
+  MexMusicPlayerPrivate *priv = player->priv;
+
+  g_mutex_lock (&priv->next_lock);
+  if (priv->next_uri)
+    {
+      g_object_set (pipeline, "uri", priv->next_uri, NULL);
+      priv->next_queued = TRUE;
+    }
+  g_mutex_unlock (&priv->next_lock);
+}
+
+/* The queued track has started playing, catch up with it */
+static void
+mex_music_player_stream_start_cb (GstBus         *bus,
+                                  GstMessage     *message,
+                                  MexMusicPlayer *player)
+{
+  MexMusicPlayerPrivate *priv = player->priv;
+  gint next_index;
+  gboolean queued;
+
+  g_mutex_lock (&priv->next_lock);
+  queued = priv->next_queued;
+  next_index = priv->next_index;
+  priv->next_queued = FALSE;
+  g_mutex_unlock (&priv->next_lock);
+
+  if (!queued || next_index < 0)
+    return;
+
+  priv->current_index = next_index;
+  mex_music_player_show_content (player,
+                                 mex_music_player_get_content_at (player,
+                                                                  next_index));
+  mex_music_player_prepare_next (player);
+}
+
 void
 mex_music_player_next (MexMusicPlayer *player)
 {
@@ -633,47 +798,114 @@ mex_music_player_repeat_toggled (MexMusicPlayer *player,
   MexMusicPlayerPrivate *priv = player->priv;
 
   priv->repeat = mx_button_get_toggled (repeat_button);
+
+  mex_music_player_prepare_next (player);
 }
 
 
-static gint
-mex_music_player_random_sort (gconstpointer a,
-                              gconstpointer b)
+/* Fisher-Yates shuffle of the @length first tracks, @positions is the
+ * inverse of @order. @rand can be %NULL to use the global generator */
+static void
+mex_music_player_shuffle_order (GArray *order,
+                                GArray *positions,
+                                gint    length,
+                                GRand  *rand)
+{
+  gint i, j, tmp;
+
+  g_array_set_size (order, length);
+  g_array_set_size (positions, length);
+
+  for (i = 0; i < length; i++)
+    g_array_index (order, gint, i) = i;
+
+  for (i = length - 1; i > 0; i--)
+    {
+      j = rand ? g_rand_int_range (rand, 0, i + 1)
+               : g_random_int_range (0, i + 1);
+
+      tmp = g_array_index (order, gint, i);
+      g_array_index (order, gint, i) = g_array_index (order, gint, j);
+      g_array_index (order, gint, j) = tmp;
+    }
+
+  for (i = 0; i < length; i++)
+    g_array_index (positions, gint, g_array_index (order, gint, i)) = i;
+}
+
+/* Moves @track to the start of the shuffled order */
+static void
+mex_music_player_shuffle_move_first (GArray *order,
+                                     GArray *positions,
+                                     gint    track)
 {
-  /* return a random sort value */
-  return g_random_int_range (-1, 2);
+  gint position, first;
+
+  position = g_array_index (positions, gint, track);
+  first = g_array_index (order, gint, 0);
+
+  g_array_index (order, gint, position) = first;
+  g_array_index (positions, gint, first) = position;
+  g_array_index (order, gint, 0) = track;
+  g_array_index (positions, gint, track) = 0;
 }
 
 static void
-mex_music_player_shuffle_toggled (MexMusicPlayer *player,
-                                  GParamSpec     *spec,
-                                  MxButton       *button)
+mex_music_player_shuffle (MexMusicPlayer *player)
 {
   MexMusicPlayerPrivate *priv = player->priv;
-  gint i;
+  gint length, current = -1;
 
-  if (mx_button_get_toggled (button))
+  length = priv->model ? mex_model_get_length (priv->model) : 0;
+
+  if (!priv->shuffle)
     {
-      gint length;
+      priv->shuffle = g_array_sized_new (FALSE, FALSE, sizeof (gint), length);
+      priv->shuffle_positions = g_array_sized_new (FALSE, FALSE,
+                                                   sizeof (gint), length);
+    }
 
-      length = mex_model_get_length (priv->model);
+  mex_music_player_shuffle_order (priv->shuffle, priv->shuffle_positions,
+                                  length, NULL);
 
-      priv->shuffle = g_array_sized_new (FALSE, FALSE, sizeof (gint), length);
+  /* the track being played comes first and the others follow in a random
+   * order, going back goes through the tracks that have been played */
+  if (priv->content)
+    current = mex_model_index (priv->model, priv->content);
 
-      for (i = 0; i < length; i++)
-        g_array_insert_val (priv->shuffle, i, i);
+  if (current >= 0)
+    mex_music_player_shuffle_move_first (priv->shuffle,
+                                         priv->shuffle_positions, current);
+  priv->current_index = 0;
+}
 
-      /* shuffle the list */
-      g_array_sort (priv->shuffle, mex_music_player_random_sort);
+static void
+mex_music_player_shuffle_toggled (MexMusicPlayer *player,
+                                  GParamSpec     *spec,
+                                  MxButton       *button)
+{
+  MexMusicPlayerPrivate *priv = player->priv;
+
+  if (mx_button_get_toggled (button))
+    {
+      mex_music_player_shuffle (player);
     }
   else
     {
       if (priv->shuffle)
         {
+          if (priv->current_index < (gint) priv->shuffle->len)
+            priv->current_index = g_array_index (priv->shuffle, gint,
+                                                 priv->current_index);
+
           g_array_free (priv->shuffle, TRUE);
+          g_array_free (priv->shuffle_positions, TRUE);
           priv->shuffle = NULL;
+          priv->shuffle_positions = NULL;
         }
     }
+
+  mex_music_player_prepare_next (player);
 }
 
 static void
@@ -782,3 +1014,82 @@ mex_music_player_set_uri (MexMusicPlayer *player, const gchar *uri)
 
   g_free (old_uri);
 }
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-test-internal.h"
+
+#define SHUFFLE_N_TRACKS 4
+#define SHUFFLE_N_PERMUTATIONS 24
+#define SHUFFLE_N_ROUNDS (SHUFFLE_N_PERMUTATIONS * 5000)
+
+/* index of a permutation of SHUFFLE_N_TRACKS elements (Lehmer code) */
+static gint
+_test_permutation_rank (GArray *order)
+{
+  gint i, j, rank = 0;
+
+  for (i = 0; i < SHUFFLE_N_TRACKS; i++)
+    {
+      gint smaller = 0;
+
+      for (j = i + 1; j < SHUFFLE_N_TRACKS; j++)
+        if (g_array_index (order, gint, j) < g_array_index (order, gint, i))
+          smaller++;
+
+      rank = rank * (SHUFFLE_N_TRACKS - i) + smaller;
+    }
+
+  return rank;
+}
+
+void
+mex_test_music_player_shuffle (void)
+{
+  guint counts[SHUFFLE_N_PERMUTATIONS] = { 0, };
+  GArray *order, *positions;
+  gdouble expected, chi2;
+  GRand *rand;
+  gint i;
+
+  rand = g_rand_new_with_seed (0x5eed);
+  order = g_array_new (FALSE, FALSE, sizeof (gint));
+  positions = g_array_new (FALSE, FALSE, sizeof (gint));
+
+  /* every permutation is equally likely */
+  for (i = 0; i < SHUFFLE_N_ROUNDS; i++)
+    {
+      mex_music_player_shuffle_order (order, positions, SHUFFLE_N_TRACKS,
+                                      rand);
+      counts[_test_permutation_rank (order)]++;
+    }
+
+  expected = (gdouble) SHUFFLE_N_ROUNDS / SHUFFLE_N_PERMUTATIONS;
+  chi2 = 0;
+  for (i = 0; i < SHUFFLE_N_PERMUTATIONS; i++)
+    chi2 += (counts[i] - expected) * (counts[i] - expected) / expected;
+
+  /* 23 degrees of freedom, p = 0.001 */
+  g_assert_cmpfloat (chi2, <, 49.73);
+
+  /* the positions are the inverse of the order, even after moving the
+   * current track first */
+  mex_music_player_shuffle_order (order, positions, 100, rand);
+  mex_music_player_shuffle_move_first (order, positions, 42);
+  g_assert_cmpint (g_array_index (order, gint, 0), ==, 42);
+  for (i = 0; i < 100; i++)
+    g_assert_cmpint (g_array_index (positions, gint,
+                                    g_array_index (order, gint, i)), ==, i);
+
+  /* degenerate lists */
+  mex_music_player_shuffle_order (order, positions, 1, rand);
+  g_assert_cmpint (g_array_index (order, gint, 0), ==, 0);
+  mex_music_player_shuffle_order (order, positions, 0, rand);
+  g_assert_cmpuint (order->len, ==, 0);
+
+  g_array_free (order, TRUE);
+  g_array_free (positions, TRUE);
+  g_rand_free (rand);
+}
+
+#endif
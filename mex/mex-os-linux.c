@@ -25,3 +25,9 @@ mex_os_get_n_cores (void)
 {
   return sysconf (_SC_NPROCESSORS_ONLN);
 }
+
+gint
+mex_os_fsync (gint fd)
+{
+  return fsync (fd);
+}
@@ -16,6 +16,8 @@
  * along with this program; if not, see <http://www.gnu.org/licenses>
  */
 
+#include <io.h>
+
 #include "mex-os.h"
 
 /* FIXME: port that function :) */
@@ -24,3 +26,9 @@ mex_os_get_n_cores (void)
 {
   return 1;
 }
+
+gint
+mex_os_fsync (gint fd)
+{
+  return _commit (fd);
+}
@@ -24,6 +24,7 @@
 G_BEGIN_DECLS
 
 gint  mex_os_get_n_cores (void);
+gint  mex_os_fsync       (gint fd);
 
 G_END_DECLS
 
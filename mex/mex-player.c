@@ -34,6 +34,7 @@
 #include "mex-content-tile.h"
 #include "mex-media-controls.h"
 #include "mex-screensaver.h"
+#include "mex-resume-store.h"
 #include "mex-log.h"
 #include "mex-utils.h"
 
@@ -57,6 +58,9 @@ G_DEFINE_TYPE_WITH_CODE (MexPlayer, mex_player, MX_TYPE_STACK,
 
 #define   GST_PLAY_FLAG_VIS (1 << 3)
 
+/* how often the position is saved while playing, in seconds */
+#define CHECKPOINT_INTERVAL 15
+
 struct _MexPlayerPrivate
 {
   MexMediaDBUSBridge *bridge;
@@ -79,6 +83,9 @@ struct _MexPlayerPrivate
   gdouble current_position;
   guint   duration;
 
+  gchar  *stream_uri;
+  gint64  last_checkpoint;
+
   MexScreensaver *screensaver;
 };
 
@@ -107,6 +114,7 @@ static void mex_get_stream_cb (MexProgram   *program,
                                gpointer      user_data);
 
 static void save_old_content (MexPlayer *player);
+static void mex_player_checkpoint (MexPlayer *player);
 
 static void media_eos_cb (ClutterMedia *media,
                           MexPlayer    *player);
@@ -352,6 +360,9 @@ mex_player_dispose (GObject *object)
       priv->bridge = NULL;
     }
 
+  g_free (priv->stream_uri);
+  priv->stream_uri = NULL;
+
   G_OBJECT_CLASS (mex_player_parent_class)->dispose (object);
 }
 
@@ -582,6 +593,15 @@ media_eos_cb (ClutterMedia *media,
 
   priv->position = 0.0;
 
+  /* watched until the end, start from the beginning next time */
+  if (priv->stream_uri)
+    {
+      mex_resume_store_remove (mex_resume_store_get_default (),
+                               priv->stream_uri);
+      g_free (priv->stream_uri);
+      priv->stream_uri = NULL;
+    }
+
   /* Check to see if we have enqueued content and if so play it next */
   enqueued_content =
     mex_media_controls_get_enqueued (MEX_MEDIA_CONTROLS (priv->controls),
@@ -621,7 +641,13 @@ media_playing_cb (ClutterMedia *media,
 
   /* reset at_eos flag if a video is now playing */
   if (clutter_media_get_playing (media))
-    priv->at_eos = FALSE;
+    {
+      priv->at_eos = FALSE;
+
+      /* played again after the end */
+      if (!priv->stream_uri)
+        priv->stream_uri = clutter_media_get_uri (media);
+    }
 }
 
 static void
@@ -648,10 +674,46 @@ save_old_content (MexPlayer *player)
         }
   }
 
+  /* not all contents can save their metadata, keep the position locally */
+  if (!priv->at_eos)
+    {
+      priv->last_checkpoint = 0;
+      mex_player_checkpoint (player);
+    }
+
   mex_content_set_last_used_metadatas (priv->content);
   mex_content_save_metadata (priv->content);
 }
 
+/* Saves the current position in the resume store, at most every
+ * CHECKPOINT_INTERVAL seconds, so that a crash doesn't lose it */
+static void
+mex_player_checkpoint (MexPlayer *player)
+{
+  MexPlayerPrivate *priv = player->priv;
+  gdouble duration;
+  gint64 now;
+
+  if (!priv->stream_uri || priv->at_eos)
+    return;
+
+  now = g_get_monotonic_time ();
+  if (priv->last_checkpoint &&
+      now - priv->last_checkpoint < CHECKPOINT_INTERVAL * G_USEC_PER_SEC)
+    return;
+
+  duration = clutter_media_get_duration (priv->media);
+  if (duration <= 0 || priv->current_position <= 0)
+    return;
+
+  priv->last_checkpoint = now;
+
+  mex_resume_store_set_position (mex_resume_store_get_default (),
+                                 priv->stream_uri,
+                                 priv->current_position * duration,
+                                 duration);
+}
+
 static void
 media_uri_changed_cb (GObject *object, GParamSpec *spec, MexPlayer *player)
 {
@@ -684,7 +746,12 @@ media_update_progress (GObject    *gobject,
   MexPlayerPrivate *priv = player->priv;
 
   if (!priv->at_eos)
-    priv->current_position = clutter_media_get_progress (priv->media);
+    {
+      priv->current_position = clutter_media_get_progress (priv->media);
+
+      if (clutter_media_get_playing (priv->media))
+        mex_player_checkpoint (player);
+    }
 }
 
 static void
@@ -779,6 +846,7 @@ mex_get_stream_cb (MexProgram   *program,
   MexPlayerPrivate *priv = player->priv;
   MexGenericContent  *generic_content;
   ClutterGstVideoTexture *video_texture;
+  guint resume_position, resume_duration;
 
   if (G_UNLIKELY (error))
     {
@@ -826,6 +894,17 @@ mex_get_stream_cb (MexProgram   *program,
         g_object_set (G_OBJECT (gst_element), "vis-plugin", visual, NULL);
     }
 
+  /* the local checkpoints are more recent than the metadata of the
+   * content, and work for contents that can't save their metadata */
+  g_free (priv->stream_uri);
+  priv->stream_uri = g_strdup (url);
+  priv->last_checkpoint = g_get_monotonic_time ();
+
+  resume_position = mex_resume_store_get_position (mex_resume_store_get_default (),
+                                                   url, &resume_duration);
+  if (resume_position > 0 && resume_duration > 0)
+    priv->position = (gdouble) resume_position / (gdouble) resume_duration;
+
   MEX_DEBUG ("set uri %s", url);
   clutter_media_set_uri (CLUTTER_MEDIA (priv->media), url);
   generic_content = MEX_GENERIC_CONTENT (priv->content);
@@ -841,6 +920,7 @@ mex_player_quit (MexPlayer *player)
 
   MEX_DEBUG ("quit");
   save_old_content (player);
+  mex_resume_store_flush (mex_resume_store_get_default ());
   clutter_media_set_uri (CLUTTER_MEDIA (priv->media), NULL);
   clutter_media_set_playing (priv->media, FALSE);
   g_signal_emit (player, signals[CLOSE_REQUEST], 0);
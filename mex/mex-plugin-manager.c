@@ -21,9 +21,14 @@
 
 #include <gmodule.h>
 
+#include "mex-enum-types.h"
+#include "mex-log-private.h"
 #include "mex-marshal.h"
 #include "mex-plugin.h"
 #include "mex-plugin-manager.h"
+#include "mex-private.h"
+
+#define MEX_LOG_DOMAIN_DEFAULT  startup_log_domain
 
 G_DEFINE_TYPE (MexPluginManager, mex_plugin_manager, G_TYPE_OBJECT)
 
@@ -46,11 +51,52 @@ enum
   LAST_SIGNAL
 };
 
+/* Plugins can ship a key file next to their module describing what they
+ * provide, eg. mex-tracker.so comes with mex-tracker.mex-plugin:
+ *
+ *   [Plugin]
+ *   Name=Tracker
+ *   Priority=200
+ *   Capabilities=model-provider;
+ *   Categories=videos;pictures;music;
+ *   Load=idle
+ *
+ * This lets us decide when to open the module without having to dlopen() it
+ * first. Load can be "startup" (opened by mex_plugin_manager_refresh(), what
+ * happens to modules without a descriptor), "idle" (opened once the main loop
+ * is idle, or earlier if needed) or "demand" (only opened when one of its
+ * categories or capabilities is asked for). */
+#define PLUGIN_DESCRIPTOR_EXTENSION ".mex-plugin"
+#define PLUGIN_DESCRIPTOR_GROUP     "Plugin"
+
+typedef enum
+{
+  MEX_PLUGIN_LOAD_STARTUP,
+  MEX_PLUGIN_LOAD_IDLE,
+  MEX_PLUGIN_LOAD_DEMAND
+} MexPluginLoadPolicy;
+
+typedef struct
+{
+  gchar                 *module_path;
+  gchar                 *name;
+  gint                   priority;
+  MexPluginCapabilities  capabilities;
+  gchar                **categories;
+  MexPluginLoadPolicy    load;
+} MexPluginDescriptor;
+
 struct _MexPluginManagerPrivate
 {
   gchar      **search_paths;
   GList       *descriptions;
   GHashTable  *plugins;
+
+  /* modules we have seen (opened or not), indexed by path */
+  GHashTable  *modules;
+  /* descriptors of the modules not opened yet, sorted by priority */
+  GList       *pending;
+  guint        idle_load_id;
 };
 
 static guint signals[LAST_SIGNAL] = { 0, };
@@ -136,17 +182,41 @@ mex_plugin_manager_set_property (GObject      *object,
     }
 }
 
+static void
+mex_plugin_descriptor_free (MexPluginDescriptor *descriptor)
+{
+  g_free (descriptor->module_path);
+  g_free (descriptor->name);
+  g_strfreev (descriptor->categories);
+  g_slice_free (MexPluginDescriptor, descriptor);
+}
+
 static void
 mex_plugin_manager_dispose (GObject *object)
 {
   MexPluginManagerPrivate *priv = MEX_PLUGIN_MANAGER (object)->priv;
 
+  if (priv->idle_load_id)
+    {
+      g_source_remove (priv->idle_load_id);
+      priv->idle_load_id = 0;
+    }
+
   if (priv->plugins)
     {
       g_hash_table_unref (priv->plugins);
       priv->plugins = NULL;
     }
 
+  if (priv->modules)
+    {
+      g_hash_table_unref (priv->modules);
+      priv->modules = NULL;
+    }
+
+  g_list_free_full (priv->pending, (GDestroyNotify) mex_plugin_descriptor_free);
+  priv->pending = NULL;
+
   G_OBJECT_CLASS (mex_plugin_manager_parent_class)->dispose (object);
 }
 
@@ -170,6 +240,16 @@ sort_by_prority (gconstpointer ap,
   return a->priority - b->priority;
 }
 
+static gint
+sort_descriptors_by_priority (gconstpointer ap,
+                              gconstpointer bp)
+{
+  const MexPluginDescriptor *a = ap;
+  const MexPluginDescriptor *b = bp;
+
+  return a->priority - b->priority;
+}
+
 static void
 mex_plugin_manager_open_plugin (MexPluginManager *manager,
                                 const gchar      *filename)
@@ -180,9 +260,12 @@ mex_plugin_manager_open_plugin (MexPluginManager *manager,
   GType plugin_type;
   gchar *plugin_name;
   gchar *plugin_suffix;
+  gint64 start;
 
   MexPluginManagerPrivate *priv = manager->priv;
 
+  start = g_get_monotonic_time ();
+
   /* Extract the plugin name */
   plugin_name = g_path_get_basename (filename);
   if ((plugin_suffix = g_strrstr (plugin_name, ".")))
@@ -224,6 +307,7 @@ mex_plugin_manager_open_plugin (MexPluginManager *manager,
       return;
     }
 
+  _mex_startup_timeline_add (plugin_name, "open", start);
   g_free (plugin_name);
 
   /* Unloading modules usually has bad effects - don't allow it */
@@ -271,6 +355,8 @@ mex_plugin_manager_init (MexPluginManager *self)
   priv->search_paths = build_plugin_search_paths ();
 
   priv->plugins = g_hash_table_new (g_direct_hash, g_direct_equal);
+  priv->modules = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, NULL);
 }
 
 MexPluginManager *
@@ -284,15 +370,200 @@ mex_plugin_manager_get_default (void)
   return manager;
 }
 
-void
-mex_plugin_manager_refresh (MexPluginManager *manager)
+static MexPluginDescriptor *
+mex_plugin_manager_read_descriptor (const gchar *module_path)
+{
+  MexPluginDescriptor *descriptor;
+  GFlagsClass *flags_class;
+  GKeyFile *key_file;
+  gchar *path, *load;
+  gchar **capabilities;
+  GError *error = NULL;
+  gint i;
+
+  /* mex-foo.so -> mex-foo.mex-plugin */
+  path = g_strdup_printf ("%.*s" PLUGIN_DESCRIPTOR_EXTENSION,
+                          (gint) (strlen (module_path) -
+                                  strlen (PLUGIN_EXTENSION)),
+                          module_path);
+
+  if (!g_file_test (path, G_FILE_TEST_IS_REGULAR))
+    {
+      g_free (path);
+      return NULL;
+    }
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, &error))
+    {
+      g_warning (G_STRLOC ": Couldn't read plugin descriptor %s: %s",
+                 path, error->message);
+      g_error_free (error);
+      g_key_file_free (key_file);
+      g_free (path);
+      return NULL;
+    }
+  g_free (path);
+
+  descriptor = g_slice_new0 (MexPluginDescriptor);
+  descriptor->module_path = g_strdup (module_path);
+  descriptor->name = g_key_file_get_string (key_file, PLUGIN_DESCRIPTOR_GROUP,
+                                            "Name", NULL);
+  if (!descriptor->name)
+    descriptor->name = g_path_get_basename (module_path);
+
+  descriptor->priority = MEX_PLUGIN_PRIORITY_NORMAL;
+  if (g_key_file_has_key (key_file, PLUGIN_DESCRIPTOR_GROUP, "Priority", NULL))
+    descriptor->priority = g_key_file_get_integer (key_file,
+                                                   PLUGIN_DESCRIPTOR_GROUP,
+                                                   "Priority", NULL);
+
+  descriptor->categories = g_key_file_get_string_list (key_file,
+                                                       PLUGIN_DESCRIPTOR_GROUP,
+                                                       "Categories",
+                                                       NULL, NULL);
+
+  capabilities = g_key_file_get_string_list (key_file, PLUGIN_DESCRIPTOR_GROUP,
+                                             "Capabilities", NULL, NULL);
+  flags_class = g_type_class_ref (MEX_TYPE_PLUGIN_CAPABILITIES);
+  for (i = 0; capabilities && capabilities[i]; i++)
+    {
+      GFlagsValue *value;
+
+      value = g_flags_get_value_by_nick (flags_class, capabilities[i]);
+      if (value)
+        descriptor->capabilities |= value->value;
+      else
+        g_warning (G_STRLOC ": Unknown capability '%s' for plugin %s",
+                   capabilities[i], descriptor->name);
+    }
+  g_type_class_unref (flags_class);
+  g_strfreev (capabilities);
+
+  load = g_key_file_get_string (key_file, PLUGIN_DESCRIPTOR_GROUP, "Load",
+                                NULL);
+  if (!g_strcmp0 (load, "demand"))
+    descriptor->load = MEX_PLUGIN_LOAD_DEMAND;
+  else if (!g_strcmp0 (load, "startup"))
+    descriptor->load = MEX_PLUGIN_LOAD_STARTUP;
+  else
+    descriptor->load = MEX_PLUGIN_LOAD_IDLE;
+  g_free (load);
+
+  g_key_file_free (key_file);
+
+  return descriptor;
+}
+
+/* Create the plugin objects of the descriptions opened so far */
+static void
+mex_plugin_manager_instantiate (MexPluginManager *manager)
+{
+  MexPluginManagerPrivate *priv = manager->priv;
+  GList *l;
+
+  /* in open_plugins() we inserted PluginDescriptions in prioriy order in
+   * priv->descriptions, time to load the plugins */
+  for (l = priv->descriptions; l; l = g_list_next (l))
+    {
+      MexPluginDescription *desc = l->data;
+      GType plugin_type;
+      GObject *plugin;
+      gint64 start;
+
+      /* already loaded */
+      if (g_hash_table_lookup (priv->plugins, desc))
+        continue;
+
+      start = g_get_monotonic_time ();
+
+      plugin_type = desc->get_type ();
+      plugin = g_object_new (plugin_type, NULL);
+      g_hash_table_insert (priv->plugins, desc, plugin);
+
+      g_signal_emit (manager, signals[PLUGIN_LOADED], 0, plugin);
+
+      _mex_startup_timeline_add (desc->name, "init", start);
+    }
+}
+
+static void
+mex_plugin_manager_load_descriptors (MexPluginManager *manager,
+                                     GList            *descriptors)
 {
   MexPluginManagerPrivate *priv = manager->priv;
   GList *l;
+
+  if (!descriptors)
+    return;
+
+  /* Plugins tend to look up their Grilo sources when created */
+  _mex_grilo_plugins_ensure_loaded ();
+
+  for (l = descriptors; l; l = l->next)
+    {
+      MexPluginDescriptor *descriptor = l->data;
+
+      priv->pending = g_list_remove (priv->pending, descriptor);
+
+      MEX_DEBUG ("Loading plugin %s", descriptor->name);
+      mex_plugin_manager_open_plugin (manager, descriptor->module_path);
+    }
+
+  mex_plugin_manager_instantiate (manager);
+
+  g_list_free_full (descriptors, (GDestroyNotify) mex_plugin_descriptor_free);
+}
+
+static gboolean
+mex_plugin_manager_idle_load_cb (MexPluginManager *manager)
+{
+  MexPluginManagerPrivate *priv = manager->priv;
+  GList *l;
+
+  /* Open one plugin per iteration so that we keep drawing frames */
+  for (l = priv->pending; l; l = l->next)
+    {
+      MexPluginDescriptor *descriptor = l->data;
+
+      if (descriptor->load == MEX_PLUGIN_LOAD_IDLE)
+        {
+          mex_plugin_manager_load_descriptors (manager,
+                                               g_list_prepend (NULL,
+                                                               descriptor));
+          return TRUE;
+        }
+    }
+
+  priv->idle_load_id = 0;
+
+  /* Everything we wanted at startup is there now */
+  _mex_startup_timeline_dump ();
+
+  return FALSE;
+}
+
+/**
+ * mex_plugin_manager_refresh:
+ * @manager: a #MexPluginManager
+ *
+ * Scans the plugin search paths for new plugins. Plugins without a
+ * descriptor file, or whose descriptor asks for it, are opened and created
+ * straight away. The other ones are opened when idle or when one of their
+ * categories or capabilities is needed, see
+ * mex_plugin_manager_load_category() and
+ * mex_plugin_manager_load_capabilities().
+ */
+void
+mex_plugin_manager_refresh (MexPluginManager *manager)
+{
+  MexPluginManagerPrivate *priv;
   gint i;
 
   g_return_if_fail (MEX_IS_PLUGIN_MANAGER (manager));
 
+  priv = manager->priv;
+
   for (i = 0; priv->search_paths[i]; i++)
     {
       GDir *dir;
@@ -329,30 +600,122 @@ mex_plugin_manager_refresh (MexPluginManager *manager)
       while (files)
         {
           gchar *full_file = files->data;
-
-          mex_plugin_manager_open_plugin (manager, full_file);
-          g_free (full_file);
+          MexPluginDescriptor *descriptor;
 
           files = g_list_delete_link (files, files);
+
+          if (g_hash_table_lookup (priv->modules, full_file))
+            {
+              g_free (full_file);
+              continue;
+            }
+          g_hash_table_insert (priv->modules, full_file, GINT_TO_POINTER (1));
+
+          descriptor = mex_plugin_manager_read_descriptor (full_file);
+          if (descriptor && descriptor->load != MEX_PLUGIN_LOAD_STARTUP)
+            {
+              priv->pending =
+                g_list_insert_sorted (priv->pending, descriptor,
+                                      sort_descriptors_by_priority);
+              continue;
+            }
+
+          if (descriptor)
+            mex_plugin_descriptor_free (descriptor);
+
+          mex_plugin_manager_open_plugin (manager, full_file);
         }
     }
 
-  /* in open_plugins() we inserted PluginDescriptions in prioriy order in
-   * priv->descriptions, time to load the plugins */
-  for (l = priv->descriptions; l; l = g_list_next (l))
+  mex_plugin_manager_instantiate (manager);
+
+  if (!priv->idle_load_id)
+    priv->idle_load_id =
+      g_idle_add_full (G_PRIORITY_LOW,
+                       (GSourceFunc) mex_plugin_manager_idle_load_cb,
+                       manager, NULL);
+}
+
+/**
+ * mex_plugin_manager_load_category:
+ * @manager: a #MexPluginManager
+ * @category: the name of a model category
+ *
+ * Opens the plugins, not loaded yet, that provide models for @category.
+ */
+void
+mex_plugin_manager_load_category (MexPluginManager *manager,
+                                  const gchar      *category)
+{
+  MexPluginManagerPrivate *priv;
+  GList *l, *descriptors = NULL;
+
+  g_return_if_fail (MEX_IS_PLUGIN_MANAGER (manager));
+  g_return_if_fail (category != NULL);
+
+  priv = manager->priv;
+
+  for (l = priv->pending; l; l = l->next)
     {
-      MexPluginDescription *desc = l->data;
-      GType plugin_type;
-      GObject *plugin;
+      MexPluginDescriptor *descriptor = l->data;
 
-      /* already loaded */
-      if (g_hash_table_lookup (priv->plugins, desc))
-        continue;
+      gint i;
 
-      plugin_type = desc->get_type ();
-      plugin = g_object_new (plugin_type, NULL);
-      g_hash_table_insert (priv->plugins, desc, plugin);
+      for (i = 0; descriptor->categories && descriptor->categories[i]; i++)
+        if (g_str_equal (descriptor->categories[i], category))
+          {
+            descriptors = g_list_prepend (descriptors, descriptor);
+            break;
+          }
+    }
 
-      g_signal_emit (manager, signals[PLUGIN_LOADED], 0, plugin);
+  mex_plugin_manager_load_descriptors (manager, g_list_reverse (descriptors));
+}
+
+/**
+ * mex_plugin_manager_load_capabilities:
+ * @manager: a #MexPluginManager
+ * @capabilities: a mask of #MexPluginCapabilities
+ *
+ * Opens the plugins, not loaded yet, that advertise any of @capabilities.
+ */
+void
+mex_plugin_manager_load_capabilities (MexPluginManager      *manager,
+                                      MexPluginCapabilities  capabilities)
+{
+  MexPluginManagerPrivate *priv;
+  GList *l, *descriptors = NULL;
+
+  g_return_if_fail (MEX_IS_PLUGIN_MANAGER (manager));
+
+  priv = manager->priv;
+
+  for (l = priv->pending; l; l = l->next)
+    {
+      MexPluginDescriptor *descriptor = l->data;
+
+      if (descriptor->capabilities & capabilities)
+        descriptors = g_list_prepend (descriptors, descriptor);
     }
+
+  mex_plugin_manager_load_descriptors (manager, g_list_reverse (descriptors));
+}
+
+/**
+ * mex_plugin_manager_load_pending:
+ * @manager: a #MexPluginManager
+ *
+ * Opens all the plugins found by mex_plugin_manager_refresh() that have not
+ * been loaded yet, whatever their load policy is.
+ */
+void
+mex_plugin_manager_load_pending (MexPluginManager *manager)
+{
+  MexPluginManagerPrivate *priv;
+
+  g_return_if_fail (MEX_IS_PLUGIN_MANAGER (manager));
+
+  priv = manager->priv;
+
+  mex_plugin_manager_load_descriptors (manager, g_list_copy (priv->pending));
 }
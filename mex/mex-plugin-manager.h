@@ -52,6 +52,27 @@ typedef struct _MexPluginManagerPrivate MexPluginManagerPrivate;
 
 typedef GType (*MexPluginGetTypeFunc)(void);
 
+/**
+ * MexPluginCapabilities:
+ * @MEX_PLUGIN_CAPABILITY_NONE: the plugin does not advertise anything
+ * @MEX_PLUGIN_CAPABILITY_MODEL_PROVIDER: the plugin provides models
+ * @MEX_PLUGIN_CAPABILITY_ACTION_PROVIDER: the plugin provides actions
+ * @MEX_PLUGIN_CAPABILITY_TOOL_PROVIDER: the plugin provides tools
+ * @MEX_PLUGIN_CAPABILITY_APPLET_PROVIDER: the plugin provides applets
+ *
+ * What a plugin provides, as advertised by its descriptor file. This is used
+ * to load plugins that have not been opened yet when one of their
+ * capabilities is first needed.
+ */
+typedef enum
+{
+  MEX_PLUGIN_CAPABILITY_NONE            = 0,
+  MEX_PLUGIN_CAPABILITY_MODEL_PROVIDER  = 1 << 0,
+  MEX_PLUGIN_CAPABILITY_ACTION_PROVIDER = 1 << 1,
+  MEX_PLUGIN_CAPABILITY_TOOL_PROVIDER   = 1 << 2,
+  MEX_PLUGIN_CAPABILITY_APPLET_PROVIDER = 1 << 3
+} MexPluginCapabilities;
+
 struct _MexPluginManager
 {
   GObject parent;
@@ -73,6 +94,12 @@ MexPluginManager *mex_plugin_manager_get_default (void);
 
 void mex_plugin_manager_refresh (MexPluginManager *manager);
 
+void mex_plugin_manager_load_category     (MexPluginManager      *manager,
+                                           const gchar           *category);
+void mex_plugin_manager_load_capabilities (MexPluginManager      *manager,
+                                           MexPluginCapabilities  capabilities);
+void mex_plugin_manager_load_pending      (MexPluginManager      *manager);
+
 G_END_DECLS
 
 #endif /* __MEX_PLUGIN_MANAGER_H__ */
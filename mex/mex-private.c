@@ -19,6 +19,21 @@
 
 #include "mex-private.h"
 #include "mex-content.h"
+#include "mex-log-private.h"
+
+#define MEX_LOG_DOMAIN_DEFAULT  startup_log_domain
+MEX_LOG_DOMAIN(startup_log_domain);
+
+typedef struct
+{
+  gchar  *what;
+  gint64  start;
+  gint64  duration;
+} MexStartupEvent;
+
+static GArray   *startup_events = NULL;
+static gint64    startup_origin = 0;
+static gboolean  startup_done = FALSE;
 
 gboolean
 mex_content_title_fallback_cb (GBinding     *binding,
@@ -85,3 +100,86 @@ _mex_print_date (GDateTime *date)
   g_free (str);
 }
 
+
+/*
+ * Startup timeline
+ *
+ * Records how long the expensive steps of the start up (opening plugins,
+ * loading Grilo plugins, ...) took. Each step is logged as it completes and
+ * a summary, most expensive step first, is given once the start up is over.
+ */
+
+void
+_mex_startup_timeline_add (const gchar *what,
+                           const gchar *stage,
+                           gint64       start)
+{
+  MexStartupEvent event;
+
+  if (G_UNLIKELY (startup_origin == 0))
+    startup_origin = start;
+
+  event.start = start - startup_origin;
+  event.duration = g_get_monotonic_time () - start;
+  event.what = g_strdup_printf ("%s (%s)", what, stage);
+
+  MEX_INFO ("+%.1f ms: %s took %.1f ms",
+            event.start / 1000.0, event.what, event.duration / 1000.0);
+
+  /* after the summary only log the events */
+  if (startup_done)
+    {
+      g_free (event.what);
+      return;
+    }
+
+  if (!startup_events)
+    startup_events = g_array_new (FALSE, FALSE, sizeof (MexStartupEvent));
+
+  g_array_append_val (startup_events, event);
+}
+
+static gint
+startup_event_compare (gconstpointer a,
+                       gconstpointer b)
+{
+  const MexStartupEvent *event_a = a;
+  const MexStartupEvent *event_b = b;
+
+  if (event_a->duration > event_b->duration)
+    return -1;
+
+  return (event_a->duration < event_b->duration) ? 1 : 0;
+}
+
+void
+_mex_startup_timeline_dump (void)
+{
+  gint64 total = 0;
+  guint i;
+
+  if (startup_done || !startup_events)
+    return;
+
+  g_array_sort (startup_events, startup_event_compare);
+
+  for (i = 0; i < startup_events->len; i++)
+    total += g_array_index (startup_events, MexStartupEvent, i).duration;
+
+  MEX_INFO ("Start up finished after %.1f ms, %u steps took %.1f ms:",
+            (g_get_monotonic_time () - startup_origin) / 1000.0,
+            startup_events->len, total / 1000.0);
+
+  for (i = 0; i < startup_events->len; i++)
+    {
+      MexStartupEvent *event = &g_array_index (startup_events,
+                                               MexStartupEvent, i);
+
+      MEX_INFO ("  %8.1f ms  %s", event->duration / 1000.0, event->what);
+      g_free (event->what);
+    }
+
+  g_array_free (startup_events, TRUE);
+  startup_events = NULL;
+  startup_done = TRUE;
+}
@@ -43,6 +43,15 @@ gboolean mex_content_title_fallback_cb (GBinding     *binding,
                                         gpointer      user_data);
 void _mex_print_date (GDateTime *date);
 
+/* Startup timeline, see MEX_DEBUG=startup:info */
+void _mex_startup_timeline_add  (const gchar *what,
+                                 const gchar *stage,
+                                 gint64       start);
+void _mex_startup_timeline_dump (void);
+
+/* mex-main.c */
+void _mex_grilo_plugins_ensure_loaded (void);
+
 G_END_DECLS
 
 #endif /* __MEX_PRIVATE_H__ */
@@ -25,11 +25,16 @@
  * in the model which are translated to GObjects (see mex_proxy_set_limit()),
  * and reorder the content in a model (by changing the start point from
  * which items are added: see mex_proxy_start_at()).
+ *
+ * Creating objects can be expensive so it is spread over several frames.
+ * All the proxies share the time that can be spent creating objects in a
+ * frame, proxies with a higher #MexProxy:priority being served first.
  */
 
 #include "mex-proxy.h"
 #include "mex-marshal.h"
 #include "mex-content.h"
+#include "mex-enum-types.h"
 #include <clutter/clutter.h>
 
 G_DEFINE_ABSTRACT_TYPE (MexProxy, mex_proxy, G_TYPE_OBJECT)
@@ -43,6 +48,7 @@ enum
 
   PROP_MODEL,
   PROP_TYPE,
+  PROP_PRIORITY
 };
 
 enum
@@ -58,16 +64,38 @@ struct _MexProxyPrivate
   MexModel   *model;
   GType       object_type;
   GHashTable *content_to_object;
+  GHashTable *object_to_content;
 
   GQueue     *to_add;
   GHashTable *to_add_hash;
-  GTimer     *timer;
-  guint       timer_timeout;
+
+  MexProxyPriority priority;
 };
 
 static guint signals[LAST_SIGNAL] = { 0, };
 
+/* The scheduler shares a per-frame budget for creating objects between all
+ * the proxies. The budget shrinks when frames take longer than they should
+ * and grows back when they don't. */
+#define FRAME_INTERVAL_MS  (1000.0 / 60.0)
+#define DEFAULT_BUDGET_MS  5.0
+#define MIN_BUDGET_MS      1.0
+#define MAX_BUDGET_MS      8.0
+
+typedef struct
+{
+  GList   *proxies;   /* proxies with contents to add, by priority */
+  guint    repaint_id;
+  GTimer  *timer;     /* time spent in the current frame */
+  gdouble  budget;
+  gint64   last_frame;
+} MexProxyScheduler;
+
+static MexProxyScheduler scheduler = { NULL, 0, NULL, DEFAULT_BUDGET_MS, 0 };
+
 static void mex_proxy_object_gone_cb (MexProxy *proxy, GObject *object);
+static void mex_proxy_scheduler_add (MexProxy *proxy);
+static void mex_proxy_scheduler_remove (MexProxy *proxy);
 static void mex_proxy_controller_changed_cb (GController          *controller,
                                              GControllerAction     action,
                                              GControllerReference *ref,
@@ -91,6 +119,10 @@ mex_proxy_get_property (GObject    *object,
       g_value_set_gtype (value, mex_proxy_get_object_type (proxy));
       break;
 
+    case PROP_PRIORITY:
+      g_value_set_enum (value, mex_proxy_get_priority (proxy));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -115,6 +147,10 @@ mex_proxy_set_property (GObject      *object,
       priv->object_type = g_value_get_gtype (value);
       break;
 
+    case PROP_PRIORITY:
+      mex_proxy_set_priority (proxy, g_value_get_enum (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -137,6 +173,12 @@ mex_proxy_dispose (GObject *object)
       priv->content_to_object = NULL;
     }
 
+  if (priv->object_to_content)
+    {
+      g_hash_table_unref (priv->object_to_content);
+      priv->object_to_content = NULL;
+    }
+
   if (priv->to_add)
     {
       g_queue_free (priv->to_add);
@@ -149,11 +191,7 @@ mex_proxy_dispose (GObject *object)
       priv->to_add_hash = NULL;
     }
 
-  if (priv->timer)
-    {
-      g_timer_destroy (priv->timer);
-      priv->timer = NULL;
-    }
+  mex_proxy_scheduler_remove (proxy);
 
   G_OBJECT_CLASS (mex_proxy_parent_class)->dispose (object);
 }
@@ -193,6 +231,14 @@ mex_proxy_class_init (MexProxyClass *klass)
                               G_PARAM_STATIC_STRINGS);
   g_object_class_install_property (object_class, PROP_TYPE, pspec);
 
+  pspec = g_param_spec_enum ("priority",
+                             "Priority",
+                             "Priority of the proxy when creating objects.",
+                             MEX_TYPE_PROXY_PRIORITY,
+                             MEX_PROXY_PRIORITY_DEFAULT,
+                             G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_PRIORITY, pspec);
+
   signals[OBJECT_CREATED] =
     g_signal_new ("object-created",
                   G_TYPE_FROM_CLASS (klass),
@@ -225,9 +271,12 @@ mex_proxy_init (MexProxy *self)
                            (GDestroyNotify)g_object_unref,
                            NULL);
 
-  priv->timer = g_timer_new ();
+  priv->object_to_content = g_hash_table_new (NULL, NULL);
+
   priv->to_add = g_queue_new ();
   priv->to_add_hash = g_hash_table_new (NULL, NULL);
+
+  priv->priority = MEX_PROXY_PRIORITY_DEFAULT;
 }
 
 MexModel *
@@ -244,22 +293,57 @@ mex_proxy_get_object_type (MexProxy *proxy)
   return proxy->priv->object_type;
 }
 
+/**
+ * mex_proxy_set_priority:
+ * @proxy: a #MexProxy
+ * @priority: the new priority
+ *
+ * Sets the priority of @proxy when creating objects. Proxies whose objects
+ * are visible or focused should be served before the others.
+ */
+void
+mex_proxy_set_priority (MexProxy         *proxy,
+                        MexProxyPriority  priority)
+{
+  MexProxyPrivate *priv;
+
+  g_return_if_fail (MEX_IS_PROXY (proxy));
+
+  priv = proxy->priv;
+
+  if (priv->priority == priority)
+    return;
+
+  priv->priority = priority;
+
+  if (g_list_find (scheduler.proxies, proxy))
+    {
+      mex_proxy_scheduler_remove (proxy);
+      mex_proxy_scheduler_add (proxy);
+    }
+
+  g_object_notify (G_OBJECT (proxy), "priority");
+}
+
+MexProxyPriority
+mex_proxy_get_priority (MexProxy *proxy)
+{
+  g_return_val_if_fail (MEX_IS_PROXY (proxy), MEX_PROXY_PRIORITY_DEFAULT);
+  return proxy->priv->priority;
+}
+
 static void
 mex_proxy_object_gone_cb (MexProxy *proxy,
                           GObject  *object)
 {
-  GHashTableIter iter;
-  gpointer key, value;
+  MexProxyPrivate *priv = proxy->priv;
+  MexContent *content;
 
-  g_hash_table_iter_init (&iter, proxy->priv->content_to_object);
-  while (g_hash_table_iter_next (&iter, &key, &value))
+  content = g_hash_table_lookup (priv->object_to_content, object);
+  if (content)
     {
-      if ((GObject *)value == object)
-        {
-          g_hash_table_iter_remove (&iter);
-
-          return;
-        }
+      g_hash_table_remove (priv->object_to_content, object);
+      g_hash_table_remove (priv->content_to_object, content);
     }
 }
 
@@ -274,6 +358,7 @@ mex_proxy_add_content_no_defer (MexProxy   *proxy,
   object = g_object_new (priv->object_type, NULL);
 
   g_hash_table_insert (priv->content_to_object, g_object_ref_sink (content), object);
+  g_hash_table_insert (priv->object_to_content, object, content);
 
   g_object_weak_ref (object, (GWeakNotify)mex_proxy_object_gone_cb, proxy);
 
@@ -282,32 +367,133 @@ mex_proxy_add_content_no_defer (MexProxy   *proxy,
   g_object_unref (object);
 }
 
+static gint
+mex_proxy_compare_priority (gconstpointer a,
+                            gconstpointer b)
+{
+  return MEX_PROXY (a)->priv->priority - MEX_PROXY (b)->priv->priority;
+}
+
+static void
+mex_proxy_scheduler_add (MexProxy *proxy)
+{
+  if (g_list_find (scheduler.proxies, proxy))
+    return;
+
+  /* keeps the proxies with the same priority in order */
+  scheduler.proxies = g_list_append (scheduler.proxies, proxy);
+  scheduler.proxies = g_list_sort (scheduler.proxies,
+                                   mex_proxy_compare_priority);
+}
+
+static void
+mex_proxy_scheduler_remove (MexProxy *proxy)
+{
+  scheduler.proxies = g_list_remove (scheduler.proxies, proxy);
+}
+
+/* Adjusts the budget given the time between the last two frames */
+static void
+mex_proxy_scheduler_adapt (gdouble interval_ms)
+{
+  if (interval_ms > FRAME_INTERVAL_MS * 1.5)
+    scheduler.budget = MAX (MIN_BUDGET_MS, scheduler.budget * 0.75);
+  else if (interval_ms < FRAME_INTERVAL_MS * 1.1)
+    scheduler.budget = MIN (MAX_BUDGET_MS, scheduler.budget + 0.5);
+}
+
 static gboolean
-mex_proxy_stop_timer_cb (MexProxy *proxy)
+mex_proxy_scheduler_over_budget (void)
 {
-  MexProxyPrivate *priv = proxy->priv;
+  return g_timer_elapsed (scheduler.timer, NULL) * 1000 >= scheduler.budget;
+}
 
-  g_timer_start (priv->timer);
+/* Creates objects until the budget of the frame is spent */
+static guint
+mex_proxy_scheduler_dispatch (void)
+{
+  guint n_created = 0;
 
-  while (g_timer_elapsed (priv->timer, NULL) * 1000 < 5 &&
-         !g_queue_is_empty (priv->to_add))
+  while (scheduler.proxies && !mex_proxy_scheduler_over_budget ())
     {
-      MexContent *content = g_queue_pop_head (priv->to_add);
-      g_hash_table_remove (priv->to_add_hash, content);
+      MexProxy *proxy = scheduler.proxies->data;
+      MexProxyPrivate *priv = proxy->priv;
+      MexContent *content;
+
+      content = g_queue_pop_head (priv->to_add);
+      if (content)
+        g_hash_table_remove (priv->to_add_hash, content);
 
+      if (g_queue_is_empty (priv->to_add))
+        mex_proxy_scheduler_remove (proxy);
+
+      if (!content)
+        continue;
+
+      g_object_ref (proxy);
       mex_proxy_add_content_no_defer (proxy, content);
       g_object_unref (content);
+      g_object_unref (proxy);
+
+      n_created++;
     }
 
-  g_timer_stop (priv->timer);
+  return n_created;
+}
+
+/* Makes sure the stages paint another frame to dispatch in */
+static void
+mex_proxy_scheduler_queue_frame (void)
+{
+  ClutterStageManager *stage_manager = clutter_stage_manager_get_default ();
+  const GSList *s;
+
+  for (s = clutter_stage_manager_peek_stages (stage_manager); s; s = s->next)
+    clutter_actor_queue_redraw (CLUTTER_ACTOR (s->data));
+}
+
+/* Runs once before each frame is painted: the interval between two of them
+ * is the real frame time, and the budget of the frame starts there. */
+static gboolean
+mex_proxy_scheduler_frame_cb (gpointer data)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  if (scheduler.last_frame)
+    mex_proxy_scheduler_adapt ((now - scheduler.last_frame) / 1000.0);
+  scheduler.last_frame = now;
 
-  if (g_queue_is_empty (priv->to_add))
+  g_timer_start (scheduler.timer);
+  mex_proxy_scheduler_dispatch ();
+
+  if (!scheduler.proxies)
     {
-      priv->timer_timeout = 0;
+      scheduler.repaint_id = 0;
+      scheduler.last_frame = 0;
       return FALSE;
     }
-  else
-    return TRUE;
+
+  mex_proxy_scheduler_queue_frame ();
+
+  return TRUE;
+}
+
+static void
+mex_proxy_scheduler_start (void)
+{
+  if (scheduler.repaint_id)
+    return;
+
+  if (!scheduler.timer)
+    {
+      scheduler.timer = g_timer_new ();
+      g_timer_start (scheduler.timer);
+    }
+
+  scheduler.repaint_id =
+    clutter_threads_add_repaint_func_full (CLUTTER_REPAINT_FLAGS_PRE_PAINT,
+                                           mex_proxy_scheduler_frame_cb,
+                                           NULL, NULL);
 }
 
 static void
@@ -316,26 +502,19 @@ mex_proxy_add_content (MexProxy   *proxy,
 {
   MexProxyPrivate *priv = proxy->priv;
 
-  /* Start the timer or re-start its time-out */
-  if (!priv->timer_timeout)
-    {
-      g_timer_start (priv->timer);
-      priv->timer_timeout =
-        g_idle_add_full (CLUTTER_PRIORITY_REDRAW,
-                         (GSourceFunc)mex_proxy_stop_timer_cb,
-                         proxy,
-                         NULL);
-    }
+  mex_proxy_scheduler_start ();
 
-  /* Don't spend more than 5ms before hitting the main-loop again
-   * creating/adding objects, and make sure to maintain order.
+  /* Don't go over the budget of the frame before the next one is painted,
+   * and make sure to maintain order.
    */
   if (!g_queue_is_empty (priv->to_add) ||
-      g_timer_elapsed (priv->timer, NULL) * 1000 >= 5)
+      mex_proxy_scheduler_over_budget ())
     {
       g_queue_push_tail (priv->to_add, g_object_ref_sink (content));
       g_hash_table_insert (priv->to_add_hash, content,
                            g_queue_peek_tail_link (priv->to_add));
+      mex_proxy_scheduler_add (proxy);
+      mex_proxy_scheduler_queue_frame ();
       return;
     }
 
@@ -361,6 +540,7 @@ mex_proxy_remove_content (MexProxy   *proxy,
       g_object_weak_unref (object,
                            (GWeakNotify)mex_proxy_object_gone_cb,
                            proxy);
+      g_hash_table_remove (priv->object_to_content, object);
       g_hash_table_remove (priv->content_to_object, content);
 
       g_object_unref (object);
@@ -388,6 +568,7 @@ mex_proxy_clear (MexProxy *proxy)
   g_queue_foreach (priv->to_add, (GFunc)g_object_unref, NULL);
   g_queue_clear (priv->to_add);
   g_hash_table_remove_all (priv->to_add_hash);
+  mex_proxy_scheduler_remove (proxy);
 
   g_list_free (contents);
 }
@@ -404,12 +585,6 @@ mex_proxy_set_model (MexProxy *proxy, MexModel *model)
 
   if (priv->model)
     {
-      if (priv->timer_timeout)
-        {
-          g_source_remove (priv->timer_timeout);
-          priv->timer_timeout = 0;
-        }
-
       controller = mex_model_get_controller (priv->model);
 
       g_signal_handlers_disconnect_by_func (controller,
@@ -500,3 +675,146 @@ mex_proxy_controller_changed_cb (GController          *controller,
       break;
     }
 }
+
+#if defined (ENABLE_TESTS)
+
+#include <math.h>
+
+#include "mex-generic-model.h"
+#include "mex-generic-proxy.h"
+#include "mex-program.h"
+#include "mex-test-internal.h"
+
+#define SCHEDULER_N_CONTENTS 20
+
+/* an object that takes about a millisecond to create */
+typedef GObject MexTestSlowObject;
+typedef GObjectClass MexTestSlowObjectClass;
+
+G_DEFINE_TYPE (MexTestSlowObject, mex_test_slow_object, G_TYPE_OBJECT)
+
+static void
+mex_test_slow_object_class_init (MexTestSlowObjectClass *klass)
+{
+}
+
+static void
+mex_test_slow_object_init (MexTestSlowObject *self)
+{
+  g_usleep (1000);
+}
+
+typedef struct
+{
+  guint n_default;
+  guint n_focused;
+} SchedulerTestData;
+
+static void
+_test_default_created_cb (MexProxy          *proxy,
+                          GObject           *content,
+                          GObject           *object,
+                          SchedulerTestData *data)
+{
+  data->n_default++;
+}
+
+static void
+_test_focused_created_cb (MexProxy          *proxy,
+                          GObject           *content,
+                          GObject           *object,
+                          SchedulerTestData *data)
+{
+  data->n_focused++;
+}
+
+void
+mex_test_proxy_scheduler (void)
+{
+  SchedulerTestData data = { 0, 0 };
+  MexModel *default_model, *focused_model;
+  MexProxy *default_proxy, *focused_proxy;
+  guint i, n_created, n_default_before;
+  gdouble budget;
+
+  /* the budget is clamped */
+  scheduler.budget = MIN_BUDGET_MS;
+  mex_proxy_scheduler_adapt (FRAME_INTERVAL_MS * 4);
+  g_assert_cmpfloat (scheduler.budget, ==, MIN_BUDGET_MS);
+
+  scheduler.budget = MAX_BUDGET_MS;
+  mex_proxy_scheduler_adapt (FRAME_INTERVAL_MS);
+  g_assert_cmpfloat (scheduler.budget, ==, MAX_BUDGET_MS);
+
+  mex_proxy_scheduler_adapt (FRAME_INTERVAL_MS * 4);
+  g_assert_cmpfloat (scheduler.budget, <, MAX_BUDGET_MS);
+
+  budget = scheduler.budget = 2.0;
+
+  default_model = mex_generic_model_new ("default", NULL);
+  focused_model = mex_generic_model_new ("focused", NULL);
+
+  default_proxy = mex_generic_proxy_new (default_model,
+                                         mex_test_slow_object_get_type ());
+  focused_proxy = mex_generic_proxy_new (focused_model,
+                                         mex_test_slow_object_get_type ());
+  mex_proxy_set_priority (focused_proxy, MEX_PROXY_PRIORITY_FOCUSED);
+
+  g_signal_connect (default_proxy, "object-created",
+                    G_CALLBACK (_test_default_created_cb), &data);
+  g_signal_connect (focused_proxy, "object-created",
+                    G_CALLBACK (_test_focused_created_cb), &data);
+
+  /* the default proxy gets its contents first, the first few objects are
+   * created straight away and the rest is deferred */
+  for (i = 0; i < SCHEDULER_N_CONTENTS; i++)
+    {
+      MexProgram *program = mex_program_new (NULL);
+      mex_model_add_content (default_model, MEX_CONTENT (program));
+    }
+  for (i = 0; i < SCHEDULER_N_CONTENTS; i++)
+    {
+      MexProgram *program = mex_program_new (NULL);
+      mex_model_add_content (focused_model, MEX_CONTENT (program));
+    }
+
+  g_assert_cmpuint (data.n_default + data.n_focused, <, 2 * SCHEDULER_N_CONTENTS);
+  g_assert (scheduler.proxies != NULL);
+
+  /* a frame doesn't go over its budget by more than one object */
+  n_default_before = data.n_default;
+  g_timer_start (scheduler.timer);
+  n_created = mex_proxy_scheduler_dispatch ();
+  g_assert_cmpuint (n_created, >, 0);
+  g_assert_cmpuint (n_created, <=, (guint) ceil (budget) + 1);
+
+  /* the focused proxy is served first */
+  g_assert_cmpuint (data.n_default, ==, n_default_before);
+
+  while (scheduler.proxies)
+    {
+      g_timer_start (scheduler.timer);
+      mex_proxy_scheduler_dispatch ();
+
+      if (data.n_default > n_default_before)
+        g_assert_cmpuint (data.n_focused, ==, SCHEDULER_N_CONTENTS);
+    }
+
+  g_assert_cmpuint (data.n_default, ==, SCHEDULER_N_CONTENTS);
+  g_assert_cmpuint (data.n_focused, ==, SCHEDULER_N_CONTENTS);
+
+  if (scheduler.repaint_id)
+    {
+      clutter_threads_remove_repaint_func (scheduler.repaint_id);
+      scheduler.repaint_id = 0;
+    }
+  scheduler.last_frame = 0;
+  scheduler.budget = DEFAULT_BUDGET_MS;
+
+  g_object_unref (default_proxy);
+  g_object_unref (focused_proxy);
+  g_object_unref (default_model);
+  g_object_unref (focused_model);
+}
+
+#endif /* ENABLE_TESTS */
@@ -47,6 +47,23 @@ G_BEGIN_DECLS
   (G_TYPE_INSTANCE_GET_CLASS ((obj), \
   MEX_TYPE_PROXY, MexProxyClass))
 
+/**
+ * MexProxyPriority:
+ * @MEX_PROXY_PRIORITY_FOCUSED: the objects are in a focused view
+ * @MEX_PROXY_PRIORITY_VISIBLE: the objects are visible
+ * @MEX_PROXY_PRIORITY_DEFAULT: the default priority
+ * @MEX_PROXY_PRIORITY_HIDDEN: the objects are not visible
+ *
+ * The order in which proxies get to create their objects.
+ */
+typedef enum
+{
+  MEX_PROXY_PRIORITY_FOCUSED,
+  MEX_PROXY_PRIORITY_VISIBLE,
+  MEX_PROXY_PRIORITY_DEFAULT,
+  MEX_PROXY_PRIORITY_HIDDEN
+} MexProxyPriority;
+
 typedef struct _MexProxy MexProxy;
 typedef struct _MexProxyClass MexProxyClass;
 typedef struct _MexProxyPrivate MexProxyPrivate;
@@ -78,6 +95,10 @@ void mex_proxy_set_model (MexProxy *proxy, MexModel *model);
 
 GType     mex_proxy_get_object_type (MexProxy *proxy);
 
+void             mex_proxy_set_priority (MexProxy         *proxy,
+                                         MexProxyPriority  priority);
+MexProxyPriority mex_proxy_get_priority (MexProxy         *proxy);
+
 G_END_DECLS
 
 #endif /* __MEX_PROXY_H__ */
@@ -20,10 +20,17 @@
 #include "config.h"
 #endif
 
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <json-glib/json-glib.h>
 
 #include "mex-queue-model.h"
+#include "mex-os.h"
 #include "mex-program.h"
 
 G_DEFINE_TYPE (MexQueueModel, mex_queue_model, MEX_TYPE_GENERIC_MODEL)
@@ -31,9 +38,61 @@ G_DEFINE_TYPE (MexQueueModel, mex_queue_model, MEX_TYPE_GENERIC_MODEL)
 #define QUEUE_MODEL_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_QUEUE_MODEL, MexQueueModelPrivate))
 
+/*
+ * The queue is persisted in two files:
+ *
+ *  - queue.json, a snapshot of the whole queue:
+ *      { "generation" : 4, "items" : [ { ...content... }, ... ] }
+ *    Older versions wrote a bare array of contents, which is still read.
+ *
+ *  - queue.journal, the changes made since that snapshot, one JSON record
+ *    per line:
+ *      { "generation" : 4 }
+ *      { "op" : "add", "index" : 3, "content" : { ...content... } }
+ *      { "op" : "remove", "index" : 0 }
+ *      { "op" : "clear" }
+ *
+ * Changes only append a line to the journal. Every now and then (and after
+ * a reordering of the queue, which the journal can't express) the queue is
+ * compacted: a new snapshot is written with a bumped generation number and
+ * the journal is restarted. Both files are replaced atomically and a journal
+ * whose generation doesn't match the snapshot's is stale and ignored, so a
+ * crash at any point leaves a consistent queue behind. A crash in the middle
+ * of an append leaves a truncated last line that is dropped when replaying.
+ *
+ * All the I/O happens, in order, in a dedicated thread.
+ */
+
+#define QUEUE_MAX_JOURNAL_RECORDS 100
+#define QUEUE_COMPACT_TIMEOUT     60 /* seconds */
+
+typedef enum
+{
+  QUEUE_JOB_LOAD,
+  QUEUE_JOB_APPEND,
+  QUEUE_JOB_COMPACT
+} QueueJobType;
+
+typedef struct
+{
+  QueueJobType   type;
+  MexQueueModel *model;
+  gchar         *data;
+  guint          generation;
+} QueueJob;
+
+/* result of a QUEUE_JOB_LOAD */
+typedef struct
+{
+  MexQueueModel *model;
+  GPtrArray     *nodes;
+  guint          generation;
+  guint          n_records;
+  gboolean       torn;
+} QueueLoadResult;
 
-static void mex_queue_model_save (MexQueueModel *model);
 static void mex_queue_model_load (MexQueueModel *model);
+static void mex_queue_model_compact (MexQueueModel *model);
 
 static void _controller_changed_cb (GController          *controller,
                                     GControllerAction     action,
@@ -43,7 +102,17 @@ static void _controller_changed_cb (GController          *controller,
 struct _MexQueueModelPrivate
 {
   GController *controller;
-  guint serialise_idle_id;
+
+  gchar       *snapshot_path;
+  gchar       *journal_path;
+  GThreadPool *io_pool;
+
+  guint        generation;
+  guint        n_journal_records;
+  guint        compact_id;
+
+  guint        loading : 1;
+  guint        compact_after_load : 1;
 };
 
 
@@ -87,12 +156,27 @@ mex_queue_model_dispose (GObject *object)
       priv->controller = NULL;
     }
 
+  if (priv->compact_id)
+    {
+      g_source_remove (priv->compact_id);
+      priv->compact_id = 0;
+    }
+
   G_OBJECT_CLASS (mex_queue_model_parent_class)->dispose (object);
 }
 
 static void
 mex_queue_model_finalize (GObject *object)
 {
+  MexQueueModelPrivate *priv = MEX_QUEUE_MODEL (object)->priv;
+
+  /* wait for the pending writes */
+  if (priv->io_pool)
+    g_thread_pool_free (priv->io_pool, FALSE, TRUE);
+
+  g_free (priv->snapshot_path);
+  g_free (priv->journal_path);
+
   G_OBJECT_CLASS (mex_queue_model_parent_class)->finalize (object);
 }
 
@@ -109,18 +193,536 @@ mex_queue_model_class_init (MexQueueModelClass *klass)
   object_class->finalize = mex_queue_model_finalize;
 }
 
+/*
+ * Journal records
+ */
+
+static gchar *
+_node_to_line (JsonNode *node)
+{
+  JsonGenerator *generator;
+  GString *line;
+  gchar *data;
+  gsize length;
+
+  generator = json_generator_new ();
+  json_generator_set_root (generator, node);
+  data = json_generator_to_data (generator, &length);
+  g_object_unref (generator);
+
+  /* records are separated by new lines, the generator does not output any
+   * when not pretty printing */
+  line = g_string_new_len (data, length);
+  g_string_append_c (line, '\n');
+  g_free (data);
+
+  return g_string_free (line, FALSE);
+}
+
+static gchar *
+_record_new (const gchar *op,
+             gint         index_,
+             MexContent  *content)
+{
+  JsonObject *object;
+  JsonNode *node;
+  gchar *line;
+
+  object = json_object_new ();
+  json_object_set_string_member (object, "op", op);
+  if (index_ >= 0)
+    json_object_set_int_member (object, "index", index_);
+  if (content)
+    json_object_set_member (object, "content",
+                            json_gobject_serialize (G_OBJECT (content)));
+
+  node = json_node_new (JSON_NODE_OBJECT);
+  json_node_take_object (node, object);
+  line = _node_to_line (node);
+  json_node_free (node);
+
+  return line;
+}
+
+static gchar *
+_journal_header_new (guint generation)
+{
+  JsonObject *object;
+  JsonNode *node;
+  gchar *line;
+
+  object = json_object_new ();
+  json_object_set_int_member (object, "generation", generation);
+
+  node = json_node_new (JSON_NODE_OBJECT);
+  json_node_take_object (node, object);
+  line = _node_to_line (node);
+  json_node_free (node);
+
+  return line;
+}
+
+static gchar *
+_model_to_snapshot (MexQueueModel *model,
+                    guint          generation)
+{
+  JsonObject *object;
+  JsonArray *json_array;
+  JsonNode *root;
+  JsonGenerator *generator;
+  gchar *data;
+  gint i;
+
+  json_array = json_array_sized_new (mex_model_get_length (MEX_MODEL (model)));
+
+  for (i = 0; i < mex_model_get_length (MEX_MODEL (model)); i++)
+    {
+      MexContent *content;
+      JsonNode *content_node;
+
+      content = mex_model_get_content (MEX_MODEL (model), i);
+
+      content_node = json_gobject_serialize (G_OBJECT (content));
+      json_array_add_element (json_array, content_node);
+    }
+
+  object = json_object_new ();
+  json_object_set_int_member (object, "generation", generation);
+  json_object_set_array_member (object, "items", json_array);
+
+  root = json_node_new (JSON_NODE_OBJECT);
+  json_node_take_object (root, object);
+
+  generator = json_generator_new ();
+  json_generator_set_root (generator, root);
+  data = json_generator_to_data (generator, NULL);
+
+  g_object_unref (generator);
+  json_node_free (root);
+
+  return data;
+}
+
+/*
+ * Replaying
+ */
+
+/* Apply the journal records to the array of content nodes read from the
+ * snapshot. Returns the number of records replayed, *torn is set if the
+ * journal ends with an incomplete or corrupted record */
+static guint
+_replay_journal (GPtrArray   *nodes,
+                 const gchar *journal,
+                 gsize        journal_length,
+                 guint        generation,
+                 gboolean    *torn)
+{
+  JsonParser *parser;
+  const gchar *line, *end, *journal_end;
+  gboolean header = TRUE;
+  guint n_records = 0;
+
+  *torn = FALSE;
+
+  if (!journal)
+    return 0;
+
+  parser = json_parser_new ();
+  journal_end = journal + journal_length;
+
+  for (line = journal; line < journal_end; line = end + 1)
+    {
+      JsonNode *root;
+      JsonObject *record;
+      const gchar *op;
+      gint64 index_;
+
+      end = memchr (line, '\n', journal_end - line);
+
+      /* the last record was not fully written */
+      if (!end)
+        {
+          *torn = TRUE;
+          break;
+        }
+
+      if (end == line)
+        continue;
+
+      if (!json_parser_load_from_data (parser, line, end - line, NULL))
+        {
+          *torn = TRUE;
+          break;
+        }
+
+      root = json_parser_get_root (parser);
+      if (!JSON_NODE_HOLDS_OBJECT (root))
+        {
+          *torn = TRUE;
+          break;
+        }
+      record = json_node_get_object (root);
+
+      if (header)
+        {
+          header = FALSE;
+
+          /* the journal predates the snapshot, we crashed while compacting */
+          if (!json_object_has_member (record, "generation") ||
+              json_object_get_int_member (record, "generation") != generation)
+            break;
+
+          continue;
+        }
+
+      op = json_object_get_string_member (record, "op");
+      index_ = json_object_has_member (record, "index") ?
+        json_object_get_int_member (record, "index") : -1;
+
+      if (!g_strcmp0 (op, "add") &&
+          index_ >= 0 && index_ <= nodes->len &&
+          json_object_has_member (record, "content"))
+        {
+          JsonNode *content;
+
+          content = json_node_copy (json_object_get_member (record, "content"));
+          g_ptr_array_add (nodes, NULL);
+          memmove (&nodes->pdata[index_ + 1], &nodes->pdata[index_],
+                   (nodes->len - 1 - index_) * sizeof (gpointer));
+          nodes->pdata[index_] = content;
+        }
+      else if (!g_strcmp0 (op, "remove") &&
+               index_ >= 0 && index_ < nodes->len)
+        {
+          g_ptr_array_remove_index (nodes, index_);
+        }
+      else if (!g_strcmp0 (op, "clear"))
+        {
+          g_ptr_array_set_size (nodes, 0);
+        }
+      else
+        {
+          g_warning (G_STRLOC ": Invalid queue journal record");
+          *torn = TRUE;
+          break;
+        }
+
+      n_records++;
+    }
+
+  g_object_unref (parser);
+
+  return n_records;
+}
+
+/* Read the snapshot, returns the content nodes it contains */
+static GPtrArray *
+_read_snapshot (const gchar *snapshot,
+                gsize        snapshot_length,
+                guint       *generation)
+{
+  JsonParser *parser;
+  GPtrArray *nodes;
+  JsonArray *array = NULL;
+  JsonNode *root;
+  GError *error = NULL;
+  gint i;
+
+  nodes = g_ptr_array_new_with_free_func ((GDestroyNotify) json_node_free);
+  *generation = 0;
+
+  if (!snapshot)
+    return nodes;
+
+  parser = json_parser_new ();
+  if (!json_parser_load_from_data (parser, snapshot, snapshot_length, &error))
+    {
+      g_warning (G_STRLOC ": error populating from file: %s",
+                 error->message);
+      g_clear_error (&error);
+      g_object_unref (parser);
+      return nodes;
+    }
+
+  root = json_parser_get_root (parser);
+
+  if (JSON_NODE_HOLDS_ARRAY (root))
+    {
+      array = json_node_get_array (root);
+    }
+  else if (JSON_NODE_HOLDS_OBJECT (root))
+    {
+      JsonObject *object = json_node_get_object (root);
+
+      *generation = json_object_get_int_member (object, "generation");
+      array = json_object_get_array_member (object, "items");
+    }
+
+  if (!array)
+    g_warning (G_STRLOC ": JSON data not of expected format!");
+
+  for (i = 0; array && i < json_array_get_length (array); i++)
+    g_ptr_array_add (nodes, json_node_copy (json_array_get_element (array, i)));
+
+  g_object_unref (parser);
+
+  return nodes;
+}
+
+/*
+ * I/O thread
+ */
+
+static gboolean
+_append_to_journal (const gchar  *path,
+                    guint         generation,
+                    const gchar  *data,
+                    GError      **error)
+{
+  gchar *header = NULL;
+  gsize length;
+  gint fd;
+
+  /* a journal always starts with the generation of its snapshot */
+  if (!g_file_test (path, G_FILE_TEST_EXISTS))
+    header = _journal_header_new (generation);
+
+  fd = g_open (path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "Could not open %s: %s", path, g_strerror (errno));
+      g_free (header);
+      return FALSE;
+    }
+
+  if (header)
+    data = header = g_strconcat (header, data, NULL);
+
+  length = strlen (data);
+  while (length > 0)
+    {
+      gssize written = write (fd, data, length);
+
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                       "Could not write to %s: %s", path, g_strerror (errno));
+          break;
+        }
+
+      data += written;
+      length -= written;
+    }
+
+  mex_os_fsync (fd);
+  close (fd);
+  g_free (header);
+
+  return (length == 0);
+}
+
 static gboolean
-_serialise_idle_cb (MexQueueModel *model)
+_load_done_cb (QueueLoadResult *result)
 {
+  MexQueueModel *model = result->model;
   MexQueueModelPrivate *priv = model->priv;
+  GList *contents = NULL;
+  gboolean compact;
+  gint i;
+
+  for (i = result->nodes->len - 1; i >= 0; i--)
+    {
+      MexContent *content;
+
+      content = (MexContent *)
+        json_gobject_deserialize (MEX_TYPE_PROGRAM,
+                                  g_ptr_array_index (result->nodes, i));
+      if (content)
+        contents = g_list_prepend (contents, content);
+    }
 
-  mex_queue_model_save (model);
+  priv->generation = result->generation;
 
-  priv->serialise_idle_id = 0;
+  /* compact what we have replayed and drop any partial record, also
+   * persist whatever has been queued while we were loading */
+  compact = result->torn || result->n_records > 0 || priv->compact_after_load;
+
+  /* all the queued items in one go, we don't want to journal them */
+  if (contents)
+    mex_model_add (MEX_MODEL (model), contents);
+  g_list_free (contents);
+
+  priv->loading = FALSE;
+  priv->compact_after_load = FALSE;
+
+  if (compact)
+    mex_queue_model_compact (model);
+
+  g_ptr_array_unref (result->nodes);
+  g_object_unref (result->model);
+  g_slice_free (QueueLoadResult, result);
+
+  return FALSE;
+}
+
+/* the last reference may be the one of a job, the model must not be
+ * finalized in the pool it is waiting for */
+static gboolean
+_release_model_cb (MexQueueModel *model)
+{
+  g_object_unref (model);
 
   return FALSE;
 }
 
+static void
+_io_thread_func (QueueJob *job,
+                 gpointer  user_data)
+{
+  MexQueueModelPrivate *priv = job->model->priv;
+  GError *error = NULL;
+
+  switch (job->type)
+    {
+    case QUEUE_JOB_LOAD:
+      {
+        QueueLoadResult *result;
+        gchar *snapshot = NULL, *journal = NULL;
+        gsize snapshot_length = 0, journal_length = 0;
+
+        g_file_get_contents (priv->snapshot_path, &snapshot, &snapshot_length,
+                             NULL);
+        g_file_get_contents (priv->journal_path, &journal, &journal_length,
+                             NULL);
+
+        result = g_slice_new0 (QueueLoadResult);
+        result->model = job->model;
+        result->nodes = _read_snapshot (snapshot, snapshot_length,
+                                        &result->generation);
+        result->n_records = _replay_journal (result->nodes,
+                                             journal, journal_length,
+                                             result->generation,
+                                             &result->torn);
+
+        g_free (snapshot);
+        g_free (journal);
+
+        /* the result keeps the reference on the model */
+        g_idle_add ((GSourceFunc) _load_done_cb, result);
+        g_slice_free (QueueJob, job);
+        return;
+      }
+
+    case QUEUE_JOB_APPEND:
+      if (!_append_to_journal (priv->journal_path, job->generation, job->data,
+                               &error))
+        {
+          g_warning (G_STRLOC ": Unable to update the queue journal: %s",
+                     error->message);
+          g_clear_error (&error);
+        }
+      break;
+
+    case QUEUE_JOB_COMPACT:
+      {
+        gchar *header;
+
+        /* snapshot first: if we crash before restarting the journal, the
+         * generation of the old journal won't match the new snapshot */
+        if (!g_file_set_contents (priv->snapshot_path, job->data, -1, &error))
+          {
+            g_warning (G_STRLOC ": Unable to replace the queue file: %s",
+                       error->message);
+            g_clear_error (&error);
+            break;
+          }
+
+        header = _journal_header_new (job->generation);
+        if (!g_file_set_contents (priv->journal_path, header, -1, &error))
+          {
+            g_warning (G_STRLOC ": Unable to reset the queue journal: %s",
+                       error->message);
+            g_clear_error (&error);
+          }
+        g_free (header);
+      }
+      break;
+    }
+
+  g_idle_add ((GSourceFunc) _release_model_cb, job->model);
+  g_free (job->data);
+  g_slice_free (QueueJob, job);
+}
+
+static void
+mex_queue_model_push_job (MexQueueModel *model,
+                          QueueJobType   type,
+                          gchar         *data)
+{
+  MexQueueModelPrivate *priv = model->priv;
+  QueueJob *job;
+
+  job = g_slice_new (QueueJob);
+  job->type = type;
+  job->model = g_object_ref (model);
+  job->data = data;
+  job->generation = priv->generation;
+
+  g_thread_pool_push (priv->io_pool, job, NULL);
+}
+
+/*
+ * Compaction
+ */
+
+static void
+mex_queue_model_compact (MexQueueModel *model)
+{
+  MexQueueModelPrivate *priv = model->priv;
+
+  if (priv->compact_id)
+    {
+      g_source_remove (priv->compact_id);
+      priv->compact_id = 0;
+    }
+
+  priv->generation++;
+  priv->n_journal_records = 0;
+
+  mex_queue_model_push_job (model, QUEUE_JOB_COMPACT,
+                            _model_to_snapshot (model, priv->generation));
+}
+
+static gboolean
+_compact_timeout_cb (MexQueueModel *model)
+{
+  model->priv->compact_id = 0;
+  mex_queue_model_compact (model);
+
+  return FALSE;
+}
+
+static void
+mex_queue_model_journal (MexQueueModel *model,
+                         gchar         *record)
+{
+  MexQueueModelPrivate *priv = model->priv;
+
+  mex_queue_model_push_job (model, QUEUE_JOB_APPEND, record);
+
+  if (++priv->n_journal_records >= QUEUE_MAX_JOURNAL_RECORDS)
+    mex_queue_model_compact (model);
+  else if (!priv->compact_id)
+    priv->compact_id =
+      g_timeout_add_seconds_full (G_PRIORITY_LOW, QUEUE_COMPACT_TIMEOUT,
+                                  (GSourceFunc) _compact_timeout_cb,
+                                  g_object_ref (model), g_object_unref);
+}
+
 static void
 _controller_changed_cb (GController          *controller,
                         GControllerAction     action,
@@ -128,31 +730,43 @@ _controller_changed_cb (GController          *controller,
                         MexQueueModel        *model)
 {
   MexQueueModelPrivate *priv = model->priv;
-  guint index_;
+  guint index_, n_indices, i;
   MexContent *content;
 
-  /*
-   * MexGenericContent only does single items at a time so we have an
-   * assumption here that our reference only contains a single item
-   */
-
-  if (action == G_CONTROLLER_ADD || action == G_CONTROLLER_REMOVE)
-    {
-      index_ = g_controller_reference_get_index_uint (ref, 0);
-      content = mex_model_get_content (MEX_MODEL (model), index_);
-    }
+  n_indices = g_controller_reference_get_n_indices (ref);
 
   if (action == G_CONTROLLER_ADD)
     {
-      mex_content_set_metadata (content,
-                                MEX_CONTENT_METADATA_QUEUED,
-                                "yes");
+      for (i = 0; i < n_indices; i++)
+        {
+          index_ = g_controller_reference_get_index_uint (ref, i);
+          content = mex_model_get_content (MEX_MODEL (model), index_);
+
+          mex_content_set_metadata (content,
+                                    MEX_CONTENT_METADATA_QUEUED,
+                                    "yes");
+
+          if (!priv->loading)
+            mex_queue_model_journal (model, _record_new ("add", index_,
+                                                         content));
+        }
     }
   else if (action == G_CONTROLLER_REMOVE)
     {
-      mex_content_set_metadata (content,
-                                MEX_CONTENT_METADATA_QUEUED,
-                                NULL);
+      /* the content is still in the model at this point */
+      for (i = 0; i < n_indices; i++)
+        {
+          index_ = g_controller_reference_get_index_uint (ref, i);
+          content = mex_model_get_content (MEX_MODEL (model), index_);
+
+          mex_content_set_metadata (content,
+                                    MEX_CONTENT_METADATA_QUEUED,
+                                    NULL);
+
+          if (!priv->loading)
+            mex_queue_model_journal (model, _record_new ("remove", index_,
+                                                         NULL));
+        }
     }
   else if (action == G_CONTROLLER_CLEAR)
     {
@@ -167,6 +781,15 @@ _controller_changed_cb (GController          *controller,
                                     MEX_CONTENT_METADATA_QUEUED,
                                     NULL);
         }
+
+      if (!priv->loading)
+        mex_queue_model_journal (model, _record_new ("clear", -1, NULL));
+    }
+  else if (action == G_CONTROLLER_REPLACE)
+    {
+      /* the queue has been reordered, the journal can't express that */
+      if (!priv->loading)
+        mex_queue_model_compact (model);
     }
   else
     {
@@ -181,28 +804,28 @@ _controller_changed_cb (GController          *controller,
       g_type_class_unref (enum_class);
     }
 
-  if (priv->serialise_idle_id)
-    return;
-
-  /* Need to use a high priority idle here since we want to try and write
-   * *after* the content has been removed from the model
-   */
-  priv->serialise_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT,
-                                             (GSourceFunc)_serialise_idle_cb,
-                                             g_object_ref (model),
-                                             g_object_unref);
+  if (priv->loading)
+    priv->compact_after_load = TRUE;
 }
 
 static void
 mex_queue_model_init (MexQueueModel *self)
 {
   MexQueueModelPrivate *priv;
+  gchar *directory;
 
   self->priv = QUEUE_MODEL_PRIVATE (self);
   priv = self->priv;
 
-  /* Load before setting up the controller otherwise .. BOOM! */
-  mex_queue_model_load (self);
+  directory = g_build_filename (g_get_user_data_dir (), "mex", NULL);
+  g_mkdir_with_parents (directory, 0775);
+  priv->snapshot_path = g_build_filename (directory, "queue.json", NULL);
+  priv->journal_path = g_build_filename (directory, "queue.journal", NULL);
+  g_free (directory);
+
+  /* one thread so that the I/O happens in order */
+  priv->io_pool = g_thread_pool_new ((GFunc) _io_thread_func, NULL,
+                                     1, FALSE, NULL);
 
   priv->controller = mex_model_get_controller (MEX_MODEL (self));
   g_signal_connect (priv->controller,
@@ -210,6 +833,8 @@ mex_queue_model_init (MexQueueModel *self)
                     (GCallback)_controller_changed_cb,
                     self);
 
+  mex_queue_model_load (self);
+
   g_object_set (self, "title", _("Queue"), NULL);
 }
 
@@ -233,181 +858,106 @@ mex_queue_model_dup_singleton (void)
   return model;
 }
 
-static JsonGenerator *
-_model_to_generator (MexQueueModel *model)
-{
-  gint i;
-  JsonArray *json_array;
-  JsonNode *root;
-  JsonGenerator *generator;
-
-  json_array = json_array_sized_new (mex_model_get_length (MEX_MODEL (model)));
-
-  for (i = 0; i < mex_model_get_length (MEX_MODEL (model)); i++)
-    {
-      MexContent *content;
-      JsonNode *content_node;
-
-      content = mex_model_get_content (MEX_MODEL (model), i);
-
-      content_node = json_gobject_serialize (G_OBJECT (content));
-      json_array_add_element (json_array, content_node);
-    }
-
-  generator = json_generator_new ();
-  root = json_node_new (JSON_NODE_ARRAY);
-  json_node_set_array (root, json_array);
-
-  json_generator_set_root (generator, root);
-
-  json_array_unref (json_array);
-  json_node_free (root);
-
-  return generator;
-}
-
-static gchar *
-_queue_file_name (void)
+/* The snapshot and journal are read and replayed in the I/O thread, the
+ * items are added to the model in one go once back in the main loop */
+static void
+mex_queue_model_load (MexQueueModel *model)
 {
-  gchar *directory;
-  gchar *filename;
-
-  directory = g_build_filename (g_get_user_data_dir (),
-                               "mex",
-                               NULL);
-  g_mkdir_with_parents (directory, 0775);
-
-  filename = g_build_filename (g_get_user_data_dir (),
-                               "mex",
-                               "queue.json",
-                               NULL);
-
-  g_free (directory);
+  MexQueueModelPrivate *priv = model->priv;
 
-  return filename;
+  priv->loading = TRUE;
+  mex_queue_model_push_job (model, QUEUE_JOB_LOAD, NULL);
 }
 
-static void
-_file_replaced_cb (GFile        *f,
-                   GAsyncResult *res,
-                   gchar        *buf)
-{
-  GError *error = NULL;
+#if defined (ENABLE_TESTS)
 
-  if (!g_file_replace_contents_finish (f, res, NULL, &error))
-    {
-      g_warning (G_STRLOC ": Unable to replace the queue file: %s",
-                 error->message);
-      g_clear_error (&error);
-    }
-
-  g_free (buf);
-}
+#include "mex-test-internal.h"
 
-/* This function is asynchronous .. slightly worried about re-entrancy here */
-static void
-mex_queue_model_save (MexQueueModel *model)
+static gchar *
+_test_replay (const gchar *snapshot,
+              const gchar *journal,
+              gboolean    *torn)
 {
-  GFile *f;
-  gchar *filename;
-  JsonGenerator *generator;
-  gchar *buf;
-  gsize buf_len;
+  GPtrArray *nodes;
+  GString *titles;
+  guint generation, i;
 
-  filename = _queue_file_name ();
-  f = g_file_new_for_path (filename);
+  nodes = _read_snapshot (snapshot, snapshot ? strlen (snapshot) : 0,
+                          &generation);
+  _replay_journal (nodes, journal, journal ? strlen (journal) : 0,
+                   generation, torn);
 
-  if (mex_model_get_length (MEX_MODEL (model)) == 0)
+  titles = g_string_new (NULL);
+  for (i = 0; i < nodes->len; i++)
     {
-      GError *error = NULL;
-
-      if (!g_file_delete (f, NULL, &error))
-        {
-          g_warning (G_STRLOC ": Unable to delete file: %s",
-                     error->message);
-          g_clear_error (&error);
-        }
+      JsonObject *object = json_node_get_object (g_ptr_array_index (nodes, i));
 
-      g_object_unref (f);
-      g_free (filename);
-      return;
+      g_string_append (titles, json_object_get_string_member (object,
+                                                              "title"));
     }
+  g_ptr_array_unref (nodes);
 
-  generator = _model_to_generator (model);
-
-  buf = json_generator_to_data (generator, &buf_len);
-
-  g_file_replace_contents_async (f,
-                                 buf,
-                                 buf_len,
-                                 NULL,
-                                 FALSE,
-                                 G_FILE_CREATE_REPLACE_DESTINATION,
-                                 NULL,
-                                 (GAsyncReadyCallback)_file_replaced_cb,
-                                 buf);
-
-  g_object_unref (f);
-  g_free (filename);
-  g_object_unref (generator);
+  return g_string_free (titles, FALSE);
 }
 
-/* This function is synchronous! Blocking once at startup seems pretty
- * reasonable and allows us to avoid any complexity re. races
- */
-static void
-mex_queue_model_load (MexQueueModel *model)
+void
+mex_test_queue_model_journal (void)
 {
-  JsonParser *parser;
-  gchar *filename;
-  GError *error = NULL;
-  JsonNode *root;
-  JsonArray *array;
-  gint i = 0;
-
-  filename = _queue_file_name ();
-
-  if (!g_file_test (filename, G_FILE_TEST_EXISTS))
-    {
-      g_free (filename);
-
-      return;
-    }
-
-  parser = json_parser_new ();
-  if (!json_parser_load_from_file (parser, filename, &error))
-    {
-      g_warning (G_STRLOC ": error populating from file: %s",
-                 error->message);
-      g_clear_error (&error);
-      goto out;
-    }
-
-  root = json_parser_get_root (parser);
-
-  if (!JSON_NODE_HOLDS_ARRAY (root))
-    {
-      g_warning (G_STRLOC ": JSON data not of expected format!");
-
-      goto out;
-    }
-
-  array = json_node_get_array (root);
-
-  for (i = 0; i < json_array_get_length (array); i++)
-    {
-      MexContent *content;
-      JsonNode *node;
-
-      node = json_array_get_element (array, i);
-      content = (MexContent *)json_gobject_deserialize (MEX_TYPE_PROGRAM,
-                                                        node);
-
-      mex_model_add_content (MEX_MODEL (model), content);
-    }
-
-out:
-  g_free (filename);
-  g_object_unref (parser);
+  const gchar *snapshot =
+    "{ \"generation\" : 3, \"items\" : "
+    "[ { \"title\" : \"a\" }, { \"title\" : \"b\" } ] }";
+  gboolean torn;
+  gchar *titles;
+
+  /* legacy snapshot, no journal */
+  titles = _test_replay ("[ { \"title\" : \"a\" } ]", NULL, &torn);
+  g_assert_cmpstr (titles, ==, "a");
+  g_assert (!torn);
+  g_free (titles);
+
+  /* a journal applied on top of its snapshot */
+  titles = _test_replay (snapshot,
+                         "{\"generation\":3}\n"
+                         "{\"op\":\"add\",\"index\":2,"
+                         "\"content\":{\"title\":\"c\"}}\n"
+                         "{\"op\":\"remove\",\"index\":0}\n"
+                         "{\"op\":\"add\",\"index\":0,"
+                         "\"content\":{\"title\":\"d\"}}\n",
+                         &torn);
+  g_assert_cmpstr (titles, ==, "dbc");
+  g_assert (!torn);
+  g_free (titles);
+
+  /* crash in the middle of an append: the complete records are kept */
+  titles = _test_replay (snapshot,
+                         "{\"generation\":3}\n"
+                         "{\"op\":\"remove\",\"index\":1}\n"
+                         "{\"op\":\"add\",\"index\":1,\"cont",
+                         &torn);
+  g_assert_cmpstr (titles, ==, "a");
+  g_assert (torn);
+  g_free (titles);
+
+  /* crash while compacting: the journal of the previous generation has
+   * already been folded in the snapshot */
+  titles = _test_replay (snapshot,
+                         "{\"generation\":2}\n"
+                         "{\"op\":\"clear\"}\n",
+                         &torn);
+  g_assert_cmpstr (titles, ==, "ab");
+  g_assert (!torn);
+  g_free (titles);
+
+  /* a clear followed by new items */
+  titles = _test_replay (snapshot,
+                         "{\"generation\":3}\n"
+                         "{\"op\":\"clear\"}\n"
+                         "{\"op\":\"add\",\"index\":0,"
+                         "\"content\":{\"title\":\"e\"}}\n",
+                         &torn);
+  g_assert_cmpstr (titles, ==, "e");
+  g_assert (!torn);
+  g_free (titles);
 }
 
+#endif
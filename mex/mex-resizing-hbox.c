@@ -20,6 +20,7 @@
 #include "mex-resizing-hbox.h"
 #include "mex-resizing-hbox-child.h"
 #include "mex-utils.h"
+#include "mex-frame-profiler.h"
 #include "mex-scene.h"
 #include "mex-column-view.h"
 #include "mex-scroll-view.h"
@@ -1200,6 +1201,8 @@ mex_resizing_hbox_allocate (ClutterActor           *actor,
   MexResizingHBox *self = MEX_RESIZING_HBOX (actor);
   MexResizingHBoxPrivate *priv = self->priv;
 
+  mex_frame_profiler_begin_actor (actor);
+
   CLUTTER_ACTOR_CLASS (mex_resizing_hbox_parent_class)->
     allocate (actor, box, flags);
 
@@ -1213,6 +1216,8 @@ mex_resizing_hbox_allocate (ClutterActor           *actor,
     progress = 1.0;
 
   mex_resizing_hbox_allocate_children (self, box, flags, progress);
+
+  mex_frame_profiler_end_actor (actor);
 }
 
 static void
@@ -1347,6 +1352,8 @@ mex_resizing_hbox_paint (ClutterActor *actor)
   MexResizingHBox *self = MEX_RESIZING_HBOX (actor);
   MexResizingHBoxPrivate *priv = self->priv;
 
+  mex_frame_profiler_begin_actor (actor);
+
   CLUTTER_ACTOR_CLASS (mex_resizing_hbox_parent_class)->paint (actor);
 
   progress = clutter_alpha_get_alpha (priv->alpha);
@@ -1378,6 +1385,8 @@ mex_resizing_hbox_paint (ClutterActor *actor)
           break;
         }
     }
+
+  mex_frame_profiler_end_actor (actor);
 }
 
 static void
@@ -0,0 +1,670 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include "mex-resume-store.h"
+#include "mex-os.h"
+
+/*
+ * The positions are kept in a log, one record per line:
+ *
+ *   <position> <duration> <uri>
+ *
+ * in seconds, a position of 0 removing the entry of the uri. The last record
+ * of a uri wins. Records are batched and appended (and fsync'ed) from a
+ * dedicated thread, a crash in the middle of an append leaves a truncated
+ * last line that is dropped when loading. When the log gets much bigger
+ * than the number of entries it is rewritten from scratch.
+ */
+
+#define RESUME_FLUSH_TIMEOUT  5  /* seconds */
+#define RESUME_MIN_RECORDS    64
+
+G_DEFINE_TYPE (MexResumeStore, mex_resume_store, G_TYPE_OBJECT)
+
+#define RESUME_STORE_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_RESUME_STORE, \
+                                MexResumeStorePrivate))
+
+enum
+{
+  PROP_0,
+
+  PROP_PATH
+};
+
+typedef struct
+{
+  guint position;
+  guint duration;
+} ResumeEntry;
+
+typedef struct
+{
+  gchar    *path;
+  gchar    *data;
+  gboolean  rewrite;
+} ResumeJob;
+
+struct _MexResumeStorePrivate
+{
+  gchar       *path;
+  GHashTable  *entries;
+  GString     *pending;
+  guint        n_records;
+  guint        flush_id;
+  GThreadPool *io_pool;
+};
+
+static void mex_resume_store_load (MexResumeStore *store);
+
+/*
+ * I/O
+ */
+
+static gboolean
+_append (const gchar  *path,
+         const gchar  *data,
+         GError      **error)
+{
+  gsize length;
+  gint fd;
+
+  fd = g_open (path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd < 0)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   "Could not open %s: %s", path, g_strerror (errno));
+      return FALSE;
+    }
+
+  length = strlen (data);
+  while (length > 0)
+    {
+      gssize written = write (fd, data, length);
+
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                       "Could not write to %s: %s", path, g_strerror (errno));
+          break;
+        }
+
+      data += written;
+      length -= written;
+    }
+
+  mex_os_fsync (fd);
+  close (fd);
+
+  return (length == 0);
+}
+
+static void
+_io_thread_func (ResumeJob *job,
+                 gpointer   user_data)
+{
+  GError *error = NULL;
+  gboolean success;
+
+  if (job->rewrite)
+    success = g_file_set_contents (job->path, job->data, -1, &error);
+  else
+    success = _append (job->path, job->data, &error);
+
+  if (!success)
+    {
+      g_warning (G_STRLOC ": Unable to save resume positions: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+
+  g_free (job->path);
+  g_free (job->data);
+  g_slice_free (ResumeJob, job);
+}
+
+static void
+_append_record (GString     *string,
+                const gchar *uri,
+                guint        position,
+                guint        duration)
+{
+  g_string_append_printf (string, "%u %u %s\n", position, duration, uri);
+}
+
+static gchar *
+_entries_to_data (GHashTable *entries)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+  GString *data;
+
+  data = g_string_new (NULL);
+
+  g_hash_table_iter_init (&iter, entries);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      ResumeEntry *entry = value;
+      _append_record (data, key, entry->position, entry->duration);
+    }
+
+  return g_string_free (data, FALSE);
+}
+
+/* Replays the log in @data, returns the number of records or -1 if the last
+ * one is truncated */
+static gint
+_replay (GHashTable  *entries,
+         const gchar *data,
+         gsize        length)
+{
+  const gchar *line, *end, *data_end = data + length;
+  gint n_records = 0;
+
+  for (line = data; line < data_end; line = end + 1)
+    {
+      gchar *uri, *next;
+      guint position, duration;
+
+      end = memchr (line, '\n', data_end - line);
+      if (!end)
+        return -1;
+
+      position = strtoul (line, &next, 10);
+      if (next == line || *next != ' ')
+        continue;
+
+      line = next + 1;
+      duration = strtoul (line, &next, 10);
+      if (next == line || *next != ' ' || next + 1 >= end)
+        continue;
+
+      uri = g_strndup (next + 1, end - next - 1);
+
+      if (position)
+        {
+          ResumeEntry *entry = g_slice_new (ResumeEntry);
+
+          entry->position = position;
+          entry->duration = duration;
+          g_hash_table_insert (entries, uri, entry);
+        }
+      else
+        {
+          g_hash_table_remove (entries, uri);
+          g_free (uri);
+        }
+
+      n_records++;
+    }
+
+  return n_records;
+}
+
+static void
+mex_resume_store_push_job (MexResumeStore *store,
+                           gchar          *data,
+                           gboolean        rewrite)
+{
+  MexResumeStorePrivate *priv = store->priv;
+  ResumeJob *job;
+
+  job = g_slice_new (ResumeJob);
+  job->path = g_strdup (priv->path);
+  job->data = data;
+  job->rewrite = rewrite;
+
+  g_thread_pool_push (priv->io_pool, job, NULL);
+}
+
+/* Hands the pending records to the I/O thread */
+static void
+mex_resume_store_write (MexResumeStore *store)
+{
+  MexResumeStorePrivate *priv = store->priv;
+  guint n_entries;
+
+  if (priv->flush_id)
+    {
+      g_source_remove (priv->flush_id);
+      priv->flush_id = 0;
+    }
+
+  if (priv->pending->len == 0)
+    return;
+
+  n_entries = g_hash_table_size (priv->entries);
+
+  if (priv->n_records > RESUME_MIN_RECORDS + n_entries * 2)
+    {
+      mex_resume_store_push_job (store, _entries_to_data (priv->entries),
+                                 TRUE);
+      priv->n_records = n_entries;
+    }
+  else
+    mex_resume_store_push_job (store, g_strdup (priv->pending->str), FALSE);
+
+  g_string_truncate (priv->pending, 0);
+}
+
+static gboolean
+mex_resume_store_flush_cb (MexResumeStore *store)
+{
+  store->priv->flush_id = 0;
+  mex_resume_store_write (store);
+
+  return FALSE;
+}
+
+/*
+ * GObject implementation
+ */
+
+static void
+mex_resume_store_get_property (GObject    *object,
+                               guint       property_id,
+                               GValue     *value,
+                               GParamSpec *pspec)
+{
+  MexResumeStorePrivate *priv = MEX_RESUME_STORE (object)->priv;
+
+  switch (property_id)
+    {
+    case PROP_PATH:
+      g_value_set_string (value, priv->path);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_resume_store_set_property (GObject      *object,
+                               guint         property_id,
+                               const GValue *value,
+                               GParamSpec   *pspec)
+{
+  MexResumeStorePrivate *priv = MEX_RESUME_STORE (object)->priv;
+
+  switch (property_id)
+    {
+    case PROP_PATH:
+      g_free (priv->path);
+      priv->path = g_value_dup_string (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_resume_store_constructed (GObject *object)
+{
+  MexResumeStore *store = MEX_RESUME_STORE (object);
+  MexResumeStorePrivate *priv = store->priv;
+
+  if (!priv->path)
+    {
+      gchar *directory;
+
+      directory = g_build_filename (g_get_user_data_dir (), "mex", NULL);
+      g_mkdir_with_parents (directory, 0775);
+      priv->path = g_build_filename (directory, "resume-positions", NULL);
+      g_free (directory);
+    }
+
+  mex_resume_store_load (store);
+
+  if (G_OBJECT_CLASS (mex_resume_store_parent_class)->constructed)
+    G_OBJECT_CLASS (mex_resume_store_parent_class)->constructed (object);
+}
+
+static void
+mex_resume_store_finalize (GObject *object)
+{
+  MexResumeStore *store = MEX_RESUME_STORE (object);
+  MexResumeStorePrivate *priv = store->priv;
+
+  /* write what is left and wait for it */
+  mex_resume_store_write (store);
+  g_thread_pool_free (priv->io_pool, FALSE, TRUE);
+
+  g_hash_table_unref (priv->entries);
+  g_string_free (priv->pending, TRUE);
+  g_free (priv->path);
+
+  G_OBJECT_CLASS (mex_resume_store_parent_class)->finalize (object);
+}
+
+static void
+mex_resume_store_class_init (MexResumeStoreClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GParamSpec *pspec;
+
+  g_type_class_add_private (klass, sizeof (MexResumeStorePrivate));
+
+  object_class->get_property = mex_resume_store_get_property;
+  object_class->set_property = mex_resume_store_set_property;
+  object_class->constructed = mex_resume_store_constructed;
+  object_class->finalize = mex_resume_store_finalize;
+
+  pspec = g_param_spec_string ("path",
+                               "Path",
+                               "File the positions are saved to",
+                               NULL,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                               G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_PATH, pspec);
+}
+
+static void
+_entry_free (ResumeEntry *entry)
+{
+  g_slice_free (ResumeEntry, entry);
+}
+
+static void
+mex_resume_store_init (MexResumeStore *self)
+{
+  MexResumeStorePrivate *priv;
+
+  self->priv = priv = RESUME_STORE_PRIVATE (self);
+
+  priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         (GDestroyNotify) _entry_free);
+  priv->pending = g_string_new (NULL);
+
+  /* one thread so that the writes happen in order */
+  priv->io_pool = g_thread_pool_new ((GFunc) _io_thread_func, NULL,
+                                     1, FALSE, NULL);
+}
+
+static void
+mex_resume_store_load (MexResumeStore *store)
+{
+  MexResumeStorePrivate *priv = store->priv;
+  gchar *data = NULL;
+  gsize length;
+  gint n_records;
+
+  if (!g_file_get_contents (priv->path, &data, &length, NULL))
+    return;
+
+  n_records = _replay (priv->entries, data, length);
+  g_free (data);
+
+  if (n_records >= 0)
+    {
+      priv->n_records = n_records;
+      return;
+    }
+
+  /* the last write was interrupted, start again from what we have so that
+   * the next records don't end up on the truncated line */
+  data = _entries_to_data (priv->entries);
+  if (!g_file_set_contents (priv->path, data, -1, NULL))
+    g_warning (G_STRLOC ": Unable to repair %s", priv->path);
+  g_free (data);
+
+  priv->n_records = g_hash_table_size (priv->entries);
+}
+
+/*
+ * Public API
+ */
+
+MexResumeStore *
+mex_resume_store_get_default (void)
+{
+  static MexResumeStore *singleton = NULL;
+
+  if (G_LIKELY (singleton))
+    return singleton;
+
+  singleton = g_object_new (MEX_TYPE_RESUME_STORE, NULL);
+  return singleton;
+}
+
+/**
+ * mex_resume_store_new:
+ * @path: the file to keep the positions in
+ *
+ * Creates a store keeping its positions in @path, or in the user data
+ * directory if @path is %NULL. Most users want mex_resume_store_get_default().
+ *
+ * Return value: a new #MexResumeStore
+ */
+MexResumeStore *
+mex_resume_store_new (const gchar *path)
+{
+  return g_object_new (MEX_TYPE_RESUME_STORE, "path", path, NULL);
+}
+
+/**
+ * mex_resume_store_set_position:
+ * @store: a #MexResumeStore
+ * @uri: the uri of the stream
+ * @position: the position in the stream, in seconds
+ * @duration: the duration of the stream, in seconds
+ *
+ * Remembers @position for @uri. The positions are written to disk in
+ * batches, a few seconds later or when calling mex_resume_store_flush().
+ * A @position of 0 forgets the position of @uri.
+ */
+void
+mex_resume_store_set_position (MexResumeStore *store,
+                               const gchar    *uri,
+                               guint           position,
+                               guint           duration)
+{
+  MexResumeStorePrivate *priv;
+  ResumeEntry *entry;
+
+  g_return_if_fail (MEX_IS_RESUME_STORE (store));
+  g_return_if_fail (uri != NULL);
+
+  priv = store->priv;
+
+  /* uris are escaped, but let's not corrupt the log if one isn't */
+  if (strchr (uri, '\n'))
+    return;
+
+  entry = g_hash_table_lookup (priv->entries, uri);
+
+  if (position == 0)
+    {
+      if (!entry)
+        return;
+
+      g_hash_table_remove (priv->entries, uri);
+    }
+  else
+    {
+      if (entry && entry->position == position && entry->duration == duration)
+        return;
+
+      if (!entry)
+        {
+          entry = g_slice_new (ResumeEntry);
+          g_hash_table_insert (priv->entries, g_strdup (uri), entry);
+        }
+
+      entry->position = position;
+      entry->duration = duration;
+    }
+
+  _append_record (priv->pending, uri, position, duration);
+  priv->n_records++;
+
+  if (!priv->flush_id)
+    priv->flush_id =
+      g_timeout_add_seconds (RESUME_FLUSH_TIMEOUT,
+                             (GSourceFunc) mex_resume_store_flush_cb,
+                             store);
+}
+
+/**
+ * mex_resume_store_get_position:
+ * @store: a #MexResumeStore
+ * @uri: the uri of the stream
+ * @duration: (out) (allow-none): return location for the duration of the
+ *   stream, in seconds
+ *
+ * Return value: the position saved for @uri, in seconds, or 0
+ */
+guint
+mex_resume_store_get_position (MexResumeStore *store,
+                               const gchar    *uri,
+                               guint          *duration)
+{
+  ResumeEntry *entry;
+
+  g_return_val_if_fail (MEX_IS_RESUME_STORE (store), 0);
+  g_return_val_if_fail (uri != NULL, 0);
+
+  entry = g_hash_table_lookup (store->priv->entries, uri);
+
+  if (duration)
+    *duration = entry ? entry->duration : 0;
+
+  return entry ? entry->position : 0;
+}
+
+/**
+ * mex_resume_store_remove:
+ * @store: a #MexResumeStore
+ * @uri: the uri of the stream
+ *
+ * Forgets the position of @uri, for instance once it has been watched until
+ * the end.
+ */
+void
+mex_resume_store_remove (MexResumeStore *store,
+                         const gchar    *uri)
+{
+  mex_resume_store_set_position (store, uri, 0, 0);
+}
+
+/**
+ * mex_resume_store_flush:
+ * @store: a #MexResumeStore
+ *
+ * Writes the pending positions and waits for them to be on disk.
+ */
+void
+mex_resume_store_flush (MexResumeStore *store)
+{
+  MexResumeStorePrivate *priv;
+
+  g_return_if_fail (MEX_IS_RESUME_STORE (store));
+
+  priv = store->priv;
+
+  mex_resume_store_write (store);
+
+  /* there is no way to wait on a pool, replace it */
+  g_thread_pool_free (priv->io_pool, FALSE, TRUE);
+  priv->io_pool = g_thread_pool_new ((GFunc) _io_thread_func, NULL,
+                                     1, FALSE, NULL);
+}
+
+#if defined (ENABLE_TESTS)
+
+#include "mex-test-internal.h"
+
+void
+mex_test_resume_store_kill (void)
+{
+  MexResumeStore *store, *restarted;
+  gchar *directory, *path;
+  guint duration;
+  FILE *file;
+
+  directory = g_dir_make_tmp ("mex-resume-XXXXXX", NULL);
+  g_assert (directory);
+  path = g_build_filename (directory, "resume-positions", NULL);
+
+  store = mex_resume_store_new (path);
+
+  /* checkpoints of a film and a song, the song finishes */
+  mex_resume_store_set_position (store, "file:///film.mkv", 600, 7200);
+  mex_resume_store_set_position (store, "file:///song.ogg", 30, 200);
+  mex_resume_store_flush (store);
+
+  mex_resume_store_set_position (store, "file:///film.mkv", 1800, 7200);
+  mex_resume_store_remove (store, "file:///song.ogg");
+  mex_resume_store_flush (store);
+
+  /* the last checkpoint is still pending when the player is killed, in the
+   * middle of writing it */
+  mex_resume_store_set_position (store, "file:///film.mkv", 1815, 7200);
+  file = g_fopen (path, "a");
+  fputs ("1815 7200 file:///fi", file);
+  fclose (file);
+
+  restarted = mex_resume_store_new (path);
+  g_assert_cmpuint (mex_resume_store_get_position (restarted,
+                                                   "file:///film.mkv",
+                                                   &duration), ==, 1800);
+  g_assert_cmpuint (duration, ==, 7200);
+  g_assert_cmpuint (mex_resume_store_get_position (restarted,
+                                                   "file:///song.ogg",
+                                                   NULL), ==, 0);
+
+  /* the truncated record doesn't get in the way of the next ones */
+  mex_resume_store_set_position (restarted, "file:///other.avi", 42, 1000);
+  g_object_unref (restarted);
+
+  restarted = mex_resume_store_new (path);
+  g_assert_cmpuint (mex_resume_store_get_position (restarted,
+                                                   "file:///other.avi",
+                                                   NULL), ==, 42);
+  g_assert_cmpuint (mex_resume_store_get_position (restarted,
+                                                   "file:///film.mkv",
+                                                   NULL), ==, 1800);
+  g_object_unref (restarted);
+
+  /* don't let the first store overwrite anything when it goes away */
+  g_string_truncate (store->priv->pending, 0);
+  g_object_unref (store);
+
+  g_unlink (path);
+  g_rmdir (directory);
+  g_free (path);
+  g_free (directory);
+}
+
+#endif /* ENABLE_TESTS */
@@ -0,0 +1,78 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+
+#ifndef __MEX_RESUME_STORE_H__
+#define __MEX_RESUME_STORE_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_RESUME_STORE mex_resume_store_get_type()
+
+#define MEX_RESUME_STORE(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MEX_TYPE_RESUME_STORE, MexResumeStore))
+
+#define MEX_RESUME_STORE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), MEX_TYPE_RESUME_STORE, MexResumeStoreClass))
+
+#define MEX_IS_RESUME_STORE(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MEX_TYPE_RESUME_STORE))
+
+#define MEX_IS_RESUME_STORE_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), MEX_TYPE_RESUME_STORE))
+
+#define MEX_RESUME_STORE_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), MEX_TYPE_RESUME_STORE, MexResumeStoreClass))
+
+typedef struct _MexResumeStore MexResumeStore;
+typedef struct _MexResumeStoreClass MexResumeStoreClass;
+typedef struct _MexResumeStorePrivate MexResumeStorePrivate;
+
+struct _MexResumeStore
+{
+  GObject parent;
+
+  MexResumeStorePrivate *priv;
+};
+
+struct _MexResumeStoreClass
+{
+  GObjectClass parent_class;
+};
+
+GType            mex_resume_store_get_type     (void) G_GNUC_CONST;
+
+MexResumeStore * mex_resume_store_get_default  (void);
+MexResumeStore * mex_resume_store_new          (const gchar    *path);
+
+void             mex_resume_store_set_position (MexResumeStore *store,
+                                                const gchar    *uri,
+                                                guint           position,
+                                                guint           duration);
+guint            mex_resume_store_get_position (MexResumeStore *store,
+                                                const gchar    *uri,
+                                                guint          *duration);
+void             mex_resume_store_remove       (MexResumeStore *store,
+                                                const gchar    *uri);
+void             mex_resume_store_flush        (MexResumeStore *store);
+
+G_END_DECLS
+
+#endif /* __MEX_RESUME_STORE_H__ */
@@ -1088,6 +1088,9 @@ mex_slide_show_set_model (MexContentView *view,
       priv->proxy = mex_content_proxy_new (NULL,
                                            container,
                                            MEX_TYPE_CONTENT_TILE);
+      /* the photo strip is part of the focused view */
+      mex_proxy_set_priority (priv->proxy, MEX_PROXY_PRIORITY_FOCUSED);
+
       /* set the model after the object-created signal handler is connected to
        * ensure it is called for all items */
       g_signal_connect (priv->proxy, "object-created",
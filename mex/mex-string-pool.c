@@ -0,0 +1,153 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "mex-string-pool.h"
+
+/*
+ * The same media is usually shown by several feeds (the library, the
+ * search results, the queue...), each with its own MexContent. Their ids,
+ * mime types and URLs are the same strings over and over, so they are kept
+ * once here. Unlike quarks the strings are reference counted and go away
+ * with their last user.
+ *
+ * The reference count is stored just before the characters: releasing a
+ * string does not need to look it up.
+ */
+
+typedef struct
+{
+  guint ref_count;
+  guint length;
+  gchar string[1];
+} PoolEntry;
+
+#define POOL_ENTRY(s) \
+  ((PoolEntry *) ((s) - G_STRUCT_OFFSET (PoolEntry, string)))
+
+G_LOCK_DEFINE_STATIC (pool);
+static GHashTable *pool = NULL;
+static MexStringPoolStats pool_stats = { 0, };
+
+/**
+ * mex_string_pool_intern:
+ * @string: (allow-none): a string
+ *
+ * Returns the copy of @string kept in the pool, adding it if needed. The
+ * copy is the same for every caller and stays valid until each of them
+ * gave it back with mex_string_pool_release().
+ *
+ * Returns: (transfer full): the pooled copy of @string, or %NULL
+ */
+const gchar *
+mex_string_pool_intern (const gchar *string)
+{
+  PoolEntry *entry;
+
+  if (string == NULL)
+    return NULL;
+
+  G_LOCK (pool);
+
+  if (G_UNLIKELY (pool == NULL))
+    pool = g_hash_table_new (g_str_hash, g_str_equal);
+
+  entry = g_hash_table_lookup (pool, string);
+  if (entry)
+    {
+      entry->ref_count++;
+      pool_stats.n_bytes_saved += entry->length + 1;
+    }
+  else
+    {
+      gsize length = strlen (string);
+
+      entry = g_malloc (G_STRUCT_OFFSET (PoolEntry, string) + length + 1);
+      entry->ref_count = 1;
+      entry->length = length;
+      memcpy (entry->string, string, length + 1);
+
+      g_hash_table_insert (pool, entry->string, entry);
+
+      pool_stats.n_strings++;
+      pool_stats.n_bytes += length + 1;
+    }
+  pool_stats.n_references++;
+
+  G_UNLOCK (pool);
+
+  return entry->string;
+}
+
+/**
+ * mex_string_pool_release:
+ * @string: (allow-none): a string returned by mex_string_pool_intern()
+ *
+ * Gives back a reference on a pooled string.
+ */
+void
+mex_string_pool_release (const gchar *string)
+{
+  PoolEntry *entry;
+
+  if (string == NULL)
+    return;
+
+  entry = POOL_ENTRY (string);
+
+  G_LOCK (pool);
+
+  pool_stats.n_references--;
+
+  if (--entry->ref_count)
+    {
+      pool_stats.n_bytes_saved -= entry->length + 1;
+      G_UNLOCK (pool);
+      return;
+    }
+
+  g_hash_table_remove (pool, entry->string);
+  pool_stats.n_strings--;
+  pool_stats.n_bytes -= entry->length + 1;
+
+  G_UNLOCK (pool);
+
+  g_free (entry);
+}
+
+/**
+ * mex_string_pool_get_stats:
+ * @stats: (out): where to store the counters
+ *
+ * Tells how many strings the pool holds and how much memory sharing them
+ * saves.
+ */
+void
+mex_string_pool_get_stats (MexStringPoolStats *stats)
+{
+  g_return_if_fail (stats != NULL);
+
+  G_LOCK (pool);
+  *stats = pool_stats;
+  G_UNLOCK (pool);
+}
@@ -0,0 +1,50 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __MEX_STRING_POOL_H__
+#define __MEX_STRING_POOL_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * MexStringPoolStats:
+ * @n_strings: the different strings in the pool
+ * @n_references: the references held on them
+ * @n_bytes: the bytes taken by the strings
+ * @n_bytes_saved: the bytes a copy per reference would have taken on top
+ *
+ * What the string pool holds.
+ */
+typedef struct
+{
+  guint n_strings;
+  guint n_references;
+  gsize n_bytes;
+  gsize n_bytes_saved;
+} MexStringPoolStats;
+
+const gchar * mex_string_pool_intern    (const gchar        *string);
+void          mex_string_pool_release   (const gchar        *string);
+
+void          mex_string_pool_get_stats (MexStringPoolStats *stats);
+
+G_END_DECLS
+
+#endif /* __MEX_STRING_POOL_H__ */
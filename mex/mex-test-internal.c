@@ -16,6 +16,12 @@
  * along with this program; if not, see <http://www.gnu.org/licenses>
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <glib/gstdio.h>
 
 #include "mex.h"
 #include "mex-test-internal.h"
@@ -24,12 +30,70 @@ int
 main (int   argc,
       char *argv[])
 {
+    gchar *data_dirs, *tmp_dir, *data_link;
+    gint result;
+
+    /* the actors under test load their json files from the source tree */
+    tmp_dir = g_dir_make_tmp ("mex-test-internal-XXXXXX", NULL);
+    g_assert (tmp_dir);
+    data_link = g_build_filename (tmp_dir, PACKAGE_NAME, NULL);
+    g_assert_cmpint (symlink (MEX_TEST_DATA_DIR, data_link), ==, 0);
+    data_dirs = g_getenv ("XDG_DATA_DIRS") ?
+      g_strconcat (tmp_dir, G_SEARCHPATH_SEPARATOR_S,
+                   g_getenv ("XDG_DATA_DIRS"), NULL) :
+      g_strconcat (tmp_dir, ":/usr/local/share/:/usr/share/", NULL);
+    g_setenv ("XDG_DATA_DIRS", data_dirs, TRUE);
+    g_free (data_dirs);
+
     g_type_init ();
     g_test_init (&argc, &argv, NULL);
     mex_init (&argc, &argv);
 
     g_test_add_func ("/internal/metadata/humanise_date",
                      mex_test_metadata_humanise_date);
+    g_test_add_func ("/internal/metadata/from_uri",
+                     mex_test_metadata_from_uri);
+    g_test_add_func ("/internal/metadata/from_uris_perf",
+                     mex_test_metadata_from_uris_perf);
+    g_test_add_func ("/internal/column/populate",
+                     mex_test_column_populate);
+    g_test_add_func ("/internal/channel-manager/logos",
+                     mex_test_channel_manager_logos);
+    g_test_add_func ("/internal/epg-manager/merge",
+                     mex_test_epg_manager_merge);
+    g_test_add_func ("/internal/frame-profiler/percentiles",
+                     mex_test_frame_profiler);
+    g_test_add_func ("/internal/grilo-feed/paged",
+                     mex_test_grilo_feed_paged);
+    g_test_add_func ("/internal/grilo-feed/snapshot",
+                     mex_test_grilo_feed_snapshot);
+    g_test_add_func ("/internal/grilo-feed/content-updated",
+                     mex_test_grilo_feed_content_updated);
+    g_test_add_func ("/internal/grilo-feed/shared-strings",
+                     mex_test_grilo_feed_shared_strings);
+    g_test_add_func ("/internal/key-coalescer/burst",
+                     mex_test_key_coalescer);
+    g_test_add_func ("/internal/media-controls/window",
+                     mex_test_media_controls_window);
+    g_test_add_func ("/internal/metadata-queue/coalesce",
+                     mex_test_metadata_queue_coalesce);
+    g_test_add_func ("/internal/metadata-queue/flush",
+                     mex_test_metadata_queue_flush);
+    g_test_add_func ("/internal/music-player/shuffle",
+                     mex_test_music_player_shuffle);
+    g_test_add_func ("/internal/proxy/scheduler",
+                     mex_test_proxy_scheduler);
+    g_test_add_func ("/internal/queue-model/journal",
+                     mex_test_queue_model_journal);
+    g_test_add_func ("/internal/resume-store/kill",
+                     mex_test_resume_store_kill);
+
+    result = g_test_run ();
+
+    g_unlink (data_link);
+    g_rmdir (tmp_dir);
+    g_free (data_link);
+    g_free (tmp_dir);
 
-    return g_test_run ();
+    return result;
 }
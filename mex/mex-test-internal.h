@@ -24,6 +24,48 @@ G_BEGIN_DECLS
 
 /* mex-metadata-utils.c */
 void mex_test_metadata_humanise_date (void);
+void mex_test_metadata_from_uri (void);
+void mex_test_metadata_from_uris_perf (void);
+
+/* mex-column.c */
+void mex_test_column_populate (void);
+
+/* mex-frame-profiler.c */
+void mex_test_frame_profiler (void);
+
+/* mex-key-coalescer.c */
+void mex_test_key_coalescer (void);
+
+/* mex-grilo-feed.c */
+void mex_test_grilo_feed_paged (void);
+void mex_test_grilo_feed_snapshot (void);
+void mex_test_grilo_feed_content_updated (void);
+void mex_test_grilo_feed_shared_strings (void);
+
+/* mex-proxy.c */
+void mex_test_proxy_scheduler (void);
+
+/* mex-channel-manager.c */
+void mex_test_channel_manager_logos (void);
+
+/* mex-epg-manager.c */
+void mex_test_epg_manager_merge (void);
+
+/* mex-media-controls.c */
+void mex_test_media_controls_window (void);
+
+/* mex-metadata-queue.c */
+void mex_test_metadata_queue_coalesce (void);
+void mex_test_metadata_queue_flush (void);
+
+/* mex-music-player.c */
+void mex_test_music_player_shuffle (void);
+
+/* mex-queue-model.c */
+void mex_test_queue_model_journal (void);
+
+/* mex-resume-store.c */
+void mex_test_resume_store_kill (void);
 
 G_END_DECLS
 
@@ -339,6 +339,18 @@ mex_view_model_get_model (MexModel *model)
   return priv->model;
 }
 
+/* the view shows contents of the model */
+static void
+mex_view_model_set_visible_contents (MexModel   *model,
+                                     MexContent *first,
+                                     MexContent *last)
+{
+  MexViewModelPrivate *priv = VIEW_MODEL_PRIVATE (model);
+
+  if (priv->model)
+    mex_model_set_visible_contents (priv->model, first, last);
+}
+
 static MexContent *
 mex_view_model_get_content (MexModel *model, guint idx)
 {
@@ -465,6 +477,7 @@ mex_model_iface_init (MexModelIface *iface)
   iface->get_controller = mex_view_model_get_controller;
   iface->get_length = mex_view_model_get_length;
   iface->index = mex_view_model_index;
+  iface->set_visible_contents = mex_view_model_set_visible_contents;
 
   /* TODO: this should not be part of the MexModel interface */
   iface->get_model = mex_view_model_get_model;
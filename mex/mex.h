@@ -48,6 +48,7 @@
 #include <mex/mex-epg-manager.h>
 #include <mex/mex-epg-provider.h>
 #include <mex/mex-epg-radiotimes.h>
+#include <mex/mex-frame-profiler.h>
 #include <mex/mex-generic-model.h>
 #include <mex/mex-generic-proxy.h>
 #include <mex/mex-grid.h>
@@ -58,12 +59,14 @@
 #include <mex/mex-group-item.h>
 #include <mex/mex-info-bar.h>
 #include <mex/mex-info-panel.h>
+#include <mex/mex-key-coalescer.h>
 #include <mex/mex-lirc.h>
 #include <mex/mex-log.h>
 #include <mex/mex-logo-provider.h>
 #include <mex/mex-main.h>
 #include <mex/mex-media-controls.h>
 #include <mex/mex-menu.h>
+#include <mex/mex-metadata-queue.h>
 #include <mex/mex-mmkeys.h>
 #include <mex/mex-model.h>
 #include <mex/mex-model-manager.h>
@@ -78,12 +81,14 @@
 #include <mex/mex-proxy.h>
 #include <mex/mex-resizing-hbox.h>
 #include <mex/mex-resizing-hbox-child.h>
+#include <mex/mex-resume-store.h>
 #include <mex/mex-scroll-indicator.h>
 #include <mex/mex-scroll-view.h>
 #include <mex/mex-scrollable-container.h>
 #include <mex/mex-settings.h>
 #include <mex/mex-shadow.h>
 #include <mex/mex-slide-show.h>
+#include <mex/mex-string-pool.h>
 #include <mex/mex-tile.h>
 #include <mex/mex-tool-provider.h>
 #include <mex/mex-queue-button.h>
@@ -21,6 +21,7 @@
 #endif
 
 #include "mex-applications-plugin.h"
+#include "mex-applications-scanner.h"
 
 #include <mex/mex-plugin.h>
 #include <mex/mex-model-provider.h>
@@ -30,7 +31,6 @@
 #include <mex/mex-application.h>
 
 #include <glib/gi18n-lib.h>
-#include <gio/gdesktopappinfo.h>
 #include <gmodule.h>
 
 static void model_provider_iface_init (MexModelProviderInterface *iface);
@@ -51,6 +51,7 @@ struct _MexApplicationsPluginPrivate {
   GList *actions;
 
   MexModel *applications_model;
+  MexApplicationsScanner *scanner;
 };
 
 static void
@@ -59,6 +60,12 @@ mex_applications_plugin_dispose (GObject *object)
   MexApplicationsPlugin *self = MEX_APPLICATIONS_PLUGIN (object);
   MexApplicationsPluginPrivate *priv = self->priv;
 
+  if (priv->scanner)
+    {
+      g_object_unref (priv->scanner);
+      priv->scanner = NULL;
+    }
+
   while (priv->models)
     {
       g_object_unref (priv->models->data);
@@ -117,56 +124,17 @@ _applications_plugin_launch_action_cb (MxAction *action,
     }
 }
 
-static MexApplication *
-_application_new_from_desktop_file (const gchar *desktop_file_id)
+static gint
+_sort_by_name (MexContent *a,
+               MexContent *b,
+               gpointer    user_data)
 {
-  GDesktopAppInfo *dai;
-  GAppInfo        *ai;
+  const gchar *name_a, *name_b;
 
-  dai = g_desktop_app_info_new (desktop_file_id);
-  ai = G_APP_INFO (dai);
-
-  if (dai)
-    {
-      MexApplication *application;
-
-      application = g_object_new (MEX_TYPE_APPLICATION,
-                                  "name", g_app_info_get_name (ai),
-                                  "desktop-file",
-                                        g_desktop_app_info_get_filename (dai),
-                                  "executable",
-                                        g_app_info_get_commandline (ai),
-                                  "description",
-                                        g_app_info_get_description (ai),
-                                  "icon", NULL,
-                                  NULL);
-
-      return application;
-    }
+  name_a = mex_application_get_name (MEX_APPLICATION (a));
+  name_b = mex_application_get_name (MEX_APPLICATION (b));
 
-  return NULL;
-}
-
-static void
-_populate_model (MexApplicationsPlugin *self)
-{
-  MexApplicationsPluginPrivate *priv = self->priv;
-  MexApplication *application;
-
-  application = _application_new_from_desktop_file ("mex-networks.desktop");
-  if (application)
-    mex_model_add_content (priv->applications_model,
-                           MEX_CONTENT (application));
-
-  application = _application_new_from_desktop_file ("mex-browser.desktop");
-  if (application)
-    mex_model_add_content (priv->applications_model,
-                           MEX_CONTENT (application));
-
-  application = _application_new_from_desktop_file ("gnome-terminal.desktop");
-  if (application)
-    mex_model_add_content (priv->applications_model,
-                           MEX_CONTENT (application));
+  return g_utf8_collate (name_a ? name_a : "", name_b ? name_b : "");
 }
 
 static void
@@ -180,8 +148,11 @@ mex_applications_plugin_init (MexApplicationsPlugin *self)
   priv->applications_model = mex_generic_model_new (_("Applications"),
                                                     "icon-applications");
   g_object_set (priv->applications_model, "category", "applications", NULL);
+  mex_model_set_sort_func (priv->applications_model, _sort_by_name, NULL);
 
-  _populate_model (self);
+  /* the applications show up as they are found */
+  priv->scanner = mex_applications_scanner_new (priv->applications_model);
+  mex_applications_scanner_start (priv->scanner);
 
   action_info = g_new0 (MexActionInfo, 1);
   action_info->action = mx_action_new_full ("launch",
@@ -233,7 +204,7 @@ mex_applications_get_type (void)
 }
 
 MEX_DEFINE_PLUGIN ("applications",
-		   "A column with a few apps",
+		   "A column with the installed applications",
 		   PACKAGE_VERSION,
 		   "LGPLv2.1+",
 		   "Robert Bradford <rob@linux.intel.com>",
@@ -0,0 +1,866 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mex-applications-scanner.h"
+
+#include <string.h>
+
+#include <gio/gio.h>
+#include <gio/gdesktopappinfo.h>
+
+/*
+ * The scanner fills a model with the applications installed in the XDG
+ * application directories.
+ *
+ * Directories are read in a thread. What was found is cached with the
+ * modification time of each directory, so on the next start only the
+ * directories that changed are read again: installing or removing a
+ * desktop file (package managers rename their files in place) changes the
+ * time of its directory. File monitors catch the changes made while we
+ * run, including edits of existing files, and rescan the directories they
+ * happened in.
+ *
+ * Desktop files in subdirectories (the legacy "vendor-" prefixed ids) are
+ * not looked at.
+ */
+
+#define CACHE_VERSION   1
+#define RESCAN_TIMEOUT  1 /* seconds */
+
+G_DEFINE_TYPE (MexApplicationsScanner, mex_applications_scanner,
+               G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_APPLICATIONS_SCANNER, \
+                                MexApplicationsScannerPrivate))
+
+enum
+{
+  PROP_0,
+
+  PROP_MODEL
+};
+
+typedef struct
+{
+  gchar    *id;
+  gchar    *filename;
+  gchar    *name;
+  gchar    *executable;
+  gchar    *description;
+  gchar    *icon;
+  gboolean  hidden;
+} AppEntry;
+
+typedef struct
+{
+  volatile gint  ref_count;
+  guint64        mtime;
+  GPtrArray     *entries;
+} DirEntry;
+
+typedef struct
+{
+  gchar      **directories;
+  gchar       *cache_file;
+  GHashTable  *previous;
+  GHashTable  *dirty;
+  GHashTable  *result;
+} ScanJob;
+
+typedef struct
+{
+  MexApplication *application;
+  AppEntry       *entry;
+} Tracked;
+
+struct _MexApplicationsScannerPrivate
+{
+  MexModel     *model;
+
+  gchar       **directories;
+  gchar        *cache_file;
+  GHashTable   *dir_entries;
+  GHashTable   *applications;
+
+  GList        *monitors;
+  GHashTable   *dirty;
+  guint         rescan_id;
+  guint         scanning : 1;
+  guint         rescan_pending : 1;
+  GCancellable *cancellable;
+};
+
+static void mex_applications_scanner_scan (MexApplicationsScanner *scanner);
+
+/*
+ * Entries
+ */
+
+static void
+app_entry_free (AppEntry *entry)
+{
+  g_free (entry->id);
+  g_free (entry->filename);
+  g_free (entry->name);
+  g_free (entry->executable);
+  g_free (entry->description);
+  g_free (entry->icon);
+  g_slice_free (AppEntry, entry);
+}
+
+static gboolean
+app_entry_equal (AppEntry *a,
+                 AppEntry *b)
+{
+  return a->hidden == b->hidden &&
+         g_strcmp0 (a->filename, b->filename) == 0 &&
+         g_strcmp0 (a->name, b->name) == 0 &&
+         g_strcmp0 (a->executable, b->executable) == 0 &&
+         g_strcmp0 (a->description, b->description) == 0 &&
+         g_strcmp0 (a->icon, b->icon) == 0;
+}
+
+static DirEntry *
+dir_entry_new (guint64 mtime)
+{
+  DirEntry *dir = g_slice_new (DirEntry);
+
+  dir->ref_count = 1;
+  dir->mtime = mtime;
+  dir->entries = g_ptr_array_new_with_free_func ((GDestroyNotify)
+                                                 app_entry_free);
+
+  return dir;
+}
+
+static DirEntry *
+dir_entry_ref (DirEntry *dir)
+{
+  g_atomic_int_inc (&dir->ref_count);
+
+  return dir;
+}
+
+static void
+dir_entry_unref (DirEntry *dir)
+{
+  if (!g_atomic_int_dec_and_test (&dir->ref_count))
+    return;
+
+  g_ptr_array_free (dir->entries, TRUE);
+  g_slice_free (DirEntry, dir);
+}
+
+static GHashTable *
+dir_table_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                (GDestroyNotify) dir_entry_unref);
+}
+
+/*
+ * Scanning, in a thread
+ */
+
+static guint64
+_get_mtime (const gchar *path)
+{
+  GFileInfo *info;
+  GFile *file;
+  guint64 mtime = 0;
+
+  file = g_file_new_for_path (path);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info)
+    {
+      mtime = g_file_info_get_attribute_uint64 (info,
+                                                G_FILE_ATTRIBUTE_TIME_MODIFIED)
+        * G_USEC_PER_SEC +
+        g_file_info_get_attribute_uint32 (info,
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+      g_object_unref (info);
+    }
+  g_object_unref (file);
+
+  return mtime;
+}
+
+static DirEntry *
+_scan_directory (const gchar *path,
+                 guint64      mtime)
+{
+  const gchar *name;
+  DirEntry *dir;
+  GDir *gdir;
+
+  dir = dir_entry_new (mtime);
+
+  gdir = g_dir_open (path, 0, NULL);
+  if (!gdir)
+    return dir;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      GDesktopAppInfo *info;
+      AppEntry *entry;
+      GIcon *icon;
+      gchar *filename;
+
+      if (!g_str_has_suffix (name, ".desktop"))
+        continue;
+
+      filename = g_build_filename (path, name, NULL);
+      info = g_desktop_app_info_new_from_filename (filename);
+      if (!info)
+        {
+          g_free (filename);
+          continue;
+        }
+
+      entry = g_slice_new0 (AppEntry);
+      entry->id = g_strdup (name);
+      entry->filename = filename;
+
+      /* a hidden entry still masks the ones of the same id that come
+       * later in the search path */
+      entry->hidden = g_desktop_app_info_get_is_hidden (info) ||
+                      !g_app_info_should_show (G_APP_INFO (info));
+      if (!entry->hidden)
+        {
+          entry->name = g_strdup (g_app_info_get_name (G_APP_INFO (info)));
+          entry->executable =
+            g_strdup (g_app_info_get_commandline (G_APP_INFO (info)));
+          entry->description =
+            g_strdup (g_app_info_get_description (G_APP_INFO (info)));
+
+          icon = g_app_info_get_icon (G_APP_INFO (info));
+          if (icon)
+            entry->icon = g_icon_to_string (icon);
+        }
+
+      g_ptr_array_add (dir->entries, entry);
+      g_object_unref (info);
+    }
+
+  g_dir_close (gdir);
+
+  return dir;
+}
+
+static GHashTable *
+_cache_load (const gchar *cache_file)
+{
+  GHashTable *table;
+  GKeyFile *key_file;
+  gchar **directories;
+  gint i, j;
+
+  table = dir_table_new ();
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, cache_file, G_KEY_FILE_NONE,
+                                  NULL) ||
+      g_key_file_get_integer (key_file, "Cache", "Version",
+                              NULL) != CACHE_VERSION)
+    {
+      g_key_file_free (key_file);
+      return table;
+    }
+
+  directories = g_key_file_get_string_list (key_file, "Cache", "Directories",
+                                            NULL, NULL);
+  for (i = 0; directories && directories[i]; i++)
+    {
+      gchar **ids;
+      DirEntry *dir;
+
+      if (!g_key_file_has_group (key_file, directories[i]))
+        continue;
+
+      dir = dir_entry_new (g_key_file_get_uint64 (key_file, directories[i],
+                                                  "Modified", NULL));
+
+      ids = g_key_file_get_string_list (key_file, directories[i],
+                                        "Applications", NULL, NULL);
+      for (j = 0; ids && ids[j]; j++)
+        {
+          AppEntry *entry;
+          gchar *group;
+
+          group = g_build_filename (directories[i], ids[j], NULL);
+
+          entry = g_slice_new0 (AppEntry);
+          entry->id = g_strdup (ids[j]);
+          entry->filename = g_strdup (group);
+          entry->hidden = g_key_file_get_boolean (key_file, group, "Hidden",
+                                                  NULL);
+          entry->name = g_key_file_get_string (key_file, group, "Name",
+                                               NULL);
+          entry->executable = g_key_file_get_string (key_file, group, "Exec",
+                                                     NULL);
+          entry->description = g_key_file_get_string (key_file, group,
+                                                      "Comment", NULL);
+          entry->icon = g_key_file_get_string (key_file, group, "Icon",
+                                               NULL);
+          g_ptr_array_add (dir->entries, entry);
+
+          g_free (group);
+        }
+      g_strfreev (ids);
+
+      g_hash_table_insert (table, g_strdup (directories[i]), dir);
+    }
+
+  g_strfreev (directories);
+  g_key_file_free (key_file);
+
+  return table;
+}
+
+static void
+_key_file_set_string (GKeyFile    *key_file,
+                      const gchar *group,
+                      const gchar *key,
+                      const gchar *value)
+{
+  if (value)
+    g_key_file_set_string (key_file, group, key, value);
+}
+
+static void
+_cache_save (const gchar  *cache_file,
+             gchar       **directories,
+             GHashTable   *table)
+{
+  GKeyFile *key_file;
+  GError *error = NULL;
+  gchar *data, *dirname;
+  gsize length;
+  guint i, j;
+
+  key_file = g_key_file_new ();
+
+  g_key_file_set_integer (key_file, "Cache", "Version", CACHE_VERSION);
+  g_key_file_set_string_list (key_file, "Cache", "Directories",
+                              (const gchar * const *) directories,
+                              g_strv_length (directories));
+
+  for (i = 0; directories[i]; i++)
+    {
+      DirEntry *dir = g_hash_table_lookup (table, directories[i]);
+      const gchar **ids;
+
+      g_key_file_set_uint64 (key_file, directories[i], "Modified",
+                             dir->mtime);
+
+      ids = g_new0 (const gchar *, dir->entries->len + 1);
+      for (j = 0; j < dir->entries->len; j++)
+        {
+          AppEntry *entry = g_ptr_array_index (dir->entries, j);
+
+          ids[j] = entry->id;
+
+          g_key_file_set_boolean (key_file, entry->filename, "Hidden",
+                                  entry->hidden);
+          _key_file_set_string (key_file, entry->filename, "Name",
+                                entry->name);
+          _key_file_set_string (key_file, entry->filename, "Exec",
+                                entry->executable);
+          _key_file_set_string (key_file, entry->filename, "Comment",
+                                entry->description);
+          _key_file_set_string (key_file, entry->filename, "Icon",
+                                entry->icon);
+        }
+      g_key_file_set_string_list (key_file, directories[i], "Applications",
+                                  ids, dir->entries->len);
+      g_free (ids);
+    }
+
+  data = g_key_file_to_data (key_file, &length, NULL);
+  g_key_file_free (key_file);
+
+  dirname = g_path_get_dirname (cache_file);
+  g_mkdir_with_parents (dirname, 0755);
+  g_free (dirname);
+
+  if (!g_file_set_contents (cache_file, data, length, &error))
+    {
+      g_warning (G_STRLOC ": Could not save the applications cache: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+
+  g_free (data);
+}
+
+static void
+scan_job_free (ScanJob *job)
+{
+  g_strfreev (job->directories);
+  g_free (job->cache_file);
+  if (job->previous)
+    g_hash_table_unref (job->previous);
+  if (job->dirty)
+    g_hash_table_unref (job->dirty);
+  if (job->result)
+    g_hash_table_unref (job->result);
+  g_slice_free (ScanJob, job);
+}
+
+static void
+scan_thread (GSimpleAsyncResult *res,
+             GObject            *object,
+             GCancellable       *cancellable)
+{
+  ScanJob *job = g_simple_async_result_get_op_res_gpointer (res);
+  gboolean changed = FALSE;
+  gint i;
+
+  if (!job->previous)
+    job->previous = _cache_load (job->cache_file);
+
+  job->result = dir_table_new ();
+
+  for (i = 0; job->directories[i]; i++)
+    {
+      const gchar *path = job->directories[i];
+      DirEntry *dir;
+      guint64 mtime;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        return;
+
+      mtime = _get_mtime (path);
+      dir = g_hash_table_lookup (job->previous, path);
+
+      if (dir && dir->mtime == mtime &&
+          !(job->dirty && g_hash_table_lookup (job->dirty, path)))
+        dir = dir_entry_ref (dir);
+      else
+        {
+          dir = _scan_directory (path, mtime);
+          changed = TRUE;
+        }
+
+      g_hash_table_insert (job->result, g_strdup (path), dir);
+    }
+
+  if (changed ||
+      g_hash_table_size (job->previous) != g_hash_table_size (job->result))
+    _cache_save (job->cache_file, job->directories, job->result);
+}
+
+/*
+ * Updating the model, in the main thread
+ */
+
+static MexApplication *
+_application_new (AppEntry *entry)
+{
+  return g_object_new (MEX_TYPE_APPLICATION,
+                       "name", entry->name,
+                       "desktop-file", entry->filename,
+                       "executable", entry->executable,
+                       "description", entry->description,
+                       "icon", entry->icon,
+                       NULL);
+}
+
+static void
+_application_update (MexApplication *application,
+                     AppEntry       *entry)
+{
+  mex_application_set_name (application, entry->name);
+  mex_application_set_desktop_file (application, entry->filename);
+  mex_application_set_executable (application, entry->executable);
+  mex_application_set_description (application, entry->description);
+  mex_application_set_icon (application, entry->icon);
+}
+
+static void
+_tracked_free (Tracked *tracked)
+{
+  g_object_unref (tracked->application);
+  g_slice_free (Tracked, tracked);
+}
+
+static void
+mex_applications_scanner_apply (MexApplicationsScanner *scanner,
+                                GHashTable             *result)
+{
+  MexApplicationsScannerPrivate *priv = scanner->priv;
+  GHashTable *visible;
+  GHashTableIter iter;
+  GList *added = NULL;
+  Tracked *tracked;
+  AppEntry *entry;
+  guint i, j;
+
+  /* the first entry of an id in the search path wins */
+  visible = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; priv->directories[i]; i++)
+    {
+      DirEntry *dir = g_hash_table_lookup (result, priv->directories[i]);
+
+      for (j = 0; dir && j < dir->entries->len; j++)
+        {
+          entry = g_ptr_array_index (dir->entries, j);
+          if (!g_hash_table_lookup (visible, entry->id))
+            g_hash_table_insert (visible, entry->id, entry);
+        }
+    }
+
+  /* applications that went away or changed */
+  g_hash_table_iter_init (&iter, priv->applications);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &tracked))
+    {
+      entry = g_hash_table_lookup (visible, tracked->entry->id);
+
+      if (!entry || entry->hidden)
+        {
+          mex_model_remove_content (priv->model,
+                                    MEX_CONTENT (tracked->application));
+          g_hash_table_iter_remove (&iter);
+          continue;
+        }
+
+      /* reused directories keep the same entries */
+      if (entry != tracked->entry && !app_entry_equal (entry, tracked->entry))
+        _application_update (tracked->application, entry);
+      tracked->entry = entry;
+    }
+
+  /* new applications, added in one go */
+  g_hash_table_iter_init (&iter, visible);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      if (entry->hidden || g_hash_table_lookup (priv->applications, entry->id))
+        continue;
+
+      tracked = g_slice_new (Tracked);
+      tracked->application = _application_new (entry);
+      tracked->entry = entry;
+      g_hash_table_insert (priv->applications, g_strdup (entry->id), tracked);
+
+      added = g_list_prepend (added, tracked->application);
+    }
+
+  if (added)
+    {
+      mex_model_add (priv->model, added);
+      g_list_free (added);
+    }
+
+  g_hash_table_unref (visible);
+
+  /* the tracked applications now point into the new table */
+  if (priv->dir_entries)
+    g_hash_table_unref (priv->dir_entries);
+  priv->dir_entries = g_hash_table_ref (result);
+}
+
+static void
+scan_cb (GObject      *source,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  MexApplicationsScanner *scanner = MEX_APPLICATIONS_SCANNER (source);
+  MexApplicationsScannerPrivate *priv = scanner->priv;
+  ScanJob *job;
+
+  job = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res));
+
+  priv->scanning = FALSE;
+
+  if (g_cancellable_is_cancelled (priv->cancellable))
+    return;
+
+  mex_applications_scanner_apply (scanner, job->result);
+
+  if (priv->rescan_pending)
+    {
+      priv->rescan_pending = FALSE;
+      mex_applications_scanner_scan (scanner);
+    }
+}
+
+static void
+mex_applications_scanner_scan (MexApplicationsScanner *scanner)
+{
+  MexApplicationsScannerPrivate *priv = scanner->priv;
+  GSimpleAsyncResult *res;
+  ScanJob *job;
+
+  if (priv->scanning)
+    {
+      priv->rescan_pending = TRUE;
+      return;
+    }
+
+  job = g_slice_new0 (ScanJob);
+  job->directories = g_strdupv (priv->directories);
+  job->cache_file = g_strdup (priv->cache_file);
+  if (priv->dir_entries)
+    job->previous = g_hash_table_ref (priv->dir_entries);
+  if (g_hash_table_size (priv->dirty))
+    {
+      job->dirty = priv->dirty;
+      priv->dirty = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, NULL);
+    }
+
+  res = g_simple_async_result_new (G_OBJECT (scanner), scan_cb, NULL,
+                                   mex_applications_scanner_scan);
+  g_simple_async_result_set_op_res_gpointer (res, job,
+                                             (GDestroyNotify) scan_job_free);
+  g_simple_async_result_run_in_thread (res, scan_thread, G_PRIORITY_LOW,
+                                       priv->cancellable);
+  g_object_unref (res);
+
+  priv->scanning = TRUE;
+}
+
+static gboolean
+rescan_timeout_cb (MexApplicationsScanner *scanner)
+{
+  scanner->priv->rescan_id = 0;
+  mex_applications_scanner_scan (scanner);
+
+  return FALSE;
+}
+
+static void
+monitor_changed_cb (GFileMonitor           *monitor,
+                    GFile                  *file,
+                    GFile                  *other_file,
+                    GFileMonitorEvent       event,
+                    MexApplicationsScanner *scanner)
+{
+  MexApplicationsScannerPrivate *priv = scanner->priv;
+  gchar *basename;
+  gboolean desktop_file;
+
+  /* wait for the writes to be done */
+  if (event == G_FILE_MONITOR_EVENT_CHANGED ||
+      event == G_FILE_MONITOR_EVENT_PRE_UNMOUNT)
+    return;
+
+  basename = g_file_get_basename (file);
+  desktop_file = g_str_has_suffix (basename, ".desktop");
+  g_free (basename);
+
+  if (!desktop_file)
+    return;
+
+  g_hash_table_insert (priv->dirty,
+                       g_strdup (g_object_get_data (G_OBJECT (monitor),
+                                                    "path")),
+                       GINT_TO_POINTER (TRUE));
+
+  /* several files are usually installed at once */
+  if (priv->rescan_id)
+    g_source_remove (priv->rescan_id);
+  priv->rescan_id = g_timeout_add_seconds (RESCAN_TIMEOUT,
+                                           (GSourceFunc) rescan_timeout_cb,
+                                           scanner);
+}
+
+/*
+ * GObject implementation
+ */
+
+static void
+mex_applications_scanner_set_property (GObject      *object,
+                                       guint         property_id,
+                                       const GValue *value,
+                                       GParamSpec   *pspec)
+{
+  MexApplicationsScannerPrivate *priv = MEX_APPLICATIONS_SCANNER (object)->priv;
+
+  switch (property_id)
+    {
+    case PROP_MODEL:
+      priv->model = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_applications_scanner_dispose (GObject *object)
+{
+  MexApplicationsScannerPrivate *priv = MEX_APPLICATIONS_SCANNER (object)->priv;
+
+  g_cancellable_cancel (priv->cancellable);
+
+  if (priv->rescan_id)
+    {
+      g_source_remove (priv->rescan_id);
+      priv->rescan_id = 0;
+    }
+
+  while (priv->monitors)
+    {
+      g_file_monitor_cancel (priv->monitors->data);
+      g_object_unref (priv->monitors->data);
+      priv->monitors = g_list_delete_link (priv->monitors, priv->monitors);
+    }
+
+  if (priv->applications)
+    {
+      g_hash_table_unref (priv->applications);
+      priv->applications = NULL;
+    }
+
+  if (priv->dir_entries)
+    {
+      g_hash_table_unref (priv->dir_entries);
+      priv->dir_entries = NULL;
+    }
+
+  if (priv->model)
+    {
+      g_object_unref (priv->model);
+      priv->model = NULL;
+    }
+
+  G_OBJECT_CLASS (mex_applications_scanner_parent_class)->dispose (object);
+}
+
+static void
+mex_applications_scanner_finalize (GObject *object)
+{
+  MexApplicationsScannerPrivate *priv = MEX_APPLICATIONS_SCANNER (object)->priv;
+
+  g_strfreev (priv->directories);
+  g_free (priv->cache_file);
+  g_hash_table_unref (priv->dirty);
+  g_object_unref (priv->cancellable);
+
+  G_OBJECT_CLASS (mex_applications_scanner_parent_class)->finalize (object);
+}
+
+static void
+mex_applications_scanner_class_init (MexApplicationsScannerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GParamSpec *pspec;
+
+  g_type_class_add_private (klass, sizeof (MexApplicationsScannerPrivate));
+
+  object_class->set_property = mex_applications_scanner_set_property;
+  object_class->dispose = mex_applications_scanner_dispose;
+  object_class->finalize = mex_applications_scanner_finalize;
+
+  pspec = g_param_spec_object ("model",
+                               "Model",
+                               "Model to add the applications to",
+                               MEX_TYPE_MODEL,
+                               G_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY |
+                               G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_MODEL, pspec);
+}
+
+static void
+mex_applications_scanner_init (MexApplicationsScanner *self)
+{
+  MexApplicationsScannerPrivate *priv;
+  const gchar * const *data_dirs;
+  GPtrArray *directories;
+  gint i;
+
+  priv = self->priv = GET_PRIVATE (self);
+
+  /* in order of precedence */
+  directories = g_ptr_array_new ();
+  g_ptr_array_add (directories,
+                   g_build_filename (g_get_user_data_dir (), "applications",
+                                     NULL));
+  data_dirs = g_get_system_data_dirs ();
+  for (i = 0; data_dirs[i]; i++)
+    g_ptr_array_add (directories,
+                     g_build_filename (data_dirs[i], "applications", NULL));
+  g_ptr_array_add (directories, NULL);
+  priv->directories = (gchar **) g_ptr_array_free (directories, FALSE);
+
+  priv->cache_file = g_build_filename (g_get_user_cache_dir (), "mex",
+                                       "applications.cache", NULL);
+
+  priv->applications = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) _tracked_free);
+  priv->dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  priv->cancellable = g_cancellable_new ();
+}
+
+MexApplicationsScanner *
+mex_applications_scanner_new (MexModel *model)
+{
+  return g_object_new (MEX_TYPE_APPLICATIONS_SCANNER, "model", model, NULL);
+}
+
+/**
+ * mex_applications_scanner_start:
+ * @scanner: a #MexApplicationsScanner
+ *
+ * Fills the model in the background and keeps it up to date.
+ */
+void
+mex_applications_scanner_start (MexApplicationsScanner *scanner)
+{
+  MexApplicationsScannerPrivate *priv;
+  gint i;
+
+  g_return_if_fail (MEX_IS_APPLICATIONS_SCANNER (scanner));
+
+  priv = scanner->priv;
+
+  if (priv->monitors)
+    return;
+
+  for (i = 0; priv->directories[i]; i++)
+    {
+      GFileMonitor *monitor;
+      GFile *file;
+
+      file = g_file_new_for_path (priv->directories[i]);
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE,
+                                          NULL, NULL);
+      g_object_unref (file);
+
+      if (!monitor)
+        continue;
+
+      g_object_set_data_full (G_OBJECT (monitor), "path",
+                              g_strdup (priv->directories[i]), g_free);
+      g_signal_connect (monitor, "changed",
+                        G_CALLBACK (monitor_changed_cb), scanner);
+      priv->monitors = g_list_prepend (priv->monitors, monitor);
+    }
+
+  mex_applications_scanner_scan (scanner);
+}
@@ -51,26 +51,19 @@ struct _MexAppsPluginPrivate
 };
 
 static void
-mex_apps_model_load (MexModel *model)
+mex_apps_model_loaded_cb (GObject      *source,
+                          GAsyncResult *res,
+                          gpointer      user_data)
 {
-  JsonParser *parser;
-  gchar *filename;
+  JsonParser *parser = JSON_PARSER (source);
+  MexModel *model = user_data;
+  GList *contents = NULL, *l;
   GError *error = NULL;
-  JsonNode *root;
   JsonArray *array;
-  gint i = 0;
-
-  filename = MEX_DATA_PLUGIN_DIR "/apps.json";
-
-  if (!g_file_test (filename, G_FILE_TEST_EXISTS))
-    {
-      g_free (filename);
-
-      return;
-    }
+  JsonNode *root;
+  gint i;
 
-  parser = json_parser_new ();
-  if (!json_parser_load_from_file (parser, filename, &error))
+  if (!json_parser_load_from_stream_finish (parser, res, &error))
     {
       g_warning (G_STRLOC ": error populating from file: %s",
                  error->message);
@@ -89,21 +82,58 @@ mex_apps_model_load (MexModel *model)
 
   array = json_node_get_array (root);
 
-  for (i = 0; i < json_array_get_length (array); i++)
+  for (i = json_array_get_length (array) - 1; i >= 0; i--)
     {
-      MexContent *content;
       JsonNode *node;
 
       node = json_array_get_element (array, i);
-      content = (MexContent *)json_gobject_deserialize (MEX_TYPE_PROGRAM,
-                                                        node);
-
-      mex_model_add_content (MEX_MODEL (model), content);
+      contents = g_list_prepend (contents,
+                                 json_gobject_deserialize (MEX_TYPE_PROGRAM,
+                                                           node));
     }
 
+  /* one change notification for the whole file */
+  mex_model_add (model, contents);
+
+  for (l = contents; l; l = l->next)
+    g_object_unref (l->data);
+  g_list_free (contents);
+
 out:
   g_object_unref (parser);
+  g_object_unref (model);
 }
+
+static void
+mex_apps_model_load (MexModel *model)
+{
+  GFileInputStream *stream;
+  JsonParser *parser;
+  GError *error = NULL;
+  GFile *file;
+
+  file = g_file_new_for_path (MEX_DATA_PLUGIN_DIR "/apps.json");
+  stream = g_file_read (file, NULL, &error);
+  g_object_unref (file);
+
+  if (!stream)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        g_warning (G_STRLOC ": error populating from file: %s",
+                   error->message);
+      g_clear_error (&error);
+
+      return;
+    }
+
+  /* don't hold the start up while parsing */
+  parser = json_parser_new ();
+  json_parser_load_from_stream_async (parser, G_INPUT_STREAM (stream), NULL,
+                                      mex_apps_model_loaded_cb,
+                                      g_object_ref (model));
+  g_object_unref (stream);
+}
+
 static void
 mex_apps_plugin_dispose (GObject *object)
 {
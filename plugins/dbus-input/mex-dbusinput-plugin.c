@@ -49,8 +49,6 @@ G_DEFINE_TYPE (MexDbusinputPlugin, mex_dbusinput_plugin, G_TYPE_OBJECT)
 
 struct _MexDbusinputPluginPrivate
 {
-  ClutterStage *stage;
-
   GDBusConnection *connection;
   GDBusNodeInfo *introspection_data;
 };
@@ -88,32 +86,14 @@ _method_cb (GDBusConnection *connection,
             GDBusMethodInvocation *invocation,
             MexDbusinputPlugin *self)
 {
-  MexDbusinputPluginPrivate *priv = MEX_DBUSINPUT_PLUGIN (self)->priv;
-
   if (g_strcmp0 (method_name, "ControlKey") == 0)
     {
       guint keyflag;
-      ClutterEvent *event;
-      ClutterKeyEvent *kevent;
 
       g_variant_get (parameters, "(u)", &keyflag);
 
-      event = clutter_event_new (CLUTTER_KEY_PRESS);
-      kevent = (ClutterKeyEvent *)event;
-
-      kevent->flags = 0;
-      kevent->source = NULL;
-      kevent->stage = CLUTTER_STAGE (priv->stage);
-      kevent->keyval = keyflag;
-      kevent->time = time (NULL);
-
-      /* KEY PRESS */
-      clutter_event_put (event);
-      /* KEY RELEASE */
-      kevent->type = CLUTTER_KEY_RELEASE;
-      clutter_event_put (event);
-
-      clutter_event_free (event);
+      /* bursts of the web remote are delivered as runs of keys */
+      mex_key_coalescer_push (mex_key_coalescer_get_default (), keyflag);
     }
   else if (g_strcmp0 (method_name, "Notification") == 0)
     {
@@ -178,8 +158,6 @@ mex_dbusinput_plugin_init (MexDbusinputPlugin *self)
   MexDbusinputPluginPrivate *priv = self->priv =
     DBUSINPUT_PLUGIN_PRIVATE (self);
 
-  priv->stage = CLUTTER_STAGE (mex_get_stage ());
-
   priv->introspection_data =
     g_dbus_node_info_new_for_xml (introspection_xml, NULL);
 
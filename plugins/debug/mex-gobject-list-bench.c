@@ -0,0 +1,169 @@
+/*
+ * gobject-list: a LD_PRELOAD library for tracking the lifetime of GObjects
+ *
+ * Copyright (C) 2011  Intel Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+/*
+ * Measures the cost gobject-list adds to the life of an object: creation,
+ * a few references and the finalization, with a set of objects kept alive
+ * like an application would.
+ *
+ *   mex-gobject-list-bench [path/to/mex-gobject-list.so [n_objects]]
+ *
+ * runs itself without the library, then preloading it with full tracking,
+ * sampling and sampling with allocation sites.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib-object.h>
+
+#define N_ALIVE 1000
+
+typedef GObject BenchObject;
+typedef GObjectClass BenchObjectClass;
+
+G_DEFINE_TYPE (BenchObject, bench_object, G_TYPE_OBJECT)
+
+static void
+bench_object_class_init (BenchObjectClass *klass)
+{
+}
+
+static void
+bench_object_init (BenchObject *self)
+{
+}
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *env[4];
+} BenchConfig;
+
+static const BenchConfig configs[] =
+{
+  { "none", { NULL } },
+  { "full", { NULL } },
+  { "sample", { "GOBJECT_LIST_SAMPLE=64", NULL } },
+  { "sample+sites", { "GOBJECT_LIST_SAMPLE=64", "GOBJECT_LIST_SITES=1",
+                      NULL } },
+};
+
+static gdouble
+run_bench (guint n_objects)
+{
+  GObject *alive[N_ALIVE] = { NULL, };
+  GTimer *timer;
+  gdouble elapsed;
+  guint i;
+
+  timer = g_timer_new ();
+
+  for (i = 0; i < n_objects; i++)
+    {
+      GObject *object;
+
+      /* two classes so that the lookups are not always the same */
+      object = g_object_new ((i % 2) ? G_TYPE_OBJECT : bench_object_get_type (),
+                             NULL);
+
+      g_object_ref (object);
+      g_object_unref (object);
+
+      if (alive[i % N_ALIVE])
+        g_object_unref (alive[i % N_ALIVE]);
+      alive[i % N_ALIVE] = object;
+    }
+
+  for (i = 0; i < N_ALIVE; i++)
+    if (alive[i])
+      g_object_unref (alive[i]);
+
+  elapsed = g_timer_elapsed (timer, NULL);
+  g_timer_destroy (timer);
+
+  return elapsed * 1e9 / n_objects;
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  const gchar *library;
+  gdouble baseline = 0;
+  guint n_objects;
+  guint i;
+
+  g_type_init ();
+
+  /* child: run and print the ns per object */
+  if (argc > 1 && strcmp (argv[1], "--run") == 0)
+    {
+      n_objects = argc > 2 ? atoi (argv[2]) : 1000000;
+      printf ("%f\n", run_bench (n_objects));
+      return EXIT_SUCCESS;
+    }
+
+  library = argc > 1 ? argv[1] : ".libs/mex-gobject-list.so";
+  n_objects = argc > 2 ? atoi (argv[2]) : 1000000;
+
+  printf ("%-14s %10s %10s\n", "mode", "ns/object", "overhead");
+
+  for (i = 0; i < G_N_ELEMENTS (configs); i++)
+    {
+      gchar *child_argv[4], *output = NULL, *n;
+      GPtrArray *envp;
+      gdouble ns;
+      gint j;
+
+      envp = g_ptr_array_new_with_free_func (g_free);
+      if (i > 0)
+        g_ptr_array_add (envp, g_strdup_printf ("LD_PRELOAD=%s", library));
+      for (j = 0; configs[i].env[j]; j++)
+        g_ptr_array_add (envp, g_strdup (configs[i].env[j]));
+      g_ptr_array_add (envp, NULL);
+
+      n = g_strdup_printf ("%u", n_objects);
+      child_argv[0] = argv[0];
+      child_argv[1] = "--run";
+      child_argv[2] = n;
+      child_argv[3] = NULL;
+
+      if (!g_spawn_sync (NULL, child_argv, (gchar **) envp->pdata, 0,
+                         NULL, NULL, &output, NULL, NULL, NULL))
+        {
+          g_printerr ("Could not run the %s benchmark\n", configs[i].name);
+          return EXIT_FAILURE;
+        }
+
+      ns = g_ascii_strtod (output, NULL);
+      if (i == 0)
+        baseline = ns;
+
+      printf ("%-14s %10.1f %9.0f%%\n", configs[i].name, ns,
+              baseline > 0 ? (ns - baseline) * 100 / baseline : 0);
+
+      g_free (output);
+      g_free (n);
+      g_ptr_array_free (envp, TRUE);
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -22,13 +22,19 @@
  *     Lionel Landwerlin <lionel.g.landwerlin@linux.intel.com>
  *     Damien Lespiau <damien.lespiau@intel.com>
  */
+#define _GNU_SOURCE
 #include <glib-object.h>
 
 #include <dlfcn.h>
 #include <signal.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
+#ifdef __GLIBC__
+#include <execinfo.h>
+#endif
+
 #ifdef HAVE_LIBUNWIND
 #define UNW_LOCAL_ONLY
 #include <libunwind.h>
@@ -70,6 +76,61 @@ static GHashTable *classes = NULL;
 
 gpointer gobject_list_pointer_to_follow = NULL;
 
+/*
+ * Sampling mode
+ *
+ * Tracking every object in a hash table behind a lock and a weak reference
+ * is too costly to leave on for long. With GOBJECT_LIST_SAMPLE=N (N > 1),
+ * creations are only counted, with an atomic increment in a fixed, lock-free
+ * table of classes, and one object in N of each class is followed with a
+ * weak reference. The number of live instances of a class is estimated from
+ * its sampled objects.
+ *
+ * GOBJECT_LIST_SITES=1 also records where the sampled objects were created.
+ * GOBJECT_LIST_REPORT=file appends a report of the estimated live instances
+ * and of their growth rate to file every GOBJECT_LIST_REPORT_INTERVAL
+ * seconds (60 by default), see mex-gobject-list-bench.c for the overhead.
+ */
+#define N_CLASS_SLOTS   4096  /* must be a power of 2 */
+#define MAX_SITES       1024
+#define SITE_DEPTH      6
+#define SITE_SKIP       3     /* _site_capture, _object_sampled, g_object_new */
+#define REPORT_N_SITES  20
+
+typedef struct
+{
+  volatile gsize type;
+  volatile gint  created;
+  volatile gint  sampled;
+  volatile gint  sampled_dead;
+
+  /* only touched by the report thread, to fit the growth rate */
+  gdouble        sum_t;
+  gdouble        sum_y;
+  gdouble        sum_ty;
+  gdouble        sum_tt;
+  guint          n_points;
+} ClassStats;
+
+typedef struct
+{
+  ClassStats    *stats;
+  gpointer       ips[SITE_DEPTH];
+  gint           n_ips;
+  volatile gint  live;
+} Site;
+
+static guint sample_rate = 1;
+static gboolean capture_sites = FALSE;
+static ClassStats class_stats[N_CLASS_SLOTS];
+
+static GStaticMutex sites_lock = G_STATIC_MUTEX_INIT;
+static GHashTable *sites = NULL;
+
+static gchar *report_path = NULL;
+static guint report_interval = 60;
+static gint64 start_time;
+
 /*
  * messages printed with PRINT() can be enabled/disabled at run time
  */
@@ -177,6 +238,10 @@ _dump_object_list (void)
   GHashTableIter iter;
   GObject *obj;
 
+  /* only the full mode knows about the objects themselves */
+  if (!objects)
+    return;
+
   g_static_mutex_lock (&objects_lock);
   g_hash_table_iter_init (&iter, objects);
   while (g_hash_table_iter_next (&iter, (gpointer) &obj, NULL))
@@ -215,6 +280,29 @@ gobject_list_get_summary (void)
   GList *tuples = NULL;
   GHashTableIter iter;
   GObjectListTuple *tuple;
+  guint i;
+
+  if (sample_rate > 1)
+    {
+      for (i = 0; i < N_CLASS_SLOTS; i++)
+        {
+          ClassStats *stats = &class_stats[i];
+          gint live;
+
+          if (!g_atomic_pointer_get (&stats->type))
+            continue;
+
+          live = (g_atomic_int_get (&stats->sampled) -
+                  g_atomic_int_get (&stats->sampled_dead)) * sample_rate;
+          if (live > 0)
+            {
+              tuple = tuple_new (g_type_name (stats->type), live);
+              tuples = g_list_prepend (tuples, tuple);
+            }
+        }
+
+      return tuples;
+    }
 
   g_static_mutex_lock (&classes_lock);
   g_hash_table_iter_init (&iter, classes);
@@ -270,6 +358,303 @@ _dump_classes_list (void)
   gobject_list_free_summary (tuples);
 }
 
+/*
+ * Sampling mode
+ */
+
+static ClassStats *
+_class_stats_lookup (GType type)
+{
+  guint i, slot;
+
+  slot = (type >> 4) & (N_CLASS_SLOTS - 1);
+  for (i = 0; i < N_CLASS_SLOTS; i++, slot = (slot + 1) & (N_CLASS_SLOTS - 1))
+    {
+      ClassStats *stats = &class_stats[slot];
+      gsize current = (gsize) g_atomic_pointer_get (&stats->type);
+
+      if (current == 0)
+        {
+          if (g_atomic_pointer_compare_and_exchange (&stats->type, 0, type))
+            return stats;
+          current = (gsize) g_atomic_pointer_get (&stats->type);
+        }
+
+      if (current == type)
+        return stats;
+    }
+
+  /* the table is full, don't count that class */
+  return NULL;
+}
+
+static guint
+_site_hash (gconstpointer key)
+{
+  const Site *site = key;
+  guint hash = GPOINTER_TO_UINT (site->stats);
+  gint i;
+
+  for (i = 0; i < site->n_ips; i++)
+    hash = hash * 31 + GPOINTER_TO_UINT (site->ips[i]);
+
+  return hash;
+}
+
+static gboolean
+_site_equal (gconstpointer a,
+             gconstpointer b)
+{
+  const Site *site_a = a, *site_b = b;
+
+  return site_a->stats == site_b->stats &&
+         site_a->n_ips == site_b->n_ips &&
+         memcmp (site_a->ips, site_b->ips,
+                 site_a->n_ips * sizeof (gpointer)) == 0;
+}
+
+static Site *
+_site_capture (ClassStats *stats)
+{
+  Site key, *site = NULL;
+#ifdef __GLIBC__
+  gpointer ips[SITE_DEPTH + SITE_SKIP];
+  gint n_ips;
+
+  n_ips = backtrace (ips, G_N_ELEMENTS (ips)) - SITE_SKIP;
+  if (n_ips <= 0)
+    return NULL;
+
+  key.stats = stats;
+  key.n_ips = n_ips;
+  memcpy (key.ips, ips + SITE_SKIP, n_ips * sizeof (gpointer));
+
+  g_static_mutex_lock (&sites_lock);
+  site = g_hash_table_lookup (sites, &key);
+  if (!site && g_hash_table_size (sites) < MAX_SITES)
+    {
+      site = g_memdup (&key, sizeof (Site));
+      site->live = 0;
+      g_hash_table_insert (sites, site, site);
+    }
+  g_static_mutex_unlock (&sites_lock);
+#endif
+
+  return site;
+}
+
+static void
+_sample_finalized (gpointer  data,
+                   GObject  *obj)
+{
+  ClassStats *stats = data;
+
+  g_atomic_int_inc (&stats->sampled_dead);
+}
+
+static void
+_site_finalized (gpointer  data,
+                 GObject  *obj)
+{
+  Site *site = data;
+
+  g_atomic_int_add (&site->live, -1);
+  g_atomic_int_inc (&site->stats->sampled_dead);
+}
+
+static void
+_object_sampled (GObject *obj)
+{
+  ClassStats *stats;
+  Site *site;
+
+  stats = _class_stats_lookup (G_OBJECT_TYPE (obj));
+  if (!stats)
+    return;
+
+  if (g_atomic_int_add (&stats->created, 1) % sample_rate)
+    return;
+
+  g_atomic_int_inc (&stats->sampled);
+
+  if (capture_sites && (site = _site_capture (stats)))
+    {
+      g_atomic_int_inc (&site->live);
+      g_object_weak_ref (obj, _site_finalized, site);
+    }
+  else
+    g_object_weak_ref (obj, _sample_finalized, stats);
+}
+
+typedef struct
+{
+  ClassStats *stats;
+  gint        live;
+  gdouble     growth;
+} ReportRow;
+
+static gint
+_report_row_cmp (gconstpointer pa,
+                 gconstpointer pb)
+{
+  const ReportRow *a = pa, *b = pb;
+
+  return (a->growth < b->growth) - (a->growth > b->growth);
+}
+
+static gint
+_site_live_cmp (gconstpointer pa,
+                gconstpointer pb)
+{
+  const Site *a = *(Site **) pa, *b = *(Site **) pb;
+
+  return b->live - a->live;
+}
+
+static void
+_write_report (void)
+{
+  GArray *rows;
+  FILE *report;
+  gdouble t;
+  guint i;
+
+  report = fopen (report_path, "a");
+  if (!report)
+    return;
+
+  t = (g_get_monotonic_time () - start_time) / (gdouble) G_USEC_PER_SEC;
+  rows = g_array_new (FALSE, FALSE, sizeof (ReportRow));
+
+  for (i = 0; i < N_CLASS_SLOTS; i++)
+    {
+      ClassStats *stats = &class_stats[i];
+      ReportRow row;
+      gdouble d;
+
+      if (!g_atomic_pointer_get (&stats->type))
+        continue;
+
+      row.stats = stats;
+      row.live = (g_atomic_int_get (&stats->sampled) -
+                  g_atomic_int_get (&stats->sampled_dead)) * sample_rate;
+
+      /* least-squares slope of the live instances over time, a slow leak
+       * shows as a steady positive growth */
+      stats->sum_t += t;
+      stats->sum_y += row.live;
+      stats->sum_ty += t * row.live;
+      stats->sum_tt += t * t;
+      stats->n_points++;
+
+      d = stats->n_points * stats->sum_tt - stats->sum_t * stats->sum_t;
+      if (stats->n_points > 1 && d > 0)
+        row.growth = (stats->n_points * stats->sum_ty -
+                      stats->sum_t * stats->sum_y) / d * 3600;
+      else
+        row.growth = 0;
+
+      if (row.live > 0 || row.growth != 0)
+        g_array_append_val (rows, row);
+    }
+
+  g_array_sort (rows, _report_row_cmp);
+
+  fprintf (report, "# %.0fs, 1 in %u objects sampled\n", t, sample_rate);
+  fprintf (report, "# type live created growth/h\n");
+  for (i = 0; i < rows->len; i++)
+    {
+      ReportRow *row = &g_array_index (rows, ReportRow, i);
+
+      fprintf (report, "%s %d %d %+.1f\n",
+               g_type_name (row->stats->type), row->live,
+               g_atomic_int_get (&row->stats->created), row->growth);
+    }
+  g_array_free (rows, TRUE);
+
+  if (capture_sites)
+    {
+      GPtrArray *live_sites = g_ptr_array_new ();
+      GHashTableIter iter;
+      Site *site;
+
+      g_static_mutex_lock (&sites_lock);
+      g_hash_table_iter_init (&iter, sites);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &site, NULL))
+        if (g_atomic_int_get (&site->live) > 0)
+          g_ptr_array_add (live_sites, site);
+      g_static_mutex_unlock (&sites_lock);
+
+      g_ptr_array_sort (live_sites, _site_live_cmp);
+
+      for (i = 0; i < MIN (live_sites->len, REPORT_N_SITES); i++)
+        {
+          gint j;
+
+          site = g_ptr_array_index (live_sites, i);
+          fprintf (report, "# site %s %d\n", g_type_name (site->stats->type),
+                   g_atomic_int_get (&site->live) * sample_rate);
+
+          for (j = 0; j < site->n_ips; j++)
+            {
+              Dl_info info;
+
+              if (dladdr (site->ips[j], &info) && info.dli_sname)
+                fprintf (report, "#   %s+%#lx\n", info.dli_sname,
+                         (gulong) ((gchar *) site->ips[j] -
+                                   (gchar *) info.dli_saddr));
+              else
+                fprintf (report, "#   %p\n", site->ips[j]);
+            }
+        }
+
+      g_ptr_array_free (live_sites, TRUE);
+    }
+
+  fclose (report);
+}
+
+static gpointer
+_report_thread (gpointer data)
+{
+  while (TRUE)
+    {
+      g_usleep (report_interval * G_USEC_PER_SEC);
+      _write_report ();
+    }
+
+  return NULL;
+}
+
+static void
+_sampling_init (void)
+{
+  const gchar *value;
+
+  value = g_getenv ("GOBJECT_LIST_SAMPLE");
+  if (value)
+    sample_rate = MAX (1, atoi (value));
+
+  if (sample_rate == 1)
+    return;
+
+  capture_sites = g_getenv ("GOBJECT_LIST_SITES") != NULL;
+  if (capture_sites)
+    sites = g_hash_table_new_full (_site_hash, _site_equal, g_free, NULL);
+
+  start_time = g_get_monotonic_time ();
+
+  report_path = g_strdup (g_getenv ("GOBJECT_LIST_REPORT"));
+  if (!report_path)
+    return;
+
+  value = g_getenv ("GOBJECT_LIST_REPORT_INTERVAL");
+  if (value)
+    report_interval = MAX (1, atoi (value));
+
+  g_thread_new ("gobject-list-report", _report_thread, NULL);
+}
+
 static void
 _sig_usr1_handler (int signal_nr)
 {
@@ -288,6 +673,9 @@ _exiting (void)
   g_print ("Living Instances:\n");
 
   _dump_classes_list ();
+
+  if (report_path)
+    _write_report ();
 }
 
 static void *
@@ -304,9 +692,13 @@ get_func (const char *func_name)
       if (handle == NULL)
         g_error ("Failed to open libgobject-2.0.so.0: %s", dlerror ());
 
-      /* set up objects & classes map */
-      objects = g_hash_table_new (NULL, NULL);
-      classes = g_hash_table_new (g_str_hash, g_str_equal);
+      /* set up objects & classes map, unless we are sampling */
+      _sampling_init ();
+      if (sample_rate == 1)
+        {
+          objects = g_hash_table_new (NULL, NULL);
+          classes = g_hash_table_new (g_str_hash, g_str_equal);
+        }
 
       /* set up signal handler */
       signal (SIGUSR1, _sig_usr1_handler);
@@ -370,6 +762,12 @@ _object_created (GObject *obj)
   const gchar *obj_name;
   gpointer found;
 
+  if (sample_rate > 1)
+    {
+      _object_sampled (obj);
+      return;
+    }
+
   obj_name = G_OBJECT_TYPE_NAME (obj);
 
   g_static_mutex_lock (&objects_lock);
@@ -394,6 +792,20 @@ _object_created (GObject *obj)
     }
 }
 
+static inline gboolean
+_trace_refs (gpointer object)
+{
+  if (G_UNLIKELY (gobject_list_pointer_to_follow == object))
+    return TRUE;
+
+  /* keep references cheap when sampling, only look at them when asked to */
+  if (sample_rate > 1 && !gobject_list_verbose)
+    return FALSE;
+
+  return object_filter (G_OBJECT_TYPE_NAME (object)) &&
+         display_filter (DISPLAY_FLAG_REFS);
+}
+
 gpointer
 g_object_newv (GType       object_type,
                guint       n_parameters,
@@ -455,25 +867,21 @@ g_object_new (GType type,
 gpointer
 g_object_ref (gpointer object)
 {
-  gpointer (* real_g_object_ref) (gpointer);
+  static gpointer (* real_g_object_ref) (gpointer) = NULL;
   GObject *obj = G_OBJECT (object);
-  const char *obj_name;
   guint ref_count;
   GObject *ret;
 
-  real_g_object_ref = get_func ("g_object_ref");
-
-  obj_name = G_OBJECT_TYPE_NAME (obj);
+  if (G_UNLIKELY (!real_g_object_ref))
+    real_g_object_ref = get_func ("g_object_ref");
 
   ref_count = obj->ref_count;
   ret = real_g_object_ref (object);
 
-  if (G_UNLIKELY (gobject_list_pointer_to_follow == object ||
-                  (object_filter (obj_name) &&
-                   display_filter (DISPLAY_FLAG_REFS))))
+  if (_trace_refs (object))
     {
       PRINT (" +  Reffed object %p, %s; ref_count: %d -> %d\n",
-          obj, obj_name, ref_count, obj->ref_count);
+          obj, G_OBJECT_TYPE_NAME (obj), ref_count, obj->ref_count);
       print_trace();
     }
 
@@ -483,25 +891,21 @@ g_object_ref (gpointer object)
 gpointer
 g_object_ref_sink (gpointer object)
 {
-  gpointer (* real_g_object_ref_sink) (gpointer);
+  static gpointer (* real_g_object_ref_sink) (gpointer) = NULL;
   GObject *obj = G_OBJECT (object);
-  const char *obj_name;
   guint ref_count;
   GObject *ret;
 
-  real_g_object_ref_sink = get_func ("g_object_ref_sink");
-
-  obj_name = G_OBJECT_TYPE_NAME (obj);
+  if (G_UNLIKELY (!real_g_object_ref_sink))
+    real_g_object_ref_sink = get_func ("g_object_ref_sink");
 
   ref_count = obj->ref_count;
   ret = real_g_object_ref_sink (object);
 
-  if (G_UNLIKELY (gobject_list_pointer_to_follow == object ||
-                  (object_filter (obj_name) &&
-                   display_filter (DISPLAY_FLAG_REFS))))
+  if (_trace_refs (object))
     {
       PRINT (" +  Reffed(sink) object %p, %s; ref_count: %d -> %d\n",
-             obj, obj_name, ref_count, obj->ref_count);
+             obj, G_OBJECT_TYPE_NAME (obj), ref_count, obj->ref_count);
       print_trace();
     }
 
@@ -513,24 +917,20 @@ g_object_add_toggle_ref (GObject       *object,
                          GToggleNotify  notify,
                          gpointer       data)
 {
-  void (* real_g_object_add_toggle_ref) (GObject *, GToggleNotify, gpointer);
+  static void (* real_g_object_add_toggle_ref) (GObject *, GToggleNotify, gpointer) = NULL;
   GObject *obj = G_OBJECT (object);
-  const char *obj_name;
   guint ref_count;
 
-  real_g_object_add_toggle_ref = get_func ("g_object_add_toggle_ref");
-
-  obj_name = G_OBJECT_TYPE_NAME (obj);
+  if (G_UNLIKELY (!real_g_object_add_toggle_ref))
+    real_g_object_add_toggle_ref = get_func ("g_object_add_toggle_ref");
 
   ref_count = obj->ref_count;
   real_g_object_add_toggle_ref (object, notify, data);
 
-  if (G_UNLIKELY (gobject_list_pointer_to_follow == object ||
-                  (object_filter (obj_name) &&
-                   display_filter (DISPLAY_FLAG_REFS))))
+  if (_trace_refs (object))
     {
       PRINT (" +  Reffed(sink) object %p, %s; ref_count: %d -> %d\n",
-             obj, obj_name, ref_count, obj->ref_count);
+             obj, G_OBJECT_TYPE_NAME (obj), ref_count, obj->ref_count);
       print_trace();
     }
 }
@@ -540,19 +940,14 @@ g_object_unref (gpointer object)
 {
   static void (* real_g_object_unref) (gpointer) = NULL;
   GObject *obj = G_OBJECT (object);
-  const char *obj_name;
 
   if (G_UNLIKELY (!real_g_object_unref))
     real_g_object_unref = get_func ("g_object_unref");
 
-  obj_name = G_OBJECT_TYPE_NAME (obj);
-
-  if (G_UNLIKELY (gobject_list_pointer_to_follow == object ||
-                  (object_filter (obj_name) &&
-                   display_filter (DISPLAY_FLAG_REFS))))
+  if (_trace_refs (object))
     {
       PRINT (" -  Unreffed object %p, %s; ref_count: %d -> %d\n",
-             obj, obj_name, obj->ref_count, obj->ref_count - 1);
+             obj, G_OBJECT_TYPE_NAME (obj), obj->ref_count, obj->ref_count - 1);
       print_trace();
     }
 
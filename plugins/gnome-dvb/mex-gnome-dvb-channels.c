@@ -0,0 +1,296 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mex-gnome-dvb-channels.h"
+
+/*
+ * Fills a model with the TV channels of an org.gnome.DVB.ChannelList.
+ *
+ * GetChannelInfos gives the channels, but their stream URLs need one
+ * GetChannelURL call each. On a satellite with a thousand services, firing
+ * all those calls at once floods the bus and makes the model change for
+ * each answer, so only MEX_GNOME_DVB_MAX_URL_CALLS calls are in flight at
+ * any time, the URLs are kept aside and the channels, sorted once by their
+ * number, are added to the model in one go when all the URLs are known.
+ */
+
+typedef struct
+{
+  guint32     uid;
+  MexContent *content;
+  gchar      *url;
+} Channel;
+
+typedef struct
+{
+  GDBusProxy         *proxy;
+  MexModel           *model;
+  GSimpleAsyncResult *result;
+
+  GArray *channels;
+  guint   next;       /* next channel to get the URL of */
+  guint   in_flight;
+} Fetch;
+
+typedef struct
+{
+  Fetch *fetch;
+  guint  index;
+} UrlCall;
+
+static void
+fetch_free (Fetch *fetch)
+{
+  guint i;
+
+  for (i = 0; i < fetch->channels->len; i++)
+    {
+      Channel *channel = &g_array_index (fetch->channels, Channel, i);
+
+      g_object_unref (channel->content);
+      g_free (channel->url);
+    }
+  g_array_free (fetch->channels, TRUE);
+
+  g_object_unref (fetch->result);
+  g_object_unref (fetch->model);
+  g_object_unref (fetch->proxy);
+  g_slice_free (Fetch, fetch);
+}
+
+static gint
+channel_compare (gconstpointer a,
+                 gconstpointer b)
+{
+  const Channel *channel_a = a, *channel_b = b;
+
+  if (channel_a->uid == channel_b->uid)
+    return 0;
+
+  return channel_a->uid < channel_b->uid ? -1 : 1;
+}
+
+static void
+fetch_complete (Fetch *fetch)
+{
+  GList *list = NULL;
+  guint i;
+
+  for (i = fetch->channels->len; i > 0; i--)
+    {
+      Channel *channel = &g_array_index (fetch->channels, Channel, i - 1);
+
+      /* not in the model yet, nobody is listening */
+      if (channel->url)
+        mex_content_set_metadata (channel->content,
+                                  MEX_CONTENT_METADATA_STREAM, channel->url);
+
+      list = g_list_prepend (list, channel->content);
+    }
+
+  if (list)
+    mex_model_add (fetch->model, list);
+  g_list_free (list);
+
+  g_simple_async_result_set_op_res_gboolean (fetch->result, TRUE);
+  g_simple_async_result_complete (fetch->result);
+
+  fetch_free (fetch);
+}
+
+static void fetch_next_urls (Fetch *fetch);
+
+static void
+get_channel_url_ready_cb (GObject      *proxy,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  UrlCall *call = user_data;
+  Fetch *fetch = call->fetch;
+  Channel *channel;
+  GError *error = NULL;
+  GVariant *variant;
+  gboolean result;
+
+  channel = &g_array_index (fetch->channels, Channel, call->index);
+  g_slice_free (UrlCall, call);
+
+  variant = g_dbus_proxy_call_finish (G_DBUS_PROXY (proxy), res, &error);
+
+  if (variant)
+    {
+      g_variant_get (variant, "(sb)", &channel->url, &result);
+      g_variant_unref (variant);
+    }
+  else
+    {
+      g_warning ("Could not get the URL of channel %u: %s", channel->uid,
+                 error->message);
+      g_clear_error (&error);
+    }
+
+  fetch->in_flight--;
+  fetch_next_urls (fetch);
+}
+
+static void
+fetch_next_urls (Fetch *fetch)
+{
+  while (fetch->in_flight < MEX_GNOME_DVB_MAX_URL_CALLS &&
+         fetch->next < fetch->channels->len)
+    {
+      Channel *channel;
+      UrlCall *call;
+
+      channel = &g_array_index (fetch->channels, Channel, fetch->next);
+
+      call = g_slice_new (UrlCall);
+      call->fetch = fetch;
+      call->index = fetch->next;
+
+      fetch->next++;
+      fetch->in_flight++;
+
+      g_dbus_proxy_call (fetch->proxy, "GetChannelURL",
+                         g_variant_new ("(u)", channel->uid),
+                         G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                         get_channel_url_ready_cb, call);
+    }
+
+  if (fetch->in_flight == 0)
+    fetch_complete (fetch);
+}
+
+static void
+get_channel_infos_ready_cb (GObject      *proxy,
+                            GAsyncResult *res,
+                            gpointer      user_data)
+{
+  Fetch *fetch = user_data;
+  GError *error = NULL;
+  GVariant *variant, *infos;
+  GVariantIter iter;
+  gboolean is_radio;
+  guint32 uid;
+  gchar *name;
+
+  variant = g_dbus_proxy_call_finish (G_DBUS_PROXY (proxy), res, &error);
+
+  if (variant == NULL)
+    {
+      g_simple_async_result_take_error (fetch->result, error);
+      g_simple_async_result_complete (fetch->result);
+      fetch_free (fetch);
+      return;
+    }
+
+  infos = g_variant_get_child_value (variant, 0);
+  g_variant_iter_init (&iter, infos);
+
+  while (g_variant_iter_next (&iter, "(usb)", &uid, &name, &is_radio))
+    {
+      Channel channel;
+      gchar id[16];
+
+      if (is_radio)
+        {
+          g_free (name);
+          continue;
+        }
+
+      g_snprintf (id, sizeof (id), "%u", uid);
+
+      channel.uid = uid;
+      channel.url = NULL;
+      channel.content = g_object_ref_sink (g_object_new (MEX_TYPE_GENERIC_CONTENT,
+                                                         NULL));
+
+      mex_content_set_metadata (channel.content, MEX_CONTENT_METADATA_TITLE,
+                                name);
+      mex_content_set_metadata (channel.content, MEX_CONTENT_METADATA_ID, id);
+      mex_content_set_metadata (channel.content, MEX_CONTENT_METADATA_MIMETYPE,
+                                "x-mex/tv");
+
+      g_array_append_val (fetch->channels, channel);
+
+      g_free (name);
+    }
+
+  g_variant_unref (infos);
+  g_variant_unref (variant);
+
+  /* the channels are ordered by number, sort them once */
+  g_array_sort (fetch->channels, channel_compare);
+
+  fetch_next_urls (fetch);
+}
+
+/**
+ * mex_gnome_dvb_channels_fetch:
+ * @channel_list: a proxy for an org.gnome.DVB.ChannelList object
+ * @model: the model to add the channels to
+ * @callback: called once the channels are in @model
+ * @user_data: data to give to @callback
+ *
+ * Adds the TV channels of @channel_list to @model, sorted by number.
+ */
+void
+mex_gnome_dvb_channels_fetch (GDBusProxy          *channel_list,
+                              MexModel            *model,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+  Fetch *fetch;
+
+  g_return_if_fail (G_IS_DBUS_PROXY (channel_list));
+  g_return_if_fail (MEX_IS_MODEL (model));
+
+  fetch = g_slice_new0 (Fetch);
+  fetch->proxy = g_object_ref (channel_list);
+  fetch->model = g_object_ref (model);
+  fetch->channels = g_array_new (FALSE, FALSE, sizeof (Channel));
+  fetch->result = g_simple_async_result_new (G_OBJECT (channel_list),
+                                             callback, user_data,
+                                             mex_gnome_dvb_channels_fetch);
+
+  g_dbus_proxy_call (channel_list, "GetChannelInfos", NULL,
+                     G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                     get_channel_infos_ready_cb, fetch);
+}
+
+gboolean
+mex_gnome_dvb_channels_fetch_finish (GDBusProxy    *channel_list,
+                                     GAsyncResult  *result,
+                                     GError       **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (result);
+
+  g_return_val_if_fail (g_simple_async_result_is_valid (result,
+                                                        G_OBJECT (channel_list),
+                                                        mex_gnome_dvb_channels_fetch),
+                        FALSE);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  return g_simple_async_result_get_op_res_gboolean (simple);
+}
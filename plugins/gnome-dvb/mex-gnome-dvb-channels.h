@@ -0,0 +1,40 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef _MEX_GNOME_DVB_CHANNELS_H
+#define _MEX_GNOME_DVB_CHANNELS_H
+
+#include <gio/gio.h>
+#include <mex/mex.h>
+
+G_BEGIN_DECLS
+
+/* at most that many GetChannelURL calls are waiting for an answer */
+#define MEX_GNOME_DVB_MAX_URL_CALLS 8
+
+void     mex_gnome_dvb_channels_fetch        (GDBusProxy          *channel_list,
+                                              MexModel            *model,
+                                              GAsyncReadyCallback  callback,
+                                              gpointer             user_data);
+gboolean mex_gnome_dvb_channels_fetch_finish (GDBusProxy          *channel_list,
+                                              GAsyncResult        *result,
+                                              GError             **error);
+
+G_END_DECLS
+
+#endif /* _MEX_GNOME_DVB_CHANNELS_H */
@@ -21,9 +21,9 @@
 #endif
 
 #include "mex-gnome-dvb-plugin.h"
+#include "mex-gnome-dvb-channels.h"
 #include <mex/mex-grilo-feed.h>
 #include <mex/mex-generic-content.h>
-#include <stdlib.h>
 
 #include <glib/gi18n.h>
 
@@ -106,101 +106,15 @@ _handle_error (GError **err)
 }
 
 static void
-get_channel_url_ready_cb (GObject      *proxy,
-                          GAsyncResult *res,
-                          gpointer      content)
+channels_fetched_cb (GObject      *proxy,
+                     GAsyncResult *res,
+                     gpointer      plugin)
 {
   GError *err = NULL;
-  GVariant *variant;
-  gchar *url;
-  gboolean result;
-
-  variant = g_dbus_proxy_call_finish (G_DBUS_PROXY (proxy), res, &err);
-
-  if (_handle_error (&err))
-    return;
-
-  g_variant_get (variant, "(sb)", &url, &result);
-
-  mex_content_set_metadata (content, MEX_CONTENT_METADATA_STREAM, url);
-
-  g_free (url);
-}
-
-static gint
-channel_insert_sort_func (gconstpointer content1,
-                          gconstpointer content2)
-{
-  const gchar *uid1, *uid2;
-  gint id1, id2;
-
-  uid1 = mex_content_get_metadata (MEX_CONTENT (content1),
-                                   MEX_CONTENT_METADATA_ID);
-  uid2 = mex_content_get_metadata (MEX_CONTENT (content2),
-                                   MEX_CONTENT_METADATA_ID);
-
 
-  id1 = (uid1) ? atoi (uid1) : 0;
-  id2 = (uid2) ? atoi (uid2) : 0;
+  mex_gnome_dvb_channels_fetch_finish (G_DBUS_PROXY (proxy), res, &err);
 
-  return id1 - id2;
-}
-
-static void
-get_channel_infos_ready_cb (GObject      *proxy,
-                            GAsyncResult *res,
-                            gpointer      plugin)
-{
-  GError *err = NULL;
-  GVariant *variant;
-  GVariantIter iter;
-  MexGnomeDvbPluginPrivate *priv = MEX_GNOME_DVB_PLUGIN (plugin)->priv;
-  gchar *name, *id;
-  guint32 uid;
-  gboolean boolean;
-  GList *list = NULL, *l;
-
-  variant = g_dbus_proxy_call_finish (G_DBUS_PROXY (proxy), res, &err);
-
-  if (_handle_error (&err))
-    return;
-
-  g_variant_iter_init (&iter, g_variant_get_child_value (variant, 0));
-
-  while (g_variant_iter_next (&iter, "(usb)", &uid, &name, &boolean))
-    {
-      MexContent *content;
-
-      if (boolean)
-        {
-          g_free (name);
-          continue;
-        }
-
-      id = g_strdup_printf ("%d", uid);
-
-      content = g_object_new (MEX_TYPE_GENERIC_CONTENT, NULL);
-
-      mex_content_set_metadata (content, MEX_CONTENT_METADATA_TITLE, name);
-      mex_content_set_metadata (content, MEX_CONTENT_METADATA_ID, id);
-      mex_content_set_metadata (content, MEX_CONTENT_METADATA_MIMETYPE,
-                                "x-mex/tv");
-
-      g_dbus_proxy_call (G_DBUS_PROXY (proxy), "GetChannelURL",
-                         g_variant_new ("(u)", uid), G_DBUS_CALL_FLAGS_NONE,
-                         -1, NULL, get_channel_url_ready_cb, content);
-
-      g_free (name);
-      g_free (id);
-
-      list = g_list_insert_sorted (list, content, channel_insert_sort_func);
-    }
-
-  for (l = list; l; l = g_list_next (l))
-    {
-      mex_model_add_content (priv->models->data, l->data);
-    }
-  g_list_free (list);
+  _handle_error (&err);
 }
 
 static void
@@ -216,8 +130,9 @@ channel_list_proxy_ready_cb (GObject      *proxy,
   if (_handle_error (&err))
     return;
 
-  g_dbus_proxy_call (new_proxy, "GetChannelInfos", NULL, G_DBUS_CALL_FLAGS_NONE,
-                     -1, NULL, get_channel_infos_ready_cb, plugin);
+  mex_gnome_dvb_channels_fetch (new_proxy,
+                                MEX_GNOME_DVB_PLUGIN (plugin)->priv->models->data,
+                                channels_fetched_cb, plugin);
 
   g_object_unref (new_proxy);
 }
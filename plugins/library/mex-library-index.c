@@ -0,0 +1,943 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include "mex-library-index.h"
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/*
+ * The index keeps, for every directory under the root, its modification
+ * time, its inode and the names of the files and directories it holds.
+ *
+ * Scans run in a thread. Every directory is looked at, but only the ones
+ * whose time or inode changed since the last scan are read again. Adding,
+ * removing or renaming an entry changes the time of its directory, so what
+ * was added and removed is found by comparing the names read with the
+ * ones in the index. The index is cached between runs, so the scan done on
+ * start only reads the directories that changed while we were not running.
+ *
+ * A directory changed in the same second it was read may keep the same
+ * time on file systems with a coarse clock; those are stored without a
+ * time and read again by the next scan.
+ *
+ * A file monitor per directory catches the changes made while we run. It
+ * marks its directory to be read again and a rescan is made once things
+ * calm down. What each scan found is given in one "changed" signal. The
+ * first scan, when there is no cache to compare with, only fills the
+ * index.
+ *
+ * Hidden files are not looked at, nor are symbolic links to directories
+ * found in the tree. The root itself may be one (~/Videos pointing to
+ * another disk is common).
+ */
+
+#define CACHE_VERSION   1
+#define CACHE_TYPE      "(uaya(ayttaayaay))"
+#define RESCAN_TIMEOUT  1 /* seconds */
+#define RACY_DELAY      (2 * G_USEC_PER_SEC)
+
+G_DEFINE_TYPE (MexLibraryIndex, mex_library_index, G_TYPE_OBJECT)
+
+#define GET_PRIVATE(o) \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_LIBRARY_INDEX, \
+                                MexLibraryIndexPrivate))
+
+enum
+{
+  PROP_0,
+
+  PROP_ROOT,
+  PROP_CACHE_FILE
+};
+
+enum
+{
+  CHANGED,
+
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0, };
+
+typedef struct
+{
+  volatile gint  ref_count;
+  guint64        mtime;
+  guint64        inode;
+  GPtrArray     *files;     /* sorted names */
+  GPtrArray     *subdirs;   /* sorted names */
+} DirEntry;
+
+typedef struct
+{
+  gchar      *root;
+  gchar      *cache_file;
+  gint64      now;
+  gboolean    initial;
+  GHashTable *previous;
+  GHashTable *dirty;
+  GHashTable *result;
+  GPtrArray  *added;
+  GPtrArray  *removed;
+  guint       n_directories;
+  guint       n_read;
+} ScanJob;
+
+struct _MexLibraryIndexPrivate
+{
+  gchar                *root;
+  gchar                *cache_file;
+  GHashTable           *directories;
+
+  GHashTable           *monitors;
+  GHashTable           *dirty;
+  guint                 rescan_id;
+  guint                 started : 1;
+  guint                 scanning : 1;
+  guint                 rescan_pending : 1;
+  GCancellable         *cancellable;
+
+  MexLibraryIndexStats  stats;
+};
+
+static void mex_library_index_scan (MexLibraryIndex *index);
+
+/*
+ * Entries
+ */
+
+static DirEntry *
+dir_entry_new (guint64 mtime,
+               guint64 inode)
+{
+  DirEntry *dir = g_slice_new (DirEntry);
+
+  dir->ref_count = 1;
+  dir->mtime = mtime;
+  dir->inode = inode;
+  dir->files = g_ptr_array_new_with_free_func (g_free);
+  dir->subdirs = g_ptr_array_new_with_free_func (g_free);
+
+  return dir;
+}
+
+static DirEntry *
+dir_entry_ref (DirEntry *dir)
+{
+  g_atomic_int_inc (&dir->ref_count);
+
+  return dir;
+}
+
+static void
+dir_entry_unref (DirEntry *dir)
+{
+  if (!g_atomic_int_dec_and_test (&dir->ref_count))
+    return;
+
+  g_ptr_array_free (dir->files, TRUE);
+  g_ptr_array_free (dir->subdirs, TRUE);
+  g_slice_free (DirEntry, dir);
+}
+
+static GHashTable *
+dir_table_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                (GDestroyNotify) dir_entry_unref);
+}
+
+static gint
+_compare_names (gconstpointer a,
+                gconstpointer b)
+{
+  return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+/*
+ * Scanning, in a thread
+ */
+
+static gboolean
+_get_info (const gchar *path,
+           gboolean     follow,
+           guint64     *mtime,
+           guint64     *inode)
+{
+  GFileInfo *info;
+  GFile *file;
+  gboolean is_dir = FALSE;
+
+  file = g_file_new_for_path (path);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC ","
+                            G_FILE_ATTRIBUTE_UNIX_INODE,
+                            follow ? G_FILE_QUERY_INFO_NONE :
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+  if (info)
+    {
+      is_dir = g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY;
+      *mtime = g_file_info_get_attribute_uint64 (info,
+                                                 G_FILE_ATTRIBUTE_TIME_MODIFIED)
+        * G_USEC_PER_SEC +
+        g_file_info_get_attribute_uint32 (info,
+                                          G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+      *inode = g_file_info_get_attribute_uint64 (info,
+                                                 G_FILE_ATTRIBUTE_UNIX_INODE);
+      g_object_unref (info);
+    }
+  g_object_unref (file);
+
+  return is_dir;
+}
+
+static DirEntry *
+_read_directory (ScanJob     *job,
+                 const gchar *path,
+                 guint64      mtime,
+                 guint64      inode)
+{
+  const gchar *name;
+  DirEntry *dir;
+  GDir *gdir;
+
+  /* racy, see above */
+  if (job->now - (gint64) mtime < RACY_DELAY)
+    mtime = 0;
+
+  dir = dir_entry_new (mtime, inode);
+
+  gdir = g_dir_open (path, 0, NULL);
+  if (!gdir)
+    return dir;
+
+  while ((name = g_dir_read_name (gdir)))
+    {
+      GStatBuf buf;
+      gchar *filename;
+
+      if (name[0] == '.')
+        continue;
+
+      filename = g_build_filename (path, name, NULL);
+
+      if (g_lstat (filename, &buf) == 0)
+        {
+          if (S_ISDIR (buf.st_mode))
+            g_ptr_array_add (dir->subdirs, g_strdup (name));
+          else if (S_ISREG (buf.st_mode) ||
+                   (S_ISLNK (buf.st_mode) &&
+                    g_file_test (filename, G_FILE_TEST_IS_REGULAR)))
+            g_ptr_array_add (dir->files, g_strdup (name));
+        }
+
+      g_free (filename);
+    }
+
+  g_dir_close (gdir);
+
+  g_ptr_array_sort (dir->files, _compare_names);
+  g_ptr_array_sort (dir->subdirs, _compare_names);
+
+  return dir;
+}
+
+/* everything that was under @path */
+static void
+_remove_tree (ScanJob     *job,
+              const gchar *path)
+{
+  DirEntry *dir = g_hash_table_lookup (job->previous, path);
+  guint i;
+
+  if (!dir)
+    return;
+
+  for (i = 0; i < dir->files->len; i++)
+    g_ptr_array_add (job->removed,
+                     g_build_filename (path,
+                                       g_ptr_array_index (dir->files, i),
+                                       NULL));
+
+  for (i = 0; i < dir->subdirs->len; i++)
+    {
+      gchar *subdir = g_build_filename (path,
+                                        g_ptr_array_index (dir->subdirs, i),
+                                        NULL);
+
+      _remove_tree (job, subdir);
+      g_ptr_array_add (job->removed, subdir);
+    }
+}
+
+/* walks the two sorted lists of names side by side */
+static void
+_diff_names (ScanJob     *job,
+             const gchar *path,
+             GPtrArray   *old,
+             GPtrArray   *new,
+             gboolean     subdirs)
+{
+  guint i = 0, j = 0;
+
+  while (i < old->len || j < new->len)
+    {
+      const gchar *old_name = i < old->len ? g_ptr_array_index (old, i) : NULL;
+      const gchar *new_name = j < new->len ? g_ptr_array_index (new, j) : NULL;
+      gint cmp;
+
+      if (!old_name)
+        cmp = 1;
+      else if (!new_name)
+        cmp = -1;
+      else
+        cmp = strcmp (old_name, new_name);
+
+      if (cmp < 0)
+        {
+          gchar *filename = g_build_filename (path, old_name, NULL);
+
+          if (subdirs)
+            _remove_tree (job, filename);
+          g_ptr_array_add (job->removed, filename);
+          i++;
+        }
+      else if (cmp > 0)
+        {
+          /* the contents of a new directory are found when scanning it */
+          g_ptr_array_add (job->added,
+                           g_build_filename (path, new_name, NULL));
+          j++;
+        }
+      else
+        {
+          i++;
+          j++;
+        }
+    }
+}
+
+static void
+_scan_directory (ScanJob      *job,
+                 const gchar  *path,
+                 GCancellable *cancellable)
+{
+  DirEntry *dir, *previous;
+  guint64 mtime, inode;
+  guint i;
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  if (!_get_info (path, strcmp (path, job->root) == 0, &mtime, &inode))
+    return;
+
+  job->n_directories++;
+
+  previous = g_hash_table_lookup (job->previous, path);
+
+  if (previous && previous->mtime == mtime && previous->inode == inode &&
+      !(job->dirty && g_hash_table_lookup (job->dirty, path)))
+    dir = dir_entry_ref (previous);
+  else
+    {
+      GPtrArray *none = g_ptr_array_new ();
+
+      dir = _read_directory (job, path, mtime, inode);
+      job->n_read++;
+
+      _diff_names (job, path, previous ? previous->files : none,
+                   dir->files, FALSE);
+      _diff_names (job, path, previous ? previous->subdirs : none,
+                   dir->subdirs, TRUE);
+
+      g_ptr_array_free (none, TRUE);
+    }
+
+  g_hash_table_insert (job->result, g_strdup (path), dir);
+
+  for (i = 0; i < dir->subdirs->len; i++)
+    {
+      gchar *subdir = g_build_filename (path,
+                                        g_ptr_array_index (dir->subdirs, i),
+                                        NULL);
+
+      _scan_directory (job, subdir, cancellable);
+      g_free (subdir);
+    }
+}
+
+static GHashTable *
+_cache_load (const gchar *cache_file,
+             const gchar *root)
+{
+  GVariant *cache, *entries, *entry;
+  GHashTable *table;
+  GVariantIter iter;
+  const gchar *cache_root;
+  guint32 version;
+  gchar *data;
+  gsize length;
+
+  table = dir_table_new ();
+
+  if (!g_file_get_contents (cache_file, &data, &length, NULL))
+    return table;
+
+  cache = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_TYPE), data, length,
+                                   FALSE, g_free, data);
+  g_variant_ref_sink (cache);
+
+  g_variant_get (cache, "(u^&ay@a(ayttaayaay))", &version, &cache_root,
+                 &entries);
+
+  /* the cache of another root would only make us read everything */
+  if (version != CACHE_VERSION || strcmp (cache_root, root) != 0)
+    goto out;
+
+  g_variant_iter_init (&iter, entries);
+  while ((entry = g_variant_iter_next_value (&iter)))
+    {
+      GVariant *files, *subdirs;
+      const gchar **names, *path;
+      guint64 mtime, inode;
+      DirEntry *dir;
+      gsize i, n_names;
+
+      g_variant_get (entry, "(^&aytt@aay@aay)", &path, &mtime, &inode,
+                     &files, &subdirs);
+
+      dir = dir_entry_new (mtime, inode);
+
+      names = g_variant_get_bytestring_array (files, &n_names);
+      for (i = 0; i < n_names; i++)
+        g_ptr_array_add (dir->files, g_strdup (names[i]));
+      g_free (names);
+
+      names = g_variant_get_bytestring_array (subdirs, &n_names);
+      for (i = 0; i < n_names; i++)
+        g_ptr_array_add (dir->subdirs, g_strdup (names[i]));
+      g_free (names);
+
+      g_hash_table_insert (table, g_strdup (path), dir);
+
+      g_variant_unref (files);
+      g_variant_unref (subdirs);
+      g_variant_unref (entry);
+    }
+
+out:
+  g_variant_unref (entries);
+  g_variant_unref (cache);
+
+  return table;
+}
+
+static void
+_cache_save (const gchar *cache_file,
+             const gchar *root,
+             GHashTable  *table)
+{
+  GVariantBuilder entries;
+  GHashTableIter iter;
+  GError *error = NULL;
+  const gchar *path;
+  GVariant *cache;
+  DirEntry *dir;
+  gchar *dirname;
+
+  g_variant_builder_init (&entries, G_VARIANT_TYPE ("a(ayttaayaay)"));
+
+  g_hash_table_iter_init (&iter, table);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &path,
+                                 (gpointer *) &dir))
+    g_variant_builder_add (&entries, "(^aytt@aay@aay)",
+                           path,
+                           dir->mtime,
+                           dir->inode,
+                           g_variant_new_bytestring_array ((const gchar * const *)
+                                                           dir->files->pdata,
+                                                           dir->files->len),
+                           g_variant_new_bytestring_array ((const gchar * const *)
+                                                           dir->subdirs->pdata,
+                                                           dir->subdirs->len));
+
+  cache = g_variant_ref_sink (g_variant_new ("(u^aya(ayttaayaay))",
+                                             CACHE_VERSION, root, &entries));
+
+  dirname = g_path_get_dirname (cache_file);
+  g_mkdir_with_parents (dirname, 0755);
+  g_free (dirname);
+
+  if (!g_file_set_contents (cache_file, g_variant_get_data (cache),
+                            g_variant_get_size (cache), &error))
+    {
+      g_warning (G_STRLOC ": Could not save the library index: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+
+  g_variant_unref (cache);
+}
+
+static void
+scan_job_free (ScanJob *job)
+{
+  g_free (job->root);
+  g_free (job->cache_file);
+  if (job->previous)
+    g_hash_table_unref (job->previous);
+  if (job->dirty)
+    g_hash_table_unref (job->dirty);
+  if (job->result)
+    g_hash_table_unref (job->result);
+  if (job->added)
+    g_ptr_array_free (job->added, TRUE);
+  if (job->removed)
+    g_ptr_array_free (job->removed, TRUE);
+  g_slice_free (ScanJob, job);
+}
+
+static void
+scan_thread (GSimpleAsyncResult *res,
+             GObject            *object,
+             GCancellable       *cancellable)
+{
+  ScanJob *job = g_simple_async_result_get_op_res_gpointer (res);
+
+  if (!job->previous)
+    {
+      job->previous = _cache_load (job->cache_file, job->root);
+      job->initial = g_hash_table_size (job->previous) == 0;
+    }
+
+  job->result = dir_table_new ();
+  job->added = g_ptr_array_new_with_free_func (g_free);
+  job->removed = g_ptr_array_new_with_free_func (g_free);
+
+  _scan_directory (job, job->root, cancellable);
+
+  if (g_cancellable_is_cancelled (cancellable))
+    return;
+
+  /* the root itself went away */
+  if (!g_hash_table_lookup (job->result, job->root))
+    _remove_tree (job, job->root);
+
+  g_ptr_array_sort (job->added, _compare_names);
+  g_ptr_array_sort (job->removed, _compare_names);
+
+  if (job->n_read ||
+      g_hash_table_size (job->previous) != g_hash_table_size (job->result))
+    _cache_save (job->cache_file, job->root, job->result);
+}
+
+/*
+ * Back in the main thread
+ */
+
+static void
+monitor_changed_cb (GFileMonitor      *monitor,
+                    GFile             *file,
+                    GFile             *other_file,
+                    GFileMonitorEvent  event,
+                    MexLibraryIndex   *index);
+
+static void
+mex_library_index_update_monitors (MexLibraryIndex *index)
+{
+  MexLibraryIndexPrivate *priv = index->priv;
+  GHashTableIter iter;
+  GFileMonitor *monitor;
+  const gchar *path;
+
+  /* directories that went away */
+  g_hash_table_iter_init (&iter, priv->monitors);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &path,
+                                 (gpointer *) &monitor))
+    if (!g_hash_table_lookup (priv->directories, path))
+      g_hash_table_iter_remove (&iter);
+
+  /* and new ones */
+  g_hash_table_iter_init (&iter, priv->directories);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &path, NULL))
+    {
+      GFile *file;
+
+      if (g_hash_table_lookup (priv->monitors, path))
+        continue;
+
+      file = g_file_new_for_path (path);
+      monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE,
+                                          NULL, NULL);
+      g_object_unref (file);
+
+      if (!monitor)
+        continue;
+
+      g_object_set_data_full (G_OBJECT (monitor), "path", g_strdup (path),
+                              g_free);
+      g_signal_connect (monitor, "changed",
+                        G_CALLBACK (monitor_changed_cb), index);
+      g_hash_table_insert (priv->monitors, g_strdup (path), monitor);
+    }
+}
+
+static void
+scan_cb (GObject      *source,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  MexLibraryIndex *index = MEX_LIBRARY_INDEX (source);
+  MexLibraryIndexPrivate *priv = index->priv;
+  ScanJob *job;
+
+  job = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res));
+
+  priv->scanning = FALSE;
+
+  if (g_cancellable_is_cancelled (priv->cancellable))
+    return;
+
+  if (priv->directories)
+    g_hash_table_unref (priv->directories);
+  priv->directories = g_hash_table_ref (job->result);
+
+  mex_library_index_update_monitors (index);
+
+  priv->stats.n_directories = job->n_directories;
+  priv->stats.n_read = job->n_read;
+  priv->stats.n_added = job->added->len;
+  priv->stats.n_removed = job->removed->len;
+
+  if (!job->initial && (job->added->len || job->removed->len))
+    g_signal_emit (index, signals[CHANGED], 0, job->added, job->removed);
+
+  if (priv->rescan_pending)
+    {
+      priv->rescan_pending = FALSE;
+      mex_library_index_scan (index);
+    }
+}
+
+static void
+mex_library_index_scan (MexLibraryIndex *index)
+{
+  MexLibraryIndexPrivate *priv = index->priv;
+  GSimpleAsyncResult *res;
+  ScanJob *job;
+
+  if (priv->scanning)
+    {
+      priv->rescan_pending = TRUE;
+      return;
+    }
+
+  job = g_slice_new0 (ScanJob);
+  job->root = g_strdup (priv->root);
+  job->cache_file = g_strdup (priv->cache_file);
+  job->now = g_get_real_time ();
+  if (priv->directories)
+    job->previous = g_hash_table_ref (priv->directories);
+  if (g_hash_table_size (priv->dirty))
+    {
+      job->dirty = priv->dirty;
+      priv->dirty = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, NULL);
+    }
+
+  priv->scanning = TRUE;
+
+  res = g_simple_async_result_new (G_OBJECT (index), scan_cb, NULL,
+                                   mex_library_index_scan);
+  g_simple_async_result_set_op_res_gpointer (res, job,
+                                             (GDestroyNotify) scan_job_free);
+  g_simple_async_result_run_in_thread (res, scan_thread, G_PRIORITY_LOW,
+                                       priv->cancellable);
+  g_object_unref (res);
+}
+
+static gboolean
+rescan_timeout_cb (MexLibraryIndex *index)
+{
+  index->priv->rescan_id = 0;
+  mex_library_index_scan (index);
+
+  return FALSE;
+}
+
+static void
+monitor_changed_cb (GFileMonitor      *monitor,
+                    GFile             *file,
+                    GFile             *other_file,
+                    GFileMonitorEvent  event,
+                    MexLibraryIndex   *index)
+{
+  MexLibraryIndexPrivate *priv = index->priv;
+
+  /* only the entries coming and going matter */
+  if (event != G_FILE_MONITOR_EVENT_CREATED &&
+      event != G_FILE_MONITOR_EVENT_DELETED &&
+      event != G_FILE_MONITOR_EVENT_MOVED)
+    return;
+
+  g_hash_table_insert (priv->dirty,
+                       g_strdup (g_object_get_data (G_OBJECT (monitor),
+                                                    "path")),
+                       GINT_TO_POINTER (TRUE));
+
+  /* files are usually copied or removed a few at a time */
+  if (priv->rescan_id)
+    g_source_remove (priv->rescan_id);
+  priv->rescan_id = g_timeout_add_seconds (RESCAN_TIMEOUT,
+                                           (GSourceFunc) rescan_timeout_cb,
+                                           index);
+}
+
+static void
+_monitor_free (GFileMonitor *monitor)
+{
+  g_signal_handlers_disconnect_matched (monitor, G_SIGNAL_MATCH_FUNC,
+                                        0, 0, NULL, monitor_changed_cb, NULL);
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+/*
+ * GObject implementation
+ */
+
+static void
+mex_library_index_get_property (GObject    *object,
+                                guint       property_id,
+                                GValue     *value,
+                                GParamSpec *pspec)
+{
+  MexLibraryIndexPrivate *priv = MEX_LIBRARY_INDEX (object)->priv;
+
+  switch (property_id)
+    {
+    case PROP_ROOT:
+      g_value_set_string (value, priv->root);
+      break;
+
+    case PROP_CACHE_FILE:
+      g_value_set_string (value, priv->cache_file);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_library_index_set_property (GObject      *object,
+                                guint         property_id,
+                                const GValue *value,
+                                GParamSpec   *pspec)
+{
+  MexLibraryIndexPrivate *priv = MEX_LIBRARY_INDEX (object)->priv;
+
+  switch (property_id)
+    {
+    case PROP_ROOT:
+      priv->root = g_value_dup_string (value);
+      /* the paths given in "changed" are built from it */
+      while (priv->root && strlen (priv->root) > 1 &&
+             g_str_has_suffix (priv->root, G_DIR_SEPARATOR_S))
+        priv->root[strlen (priv->root) - 1] = '\0';
+      break;
+
+    case PROP_CACHE_FILE:
+      priv->cache_file = g_value_dup_string (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+mex_library_index_dispose (GObject *object)
+{
+  MexLibraryIndexPrivate *priv = MEX_LIBRARY_INDEX (object)->priv;
+
+  g_cancellable_cancel (priv->cancellable);
+
+  if (priv->rescan_id)
+    {
+      g_source_remove (priv->rescan_id);
+      priv->rescan_id = 0;
+    }
+
+  g_hash_table_remove_all (priv->monitors);
+
+  if (priv->directories)
+    {
+      g_hash_table_unref (priv->directories);
+      priv->directories = NULL;
+    }
+
+  G_OBJECT_CLASS (mex_library_index_parent_class)->dispose (object);
+}
+
+static void
+mex_library_index_finalize (GObject *object)
+{
+  MexLibraryIndexPrivate *priv = MEX_LIBRARY_INDEX (object)->priv;
+
+  g_free (priv->root);
+  g_free (priv->cache_file);
+  g_hash_table_unref (priv->monitors);
+  g_hash_table_unref (priv->dirty);
+  g_object_unref (priv->cancellable);
+
+  G_OBJECT_CLASS (mex_library_index_parent_class)->finalize (object);
+}
+
+static void
+mex_library_index_class_init (MexLibraryIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GParamSpec *pspec;
+
+  g_type_class_add_private (klass, sizeof (MexLibraryIndexPrivate));
+
+  object_class->get_property = mex_library_index_get_property;
+  object_class->set_property = mex_library_index_set_property;
+  object_class->dispose = mex_library_index_dispose;
+  object_class->finalize = mex_library_index_finalize;
+
+  pspec = g_param_spec_string ("root",
+                               "Root",
+                               "Directory whose tree is indexed",
+                               NULL,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                               G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_ROOT, pspec);
+
+  pspec = g_param_spec_string ("cache-file",
+                               "Cache file",
+                               "File the index is kept in between runs",
+                               NULL,
+                               G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY |
+                               G_PARAM_STATIC_STRINGS);
+  g_object_class_install_property (object_class, PROP_CACHE_FILE, pspec);
+
+  /**
+   * MexLibraryIndex::changed:
+   * @index: the #MexLibraryIndex
+   * @added: (element-type filename): the sorted paths of the files and
+   *   directories found by a scan
+   * @removed: (element-type filename): the sorted paths of the ones that
+   *   went away
+   *
+   * Emitted after a scan found changes in the tree.
+   */
+  signals[CHANGED] = g_signal_new ("changed",
+                                   G_TYPE_FROM_CLASS (klass),
+                                   G_SIGNAL_RUN_LAST,
+                                   0, NULL, NULL,
+                                   g_cclosure_marshal_generic,
+                                   G_TYPE_NONE, 2,
+                                   G_TYPE_POINTER,
+                                   G_TYPE_POINTER);
+}
+
+static void
+mex_library_index_init (MexLibraryIndex *self)
+{
+  MexLibraryIndexPrivate *priv;
+
+  priv = self->priv = GET_PRIVATE (self);
+
+  priv->monitors = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                          (GDestroyNotify) _monitor_free);
+  priv->dirty = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  priv->cancellable = g_cancellable_new ();
+}
+
+MexLibraryIndex *
+mex_library_index_new (const gchar *root,
+                       const gchar *cache_file)
+{
+  g_return_val_if_fail (root != NULL, NULL);
+  g_return_val_if_fail (cache_file != NULL, NULL);
+
+  return g_object_new (MEX_TYPE_LIBRARY_INDEX,
+                       "root", root,
+                       "cache-file", cache_file,
+                       NULL);
+}
+
+const gchar *
+mex_library_index_get_root (MexLibraryIndex *index)
+{
+  g_return_val_if_fail (MEX_IS_LIBRARY_INDEX (index), NULL);
+
+  return index->priv->root;
+}
+
+/**
+ * mex_library_index_start:
+ * @index: a #MexLibraryIndex
+ *
+ * Scans the tree in the background, starting from the cached index, and
+ * keeps watching it.
+ */
+void
+mex_library_index_start (MexLibraryIndex *index)
+{
+  g_return_if_fail (MEX_IS_LIBRARY_INDEX (index));
+
+  if (index->priv->started)
+    return;
+
+  index->priv->started = TRUE;
+  mex_library_index_scan (index);
+}
+
+/**
+ * mex_library_index_is_scanning:
+ * @index: a #MexLibraryIndex
+ *
+ * Returns: whether a scan is running or waiting for the changes being
+ *   made to calm down
+ */
+gboolean
+mex_library_index_is_scanning (MexLibraryIndex *index)
+{
+  g_return_val_if_fail (MEX_IS_LIBRARY_INDEX (index), FALSE);
+
+  return index->priv->scanning || index->priv->rescan_id;
+}
+
+void
+mex_library_index_get_stats (MexLibraryIndex      *index,
+                             MexLibraryIndexStats *stats)
+{
+  g_return_if_fail (MEX_IS_LIBRARY_INDEX (index));
+  g_return_if_fail (stats != NULL);
+
+  *stats = index->priv->stats;
+}
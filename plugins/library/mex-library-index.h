@@ -0,0 +1,85 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef _MEX_LIBRARY_INDEX
+#define _MEX_LIBRARY_INDEX
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_LIBRARY_INDEX mex_library_index_get_type()
+
+#define MEX_LIBRARY_INDEX(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj), MEX_TYPE_LIBRARY_INDEX, MexLibraryIndex))
+
+#define MEX_LIBRARY_INDEX_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST ((klass), MEX_TYPE_LIBRARY_INDEX, MexLibraryIndexClass))
+
+#define MEX_IS_LIBRARY_INDEX(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj), MEX_TYPE_LIBRARY_INDEX))
+
+#define MEX_IS_LIBRARY_INDEX_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass), MEX_TYPE_LIBRARY_INDEX))
+
+#define MEX_LIBRARY_INDEX_GET_CLASS(obj) \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj), MEX_TYPE_LIBRARY_INDEX, MexLibraryIndexClass))
+
+typedef struct _MexLibraryIndexPrivate MexLibraryIndexPrivate;
+
+typedef struct {
+  GObject parent;
+  MexLibraryIndexPrivate *priv;
+} MexLibraryIndex;
+
+typedef struct {
+  GObjectClass parent_class;
+} MexLibraryIndexClass;
+
+/**
+ * MexLibraryIndexStats:
+ * @n_directories: the directories looked at by the last scan
+ * @n_read: the ones that had changed and were read again
+ * @n_added: the files and directories found by the last scan
+ * @n_removed: the files and directories that went away
+ *
+ * What the last scan of a #MexLibraryIndex did.
+ */
+typedef struct {
+  guint n_directories;
+  guint n_read;
+  guint n_added;
+  guint n_removed;
+} MexLibraryIndexStats;
+
+GType             mex_library_index_get_type     (void);
+
+MexLibraryIndex * mex_library_index_new          (const gchar          *root,
+                                                  const gchar          *cache_file);
+
+const gchar *     mex_library_index_get_root     (MexLibraryIndex      *index);
+
+void              mex_library_index_start        (MexLibraryIndex      *index);
+gboolean          mex_library_index_is_scanning  (MexLibraryIndex      *index);
+
+void              mex_library_index_get_stats    (MexLibraryIndex      *index,
+                                                  MexLibraryIndexStats *stats);
+
+G_END_DECLS
+
+#endif /* _MEX_LIBRARY_INDEX */
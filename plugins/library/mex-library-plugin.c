@@ -21,11 +21,16 @@
 #endif
 
 #include "mex-library-plugin.h"
+#include "mex-library-index.h"
 #include <mex/mex-grilo-feed.h>
 
 #include <glib/gi18n.h>
 
 static void mex_model_provider_iface_init (MexModelProviderInterface *iface);
+static void index_changed_cb (MexLibraryIndex *index,
+                              GPtrArray       *added,
+                              GPtrArray       *removed,
+                              MexGriloFeed    *feed);
 
 G_DEFINE_TYPE_WITH_CODE (MexLibraryPlugin, mex_library_plugin,
                          G_TYPE_OBJECT,
@@ -38,6 +43,7 @@ G_DEFINE_TYPE_WITH_CODE (MexLibraryPlugin, mex_library_plugin,
 struct _MexLibraryPluginPrivate
 {
   GList *models;
+  GList *indexes;
 };
 
 
@@ -46,6 +52,15 @@ mex_library_plugin_dispose (GObject *object)
 {
   MexLibraryPluginPrivate *priv = MEX_LIBRARY_PLUGIN (object)->priv;
 
+  while (priv->indexes)
+    {
+      g_signal_handlers_disconnect_matched (priv->indexes->data,
+                                            G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
+                                            index_changed_cb, NULL);
+      g_object_unref (priv->indexes->data);
+      priv->indexes = g_list_delete_link (priv->indexes, priv->indexes);
+    }
+
   while (priv->models)
     {
       g_object_unref (priv->models->data);
@@ -123,6 +138,183 @@ mex_library_plugin_get_box_for_path (GrlSource   *source,
   return box;
 }
 
+/*
+ * The feeds only show the top of their folder, grl-filesystem does not tell
+ * us when it changes. A MexLibraryIndex watches each folder and what comes
+ * and goes at its top is added to or removed from its feed.
+ */
+
+typedef struct
+{
+  MexGriloFeed *feed;
+  GPtrArray    *medias;
+  guint         pending;
+} AddClosure;
+
+static void
+mex_library_plugin_update_feed (MexGriloFeed        *feed,
+                                GPtrArray           *medias,
+                                GrlSourceChangeType  change_type)
+{
+  GrlSource *source = NULL;
+
+  g_object_get (feed, "grilo-source", &source, NULL);
+  if (!source)
+    return;
+
+  /* in one go, the feed batches the additions */
+  MEX_GRILO_FEED_GET_CLASS (feed)->content_updated (source, medias,
+                                                    change_type, FALSE, feed);
+  g_object_unref (source);
+}
+
+static void
+media_from_uri_cb (GrlSource    *source,
+                   guint         operation_id,
+                   GrlMedia     *media,
+                   gpointer      user_data,
+                   const GError *error)
+{
+  AddClosure *closure = user_data;
+
+  /* no media for the files grl-filesystem does not show */
+  if (media)
+    g_ptr_array_add (closure->medias, media);
+
+  if (--closure->pending)
+    return;
+
+  if (closure->medias->len)
+    mex_library_plugin_update_feed (closure->feed, closure->medias,
+                                    GRL_CONTENT_ADDED);
+
+  g_ptr_array_free (closure->medias, TRUE);
+  g_object_unref (closure->feed);
+  g_slice_free (AddClosure, closure);
+}
+
+static void
+index_changed_cb (MexLibraryIndex *index,
+                  GPtrArray       *added,
+                  GPtrArray       *removed,
+                  MexGriloFeed    *feed)
+{
+  const gchar *root = mex_library_index_get_root (index);
+  GrlOperationOptions *options;
+  GHashTable *removed_uris;
+  AddClosure *closure;
+  GrlSource *source;
+  GList *keys;
+  guint i, length;
+
+  removed_uris = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (i = 0; i < removed->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (removed, i);
+      gchar *dirname = g_path_get_dirname (path);
+      gchar *uri;
+
+      if (g_str_equal (dirname, root) &&
+          (uri = g_filename_to_uri (path, NULL, NULL)))
+        g_hash_table_insert (removed_uris, uri, GINT_TO_POINTER (TRUE));
+      g_free (dirname);
+    }
+
+  if (g_hash_table_size (removed_uris))
+    {
+      GPtrArray *medias = g_ptr_array_new_with_free_func (g_object_unref);
+
+      length = mex_model_get_length (MEX_MODEL (feed));
+      for (i = 0; i < length; i++)
+        {
+          MexContent *content = mex_model_get_content (MEX_MODEL (feed), i);
+          const gchar *uri =
+            mex_content_get_metadata (content, MEX_CONTENT_METADATA_STREAM);
+          GrlMedia *media;
+
+          if (!uri || !g_hash_table_lookup (removed_uris, uri))
+            continue;
+
+          media = mex_grilo_program_get_grilo_media (MEX_GRILO_PROGRAM (content));
+          g_ptr_array_add (medias, g_object_ref (media));
+        }
+
+      if (medias->len)
+        mex_library_plugin_update_feed (feed, medias, GRL_CONTENT_REMOVED);
+      g_ptr_array_free (medias, TRUE);
+    }
+  g_hash_table_unref (removed_uris);
+
+  g_object_get (feed,
+                "grilo-source", &source,
+                "grilo-query-keys", &keys,
+                NULL);
+  if (!source)
+    return;
+
+  closure = g_slice_new0 (AddClosure);
+  closure->feed = g_object_ref (feed);
+  closure->medias = g_ptr_array_new_with_free_func (g_object_unref);
+  closure->pending = 1;
+
+  options = grl_operation_options_new (NULL);
+  for (i = 0; i < added->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (added, i);
+      gchar *dirname = g_path_get_dirname (path);
+      gchar *uri;
+
+      if (g_str_equal (dirname, root) &&
+          (uri = g_filename_to_uri (path, NULL, NULL)))
+        {
+          closure->pending++;
+          grl_source_get_media_from_uri (source, uri, keys, options,
+                                         media_from_uri_cb, closure);
+          g_free (uri);
+        }
+      g_free (dirname);
+    }
+  g_object_unref (options);
+
+  /* drop the reference that kept the closure alive while queuing */
+  media_from_uri_cb (source, 0, NULL, closure, NULL);
+
+  g_list_free (keys);
+  g_object_unref (source);
+}
+
+/* the folders are browsed again on every start, show what they held last
+ * time until the browse completes, then follow their changes */
+static void
+mex_library_plugin_track_feed (MexLibraryPlugin *self,
+                               MexFeed          *feed,
+                               GrlSource        *source,
+                               const gchar      *category,
+                               const gchar      *path)
+{
+  MexLibraryPluginPrivate *priv = self->priv;
+  gchar *name, *filename;
+  MexLibraryIndex *index;
+
+  name = g_strconcat (category, path, NULL);
+
+  filename = mex_grilo_feed_build_snapshot_filename (source, name);
+  g_object_set (feed, "snapshot", filename, NULL);
+  g_free (filename);
+
+  g_strcanon (name, G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS "-_.", '_');
+  filename = g_build_filename (g_get_user_cache_dir (), "mex", "library",
+                               name, NULL);
+  index = mex_library_index_new (path, filename);
+  g_free (filename);
+
+  g_signal_connect (index, "changed", G_CALLBACK (index_changed_cb), feed);
+  mex_library_index_start (index);
+  priv->indexes = g_list_prepend (priv->indexes, index);
+
+  g_free (name);
+}
+
 static void
 mex_library_plugin_init (MexLibraryPlugin *self)
 {
@@ -201,6 +393,8 @@ mex_library_plugin_init (MexLibraryPlugin *self)
                   g_object_set (feed, "icon-name", "icon-library",
                                 "placeholder-text", "No videos found",
                                 "category", "videos", NULL);
+                  mex_library_plugin_track_feed (self, feed, source, "videos",
+                                                 paths[i]);
 
                   mex_grilo_feed_browse (MEX_GRILO_FEED (feed), 0, G_MAXINT);
 
@@ -259,6 +453,8 @@ mex_library_plugin_init (MexLibraryPlugin *self)
                   g_object_set (feed, "icon-name", "icon-library",
                                 "placeholder-text", "No pictures found",
                                 "category", "pictures", NULL);
+                  mex_library_plugin_track_feed (self, feed, source, "pictures",
+                                                 paths[i]);
 
                   mex_grilo_feed_browse (MEX_GRILO_FEED (feed), 0, G_MAXINT);
 
@@ -318,6 +514,8 @@ mex_library_plugin_init (MexLibraryPlugin *self)
                   g_object_set (feed, "icon-name", "icon-library",
                                 "placeholder-text", "No Music found",
                                 "category", "music", NULL);
+                  mex_library_plugin_track_feed (self, feed, source, "music",
+                                                 paths[i]);
 
                   mex_grilo_feed_browse (MEX_GRILO_FEED (feed), 0, G_MAXINT);
 
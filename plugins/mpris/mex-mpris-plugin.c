@@ -26,6 +26,7 @@
 #endif
 
 #include "mex-mpris-plugin.h"
+#include "mex-mpris-properties.h"
 #include "mpris-spec.h"
 
 #include <string.h>
@@ -47,6 +48,13 @@ struct _MexMprisPluginPrivate
   GDBusConnection *connection;
   GDBusNodeInfo *introspection_data;
   gchar **mimes_supported;
+
+  /* the values of the Player properties, Position apart */
+  MexMprisProperties *properties;
+
+  MexContent *track;
+  guint track_serial;
+  gchar *track_id;
 };
 
 static void
@@ -57,6 +65,12 @@ mex_mpris_plugin_finalize (GObject *object)
   if (priv->connection)
     g_object_unref (priv->connection);
 
+  g_object_unref (priv->properties);
+
+  if (priv->track)
+    g_object_unref (priv->track);
+  g_free (priv->track_id);
+
   g_dbus_node_info_unref (priv->introspection_data);
 
   if (priv->mimes_supported)
@@ -186,72 +200,121 @@ _set_player_property_cb (GDBusConnection  *connection,
 }
 
 
-static GVariant *
-_get_player_property_cb (GDBusConnection  *connection,
-                         const gchar      *sender,
-                         const gchar      *object_path,
-                         const gchar      *interface_name,
-                         const gchar      *property_name,
-                         GError          **error,
-                         gpointer          user_data)
+static ClutterMedia *
+_get_active_media (MexMprisPlugin *self)
 {
-  MexMprisPluginPrivate *priv = MEX_MPRIS_PLUGIN (user_data)->priv;
-  ClutterMedia *media;
-  GVariant *v = NULL;
+  MexMprisPluginPrivate *priv = MEX_MPRIS_PLUGIN (self)->priv;
 
   if (mex_music_player_is_playing (priv->music))
-    media = mex_music_player_get_clutter_media (priv->music);
+    return mex_music_player_get_clutter_media (priv->music);
   else
-    media = mex_player_get_clutter_media (priv->player);
+    return mex_player_get_clutter_media (priv->player);
+}
 
-  if (g_strcmp0 ("PlaybackStatus", property_name) == 0)
+static MexContent *
+_get_active_content (MexMprisPlugin *self)
+{
+  MexMprisPluginPrivate *priv = MEX_MPRIS_PLUGIN (self)->priv;
+
+  if (mex_music_player_is_playing (priv->music))
+    return mex_content_view_get_content (MEX_CONTENT_VIEW (priv->music));
+  else
+    return mex_content_view_get_content (MEX_CONTENT_VIEW (priv->player));
+}
+
+static void
+_update_status (MexMprisPlugin *self)
+{
+  MexMprisPluginPrivate *priv = MEX_MPRIS_PLUGIN (self)->priv;
+  ClutterMedia *media = _get_active_media (self);
+  const gchar *status;
+
+  /* Doesn't map to ClutterMedia straight away so try to emulate.
+   * Playback could theoretically be paused at progress 0.0 but well ...*/
+  if (clutter_media_get_playing (media))
+    status = "Playing";
+  else if (clutter_media_get_progress (media) != 0)
+    status = "Paused";
+  else
+    status = "Stopped";
+
+  mex_mpris_properties_set (priv->properties, "PlaybackStatus",
+                            g_variant_new_string (status));
+  mex_mpris_properties_set (priv->properties, "Volume",
+                            g_variant_new_double (clutter_media_get_audio_volume (media)));
+  mex_mpris_properties_set (priv->properties, "CanSeek",
+                            g_variant_new_boolean (clutter_media_get_can_seek (media)));
+}
+
+static void
+_update_metadata (MexMprisPlugin *self)
+{
+  MexMprisPluginPrivate *priv = MEX_MPRIS_PLUGIN (self)->priv;
+  ClutterMedia *media = _get_active_media (self);
+  MexContent *content = _get_active_content (self);
+  gint64 length;
+
+  /* a new track id each time the content changes, even to one played
+   * before, that is how clients know they need to refresh */
+  if (content != priv->track)
     {
-      /* Doesn't map to ClutterMedia straight away so try to emulate.
-       * Playback could theoretically be paused at progress 0.0 but well ...*/
-      gdouble progress = clutter_media_get_progress (media);
-      gboolean playing = clutter_media_get_playing (media);
-
-      if (playing)
-          v = g_variant_new_string ("Playing");
-      else if (progress != 0)
-          v = g_variant_new_string ("Paused");
-       else
-          v = g_variant_new_string ("Stopped");
+      if (priv->track)
+        g_object_unref (priv->track);
+      priv->track = content ? g_object_ref (content) : NULL;
+
+      g_free (priv->track_id);
+      if (content)
+        priv->track_id = g_strdup_printf (MEX_MPRIS_TRACK_PATH "/%u",
+                                          ++priv->track_serial);
+      else
+        priv->track_id = g_strdup (MEX_MPRIS_NO_TRACK);
     }
 
-  else if (g_strcmp0 ("LoopStatus", property_name) == 0)
-    v = g_variant_new_string ("None");
+  length = clutter_media_get_duration (media) * G_USEC_PER_SEC;
 
-  else if (g_strcmp0 ("Rate", property_name) == 0 ||
-           g_strcmp0 ("MinimumRate", property_name)  == 0 ||
-           g_strcmp0 ("MinimumRate", property_name) == 0 )
-    v = g_variant_new_double (1.0);
+  mex_mpris_properties_set (priv->properties, "Metadata",
+                            mex_mpris_metadata_new (content, priv->track_id,
+                                                    length));
+}
 
-  else if (g_strcmp0 ("Shuffle", property_name) == 0)
-    v = g_variant_new_boolean (FALSE);
+static void
+_media_notify_cb (ClutterMedia   *media,
+                  GParamSpec     *pspec,
+                  MexMprisPlugin *self)
+{
+  /* progress notifications come several times a second, only the status
+   * can change with them */
+  if (!g_str_equal (pspec->name, "progress"))
+    _update_metadata (self);
 
-  else if (g_strcmp0 ("Volume", property_name) == 0)
-    v = g_variant_new_double (clutter_media_get_audio_volume (media));
+  _update_status (self);
+}
+
+static GVariant *
+_get_player_property_cb (GDBusConnection  *connection,
+                         const gchar      *sender,
+                         const gchar      *object_path,
+                         const gchar      *interface_name,
+                         const gchar      *property_name,
+                         GError          **error,
+                         gpointer          user_data)
+{
+  MexMprisPluginPrivate *priv = MEX_MPRIS_PLUGIN (user_data)->priv;
+  GVariant *v;
 
-  else if (g_strcmp0 ("Position", property_name) == 0)
+  /* Position changes all the time and is never signalled, so it is the
+   * only property worked out on demand */
+  if (g_strcmp0 ("Position", property_name) == 0)
     {
+      ClutterMedia *media = _get_active_media (MEX_MPRIS_PLUGIN (user_data));
       gdouble duration_s = clutter_media_get_duration (media);
       gdouble progress_rel = clutter_media_get_progress (media);
-      gint64 position_ms = duration_s * 1000000 * progress_rel;
-      v = g_variant_new_int64 (position_ms);
-    }
-
-  else if (g_strcmp0 ("CanGoNext", property_name) == 0 ||
-           g_strcmp0 ("CanGoPrevious", property_name) == 0 ||
-           g_strcmp0 ("CanPlay", property_name) == 0 ||
-           g_strcmp0 ("CanControl", property_name) == 0 ||
-           g_strcmp0 ("CanPause", property_name) == 0)
-    v = g_variant_new_boolean (TRUE);
+      gint64 position_us = duration_s * 1000000 * progress_rel;
 
-  else if (g_strcmp0 ("CanSeek", property_name) == 0)
-    v = g_variant_new_boolean (clutter_media_get_can_seek (media));
+      return g_variant_new_int64 (position_us);
+    }
 
-  if (v)
+  if ((v = mex_mpris_properties_get (priv->properties, property_name)))
     return v;
 
   g_set_error (error,
@@ -384,6 +447,23 @@ _player_method_cb (GDBusConnection       *connection,
      else
        mex_player_quit (priv->player);
    }
+ else if (g_strcmp0 (method_name, "SetPosition") == 0)
+   {
+     ClutterMedia *media = _get_active_media (self);
+     const gchar *track_id;
+     gdouble duration;
+     gint64 position;
+
+     g_variant_get (parameters, "(&ox)", &track_id, &position);
+     duration = clutter_media_get_duration (media);
+
+     /* requests for a track that is not playing any more are ignored */
+     if (g_strcmp0 (track_id, priv->track_id) == 0 &&
+         position >= 0 && duration > 0 &&
+         position <= duration * G_USEC_PER_SEC)
+       clutter_media_set_progress (media,
+                                   position / (duration * G_USEC_PER_SEC));
+   }
  else
      g_message ("Unhandled MPRIS Player method %s", method_name);
 
@@ -439,6 +519,9 @@ on_bus_acquired (GObject      *source_object,
                                      NULL,
                                      &error);
 
+  mex_mpris_properties_export (priv->properties, priv->connection,
+                               MPRIS_OBJECT_NAME);
+
   if (error)
     {
       g_warning ("Problem registering object: %s", error->message);
@@ -453,23 +536,62 @@ mex_mpris_plugin_init (MexMprisPlugin *self)
     MPRIS_PLUGIN_PRIVATE (self);
 
   GError *error=NULL;
-  ClutterMedia *media;
+  ClutterMedia *medias[2];
+  guint i;
 
   priv->player = mex_player_get_default ();
-  media = mex_player_get_clutter_media (priv->player);
-
-  g_signal_connect (media,
-                    "notify::in-seek",
-                    G_CALLBACK (_check_if_seeked),
-                    self);
-
   priv->music = mex_music_player_get_default ();
-  media = mex_music_player_get_clutter_media (priv->music);
 
-  g_signal_connect (media,
-                    "notify::in-seek",
-                    G_CALLBACK (_check_if_seeked),
-                    self);
+  priv->properties = mex_mpris_properties_new (MPRIS_PLAYER_INTERFACE);
+
+  /* properties that never change */
+  mex_mpris_properties_set (priv->properties, "LoopStatus",
+                            g_variant_new_string ("None"));
+  mex_mpris_properties_set (priv->properties, "Shuffle",
+                            g_variant_new_boolean (FALSE));
+  mex_mpris_properties_set (priv->properties, "Rate",
+                            g_variant_new_double (1.0));
+  mex_mpris_properties_set (priv->properties, "MinimumRate",
+                            g_variant_new_double (1.0));
+  mex_mpris_properties_set (priv->properties, "MaximumRate",
+                            g_variant_new_double (1.0));
+  mex_mpris_properties_set (priv->properties, "CanGoNext",
+                            g_variant_new_boolean (TRUE));
+  mex_mpris_properties_set (priv->properties, "CanGoPrevious",
+                            g_variant_new_boolean (TRUE));
+  mex_mpris_properties_set (priv->properties, "CanPlay",
+                            g_variant_new_boolean (TRUE));
+  mex_mpris_properties_set (priv->properties, "CanPause",
+                            g_variant_new_boolean (TRUE));
+  mex_mpris_properties_set (priv->properties, "CanControl",
+                            g_variant_new_boolean (TRUE));
+
+  medias[0] = mex_player_get_clutter_media (priv->player);
+  medias[1] = mex_music_player_get_clutter_media (priv->music);
+
+  for (i = 0; i < G_N_ELEMENTS (medias); i++)
+    {
+      g_signal_connect (medias[i],
+                        "notify::in-seek",
+                        G_CALLBACK (_check_if_seeked),
+                        self);
+
+      g_signal_connect (medias[i], "notify::playing",
+                        G_CALLBACK (_media_notify_cb), self);
+      g_signal_connect (medias[i], "notify::progress",
+                        G_CALLBACK (_media_notify_cb), self);
+      g_signal_connect (medias[i], "notify::uri",
+                        G_CALLBACK (_media_notify_cb), self);
+      g_signal_connect (medias[i], "notify::duration",
+                        G_CALLBACK (_media_notify_cb), self);
+      g_signal_connect (medias[i], "notify::audio-volume",
+                        G_CALLBACK (_media_notify_cb), self);
+      g_signal_connect (medias[i], "notify::can-seek",
+                        G_CALLBACK (_media_notify_cb), self);
+    }
+
+  _update_metadata (self);
+  _update_status (self);
 
   g_bus_own_name (G_BUS_TYPE_SESSION,
                   MPRIS_BUS_NAME_PREFIX ".media-explorer",
@@ -0,0 +1,346 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2012 sleep(5) Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "mex-mpris-properties.h"
+
+/*
+ * The values of the properties of an MPRIS interface, as last computed by
+ * the player. Get requests are answered from here, and setting a value that
+ * differs from the cached one queues the property for the next
+ * org.freedesktop.DBus.Properties.PropertiesChanged signal. The changes of
+ * MEX_MPRIS_PROPERTIES_DELAY ms are sent in one signal, so that changing
+ * track, which updates the metadata, the status and whether the stream can
+ * seek one after the other, only wakes up the listeners once.
+ */
+
+G_DEFINE_TYPE (MexMprisProperties, mex_mpris_properties, G_TYPE_OBJECT)
+
+#define MPRIS_PROPERTIES_PRIVATE(o)                         \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o),                        \
+                                MEX_TYPE_MPRIS_PROPERTIES,  \
+                                MexMprisPropertiesPrivate))
+
+struct _MexMprisPropertiesPrivate
+{
+  gchar *interface_name;
+
+  GDBusConnection *connection;
+  gchar           *object_path;
+
+  GHashTable *values;     /* name -> GVariant */
+  GHashTable *changed;    /* names to signal */
+  guint       flush_id;
+};
+
+static void
+mex_mpris_properties_finalize (GObject *object)
+{
+  MexMprisPropertiesPrivate *priv = MEX_MPRIS_PROPERTIES (object)->priv;
+
+  if (priv->flush_id)
+    g_source_remove (priv->flush_id);
+
+  if (priv->connection)
+    g_object_unref (priv->connection);
+
+  g_hash_table_unref (priv->changed);
+  g_hash_table_unref (priv->values);
+  g_free (priv->object_path);
+  g_free (priv->interface_name);
+
+  G_OBJECT_CLASS (mex_mpris_properties_parent_class)->finalize (object);
+}
+
+static void
+mex_mpris_properties_class_init (MexMprisPropertiesClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MexMprisPropertiesPrivate));
+
+  object_class->finalize = mex_mpris_properties_finalize;
+}
+
+static void
+mex_mpris_properties_init (MexMprisProperties *self)
+{
+  MexMprisPropertiesPrivate *priv = self->priv = MPRIS_PROPERTIES_PRIVATE (self);
+
+  priv->values = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free,
+                                        (GDestroyNotify) g_variant_unref);
+  priv->changed = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, NULL);
+}
+
+/**
+ * mex_mpris_properties_new:
+ * @interface_name: the D-Bus interface the properties belong to
+ *
+ * Returns: a new, empty, #MexMprisProperties
+ */
+MexMprisProperties *
+mex_mpris_properties_new (const gchar *interface_name)
+{
+  MexMprisProperties *properties;
+
+  g_return_val_if_fail (interface_name != NULL, NULL);
+
+  properties = g_object_new (MEX_TYPE_MPRIS_PROPERTIES, NULL);
+  properties->priv->interface_name = g_strdup (interface_name);
+
+  return properties;
+}
+
+/**
+ * mex_mpris_properties_export:
+ * @properties: a #MexMprisProperties
+ * @connection: the connection to signal the changes on
+ * @object_path: the object the properties are on
+ *
+ * Starts signalling the changes of @properties. The values set before do
+ * not need signalling, nobody could have read them.
+ */
+void
+mex_mpris_properties_export (MexMprisProperties *properties,
+                             GDBusConnection    *connection,
+                             const gchar        *object_path)
+{
+  MexMprisPropertiesPrivate *priv;
+
+  g_return_if_fail (MEX_IS_MPRIS_PROPERTIES (properties));
+  g_return_if_fail (G_IS_DBUS_CONNECTION (connection));
+  g_return_if_fail (g_variant_is_object_path (object_path));
+
+  priv = properties->priv;
+
+  if (priv->connection)
+    g_object_unref (priv->connection);
+  priv->connection = g_object_ref (connection);
+
+  g_free (priv->object_path);
+  priv->object_path = g_strdup (object_path);
+
+  g_hash_table_remove_all (priv->changed);
+}
+
+static gboolean
+mex_mpris_properties_flush_cb (MexMprisProperties *properties)
+{
+  properties->priv->flush_id = 0;
+  mex_mpris_properties_flush (properties);
+
+  return FALSE;
+}
+
+/**
+ * mex_mpris_properties_set:
+ * @properties: a #MexMprisProperties
+ * @name: the name of the property
+ * @value: (transfer floating): the new value of @name
+ *
+ * Caches @value and, if it is not the value @name already had, queues
+ * @name for the next PropertiesChanged signal.
+ */
+void
+mex_mpris_properties_set (MexMprisProperties *properties,
+                          const gchar        *name,
+                          GVariant           *value)
+{
+  MexMprisPropertiesPrivate *priv;
+  GVariant *old_value;
+
+  g_return_if_fail (MEX_IS_MPRIS_PROPERTIES (properties));
+  g_return_if_fail (name != NULL);
+  g_return_if_fail (value != NULL);
+
+  priv = properties->priv;
+
+  g_variant_ref_sink (value);
+
+  old_value = g_hash_table_lookup (priv->values, name);
+  if (old_value && g_variant_equal (old_value, value))
+    {
+      g_variant_unref (value);
+      return;
+    }
+
+  g_hash_table_insert (priv->values, g_strdup (name), value);
+
+  if (priv->connection == NULL)
+    return;
+
+  if (!g_hash_table_lookup_extended (priv->changed, name, NULL, NULL))
+    g_hash_table_insert (priv->changed, g_strdup (name), NULL);
+
+  if (priv->flush_id == 0)
+    priv->flush_id =
+      g_timeout_add (MEX_MPRIS_PROPERTIES_DELAY,
+                     (GSourceFunc) mex_mpris_properties_flush_cb,
+                     properties);
+}
+
+/**
+ * mex_mpris_properties_get:
+ * @properties: a #MexMprisProperties
+ * @name: the name of the property
+ *
+ * Returns: (transfer full): the cached value of @name, or %NULL
+ */
+GVariant *
+mex_mpris_properties_get (MexMprisProperties *properties,
+                          const gchar        *name)
+{
+  GVariant *value;
+
+  g_return_val_if_fail (MEX_IS_MPRIS_PROPERTIES (properties), NULL);
+
+  value = g_hash_table_lookup (properties->priv->values, name);
+
+  return value ? g_variant_ref (value) : NULL;
+}
+
+/**
+ * mex_mpris_properties_flush:
+ * @properties: a #MexMprisProperties
+ *
+ * Emits the PropertiesChanged signal for the queued changes now.
+ */
+void
+mex_mpris_properties_flush (MexMprisProperties *properties)
+{
+  MexMprisPropertiesPrivate *priv;
+  GVariantBuilder changed;
+  GHashTableIter iter;
+  GError *error = NULL;
+  gpointer name;
+
+  g_return_if_fail (MEX_IS_MPRIS_PROPERTIES (properties));
+
+  priv = properties->priv;
+
+  if (priv->flush_id)
+    {
+      g_source_remove (priv->flush_id);
+      priv->flush_id = 0;
+    }
+
+  if (priv->connection == NULL || g_hash_table_size (priv->changed) == 0)
+    return;
+
+  g_variant_builder_init (&changed, G_VARIANT_TYPE ("a{sv}"));
+
+  g_hash_table_iter_init (&iter, priv->changed);
+  while (g_hash_table_iter_next (&iter, &name, NULL))
+    g_variant_builder_add (&changed, "{sv}", name,
+                           g_hash_table_lookup (priv->values, name));
+
+  g_hash_table_remove_all (priv->changed);
+
+  if (!g_dbus_connection_emit_signal (priv->connection, NULL,
+                                      priv->object_path,
+                                      "org.freedesktop.DBus.Properties",
+                                      "PropertiesChanged",
+                                      g_variant_new ("(sa{sv}as)",
+                                                     priv->interface_name,
+                                                     &changed, NULL),
+                                      &error))
+    {
+      g_warning ("Could not signal the changed properties: %s",
+                 error->message);
+      g_clear_error (&error);
+    }
+}
+
+static void
+add_string (GVariantBuilder    *builder,
+            const gchar        *key,
+            MexContent         *content,
+            MexContentMetadata  metadata)
+{
+  const gchar *value;
+
+  value = mex_content_get_metadata (content, metadata);
+
+  if (value && *value)
+    g_variant_builder_add (builder, "{sv}", key, g_variant_new_string (value));
+}
+
+/**
+ * mex_mpris_metadata_new:
+ * @content: (allow-none): the content being played
+ * @track_id: the D-Bus object path naming the track
+ * @length: the length of the track in µs, or 0 to use the duration of
+ *   @content
+ *
+ * Builds the value of the Metadata property of the MPRIS player.
+ *
+ * Returns: (transfer floating): an a{sv} #GVariant
+ */
+GVariant *
+mex_mpris_metadata_new (MexContent  *content,
+                        const gchar *track_id,
+                        gint64       length)
+{
+  GVariantBuilder builder;
+  const gchar *artist, *duration;
+
+  g_return_val_if_fail (g_variant_is_object_path (track_id), NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&builder, "{sv}", "mpris:trackid",
+                         g_variant_new_object_path (track_id));
+
+  if (content == NULL)
+    return g_variant_builder_end (&builder);
+
+  if (length <= 0)
+    {
+      duration = mex_content_get_metadata (content,
+                                           MEX_CONTENT_METADATA_DURATION);
+      if (duration)
+        length = (gint64) atoi (duration) * G_USEC_PER_SEC;
+    }
+
+  if (length > 0)
+    g_variant_builder_add (&builder, "{sv}", "mpris:length",
+                           g_variant_new_int64 (length));
+
+  add_string (&builder, "xesam:title", content, MEX_CONTENT_METADATA_TITLE);
+  add_string (&builder, "xesam:album", content, MEX_CONTENT_METADATA_ALBUM);
+  add_string (&builder, "mpris:artUrl", content, MEX_CONTENT_METADATA_STILL);
+  add_string (&builder, "xesam:url", content, MEX_CONTENT_METADATA_STREAM);
+
+  /* artists are a list in xesam, mex only knows of one */
+  artist = mex_content_get_metadata (content, MEX_CONTENT_METADATA_ARTIST);
+  if (artist && *artist)
+    {
+      const gchar *artists[] = { artist, NULL };
+
+      g_variant_builder_add (&builder, "{sv}", "xesam:artist",
+                             g_variant_new_strv (artists, -1));
+    }
+
+  return g_variant_builder_end (&builder);
+}
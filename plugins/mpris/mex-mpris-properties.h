@@ -0,0 +1,95 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2012 sleep(5) Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __MEX_MPRIS_PROPERTIES_H__
+#define __MEX_MPRIS_PROPERTIES_H__
+
+#include <gio/gio.h>
+#include <mex/mex-content.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_MPRIS_PROPERTIES mex_mpris_properties_get_type()
+
+#define MEX_MPRIS_PROPERTIES(obj)                                       \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                   \
+                               MEX_TYPE_MPRIS_PROPERTIES, MexMprisProperties))
+
+#define MEX_MPRIS_PROPERTIES_CLASS(klass)                               \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            MEX_TYPE_MPRIS_PROPERTIES, MexMprisPropertiesClass))
+
+#define MEX_IS_MPRIS_PROPERTIES(obj)              \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),             \
+                               MEX_TYPE_MPRIS_PROPERTIES))
+
+#define MEX_IS_MPRIS_PROPERTIES_CLASS(klass)   \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),           \
+                            MEX_TYPE_MPRIS_PROPERTIES))
+
+#define MEX_MPRIS_PROPERTIES_GET_CLASS(obj)                             \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                    \
+                              MEX_TYPE_MPRIS_PROPERTIES, MexMprisPropertiesClass))
+
+/* how long changes are gathered before PropertiesChanged is emitted, in ms */
+#define MEX_MPRIS_PROPERTIES_DELAY 100
+
+#define MEX_MPRIS_NO_TRACK "/org/mpris/MediaPlayer2/TrackList/NoTrack"
+
+/* MPRIS reserves /org/mpris, the track ids are made under our own path */
+#define MEX_MPRIS_TRACK_PATH "/org/MediaExplorer/Track"
+
+typedef struct _MexMprisProperties MexMprisProperties;
+typedef struct _MexMprisPropertiesClass MexMprisPropertiesClass;
+typedef struct _MexMprisPropertiesPrivate MexMprisPropertiesPrivate;
+
+struct _MexMprisProperties
+{
+  GObject parent;
+
+  MexMprisPropertiesPrivate *priv;
+};
+
+struct _MexMprisPropertiesClass
+{
+  GObjectClass parent_class;
+};
+
+GType                mex_mpris_properties_get_type (void) G_GNUC_CONST;
+
+MexMprisProperties * mex_mpris_properties_new      (const gchar *interface_name);
+
+void                 mex_mpris_properties_export   (MexMprisProperties *properties,
+                                                    GDBusConnection    *connection,
+                                                    const gchar        *object_path);
+
+void                 mex_mpris_properties_set      (MexMprisProperties *properties,
+                                                    const gchar        *name,
+                                                    GVariant           *value);
+GVariant *           mex_mpris_properties_get      (MexMprisProperties *properties,
+                                                    const gchar        *name);
+
+void                 mex_mpris_properties_flush    (MexMprisProperties *properties);
+
+GVariant *           mex_mpris_metadata_new        (MexContent  *content,
+                                                    const gchar *track_id,
+                                                    gint64       length);
+
+G_END_DECLS
+
+#endif /* __MEX_MPRIS_PROPERTIES_H__ */
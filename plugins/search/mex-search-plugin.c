@@ -27,7 +27,14 @@
 #include <mex/mex-view-model.h>
 #include <mex/mex-grilo-feed.h>
 #include <mex/mex-grilo-tracker-feed.h>
-#include <rest/rest-xml-parser.h>
+#include "mex-suggest-index.h"
+
+/* how many searches the history column shows */
+#define HISTORY_LENGTH 10
+/* how many suggestions the search page shows */
+#define SUGGEST_LENGTH 10
+/* how long after a search the history is saved, in seconds */
+#define SAVE_DELAY 2
 
 static void mex_tool_provider_iface_init (MexToolProviderInterface *iface);
 static void mex_model_provider_iface_init (MexModelProviderInterface *iface);
@@ -58,10 +65,12 @@ struct _MexSearchPluginPrivate
   ClutterActor *search_entry;
   ClutterActor *search_shell;
   ClutterActor *suggest_column;
-  ClutterActor *spinner;
 
-  guint         suggest_timeout;
-  gpointer      suggest_id;
+  MexSuggestIndex *suggest_index;
+  gchar        *suggest_file;
+  guint         save_timeout;
+  gulong        model_added_id;
+  gulong        model_removed_id;
 
   MexProxy     *search_proxy;
   MexModel     *search_model;
@@ -69,14 +78,44 @@ struct _MexSearchPluginPrivate
 
 static void mex_search_plugin_search_cb (MexSearchPlugin *self);
 
+static gboolean
+mex_search_plugin_save_cb (MexSearchPlugin *self)
+{
+  MexSearchPluginPrivate *priv = self->priv;
+  GError *error = NULL;
+
+  priv->save_timeout = 0;
+
+  if (!mex_suggest_index_save (priv->suggest_index, priv->suggest_file,
+                               &error))
+    {
+      g_warning ("Error saving the search history: %s", error->message);
+      g_error_free (error);
+    }
+
+  return FALSE;
+}
+
 static void
 mex_search_plugin_dispose (GObject *object)
 {
   MexSearchPlugin *self = MEX_SEARCH_PLUGIN (object);
   MexSearchPluginPrivate *priv = self->priv;
+  MexModelManager *manager = mex_model_manager_get_default ();
+
+  if (priv->model_added_id)
+    {
+      g_signal_handler_disconnect (manager, priv->model_added_id);
+      priv->model_added_id = 0;
+    }
+
+  if (priv->model_removed_id)
+    {
+      g_signal_handler_disconnect (manager, priv->model_removed_id);
+      priv->model_removed_id = 0;
+    }
 
-  mex_model_manager_remove_category (mex_model_manager_get_default (),
-                                     "search");
+  mex_model_manager_remove_category (manager, "search");
 
   if (priv->history_model)
     {
@@ -90,17 +129,16 @@ mex_search_plugin_dispose (GObject *object)
       priv->suggest_model = NULL;
     }
 
-  if (priv->suggest_timeout)
+  if (priv->save_timeout)
     {
-      g_source_remove (priv->suggest_timeout);
-      priv->suggest_timeout = 0;
+      g_source_remove (priv->save_timeout);
+      mex_search_plugin_save_cb (self);
     }
 
-  if (priv->suggest_id)
+  if (priv->suggest_index)
     {
-      MexDownloadQueue *dq = mex_download_queue_get_default ();
-      mex_download_queue_cancel (dq, priv->suggest_id);
-      priv->suggest_id = NULL;
+      g_object_unref (priv->suggest_index);
+      priv->suggest_index = NULL;
     }
 
   if (priv->search_proxy)
@@ -131,6 +169,7 @@ mex_search_plugin_finalize (GObject *object)
 
   g_list_free (priv->models);
   g_list_free (priv->actions);
+  g_free (priv->suggest_file);
 
   G_OBJECT_CLASS (mex_search_plugin_parent_class)->finalize (object);
 }
@@ -216,120 +255,113 @@ mex_search_plugin_history_cb (MxAction        *action,
   mex_search_plugin_search_cb (self);
 }
 
+/* Replaces the contents of @feed with search terms */
 static void
-mex_search_plugin_update_history (MexSearchPlugin *self,
-                                  const gchar     *term)
+mex_search_plugin_set_terms (MexFeed *feed,
+                             GList   *terms)
 {
-  gint i;
-  gsize length;
-  gchar *contents, *current;
-
-  MexSearchPluginPrivate *priv = self->priv;
-  const gchar *base_dir =
-    mex_settings_get_config_dir (mex_settings_get_default ());
-  gchar *history_file = g_build_filename (base_dir, "search", "history", NULL);
+  GList *l, *contents = NULL;
 
-  /* Read the history file contents */
-  /* TODO: Make this less rubbish? */
-  g_file_get_contents (history_file, &contents, &length, NULL);
+  mex_model_clear (MEX_MODEL (feed));
 
-  /* Prepend new search-term if appropriate */
-  if (term)
+  for (l = terms; l; l = l->next)
     {
-      gint terms;
-      gchar *path;
-      gsize new_length;
-
-      gsize term_len = strlen (term);
-      gchar *new_contents = g_malloc (length + term_len + 1);
-
-      memcpy (new_contents, term, term_len);
-      new_contents[term_len] = '\n';
-      new_length = term_len + 1;
-
-      /* Truncate list to 10 terms and remove duplicates */
-      if (contents)
-        {
-          i = 0;
-          terms = 1;
-          do
-            {
-              gint cur_len;
-              char *eos = strchr (contents + i, '\n');
+      MexContent *content = MEX_CONTENT (mex_program_new (feed));
 
-              if (!eos)
-                cur_len = strlen (contents + i);
-              else
-                cur_len = eos - (contents + i);
+      mex_content_set_metadata (content, MEX_CONTENT_METADATA_TITLE, l->data);
+      mex_content_set_metadata (content, MEX_CONTENT_METADATA_MIMETYPE,
+                                "x-mex/search");
+      contents = g_list_prepend (contents, content);
+    }
 
-              if ((cur_len != term_len) ||
-                  (strncmp (contents + i, term, term_len) != 0))
-                {
-                  memcpy (new_contents + new_length, contents + i, cur_len + 1);
-                  new_length += cur_len + 1;
+  if (contents)
+    {
+      contents = g_list_reverse (contents);
+      mex_model_add (MEX_MODEL (feed), contents);
+      g_list_free (contents);
+    }
+}
 
-                  if (++terms >= 10)
-                    break;
-                }
+static void
+mex_search_plugin_update_history (MexSearchPlugin *self,
+                                  const gchar     *term)
+{
+  MexSearchPluginPrivate *priv = self->priv;
+  GList *history;
 
-              if (!eos)
-                break;
+  if (term)
+    {
+      mex_suggest_index_record_search (priv->suggest_index, term);
+
+      /* searches come in bursts, save the history once they are over */
+      if (priv->save_timeout)
+        g_source_remove (priv->save_timeout);
+      priv->save_timeout =
+        g_timeout_add_seconds (SAVE_DELAY,
+                               (GSourceFunc) mex_search_plugin_save_cb, self);
+    }
 
-              i += cur_len + 1;
-            } while (i < length);
-        }
+  history = mex_suggest_index_get_history (priv->suggest_index,
+                                           HISTORY_LENGTH);
+  mex_search_plugin_set_terms (priv->history_model, history);
+  g_list_free_full (history, g_free);
+}
 
-      new_contents[new_length++] = '\0';
+/* Reads the searches from the history file of the previous versions, one
+ * per line, the last one first */
+static void
+mex_search_plugin_import_history (MexSearchPlugin *self,
+                                  const gchar     *filename)
+{
+  MexSearchPluginPrivate *priv = self->priv;
+  gchar **terms, *contents;
+  guint i;
 
-      /* Save new list */
-      path = g_path_get_dirname (history_file);
-      g_mkdir_with_parents (path, 0755);
-      g_free (path);
+  if (!g_file_get_contents (filename, &contents, NULL, NULL))
+    return;
 
-      g_file_set_contents (history_file, new_contents, new_length, NULL);
+  terms = g_strsplit (contents, "\n", -1);
+  for (i = g_strv_length (terms); i > 0; i--)
+    if (*terms[i - 1])
+      mex_suggest_index_record_search (priv->suggest_index, terms[i - 1]);
 
-      /* Replace content with new content */
-      g_free (contents);
-      contents = new_contents;
-      length = new_length;
-    }
+  g_strfreev (terms);
+  g_free (contents);
 
-  /* Empty current list */
-  mex_model_clear (MEX_MODEL (priv->history_model));
+  mex_search_plugin_save_cb (self);
+}
 
-  /* Populate with search history */
-  if (contents)
-    {
-      current = contents;
-      while (current < contents + length)
-        {
-          MexContent *content =
-            MEX_CONTENT (mex_program_new (priv->history_model));
-          gchar *end = g_utf8_strchr (current, -1, '\n');
+static gboolean
+mex_search_plugin_is_library (MexModel *model)
+{
+  gchar *category;
+  gboolean library;
 
-          if (end)
-            *end = '\0';
+  /* not the searches, nor their results */
+  g_object_get (model, "category", &category, NULL);
+  library = g_strcmp0 (category, "search") != 0 &&
+            g_strcmp0 (category, "search-results") != 0;
+  g_free (category);
 
-          if (*current)
-            {
-              mex_content_set_metadata (content,
-                                        MEX_CONTENT_METADATA_TITLE,
-                                        current);
-              mex_content_set_metadata (content,
-                                        MEX_CONTENT_METADATA_MIMETYPE,
-                                        "x-mex/search");
-              mex_model_add_content (MEX_MODEL (priv->history_model),
-                                     content);
-            }
+  return library;
+}
 
-          if (end)
-            current = end + 1;
-          else
-            break;
-        }
+static void
+mex_search_plugin_model_added_cb (MexModelManager *manager,
+                                  MexModel        *model,
+                                  MexSearchPlugin *self)
+{
+  if (mex_search_plugin_is_library (model))
+    mex_suggest_index_add_model (self->priv->suggest_index, model);
+}
 
-      g_free (contents);
-    }
+static void
+mex_search_plugin_model_removed_cb (MexModelManager *manager,
+                                    MexModel        *model,
+                                    const gchar     *category,
+                                    MexSearchPlugin *self)
+{
+  mex_suggest_index_remove_model (self->priv->suggest_index, model);
 }
 
 static void
@@ -472,13 +504,6 @@ mex_search_plugin_search_cb (MexSearchPlugin *self)
   if (!search || search[0] == '\0')
     return;
 
-  /* Stop the suggestions search */
-  if (priv->suggest_timeout)
-    {
-      g_source_remove (priv->suggest_timeout);
-      priv->suggest_timeout = 0;
-    }
-
   /* Start a new search */
   mex_search_plugin_search (self, search);
 
@@ -519,131 +544,34 @@ mex_search_activate_content (MexContent *content)
   g_signal_emit_by_name (action, "activated");
 }
 
-static void
-mex_suggest_complete_cb (MexDownloadQueue *queue,
-                         const gchar      *uri,
-                         const gchar      *buffer,
-                         gsize             count,
-                         const GError     *error,
-                         gpointer          userdata)
-{
-  RestXmlNode *root, *n;
-  RestXmlParser *parser;
-  MexSearchPlugin *self = userdata;
-  MexSearchPluginPrivate *priv = self->priv;
-
-  priv->suggest_id = NULL;
-
-  /* hide spinner */
-  mx_spinner_set_animating (MX_SPINNER (priv->spinner), FALSE);
-  clutter_actor_hide (priv->spinner);
-
-  if (error)
-    {
-      g_warning ("Error querying Google suggestions: %s",
-                 error->message);
-      return;
-    }
-
-  parser = rest_xml_parser_new ();
-  root = rest_xml_parser_parse_from_data (parser, buffer, count);
-
-  if (!root)
-    {
-      g_warning ("Unknown error parsing Google suggestions XML");
-      g_object_unref (parser);
-      return;
-    }
-
-  /* Clear model */
-  mex_model_clear (MEX_MODEL (priv->suggest_model));
-
-  /* Add new suggestions to model */
-  n = rest_xml_node_find (root, "CompleteSuggestion");
-  for (; n; n = n->next)
-    {
-      MexContent *content;
-      const gchar *suggestion;
-
-      RestXmlNode *node = rest_xml_node_find (n, "suggestion");
-
-      if (!node)
-        continue;
-
-      suggestion = rest_xml_node_get_attr (node, "data");
-
-      if (!suggestion)
-        continue;
-
-      content = MEX_CONTENT (mex_program_new (priv->suggest_model));
-      mex_content_set_metadata (content, MEX_CONTENT_METADATA_TITLE,
-                                suggestion);
-      mex_content_set_metadata (content, MEX_CONTENT_METADATA_MIMETYPE,
-                                "x-mex/search");
-      mex_model_add_content (MEX_MODEL (priv->suggest_model), content);
-    }
-
-  /* Unref */
-  rest_xml_node_unref (root);
-  g_object_unref (parser);
-}
-
-static gboolean
-mex_suggest_timeout_cb (MexSearchPlugin *self)
-{
-  gchar *uri;
-  const gchar *text;
-  MexDownloadQueue *dq;
-
-  MexSearchPluginPrivate *priv = self->priv;
-
-  priv->suggest_timeout = 0;
-
-  text = mx_entry_get_text (MX_ENTRY (priv->search_entry));
-
-  dq = mex_download_queue_get_default ();
-
-  if (priv->suggest_id)
-    mex_download_queue_cancel (dq, priv->suggest_id);
-
-  uri =
-    g_strdup_printf ("http://google.com/complete/search?output=toolbar&q=%s",
-                     text);
-  priv->suggest_id =
-    mex_download_queue_enqueue (dq, uri, mex_suggest_complete_cb, self);
-
-  return FALSE;
-}
-
 static void
 mex_search_text_changed_cb (MxEntry         *entry,
                             GParamSpec      *pspec,
                             MexSearchPlugin *self)
 {
   MexSearchPluginPrivate *priv = self->priv;
+  const gchar *text = mx_entry_get_text (entry);
+  GPtrArray *suggestions;
+  GList *terms = NULL;
+  guint i;
 
-  if (priv->suggest_timeout)
+  /* Don't suggest anything unless we have at least 3 characters */
+  if (g_utf8_strlen (text, -1) < 3)
     {
-      g_source_remove (priv->suggest_timeout);
-      priv->suggest_timeout = 0;
-    }
-
-  /* Don't start suggestions unless we have at least 3 characters */
-  if (g_utf8_strlen (mx_entry_get_text (entry), -1) < 3)
-    {
-      /* ensure the spinner is not visible */
-      mx_spinner_set_animating (MX_SPINNER (priv->spinner), FALSE);
-      clutter_actor_hide (priv->spinner);
-
+      mex_model_clear (MEX_MODEL (priv->suggest_model));
       return;
     }
 
-  /* show spinner */
-  mx_spinner_set_animating (MX_SPINNER (priv->spinner), TRUE);
-  clutter_actor_show (priv->spinner);
+  /* the index is local and fast enough to follow the typing */
+  suggestions = mex_suggest_index_complete (priv->suggest_index, text,
+                                            SUGGEST_LENGTH);
+  for (i = suggestions->len; i > 0; i--)
+    terms = g_list_prepend (terms, g_ptr_array_index (suggestions, i - 1));
 
-  priv->suggest_timeout =
-    g_timeout_add_seconds (1, (GSourceFunc)mex_suggest_timeout_cb, self);
+  mex_search_plugin_set_terms (priv->suggest_model, terms);
+
+  g_list_free (terms);
+  g_ptr_array_free (suggestions, TRUE);
 }
 
 static void
@@ -734,8 +662,11 @@ mex_search_plugin_init (MexSearchPlugin *self)
   MexModelCategoryInfo search_results = {
       "search-results", _("Search"), "icon-panelheader-search", -1, "" };
   MexModelManager *manager = mex_model_manager_get_default ();
+  const gchar *base_dir =
+    mex_settings_get_config_dir (mex_settings_get_default ());
+  GError *error = NULL;
+  GList *l, *models;
 
-  manager = mex_model_manager_get_default ();
   mex_model_manager_add_category (manager, &search);
   mex_model_manager_add_category (manager, &search_results);
 
@@ -756,8 +687,40 @@ mex_search_plugin_init (MexSearchPlugin *self)
   priv->actions = g_list_append (NULL, &priv->action_info);
 
   /* Create the suggestions model */
-  priv->suggest_model =
-    mex_feed_new (_("Suggestions"), _("Google Suggestions"));
+  priv->suggest_model = mex_feed_new (_("Suggestions"), _("Suggestions"));
+
+  /* Index the library and the past searches */
+  priv->suggest_index = mex_suggest_index_new ();
+  priv->suggest_file = g_build_filename (base_dir, "search", "searches", NULL);
+
+  if (!mex_suggest_index_load (priv->suggest_index, priv->suggest_file,
+                               &error))
+    {
+      if (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        {
+          gchar *history_file =
+            g_build_filename (base_dir, "search", "history", NULL);
+
+          mex_search_plugin_import_history (self, history_file);
+          g_free (history_file);
+        }
+      else
+        g_warning ("Error loading the search history: %s", error->message);
+
+      g_error_free (error);
+    }
+
+  models = mex_model_manager_get_models (manager);
+  for (l = models; l; l = l->next)
+    mex_search_plugin_model_added_cb (manager, l->data, self);
+  g_list_free (models);
+
+  priv->model_added_id =
+    g_signal_connect (manager, "model-added",
+                      G_CALLBACK (mex_search_plugin_model_added_cb), self);
+  priv->model_removed_id =
+    g_signal_connect (manager, "model-removed",
+                      G_CALLBACK (mex_search_plugin_model_removed_cb), self);
 
   /* Create the search page */
 
@@ -773,16 +736,8 @@ mex_search_plugin_init (MexSearchPlugin *self)
   frame = mx_table_new ();
   clutter_actor_set_name (frame, "search-entry-frame");
   priv->search_entry = mx_entry_new ();
-  priv->spinner = mx_spinner_new ();
 
   mx_table_insert_actor (MX_TABLE (frame), priv->search_entry, 0, 0);
-  mx_table_insert_actor (MX_TABLE (frame), priv->spinner, 0, 1);
-  mx_table_child_set_x_fill (MX_TABLE (frame), priv->spinner, FALSE);
-  mx_table_child_set_x_expand (MX_TABLE (frame), priv->spinner, FALSE);
-  mx_table_child_set_y_fill (MX_TABLE (frame), priv->spinner, FALSE);
-
-  mx_spinner_set_animating (MX_SPINNER (priv->spinner), FALSE);
-  clutter_actor_hide (priv->spinner);
 
   clutter_container_add (CLUTTER_CONTAINER (header), icon, frame, NULL);
   clutter_container_child_set (CLUTTER_CONTAINER (header), icon,
@@ -0,0 +1,907 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "mex-suggest-index.h"
+#include <mex/mex-content.h>
+
+/*
+ * Search suggestions made from what is on the device: the titles and
+ * artists of the library models, and the past searches.
+ *
+ * Every term is indexed at the start of each of its words, so "mat" finds
+ * "The Matrix", in an array sorted once, in which completing a prefix is a
+ * binary search followed by a walk over the matching keys, keeping the best
+ * ones. Terms added since the last completion are kept aside and merged in
+ * one pass by the next one, so that filling the index from a model costs a
+ * single sort.
+ *
+ * A term ranks with the number of library items bearing it, and a past
+ * search counts as SEARCH_WEIGHT items, less as it gets older. The few
+ * searched terms are scored first, and the walk over the keys stops as
+ * soon as no library term can rank better than the ones found. Only the
+ * searches are saved, the library is indexed again from the models.
+ */
+
+#define SEARCH_WEIGHT 8       /* a search is worth that many library items */
+#define RECENCY_DAYS  7       /* and half that after this many days */
+#define MAX_HISTORY   1000    /* searches saved */
+
+#define HISTORY_HEADER "# mex search history 1\n"
+
+G_DEFINE_TYPE (MexSuggestIndex, mex_suggest_index, G_TYPE_OBJECT)
+
+#define SUGGEST_INDEX_PRIVATE(o)                          \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o),                      \
+                                MEX_TYPE_SUGGEST_INDEX,   \
+                                MexSuggestIndexPrivate))
+
+typedef struct
+{
+  gchar   *display;
+  gchar   *key;           /* normalised and case folded */
+  guint    n_library;
+  guint    n_searches;
+  gint64   last_search;   /* in seconds */
+  guint    search_serial; /* orders the searches of a same second */
+  guint    n_keys;
+  gboolean dead;
+} Entry;
+
+typedef struct
+{
+  const gchar *text;      /* points in entry->key */
+  Entry       *entry;
+} Key;
+
+typedef struct
+{
+  Entry *title;
+  Entry *artist;
+} ContentTerms;
+
+typedef struct
+{
+  MexSuggestIndex *index;
+  MexModel        *model;
+  GController     *controller;
+  gulong           changed_id;
+  GHashTable      *contents;   /* MexContent -> ContentTerms */
+} ModelRecord;
+
+struct _MexSuggestIndexPrivate
+{
+  GHashTable *entries;    /* key -> Entry */
+  GHashTable *searched;   /* the Entries with searches */
+  guint       n_recorded;
+
+  GArray     *keys;       /* Keys, sorted */
+  GArray     *pending;    /* Keys not merged yet */
+  GPtrArray  *dead;       /* Entries whose keys are still in the arrays */
+  guint       n_dead_keys;
+  guint       max_library;  /* no entry has more library items */
+
+  GHashTable *models;     /* MexModel -> ModelRecord */
+};
+
+static void
+entry_free (Entry *entry)
+{
+  g_free (entry->display);
+  g_free (entry->key);
+  g_slice_free (Entry, entry);
+}
+
+static gchar *
+normalise (const gchar *term)
+{
+  gchar *normalised, *folded;
+
+  if (term == NULL)
+    return NULL;
+
+  normalised = g_utf8_normalize (term, -1, G_NORMALIZE_ALL);
+  if (normalised == NULL)
+    return NULL;
+
+  folded = g_strstrip (g_utf8_casefold (normalised, -1));
+  g_free (normalised);
+
+  if (*folded == '\0')
+    {
+      g_free (folded);
+      return NULL;
+    }
+
+  return folded;
+}
+
+static gint
+key_compare (gconstpointer a,
+             gconstpointer b)
+{
+  return strcmp (((const Key *) a)->text, ((const Key *) b)->text);
+}
+
+static Entry *
+entry_get (MexSuggestIndex *index,
+           const gchar     *term)
+{
+  MexSuggestIndexPrivate *priv = index->priv;
+  gboolean word_start = TRUE;
+  Entry *entry;
+  gchar *key;
+  const gchar *p;
+
+  if (!(key = normalise (term)))
+    return NULL;
+
+  if ((entry = g_hash_table_lookup (priv->entries, key)))
+    {
+      g_free (key);
+      return entry;
+    }
+
+  entry = g_slice_new0 (Entry);
+  entry->key = key;
+  entry->display = g_strstrip (g_strdup (term));
+  g_hash_table_insert (priv->entries, entry->key, entry);
+
+  /* a key at the start of every word */
+  for (p = key; *p; p = g_utf8_next_char (p))
+    {
+      gboolean alnum = g_unichar_isalnum (g_utf8_get_char (p));
+
+      if (alnum && word_start)
+        {
+          Key new_key = { p, entry };
+
+          g_array_append_val (priv->pending, new_key);
+          entry->n_keys++;
+        }
+
+      word_start = !alnum;
+    }
+
+  return entry;
+}
+
+static Entry *
+entry_add_library (MexSuggestIndex *index,
+                   const gchar     *term)
+{
+  Entry *entry;
+
+  if ((entry = entry_get (index, term)))
+    {
+      entry->n_library++;
+      index->priv->max_library = MAX (index->priv->max_library,
+                                      entry->n_library);
+    }
+
+  return entry;
+}
+
+static void
+entry_release (MexSuggestIndex *index,
+               Entry           *entry)
+{
+  MexSuggestIndexPrivate *priv = index->priv;
+
+  if (entry->n_library || entry->n_searches)
+    return;
+
+  /* the keys still point to the entry, it goes when they do */
+  g_hash_table_steal (priv->entries, entry->key);
+  entry->dead = TRUE;
+  priv->n_dead_keys += entry->n_keys;
+  g_ptr_array_add (priv->dead, entry);
+}
+
+/* Merges the pending keys in and drops the keys of the dead entries */
+static void
+mex_suggest_index_flush (MexSuggestIndex *index)
+{
+  MexSuggestIndexPrivate *priv = index->priv;
+  GArray *keys;
+  guint i, j;
+
+  if (priv->pending->len == 0 && priv->n_dead_keys == 0)
+    return;
+
+  g_array_sort (priv->pending, key_compare);
+
+  keys = g_array_sized_new (FALSE, FALSE, sizeof (Key),
+                            priv->keys->len + priv->pending->len -
+                            priv->n_dead_keys);
+
+  i = j = 0;
+  while (i < priv->keys->len || j < priv->pending->len)
+    {
+      Key *key;
+
+      if (j >= priv->pending->len ||
+          (i < priv->keys->len &&
+           key_compare (&g_array_index (priv->keys, Key, i),
+                        &g_array_index (priv->pending, Key, j)) <= 0))
+        key = &g_array_index (priv->keys, Key, i++);
+      else
+        key = &g_array_index (priv->pending, Key, j++);
+
+      if (!key->entry->dead)
+        g_array_append_vals (keys, key, 1);
+    }
+
+  g_array_free (priv->keys, TRUE);
+  priv->keys = keys;
+
+  g_array_set_size (priv->pending, 0);
+  g_ptr_array_set_size (priv->dead, 0);
+  priv->n_dead_keys = 0;
+}
+
+static void
+model_record_add (ModelRecord *record,
+                  MexContent  *content)
+{
+  ContentTerms *terms;
+
+  if (g_hash_table_lookup (record->contents, content))
+    return;
+
+  terms = g_slice_new0 (ContentTerms);
+
+  terms->title =
+    entry_add_library (record->index,
+                       mex_content_get_metadata (content,
+                                                 MEX_CONTENT_METADATA_TITLE));
+  terms->artist =
+    entry_add_library (record->index,
+                       mex_content_get_metadata (content,
+                                                 MEX_CONTENT_METADATA_ARTIST));
+
+  g_hash_table_insert (record->contents, content, terms);
+}
+
+static void
+model_record_release_terms (ModelRecord  *record,
+                            ContentTerms *terms)
+{
+  if (terms->title)
+    {
+      terms->title->n_library--;
+      entry_release (record->index, terms->title);
+    }
+
+  if (terms->artist)
+    {
+      terms->artist->n_library--;
+      entry_release (record->index, terms->artist);
+    }
+
+  g_slice_free (ContentTerms, terms);
+}
+
+static void
+model_record_remove (ModelRecord *record,
+                     MexContent  *content)
+{
+  ContentTerms *terms;
+
+  if (!(terms = g_hash_table_lookup (record->contents, content)))
+    return;
+
+  g_hash_table_remove (record->contents, content);
+  model_record_release_terms (record, terms);
+}
+
+static void
+model_record_clear (ModelRecord *record)
+{
+  GHashTableIter iter;
+  gpointer terms;
+
+  g_hash_table_iter_init (&iter, record->contents);
+  while (g_hash_table_iter_next (&iter, NULL, &terms))
+    {
+      g_hash_table_iter_remove (&iter);
+      model_record_release_terms (record, terms);
+    }
+}
+
+static void
+model_record_add_all (ModelRecord *record)
+{
+  guint i, length;
+
+  length = mex_model_get_length (record->model);
+  for (i = 0; i < length; i++)
+    model_record_add (record, mex_model_get_content (record->model, i));
+}
+
+static void
+model_changed_cb (GController          *controller,
+                  GControllerAction     action,
+                  GControllerReference *ref,
+                  ModelRecord          *record)
+{
+  gint i, n_indices;
+
+  n_indices = g_controller_reference_get_n_indices (ref);
+
+  switch (action)
+    {
+    case G_CONTROLLER_ADD:
+      for (i = 0; i < n_indices; i++)
+        {
+          guint idx = g_controller_reference_get_index_uint (ref, i);
+
+          model_record_add (record, mex_model_get_content (record->model, idx));
+        }
+      break;
+
+    case G_CONTROLLER_REMOVE:
+      /* sent before the contents go */
+      for (i = 0; i < n_indices; i++)
+        {
+          guint idx = g_controller_reference_get_index_uint (ref, i);
+
+          model_record_remove (record,
+                               mex_model_get_content (record->model, idx));
+        }
+      break;
+
+    case G_CONTROLLER_CLEAR:
+      model_record_clear (record);
+      break;
+
+    default:
+      model_record_clear (record);
+      model_record_add_all (record);
+      break;
+    }
+}
+
+static void
+model_record_free (ModelRecord *record)
+{
+  g_signal_handler_disconnect (record->controller, record->changed_id);
+  model_record_clear (record);
+
+  g_hash_table_unref (record->contents);
+  g_object_unref (record->model);
+  g_slice_free (ModelRecord, record);
+}
+
+static void
+mex_suggest_index_dispose (GObject *object)
+{
+  MexSuggestIndexPrivate *priv = MEX_SUGGEST_INDEX (object)->priv;
+
+  if (priv->models)
+    {
+      g_hash_table_unref (priv->models);
+      priv->models = NULL;
+    }
+
+  G_OBJECT_CLASS (mex_suggest_index_parent_class)->dispose (object);
+}
+
+static void
+mex_suggest_index_finalize (GObject *object)
+{
+  MexSuggestIndexPrivate *priv = MEX_SUGGEST_INDEX (object)->priv;
+
+  g_hash_table_unref (priv->searched);
+  g_hash_table_unref (priv->entries);
+  g_ptr_array_free (priv->dead, TRUE);
+  g_array_free (priv->pending, TRUE);
+  g_array_free (priv->keys, TRUE);
+
+  G_OBJECT_CLASS (mex_suggest_index_parent_class)->finalize (object);
+}
+
+static void
+mex_suggest_index_class_init (MexSuggestIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MexSuggestIndexPrivate));
+
+  object_class->dispose = mex_suggest_index_dispose;
+  object_class->finalize = mex_suggest_index_finalize;
+}
+
+static void
+mex_suggest_index_init (MexSuggestIndex *self)
+{
+  MexSuggestIndexPrivate *priv = self->priv = SUGGEST_INDEX_PRIVATE (self);
+
+  priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, (GDestroyNotify) entry_free);
+  priv->searched = g_hash_table_new (NULL, NULL);
+  priv->keys = g_array_new (FALSE, FALSE, sizeof (Key));
+  priv->pending = g_array_new (FALSE, FALSE, sizeof (Key));
+  priv->dead = g_ptr_array_new_with_free_func ((GDestroyNotify) entry_free);
+  priv->models = g_hash_table_new_full (NULL, NULL, NULL,
+                                        (GDestroyNotify) model_record_free);
+}
+
+MexSuggestIndex *
+mex_suggest_index_new (void)
+{
+  return g_object_new (MEX_TYPE_SUGGEST_INDEX, NULL);
+}
+
+/**
+ * mex_suggest_index_add_term:
+ * @index: a #MexSuggestIndex
+ * @term: a title or a name in the library
+ *
+ * Counts one more library item bearing @term.
+ */
+void
+mex_suggest_index_add_term (MexSuggestIndex *index,
+                            const gchar     *term)
+{
+  g_return_if_fail (MEX_IS_SUGGEST_INDEX (index));
+
+  entry_add_library (index, term);
+}
+
+/**
+ * mex_suggest_index_remove_term:
+ * @index: a #MexSuggestIndex
+ * @term: a term given to mex_suggest_index_add_term()
+ *
+ * Counts one library item less bearing @term.
+ */
+void
+mex_suggest_index_remove_term (MexSuggestIndex *index,
+                               const gchar     *term)
+{
+  Entry *entry;
+  gchar *key;
+
+  g_return_if_fail (MEX_IS_SUGGEST_INDEX (index));
+
+  if (!(key = normalise (term)))
+    return;
+
+  entry = g_hash_table_lookup (index->priv->entries, key);
+  g_free (key);
+
+  if (entry == NULL || entry->n_library == 0)
+    return;
+
+  entry->n_library--;
+  entry_release (index, entry);
+}
+
+/**
+ * mex_suggest_index_add_model:
+ * @index: a #MexSuggestIndex
+ * @model: a library model
+ *
+ * Indexes the titles and artists of @model, and follows its changes.
+ */
+void
+mex_suggest_index_add_model (MexSuggestIndex *index,
+                             MexModel        *model)
+{
+  MexSuggestIndexPrivate *priv;
+  ModelRecord *record;
+
+  g_return_if_fail (MEX_IS_SUGGEST_INDEX (index));
+  g_return_if_fail (MEX_IS_MODEL (model));
+
+  priv = index->priv;
+
+  if (g_hash_table_lookup (priv->models, model))
+    return;
+
+  record = g_slice_new0 (ModelRecord);
+  record->index = index;
+  record->model = g_object_ref (model);
+  record->contents = g_hash_table_new (NULL, NULL);
+  record->controller = mex_model_get_controller (model);
+  record->changed_id = g_signal_connect (record->controller, "changed",
+                                         G_CALLBACK (model_changed_cb),
+                                         record);
+
+  g_hash_table_insert (priv->models, model, record);
+
+  model_record_add_all (record);
+}
+
+/**
+ * mex_suggest_index_remove_model:
+ * @index: a #MexSuggestIndex
+ * @model: a model given to mex_suggest_index_add_model()
+ *
+ * Forgets the titles and artists of @model.
+ */
+void
+mex_suggest_index_remove_model (MexSuggestIndex *index,
+                                MexModel        *model)
+{
+  g_return_if_fail (MEX_IS_SUGGEST_INDEX (index));
+
+  g_hash_table_remove (index->priv->models, model);
+}
+
+static void
+record_search (MexSuggestIndex *index,
+               const gchar     *term,
+               guint            n_searches,
+               gint64           when)
+{
+  Entry *entry;
+
+  if (!(entry = entry_get (index, term)))
+    return;
+
+  entry->n_searches += n_searches;
+  entry->last_search = MAX (entry->last_search, when);
+  entry->search_serial = ++index->priv->n_recorded;
+
+  g_hash_table_insert (index->priv->searched, entry, entry);
+}
+
+/**
+ * mex_suggest_index_record_search:
+ * @index: a #MexSuggestIndex
+ * @term: what was searched for
+ *
+ * Adds @term to the search history.
+ */
+void
+mex_suggest_index_record_search (MexSuggestIndex *index,
+                                 const gchar     *term)
+{
+  g_return_if_fail (MEX_IS_SUGGEST_INDEX (index));
+
+  record_search (index, term, 1, g_get_real_time () / G_USEC_PER_SEC);
+}
+
+static gint
+entry_compare_recent (gconstpointer a,
+                      gconstpointer b)
+{
+  const Entry *entry_a = *(const Entry **) a;
+  const Entry *entry_b = *(const Entry **) b;
+
+  if (entry_a->last_search != entry_b->last_search)
+    return entry_a->last_search > entry_b->last_search ? -1 : 1;
+
+  return entry_a->search_serial > entry_b->search_serial ? -1 : 1;
+}
+
+static GPtrArray *
+get_searched (MexSuggestIndex *index)
+{
+  GHashTableIter iter;
+  GPtrArray *entries;
+  gpointer entry;
+
+  entries = g_ptr_array_sized_new (g_hash_table_size (index->priv->searched));
+
+  g_hash_table_iter_init (&iter, index->priv->searched);
+  while (g_hash_table_iter_next (&iter, &entry, NULL))
+    g_ptr_array_add (entries, entry);
+
+  g_ptr_array_sort (entries, entry_compare_recent);
+
+  return entries;
+}
+
+/**
+ * mex_suggest_index_get_history:
+ * @index: a #MexSuggestIndex
+ * @max: the number of searches wanted
+ *
+ * Returns: (transfer full): the last @max searches, the last one first
+ */
+GList *
+mex_suggest_index_get_history (MexSuggestIndex *index,
+                               guint            max)
+{
+  GPtrArray *entries;
+  GList *history = NULL;
+  guint i;
+
+  g_return_val_if_fail (MEX_IS_SUGGEST_INDEX (index), NULL);
+
+  entries = get_searched (index);
+
+  for (i = MIN (max, entries->len); i > 0; i--)
+    {
+      Entry *entry = g_ptr_array_index (entries, i - 1);
+
+      history = g_list_prepend (history, g_strdup (entry->display));
+    }
+
+  g_ptr_array_free (entries, TRUE);
+
+  return history;
+}
+
+static gdouble
+entry_score (const Entry *entry,
+             gint64       now)
+{
+  gdouble score = entry->n_library;
+
+  if (entry->n_searches)
+    {
+      gdouble days = MAX (now - entry->last_search, 0) / (24.0 * 60 * 60);
+
+      score += SEARCH_WEIGHT * entry->n_searches *
+               RECENCY_DAYS / (RECENCY_DAYS + days);
+    }
+
+  return score;
+}
+
+typedef struct
+{
+  Entry  *entry;
+  gdouble score;
+} Candidate;
+
+/* Keeps the @max best candidates, the best first, a score equal to one of
+ * the kept ones ranking after it */
+static void
+best_insert (Candidate *best,
+             guint     *n_best,
+             guint      max,
+             Entry     *entry,
+             gdouble    score)
+{
+  guint pos, i;
+
+  if (*n_best == max && score <= best[max - 1].score)
+    return;
+
+  /* an entry matching at several words is there already */
+  for (i = 0; i < *n_best; i++)
+    if (best[i].entry == entry)
+      return;
+
+  if (*n_best < max)
+    (*n_best)++;
+
+  for (pos = *n_best - 1; pos > 0 && score > best[pos - 1].score; pos--)
+    best[pos] = best[pos - 1];
+
+  best[pos].entry = entry;
+  best[pos].score = score;
+}
+
+static gboolean
+entry_matches (const Entry *entry,
+               const gchar *prefix,
+               gsize        prefix_len)
+{
+  gboolean word_start = TRUE;
+  const gchar *p;
+
+  for (p = entry->key; *p; p = g_utf8_next_char (p))
+    {
+      gboolean alnum = g_unichar_isalnum (g_utf8_get_char (p));
+
+      if (alnum && word_start && strncmp (p, prefix, prefix_len) == 0)
+        return TRUE;
+
+      word_start = !alnum;
+    }
+
+  return FALSE;
+}
+
+/**
+ * mex_suggest_index_complete:
+ * @index: a #MexSuggestIndex
+ * @prefix: the start of a word of the wanted terms
+ * @max: the number of suggestions wanted
+ *
+ * Returns: (transfer full): the @max best terms having a word starting
+ *   with @prefix, the best first
+ */
+GPtrArray *
+mex_suggest_index_complete (MexSuggestIndex *index,
+                            const gchar     *prefix,
+                            guint            max)
+{
+  MexSuggestIndexPrivate *priv;
+  GHashTableIter iter;
+  Candidate *best;
+  GPtrArray *suggestions;
+  guint low, high, n_best = 0, i;
+  gpointer entry;
+  gsize prefix_len;
+  gint64 now;
+  gchar *key;
+
+  g_return_val_if_fail (MEX_IS_SUGGEST_INDEX (index), NULL);
+
+  priv = index->priv;
+  suggestions = g_ptr_array_new_with_free_func (g_free);
+
+  if (max == 0 || !(key = normalise (prefix)))
+    return suggestions;
+
+  mex_suggest_index_flush (index);
+
+  best = g_new (Candidate, max);
+  prefix_len = strlen (key);
+
+  /* the searched terms, few, with their full score */
+  now = g_get_real_time () / G_USEC_PER_SEC;
+  g_hash_table_iter_init (&iter, priv->searched);
+  while (g_hash_table_iter_next (&iter, &entry, NULL))
+    if (entry_matches (entry, key, prefix_len))
+      best_insert (best, &n_best, max, entry, entry_score (entry, now));
+
+  /* the first key not before the prefix */
+  low = 0;
+  high = priv->keys->len;
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+
+      if (strcmp (g_array_index (priv->keys, Key, mid).text, key) < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  /* then the others, scoring their library items, until none can do better
+   * than the ones kept, so that a short prefix does not walk the whole
+   * library */
+  for (i = low; i < priv->keys->len; i++)
+    {
+      Key *k = &g_array_index (priv->keys, Key, i);
+
+      if (n_best == max && best[max - 1].score >= priv->max_library)
+        break;
+
+      if (strncmp (k->text, key, prefix_len) != 0)
+        break;
+
+      if (k->entry->n_searches == 0)
+        best_insert (best, &n_best, max, k->entry, k->entry->n_library);
+    }
+
+  for (i = 0; i < n_best; i++)
+    g_ptr_array_add (suggestions, g_strdup (best[i].entry->display));
+
+  g_free (best);
+  g_free (key);
+
+  return suggestions;
+}
+
+/**
+ * mex_suggest_index_load:
+ * @index: a #MexSuggestIndex
+ * @filename: a file written by mex_suggest_index_save()
+ * @error: return location for a #GError, or %NULL
+ *
+ * Adds the searches saved in @filename to the history.
+ *
+ * Returns: %TRUE if @filename could be read
+ */
+gboolean
+mex_suggest_index_load (MexSuggestIndex  *index,
+                        const gchar      *filename,
+                        GError          **error)
+{
+  gchar *contents, *line, *next;
+
+  g_return_val_if_fail (MEX_IS_SUGGEST_INDEX (index), FALSE);
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    return FALSE;
+
+  /* one "searches last-search term" line per term, the oldest first */
+  for (line = contents; line && *line; line = next)
+    {
+      guint64 n_searches;
+      gint64 when;
+      gchar *end;
+
+      if ((next = strchr (line, '\n')))
+        *next++ = '\0';
+
+      if (*line == '#')
+        continue;
+
+      n_searches = g_ascii_strtoull (line, &end, 10);
+      if (end == line || *end != ' ')
+        continue;
+
+      line = end + 1;
+      when = g_ascii_strtoll (line, &end, 10);
+      if (end == line || *end != ' ')
+        continue;
+
+      record_search (index, end + 1, n_searches, when);
+    }
+
+  g_free (contents);
+
+  return TRUE;
+}
+
+/**
+ * mex_suggest_index_save:
+ * @index: a #MexSuggestIndex
+ * @filename: the file to write
+ * @error: return location for a #GError, or %NULL
+ *
+ * Saves the search history, the MAX_HISTORY last searches.
+ *
+ * Returns: %TRUE if @filename could be written
+ */
+gboolean
+mex_suggest_index_save (MexSuggestIndex  *index,
+                        const gchar      *filename,
+                        GError          **error)
+{
+  GPtrArray *entries;
+  GString *contents;
+  gboolean success;
+  gchar *dir;
+  guint i;
+
+  g_return_val_if_fail (MEX_IS_SUGGEST_INDEX (index), FALSE);
+
+  entries = get_searched (index);
+  contents = g_string_new (HISTORY_HEADER);
+
+  /* the oldest first, loading them back in order */
+  for (i = MIN (entries->len, MAX_HISTORY); i > 0; i--)
+    {
+      Entry *entry = g_ptr_array_index (entries, i - 1);
+
+      g_string_append_printf (contents,
+                              "%u %" G_GINT64_FORMAT " %s\n",
+                              entry->n_searches, entry->last_search,
+                              entry->display);
+    }
+
+  dir = g_path_get_dirname (filename);
+  g_mkdir_with_parents (dir, 0755);
+  g_free (dir);
+
+  success = g_file_set_contents (filename, contents->str, contents->len,
+                                 error);
+
+  g_string_free (contents, TRUE);
+  g_ptr_array_free (entries, TRUE);
+
+  return success;
+}
@@ -0,0 +1,97 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2010, 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __MEX_SUGGEST_INDEX_H__
+#define __MEX_SUGGEST_INDEX_H__
+
+#include <glib-object.h>
+#include <mex/mex-model.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_SUGGEST_INDEX mex_suggest_index_get_type()
+
+#define MEX_SUGGEST_INDEX(obj)                                        \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                 \
+                               MEX_TYPE_SUGGEST_INDEX, MexSuggestIndex))
+
+#define MEX_SUGGEST_INDEX_CLASS(klass)                                  \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            MEX_TYPE_SUGGEST_INDEX, MexSuggestIndexClass))
+
+#define MEX_IS_SUGGEST_INDEX(obj)                 \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),             \
+                               MEX_TYPE_SUGGEST_INDEX))
+
+#define MEX_IS_SUGGEST_INDEX_CLASS(klass)      \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),           \
+                            MEX_TYPE_SUGGEST_INDEX))
+
+#define MEX_SUGGEST_INDEX_GET_CLASS(obj)                                  \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                      \
+                              MEX_TYPE_SUGGEST_INDEX, MexSuggestIndexClass))
+
+typedef struct _MexSuggestIndex MexSuggestIndex;
+typedef struct _MexSuggestIndexClass MexSuggestIndexClass;
+typedef struct _MexSuggestIndexPrivate MexSuggestIndexPrivate;
+
+struct _MexSuggestIndex
+{
+  GObject parent;
+
+  MexSuggestIndexPrivate *priv;
+};
+
+struct _MexSuggestIndexClass
+{
+  GObjectClass parent_class;
+};
+
+GType             mex_suggest_index_get_type       (void) G_GNUC_CONST;
+
+MexSuggestIndex * mex_suggest_index_new            (void);
+
+void              mex_suggest_index_add_term       (MexSuggestIndex *index,
+                                                    const gchar     *term);
+void              mex_suggest_index_remove_term    (MexSuggestIndex *index,
+                                                    const gchar     *term);
+
+void              mex_suggest_index_add_model      (MexSuggestIndex *index,
+                                                    MexModel        *model);
+void              mex_suggest_index_remove_model   (MexSuggestIndex *index,
+                                                    MexModel        *model);
+
+void              mex_suggest_index_record_search  (MexSuggestIndex *index,
+                                                    const gchar     *term);
+GList *           mex_suggest_index_get_history    (MexSuggestIndex *index,
+                                                    guint            max);
+
+GPtrArray *       mex_suggest_index_complete       (MexSuggestIndex *index,
+                                                    const gchar     *prefix,
+                                                    guint            max);
+
+gboolean          mex_suggest_index_load           (MexSuggestIndex  *index,
+                                                    const gchar      *filename,
+                                                    GError          **error);
+gboolean          mex_suggest_index_save           (MexSuggestIndex  *index,
+                                                    const gchar      *filename,
+                                                    GError          **error);
+
+G_END_DECLS
+
+#endif /* __MEX_SUGGEST_INDEX_H__ */
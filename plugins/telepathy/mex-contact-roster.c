@@ -0,0 +1,438 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mex-contact-roster.h"
+
+/*
+ * The contacts of all the accounts, indexed by contact and by account, and
+ * the model showing them. Changes to the roster are applied to the model
+ * in batches: all the contacts of a change are added in one go, and
+ * removing a large part of the model rebuilds it instead of looking up
+ * every content in turn.
+ *
+ * The roster does not know about Telepathy, contacts and accounts are only
+ * used as keys, so it can be driven by stand-ins in tests.
+ */
+
+#define REBUILD_THRESHOLD 16
+
+G_DEFINE_TYPE (MexContactRoster, mex_contact_roster, G_TYPE_OBJECT)
+
+#define CONTACT_ROSTER_PRIVATE(o)                         \
+  (G_TYPE_INSTANCE_GET_PRIVATE ((o),                      \
+                                MEX_TYPE_CONTACT_ROSTER,  \
+                                MexContactRosterPrivate))
+
+typedef struct
+{
+  GObject    *contact;
+  GObject    *account;
+  MexContent *content;
+  gboolean    visible;
+} RosterEntry;
+
+struct _MexContactRosterPrivate
+{
+  MexModel                   *model;
+  MexContactRosterCreateFunc  create;
+  gpointer                    user_data;
+
+  GHashTable *contacts;   /* contact -> RosterEntry */
+  GHashTable *accounts;   /* account -> (contact -> RosterEntry) */
+};
+
+static void
+roster_entry_free (RosterEntry *entry)
+{
+  g_object_unref (entry->content);
+  g_object_unref (entry->contact);
+  g_slice_free (RosterEntry, entry);
+}
+
+static void
+mex_contact_roster_finalize (GObject *object)
+{
+  MexContactRosterPrivate *priv = MEX_CONTACT_ROSTER (object)->priv;
+
+  g_hash_table_unref (priv->accounts);
+  g_hash_table_unref (priv->contacts);
+  g_object_unref (priv->model);
+
+  G_OBJECT_CLASS (mex_contact_roster_parent_class)->finalize (object);
+}
+
+static void
+mex_contact_roster_class_init (MexContactRosterClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  g_type_class_add_private (klass, sizeof (MexContactRosterPrivate));
+
+  object_class->finalize = mex_contact_roster_finalize;
+}
+
+static void
+mex_contact_roster_init (MexContactRoster *self)
+{
+  MexContactRosterPrivate *priv;
+
+  priv = self->priv = CONTACT_ROSTER_PRIVATE (self);
+
+  priv->contacts = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL,
+                                          (GDestroyNotify) roster_entry_free);
+  priv->accounts = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                          NULL,
+                                          (GDestroyNotify) g_hash_table_unref);
+}
+
+/**
+ * mex_contact_roster_new:
+ * @model: the model to show the contacts in
+ * @create: the function creating the content of a contact
+ * @user_data: data to pass to @create
+ *
+ * Returns: a new #MexContactRoster
+ */
+MexContactRoster *
+mex_contact_roster_new (MexModel                   *model,
+                        MexContactRosterCreateFunc  create,
+                        gpointer                    user_data)
+{
+  MexContactRoster *roster;
+
+  g_return_val_if_fail (MEX_IS_MODEL (model), NULL);
+  g_return_val_if_fail (create != NULL, NULL);
+
+  roster = g_object_new (MEX_TYPE_CONTACT_ROSTER, NULL);
+  roster->priv->model = g_object_ref (model);
+  roster->priv->create = create;
+  roster->priv->user_data = user_data;
+
+  return roster;
+}
+
+static void
+mex_contact_roster_remove_from_model (MexContactRoster *roster,
+                                      GPtrArray        *contents)
+{
+  MexContactRosterPrivate *priv = roster->priv;
+  GHashTable *removed;
+  GList *kept = NULL, *l;
+  guint i, length;
+
+  if (!contents->len)
+    return;
+
+  length = mex_model_get_length (priv->model);
+
+  if (contents->len < REBUILD_THRESHOLD || contents->len * 4 < length)
+    {
+      for (i = 0; i < contents->len; i++)
+        mex_model_remove_content (priv->model,
+                                  g_ptr_array_index (contents, i));
+      return;
+    }
+
+  /* put back what stays, in the same order */
+  removed = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = 0; i < contents->len; i++)
+    g_hash_table_insert (removed, g_ptr_array_index (contents, i),
+                         GINT_TO_POINTER (TRUE));
+
+  for (i = length; i > 0; i--)
+    {
+      MexContent *content = mex_model_get_content (priv->model, i - 1);
+
+      if (!g_hash_table_lookup (removed, content))
+        kept = g_list_prepend (kept, g_object_ref (content));
+    }
+
+  g_hash_table_unref (removed);
+
+  mex_model_clear (priv->model);
+
+  if (kept)
+    {
+      mex_model_add (priv->model, kept);
+
+      for (l = kept; l; l = l->next)
+        g_object_unref (l->data);
+      g_list_free (kept);
+    }
+}
+
+/**
+ * mex_contact_roster_add:
+ * @roster: a #MexContactRoster
+ * @account: the account the contacts belong to
+ * @contacts: an array of contacts
+ *
+ * Adds @contacts, the ones already in the roster are skipped. The visible
+ * contacts are added to the model at once.
+ */
+void
+mex_contact_roster_add (MexContactRoster *roster,
+                        GObject          *account,
+                        GPtrArray        *contacts)
+{
+  MexContactRosterPrivate *priv;
+  GHashTable *account_contacts;
+  GList *added = NULL;
+  guint i;
+
+  g_return_if_fail (MEX_IS_CONTACT_ROSTER (roster));
+
+  priv = roster->priv;
+
+  account_contacts = g_hash_table_lookup (priv->accounts, account);
+  if (!account_contacts)
+    {
+      account_contacts = g_hash_table_new (g_direct_hash, g_direct_equal);
+      g_hash_table_insert (priv->accounts, account, account_contacts);
+    }
+
+  /* walk backwards so that the list keeps the order of the array */
+  for (i = contacts->len; i > 0; i--)
+    {
+      GObject *contact = g_ptr_array_index (contacts, i - 1);
+      RosterEntry *entry;
+
+      if (g_hash_table_lookup (priv->contacts, contact))
+        continue;
+
+      entry = g_slice_new (RosterEntry);
+      entry->contact = g_object_ref (contact);
+      entry->account = account;
+      entry->visible = FALSE;
+      entry->content = priv->create (contact, &entry->visible,
+                                     priv->user_data);
+      g_object_ref_sink (entry->content);
+
+      g_hash_table_insert (priv->contacts, contact, entry);
+      g_hash_table_insert (account_contacts, contact, entry);
+
+      if (entry->visible)
+        added = g_list_prepend (added, entry->content);
+    }
+
+  if (added)
+    {
+      mex_model_add (priv->model, added);
+      g_list_free (added);
+    }
+}
+
+static void
+mex_contact_roster_remove_entries (MexContactRoster *roster,
+                                   GPtrArray        *entries)
+{
+  MexContactRosterPrivate *priv = roster->priv;
+  GPtrArray *contents;
+  guint i;
+
+  contents = g_ptr_array_sized_new (entries->len);
+  for (i = 0; i < entries->len; i++)
+    {
+      RosterEntry *entry = g_ptr_array_index (entries, i);
+
+      if (entry->visible)
+        g_ptr_array_add (contents, entry->content);
+    }
+
+  mex_contact_roster_remove_from_model (roster, contents);
+  g_ptr_array_free (contents, TRUE);
+
+  for (i = 0; i < entries->len; i++)
+    {
+      RosterEntry *entry = g_ptr_array_index (entries, i);
+      GHashTable *account_contacts;
+
+      account_contacts = g_hash_table_lookup (priv->accounts, entry->account);
+      if (account_contacts)
+        g_hash_table_remove (account_contacts, entry->contact);
+
+      g_hash_table_remove (priv->contacts, entry->contact);
+    }
+}
+
+/**
+ * mex_contact_roster_remove:
+ * @roster: a #MexContactRoster
+ * @contacts: an array of contacts
+ *
+ * Removes @contacts from the roster and from the model.
+ */
+void
+mex_contact_roster_remove (MexContactRoster *roster,
+                           GPtrArray        *contacts)
+{
+  GPtrArray *entries;
+  guint i;
+
+  g_return_if_fail (MEX_IS_CONTACT_ROSTER (roster));
+
+  entries = g_ptr_array_sized_new (contacts->len);
+  for (i = 0; i < contacts->len; i++)
+    {
+      RosterEntry *entry;
+
+      entry = g_hash_table_lookup (roster->priv->contacts,
+                                   g_ptr_array_index (contacts, i));
+      if (entry)
+        g_ptr_array_add (entries, entry);
+    }
+
+  mex_contact_roster_remove_entries (roster, entries);
+  g_ptr_array_free (entries, TRUE);
+}
+
+/**
+ * mex_contact_roster_remove_account:
+ * @roster: a #MexContactRoster
+ * @account: an account
+ *
+ * Removes all the contacts of @account, when it gets disconnected.
+ */
+void
+mex_contact_roster_remove_account (MexContactRoster *roster,
+                                   GObject          *account)
+{
+  MexContactRosterPrivate *priv;
+  GHashTable *account_contacts;
+  GHashTableIter iter;
+  GPtrArray *entries;
+  RosterEntry *entry;
+
+  g_return_if_fail (MEX_IS_CONTACT_ROSTER (roster));
+
+  priv = roster->priv;
+
+  account_contacts = g_hash_table_lookup (priv->accounts, account);
+  if (!account_contacts)
+    return;
+
+  entries = g_ptr_array_sized_new (g_hash_table_size (account_contacts));
+  g_hash_table_iter_init (&iter, account_contacts);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    g_ptr_array_add (entries, entry);
+
+  mex_contact_roster_remove_entries (roster, entries);
+  g_ptr_array_free (entries, TRUE);
+
+  g_hash_table_remove (priv->accounts, account);
+}
+
+/**
+ * mex_contact_roster_clear:
+ * @roster: a #MexContactRoster
+ *
+ * Removes all the contacts.
+ */
+void
+mex_contact_roster_clear (MexContactRoster *roster)
+{
+  MexContactRosterPrivate *priv;
+
+  g_return_if_fail (MEX_IS_CONTACT_ROSTER (roster));
+
+  priv = roster->priv;
+
+  mex_model_clear (priv->model);
+  g_hash_table_remove_all (priv->accounts);
+  g_hash_table_remove_all (priv->contacts);
+}
+
+/**
+ * mex_contact_roster_set_visible:
+ * @roster: a #MexContactRoster
+ * @contact: a contact of the roster
+ * @visible: whether the contact should be in the model
+ *
+ * Adds the content of @contact to the model or removes it.
+ */
+void
+mex_contact_roster_set_visible (MexContactRoster *roster,
+                                GObject          *contact,
+                                gboolean          visible)
+{
+  MexContactRosterPrivate *priv;
+  RosterEntry *entry;
+
+  g_return_if_fail (MEX_IS_CONTACT_ROSTER (roster));
+
+  priv = roster->priv;
+
+  entry = g_hash_table_lookup (priv->contacts, contact);
+  if (!entry || entry->visible == visible)
+    return;
+
+  entry->visible = visible;
+
+  if (visible)
+    mex_model_add_content (priv->model, entry->content);
+  else
+    mex_model_remove_content (priv->model, entry->content);
+}
+
+/**
+ * mex_contact_roster_lookup:
+ * @roster: a #MexContactRoster
+ * @contact: a contact
+ *
+ * Returns: (transfer none): the content of @contact, or %NULL
+ */
+MexContent *
+mex_contact_roster_lookup (MexContactRoster *roster,
+                           GObject          *contact)
+{
+  RosterEntry *entry;
+
+  g_return_val_if_fail (MEX_IS_CONTACT_ROSTER (roster), NULL);
+
+  entry = g_hash_table_lookup (roster->priv->contacts, contact);
+
+  return entry ? entry->content : NULL;
+}
+
+/**
+ * mex_contact_roster_get_n_contacts:
+ * @roster: a #MexContactRoster
+ * @account: an account, or %NULL
+ *
+ * Returns: the number of contacts of @account, or of all the accounts
+ */
+guint
+mex_contact_roster_get_n_contacts (MexContactRoster *roster,
+                                   GObject          *account)
+{
+  GHashTable *account_contacts;
+
+  g_return_val_if_fail (MEX_IS_CONTACT_ROSTER (roster), 0);
+
+  if (!account)
+    return g_hash_table_size (roster->priv->contacts);
+
+  account_contacts = g_hash_table_lookup (roster->priv->accounts, account);
+
+  return account_contacts ? g_hash_table_size (account_contacts) : 0;
+}
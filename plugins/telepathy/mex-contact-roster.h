@@ -0,0 +1,107 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#ifndef __MEX_CONTACT_ROSTER_H__
+#define __MEX_CONTACT_ROSTER_H__
+
+#include <glib-object.h>
+#include <mex/mex-model.h>
+
+G_BEGIN_DECLS
+
+#define MEX_TYPE_CONTACT_ROSTER mex_contact_roster_get_type()
+
+#define MEX_CONTACT_ROSTER(obj)                                       \
+  (G_TYPE_CHECK_INSTANCE_CAST ((obj),                                 \
+                               MEX_TYPE_CONTACT_ROSTER, MexContactRoster))
+
+#define MEX_CONTACT_ROSTER_CLASS(klass)                                 \
+  (G_TYPE_CHECK_CLASS_CAST ((klass),                                    \
+                            MEX_TYPE_CONTACT_ROSTER, MexContactRosterClass))
+
+#define MEX_IS_CONTACT_ROSTER(obj)                \
+  (G_TYPE_CHECK_INSTANCE_TYPE ((obj),             \
+                               MEX_TYPE_CONTACT_ROSTER))
+
+#define MEX_IS_CONTACT_ROSTER_CLASS(klass)     \
+  (G_TYPE_CHECK_CLASS_TYPE ((klass),           \
+                            MEX_TYPE_CONTACT_ROSTER))
+
+#define MEX_CONTACT_ROSTER_GET_CLASS(obj)                                 \
+  (G_TYPE_INSTANCE_GET_CLASS ((obj),                                      \
+                              MEX_TYPE_CONTACT_ROSTER, MexContactRosterClass))
+
+typedef struct _MexContactRoster MexContactRoster;
+typedef struct _MexContactRosterClass MexContactRosterClass;
+typedef struct _MexContactRosterPrivate MexContactRosterPrivate;
+
+struct _MexContactRoster
+{
+  GObject parent;
+
+  MexContactRosterPrivate *priv;
+};
+
+struct _MexContactRosterClass
+{
+  GObjectClass parent_class;
+};
+
+/**
+ * MexContactRosterCreateFunc:
+ * @contact: the contact being added
+ * @visible: return location for whether the content goes in the model
+ * @user_data: the data given to mex_contact_roster_new()
+ *
+ * Creates the content standing for @contact.
+ *
+ * Returns: (transfer floating): a new #MexContent, the roster sinks it
+ */
+typedef MexContent * (*MexContactRosterCreateFunc) (GObject  *contact,
+                                                    gboolean *visible,
+                                                    gpointer  user_data);
+
+GType              mex_contact_roster_get_type    (void) G_GNUC_CONST;
+
+MexContactRoster * mex_contact_roster_new         (MexModel                   *model,
+                                                   MexContactRosterCreateFunc  create,
+                                                   gpointer                    user_data);
+
+void               mex_contact_roster_add         (MexContactRoster *roster,
+                                                   GObject          *account,
+                                                   GPtrArray        *contacts);
+void               mex_contact_roster_remove      (MexContactRoster *roster,
+                                                   GPtrArray        *contacts);
+void               mex_contact_roster_remove_account
+                                                  (MexContactRoster *roster,
+                                                   GObject          *account);
+void               mex_contact_roster_clear       (MexContactRoster *roster);
+
+void               mex_contact_roster_set_visible (MexContactRoster *roster,
+                                                   GObject          *contact,
+                                                   gboolean          visible);
+
+MexContent *       mex_contact_roster_lookup      (MexContactRoster *roster,
+                                                   GObject          *contact);
+guint              mex_contact_roster_get_n_contacts
+                                                  (MexContactRoster *roster,
+                                                   GObject          *account);
+
+G_END_DECLS
+
+#endif /* __MEX_CONTACT_ROSTER_H__ */
@@ -25,6 +25,7 @@
 #include "mex-telepathy-plugin.h"
 
 #include "mex-contact.h"
+#include "mex-contact-roster.h"
 #include "mex-telepathy-channel.h"
 
 #include <telepathy-glib/telepathy-glib.h>
@@ -67,8 +68,7 @@ struct _MexTelepathyPluginPrivate
 
   GList *models;
   GList *actions;
-  GList *contacts;
-  GHashTable *contact_accounts;
+  MexContactRoster *roster;
 
   MexTelepathyChannel        *channel;
   TpAccountManager           *account_manager;
@@ -117,12 +117,11 @@ mex_telepathy_plugin_dispose (GObject *gobject)
       priv->actions = g_list_delete_link (priv->actions, priv->actions);
     }
 
-  g_hash_table_remove_all (priv->contact_accounts);
-
-  while (priv->contacts)
+  if (priv->roster)
     {
-      g_object_unref (priv->contacts->data);
-      priv->contacts = g_list_delete_link (priv->contacts, priv->contacts);
+      mex_contact_roster_clear (priv->roster);
+      g_object_unref (priv->roster);
+      priv->roster = NULL;
     }
 
   while (priv->channel)
@@ -139,7 +138,6 @@ mex_telepathy_plugin_dispose (GObject *gobject)
   g_object_unref (priv->approver);
   g_object_unref (priv->dispatch_operation);
   g_object_unref (priv->factory);
-  g_object_unref (priv->contact_accounts);
 
   if (priv->dialog)
     {
@@ -172,19 +170,6 @@ mex_telepathy_plugin_class_init (MexTelepathyPluginClass *klass)
   g_type_class_add_private (klass, sizeof (MexTelepathyPluginPrivate));
 }
 
-static gint
-mex_telepathy_plugin_compare_mex_contact (gconstpointer a,
-                                          gconstpointer b)
-{
-  MexContact *mex_contact = MEX_CONTACT (a);
-  TpContact *contact_b = TP_CONTACT (b);
-  TpContact *contact_a = mex_contact_get_tp_contact (mex_contact);
-
-  return TP_IS_CONTACT(contact_a) && TP_IS_CONTACT(contact_b) &&
-         tp_strdiff (tp_contact_get_identifier (
-                       contact_a), tp_contact_get_identifier (contact_b));
-}
-
 static void
 mex_telepathy_plugin_on_request_subscription (GObject           *source_object,
                                               GAsyncResult      *res,
@@ -411,120 +396,86 @@ mex_telepathy_plugin_on_should_add_to_model_changed (gpointer instance,
 {
   MexTelepathyPlugin *self = MEX_TELEPATHY_PLUGIN (user_data);
   MexTelepathyPluginPrivate *priv = self->priv;
+  TpContact *contact;
 
-  MexContact *contact = MEX_CONTACT (instance);
-
-  if (should_add)
-    {
-      mex_model_add_content (priv->model, MEX_CONTENT (contact));
+  contact = mex_contact_get_tp_contact (MEX_CONTACT (instance));
 
-      mex_telepathy_plugin_trigger_notification_for_contact (
-        self,
-        mex_contact_get_tp_contact (
-          contact),
-        TRUE);
-    }
-  else
-    {
-      mex_model_remove_content (priv->model, MEX_CONTENT (contact));
+  mex_contact_roster_set_visible (priv->roster, G_OBJECT (contact),
+                                  should_add);
 
-      mex_telepathy_plugin_trigger_notification_for_contact (
-        self,
-        mex_contact_get_tp_contact (
-          contact),
-        FALSE);
-    }
+  mex_telepathy_plugin_trigger_notification_for_contact (self,
+                                                         contact,
+                                                         should_add);
 }
 
-static void
-mex_telepathy_plugin_add_contact (gpointer contact_ptr,
-                                  gpointer user_data)
+static MexContent *
+mex_telepathy_plugin_create_contact (GObject  *contact_object,
+                                     gboolean *visible,
+                                     gpointer  user_data)
 {
   MexTelepathyPlugin *self = MEX_TELEPATHY_PLUGIN (user_data);
-  MexTelepathyPluginPrivate *priv = self->priv;
-  TpContact *contact = TP_CONTACT (contact_ptr);
-  TpConnection *connection;
-  TpAccount *account;
+  TpContact *contact = TP_CONTACT (contact_object);
   MexContact *mex_contact;
 
-  /* Get the connection and account so we can keep track of it */
-  connection = tp_contact_get_connection (contact);
-  account = tp_connection_get_account (connection);
-  g_hash_table_insert (priv->contact_accounts, contact, account);
-
   MEX_DEBUG ("Adding %s", tp_contact_get_alias (contact));
 
   mex_contact = g_object_new (MEX_TYPE_CONTACT,
                               "contact", contact,
                               NULL);
 
-  /* Ref this object: we need it alive until its removal */
-  g_object_ref (mex_contact);
-
-  priv->contacts = g_list_append (priv->contacts, mex_contact);
-
-  if (mex_contact_should_add_to_model (mex_contact))
-    {
-      mex_model_add_content (priv->model, MEX_CONTENT (mex_contact));
-
-      mex_telepathy_plugin_trigger_notification_for_contact (self,
-                                                             contact,
-                                                             TRUE);
-    }
+  *visible = mex_contact_should_add_to_model (mex_contact);
 
   g_signal_connect(mex_contact,
                    "should-add-to-model-changed",
                    G_CALLBACK(
                      mex_telepathy_plugin_on_should_add_to_model_changed),
                    self);
+
+  return MEX_CONTENT (mex_contact);
 }
 
 static void
-mex_telepathy_plugin_remove_contact (gpointer contact_ptr,
-                                     gpointer user_data)
+mex_telepathy_plugin_add_contacts (MexTelepathyPlugin *self,
+                                   TpConnection       *connection,
+                                   GPtrArray          *contacts)
 {
-  MexTelepathyPlugin *self = MEX_TELEPATHY_PLUGIN (user_data);
   MexTelepathyPluginPrivate *priv = self->priv;
-  GList *found;
-  TpContact *contact = TP_CONTACT (contact_ptr);
-  gpointer found_element;
+  guint i;
 
-  MEX_DEBUG ("Removing %s", tp_contact_get_alias (contact));
+  /* Keep track of the account, to remove its contacts on disconnection */
+  mex_contact_roster_add (priv->roster,
+                          G_OBJECT (tp_connection_get_account (connection)),
+                          contacts);
+
+  if (priv->building_contact_list)
+    return;
 
-  found = g_list_find_custom (priv->contacts, contact,
-                              mex_telepathy_plugin_compare_mex_contact);
-  if (found == NULL)
+  for (i = 0; i < contacts->len; i++)
     {
-      MEX_WARNING ("Could not find contact %s!",
-                   tp_contact_get_identifier (contact));
-      return;
+      TpContact *contact = g_ptr_array_index (contacts, i);
+      MexContent *content;
+
+      content = mex_contact_roster_lookup (priv->roster, G_OBJECT (contact));
+      if (content && mex_contact_should_add_to_model (MEX_CONTACT (content)))
+        mex_telepathy_plugin_trigger_notification_for_contact (self,
+                                                               contact,
+                                                               TRUE);
     }
-
-  found_element = found->data;
-
-  mex_model_remove_content(priv->model, MEX_CONTENT (found_element));
-  priv->contacts = g_list_remove(priv->contacts, found_element);
-  g_hash_table_remove (priv->contact_accounts, contact);
-
-  MEX_DEBUG ("Contact %s removed successfully.", tp_contact_get_identifier (
-               mex_contact_get_tp_contact (found_element)));
-
-  g_object_unref (found_element);
 }
 
 static void
-mex_telepathy_plugin_on_contact_list_changed(TpConnection *connection G_GNUC_UNUSED,
+mex_telepathy_plugin_on_contact_list_changed(TpConnection *connection,
                                              GPtrArray    *added,
                                              GPtrArray    *removed,
                                              gpointer      user_data)
 {
   MexTelepathyPlugin *self = MEX_TELEPATHY_PLUGIN (user_data);
 
-  g_ptr_array_foreach (added, mex_telepathy_plugin_add_contact, self);
-  g_ptr_array_foreach (removed, mex_telepathy_plugin_remove_contact, self);
+  MEX_DEBUG ("Contact list changed: %u added, %u removed",
+             added->len, removed->len);
 
-  g_ptr_array_unref (added);
-  g_ptr_array_unref (removed);
+  mex_telepathy_plugin_add_contacts (self, connection, added);
+  mex_contact_roster_remove (self->priv->roster, removed);
 }
 
 static void
@@ -535,7 +486,6 @@ mex_telepathy_plugin_on_connection_ready (TpAccount *account,
   MexTelepathyPluginPrivate *priv = self->priv;
   TpConnection *connection = tp_account_get_connection (account);
   GPtrArray *contacts;
-  guint i;
   MEX_DEBUG ("Connection ready! %p", connection);
 
   if (connection)
@@ -545,13 +495,7 @@ mex_telepathy_plugin_on_connection_ready (TpAccount *account,
           contacts = tp_connection_dup_contact_list (connection);
 
           priv->building_contact_list = TRUE;
-
-          for (i = 0; i < contacts->len; i++)
-            {
-              TpContact *contact = g_ptr_array_index (contacts, i);
-              mex_telepathy_plugin_add_contact (contact, self);
-            }
-
+          mex_telepathy_plugin_add_contacts (self, connection, contacts);
           priv->building_contact_list = FALSE;
 
           g_ptr_array_unref (contacts);
@@ -574,33 +518,14 @@ mex_telepathy_plugin_on_account_status_changed (TpAccount  *account,
                                                 gpointer    user_data)
 {
   MexTelepathyPlugin *self = MEX_TELEPATHY_PLUGIN (user_data);
-  guint i;
-  GList *removed = NULL;
-  MexContact *mex_contact;
-  TpContact *contact;
-  TpAccount *contact_account;
 
   if (old_status == TP_CONNECTION_STATUS_CONNECTED)
     {
       MEX_WARNING ("Account got disconnected! %s", dbus_error_name);
-      /* Remove contacts from this account */
 
-      /* Iterate over priv->contacts getting their connection and account */
-      for (i = 0; i < g_list_length (self->priv->contacts); ++i)
-        {
-          mex_contact = g_list_nth_data (self->priv->contacts, i);
-          contact = mex_contact_get_tp_contact (mex_contact);
-          MEX_DEBUG ("got contact %p", contact);
-          contact_account = TP_ACCOUNT (g_hash_table_lookup (self->priv->contact_accounts,
-                                                 contact));
-          MEX_DEBUG ("got telepathy account %p", contact_account);
-
-          /* Add matching contacts to list to remove */
-          if (contact_account == account)
-            removed = g_list_append (removed, contact);
-        }
-      /* Remove matched contacts */
-      g_list_foreach (removed, mex_telepathy_plugin_remove_contact, self);
+      /* Remove contacts from this account */
+      mex_contact_roster_remove_account (self->priv->roster,
+                                         G_OBJECT (account));
     }
 }
 
@@ -1145,10 +1070,8 @@ mex_telepathy_plugin_init (MexTelepathyPlugin *self)
 
   priv = self->priv = TELEPATHY_PLUGIN_PRIVATE (self);
   priv->actions = NULL;
-  priv->contacts = NULL;
   priv->dialog = NULL;
   priv->prompt_label = NULL;
-  priv->contact_accounts = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   /* log domain */
   MEX_LOG_DOMAIN_INIT (telepathy_log_domain, "telepathy");
@@ -1157,6 +1080,9 @@ mex_telepathy_plugin_init (MexTelepathyPlugin *self)
   mex_model_manager_add_category(priv->manager, &contacts);
 
   priv->model = mex_generic_model_new("Contacts", "Feed");
+  priv->roster = mex_contact_roster_new (priv->model,
+                                         mex_telepathy_plugin_create_contact,
+                                         self);
 
   mex_telepathy_plugin_add_action ("startavcall",
                                    _("Video Call"),
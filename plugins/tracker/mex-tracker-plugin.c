@@ -29,6 +29,14 @@ G_DEFINE_TYPE (MexTrackerPlugin, mex_tracker_plugin, G_TYPE_OBJECT)
 
 #define MAX_TRACKER_RESULTS G_MAXINT
 
+/* The feeds are paged, only TRACKER_MAX_PAGES pages of TRACKER_PAGE_SIZE
+ * items are kept around the part being looked at. The pages are cut in the
+ * order tracker gives the items (the query fragments can't ask for another
+ * one), so the feeds show them in that order rather than sorting them: a
+ * sort would mix the items of each new page with the ones already shown */
+#define TRACKER_PAGE_SIZE 200
+#define TRACKER_MAX_PAGES 5
+
 #define GET_PRIVATE(o) \
   (G_TYPE_INSTANCE_GET_PRIVATE ((o), MEX_TYPE_TRACKER_PLUGIN, MexTrackerPluginPrivate))
 
@@ -149,7 +157,7 @@ add_model (MexTrackerPlugin *self,
   GList *metadata_keys, *query_keys;
   MexFeed *feed, *dir_feed;
   GrlMedia *box;
-  gchar *query, *cat_name;
+  gchar *query, *cat_name, *snapshot, *dir_snapshot_name;
   GHashTable *models;
   const gchar *source_name = grl_source_get_name (source);
   gint priority;
@@ -197,9 +205,14 @@ add_model (MexTrackerPlugin *self,
                                      query_keys,
                                      metadata_keys,
                                      NULL, box);
-  mex_model_set_sort_func (MEX_MODEL (feed),
-                           mex_model_sort_time_cb,
-                           GINT_TO_POINTER (TRUE));
+  /* show the first page of the last run while tracker answers */
+  snapshot = mex_grilo_feed_build_snapshot_filename (source, cat_name);
+  g_object_set (feed,
+                "page-size", TRACKER_PAGE_SIZE,
+                "max-pages", TRACKER_MAX_PAGES,
+                "snapshot", snapshot,
+                NULL);
+  g_free (snapshot);
   mex_grilo_feed_query (MEX_GRILO_FEED (feed), query, 0, MAX_TRACKER_RESULTS);
 
   g_hash_table_insert (models, source, feed);
@@ -214,10 +227,17 @@ add_model (MexTrackerPlugin *self,
                                          query_keys,
                                          metadata_keys,
                                          query, NULL);
-  mex_model_set_sort_func (MEX_MODEL (dir_feed),
-                           mex_model_sort_alpha_cb,
-                           GINT_TO_POINTER (FALSE));
-  mex_grilo_feed_browse (MEX_GRILO_FEED (dir_feed), 0, G_MAXINT);
+  dir_snapshot_name = g_strconcat (cat_name, "-folders", NULL);
+  snapshot = mex_grilo_feed_build_snapshot_filename (source,
+                                                     dir_snapshot_name);
+  g_object_set (dir_feed,
+                "page-size", TRACKER_PAGE_SIZE,
+                "max-pages", TRACKER_MAX_PAGES,
+                "snapshot", snapshot,
+                NULL);
+  g_free (snapshot);
+  g_free (dir_snapshot_name);
+  mex_grilo_feed_browse (MEX_GRILO_FEED (dir_feed), 0, MAX_TRACKER_RESULTS);
 
   g_object_set (G_OBJECT (feed),
                 "category", cat_name,
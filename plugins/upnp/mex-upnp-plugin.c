@@ -112,7 +112,7 @@ add_model (MexUpnpPlugin *self,
   GList *metadata_keys;
   MexFeed *feed;
   GrlMedia *box;
-  char *query, *cat_name, *placeholder;
+  char *query, *cat_name, *placeholder, *snapshot;
   GHashTable *models;
 
   switch (category)
@@ -142,10 +142,14 @@ add_model (MexUpnpPlugin *self,
   mex_model_set_sort_func (MEX_MODEL (feed),
                            mex_model_sort_time_cb,
                            GINT_TO_POINTER (TRUE));
+  /* media servers can be slow to answer, start from what they had */
+  snapshot = mex_grilo_feed_build_snapshot_filename (source, cat_name);
   g_object_set (feed, "icon-name", "icon-panelheader-computer",
                 "placeholder-text", placeholder,
                 "category", cat_name,
+                "snapshot", snapshot,
                 NULL);
+  g_free (snapshot);
   mex_grilo_feed_query (MEX_GRILO_FEED (feed), query, 0, G_MAXINT);
 
   g_hash_table_insert (models, source, feed);
@@ -529,7 +529,18 @@ mex_header_activated_cb (MexExplorer *explorer,
   current_model = mex_explorer_get_model (explorer);
 
   if (current_model == mex_explorer_get_root_model (explorer))
-    data->toplevel_model = mex_explorer_get_focused_model (explorer);
+    {
+      gchar *category;
+
+      data->toplevel_model = mex_explorer_get_focused_model (explorer);
+
+      /* Bring in the plugins feeding this category if not done already */
+      g_object_get (model, "category", &category, NULL);
+      if (category)
+        mex_plugin_manager_load_category (mex_plugin_manager_get_default (),
+                                          category);
+      g_free (category);
+    }
   else if (mex_is_toplevel_plugin_model (data, model))
     {
       data->toplevel_plugin_model = mex_model_get_model (model);
@@ -0,0 +1,254 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include <glib.h>
+
+#include <mex.h>
+
+#include "mex-contact-roster.h"
+
+/*
+ * A stand-in for a connection manager: accounts and contacts are plain
+ * GObjects and a "connection" hands out the roster of an account in one
+ * batch, the way tp_connection_dup_contact_list() does.
+ */
+
+#define N_CONTACTS 200
+
+typedef struct
+{
+  GObject   *account;
+  GPtrArray *contacts;
+} FakeConnection;
+
+static FakeConnection *
+fake_connection_new (guint n_contacts)
+{
+  FakeConnection *connection;
+  guint i;
+
+  connection = g_slice_new (FakeConnection);
+  connection->account = g_object_new (G_TYPE_OBJECT, NULL);
+  connection->contacts = g_ptr_array_new_with_free_func (g_object_unref);
+
+  for (i = 0; i < n_contacts; i++)
+    g_ptr_array_add (connection->contacts, g_object_new (G_TYPE_OBJECT, NULL));
+
+  return connection;
+}
+
+static void
+fake_connection_free (FakeConnection *connection)
+{
+  g_ptr_array_unref (connection->contacts);
+  g_object_unref (connection->account);
+  g_slice_free (FakeConnection, connection);
+}
+
+static MexContent *
+create_content (GObject  *contact,
+                gboolean *visible,
+                gpointer  user_data)
+{
+  MexContent *content;
+
+  content = MEX_CONTENT (g_object_new (MEX_TYPE_PROGRAM, NULL));
+  g_object_set_data (G_OBJECT (content), "contact", contact);
+
+  /* hide one contact out of ten, like offline contacts */
+  *visible = GPOINTER_TO_UINT (g_object_get_data (contact, "hidden")) == 0;
+
+  (*(guint *) user_data)++;
+
+  return content;
+}
+
+static void
+on_changed (GController          *controller,
+            GControllerAction     action,
+            GControllerReference *reference,
+            guint                *n_changes)
+{
+  (*n_changes)++;
+}
+
+static void
+test_roster_add (void)
+{
+  FakeConnection *connection;
+  MexContactRoster *roster;
+  MexModel *model;
+  guint n_created = 0, n_changes = 0, i;
+
+  connection = fake_connection_new (N_CONTACTS);
+  for (i = 0; i < N_CONTACTS; i += 10)
+    g_object_set_data (g_ptr_array_index (connection->contacts, i),
+                       "hidden", GUINT_TO_POINTER (1));
+
+  model = mex_generic_model_new ("Contacts", "Feed");
+  g_signal_connect (mex_model_get_controller (model), "changed",
+                    G_CALLBACK (on_changed), &n_changes);
+
+  roster = mex_contact_roster_new (model, create_content, &n_created);
+
+  /* the whole roster lands in the model in one change */
+  mex_contact_roster_add (roster, connection->account, connection->contacts);
+  g_assert_cmpuint (n_changes, ==, 1);
+  g_assert_cmpuint (n_created, ==, N_CONTACTS);
+  g_assert_cmpuint (mex_model_get_length (model), ==, N_CONTACTS * 9 / 10);
+  g_assert_cmpuint (mex_contact_roster_get_n_contacts (roster, NULL),
+                    ==, N_CONTACTS);
+
+  /* in the order the connection gave */
+  g_assert (g_object_get_data (G_OBJECT (mex_model_get_content (model, 0)),
+                               "contact") ==
+            g_ptr_array_index (connection->contacts, 1));
+
+  /* lookups */
+  for (i = 0; i < N_CONTACTS; i++)
+    {
+      GObject *contact = g_ptr_array_index (connection->contacts, i);
+      MexContent *content = mex_contact_roster_lookup (roster, contact);
+
+      g_assert (content);
+      g_assert (g_object_get_data (G_OBJECT (content), "contact") == contact);
+    }
+
+  /* adding the same contacts again does nothing */
+  mex_contact_roster_add (roster, connection->account, connection->contacts);
+  g_assert_cmpuint (n_changes, ==, 1);
+  g_assert_cmpuint (n_created, ==, N_CONTACTS);
+
+  /* showing a hidden contact */
+  mex_contact_roster_set_visible (roster,
+                                  g_ptr_array_index (connection->contacts, 0),
+                                  TRUE);
+  g_assert_cmpuint (mex_model_get_length (model), ==, N_CONTACTS * 9 / 10 + 1);
+
+  g_object_unref (roster);
+  g_object_unref (model);
+  fake_connection_free (connection);
+}
+
+static void
+test_roster_remove (void)
+{
+  FakeConnection *connection;
+  MexContactRoster *roster;
+  MexModel *model;
+  GPtrArray *removed;
+  guint n_created = 0, i;
+
+  connection = fake_connection_new (N_CONTACTS);
+  model = mex_generic_model_new ("Contacts", "Feed");
+  roster = mex_contact_roster_new (model, create_content, &n_created);
+
+  mex_contact_roster_add (roster, connection->account, connection->contacts);
+
+  /* a few contacts go away, one at a time in the model */
+  removed = g_ptr_array_new ();
+  for (i = 0; i < 4; i++)
+    g_ptr_array_add (removed, g_ptr_array_index (connection->contacts, i));
+  mex_contact_roster_remove (roster, removed);
+  g_ptr_array_unref (removed);
+
+  g_assert_cmpuint (mex_model_get_length (model), ==, N_CONTACTS - 4);
+  g_assert (mex_contact_roster_lookup (roster,
+                                       g_ptr_array_index (connection->contacts,
+                                                          0)) == NULL);
+  g_assert (mex_contact_roster_lookup (roster,
+                                       g_ptr_array_index (connection->contacts,
+                                                          4)) != NULL);
+
+  mex_contact_roster_clear (roster);
+  g_assert_cmpuint (mex_model_get_length (model), ==, 0);
+  g_assert_cmpuint (mex_contact_roster_get_n_contacts (roster, NULL), ==, 0);
+
+  g_object_unref (roster);
+  g_object_unref (model);
+  fake_connection_free (connection);
+}
+
+static void
+test_roster_disconnect (void)
+{
+  FakeConnection *big, *small;
+  MexContactRoster *roster;
+  MexModel *model;
+  guint n_created = 0, i;
+
+  big = fake_connection_new (N_CONTACTS);
+  small = fake_connection_new (N_CONTACTS / 10);
+
+  model = mex_generic_model_new ("Contacts", "Feed");
+  roster = mex_contact_roster_new (model, create_content, &n_created);
+
+  /* interleave the two accounts in the model */
+  for (i = 0; i < N_CONTACTS / 10; i++)
+    {
+      GPtrArray *batch = g_ptr_array_new ();
+
+      g_ptr_array_add (batch, g_ptr_array_index (small->contacts, i));
+      mex_contact_roster_add (roster, small->account, batch);
+      g_ptr_array_unref (batch);
+    }
+  mex_contact_roster_add (roster, big->account, big->contacts);
+
+  g_assert_cmpuint (mex_contact_roster_get_n_contacts (roster, big->account),
+                    ==, N_CONTACTS);
+  g_assert_cmpuint (mex_contact_roster_get_n_contacts (roster, small->account),
+                    ==, N_CONTACTS / 10);
+
+  /* the big account disconnects: the model is rebuilt with what is left */
+  mex_contact_roster_remove_account (roster, big->account);
+
+  g_assert_cmpuint (mex_contact_roster_get_n_contacts (roster, big->account),
+                    ==, 0);
+  g_assert_cmpuint (mex_model_get_length (model), ==, N_CONTACTS / 10);
+
+  for (i = 0; i < N_CONTACTS / 10; i++)
+    {
+      MexContent *content = mex_model_get_content (model, i);
+
+      g_assert (g_object_get_data (G_OBJECT (content), "contact") ==
+                g_ptr_array_index (small->contacts, i));
+    }
+
+  /* and then the other one */
+  mex_contact_roster_remove_account (roster, small->account);
+  g_assert_cmpuint (mex_model_get_length (model), ==, 0);
+
+  g_object_unref (roster);
+  g_object_unref (model);
+  fake_connection_free (big);
+  fake_connection_free (small);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  mex_init (&argc, &argv);
+
+  g_test_add_func ("/contact-roster/add", test_roster_add);
+  g_test_add_func ("/contact-roster/remove", test_roster_remove);
+  g_test_add_func ("/contact-roster/disconnect", test_roster_disconnect);
+
+  return g_test_run ();
+}
@@ -0,0 +1,316 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include <stdlib.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <mex.h>
+
+#include "mex-gnome-dvb-channels.h"
+
+/*
+ * A stand-in for the org.gnome.DVB.ChannelList of the DVB daemon, talking
+ * to the plugin over a peer to peer D-Bus connection, so that no session
+ * bus is needed. It answers the GetChannelURL calls from the main loop, to
+ * see how many of them the plugin has in flight.
+ */
+
+#define N_CHANNELS 1000
+#define CHANNEL_LIST_PATH "/org/gnome/DVB/DeviceGroup/1/ChannelList"
+
+static const gchar introspection_xml[] =
+  "<node>"
+  "  <interface name='org.gnome.DVB.ChannelList'>"
+  "    <method name='GetChannelInfos'>"
+  "      <arg type='a(usb)' name='infos' direction='out'/>"
+  "    </method>"
+  "    <method name='GetChannelURL'>"
+  "      <arg type='u' name='channel_id' direction='in'/>"
+  "      <arg type='s' name='url' direction='out'/>"
+  "      <arg type='b' name='result' direction='out'/>"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+typedef struct
+{
+  GDBusConnection *server;
+  GDBusConnection *client;
+
+  guint n_url_calls;
+  guint in_flight;
+  guint max_in_flight;
+} Service;
+
+/* the channels are not listed in order, and every 10th one is a radio */
+static guint32
+channel_uid (guint i)
+{
+  return (i * 7919) % N_CHANNELS + 1;
+}
+
+static gboolean
+reply_url_cb (GDBusMethodInvocation *invocation)
+{
+  Service *service = g_object_get_data (G_OBJECT (invocation), "service");
+  guint32 uid;
+  gchar *url;
+
+  g_variant_get (g_dbus_method_invocation_get_parameters (invocation),
+                 "(u)", &uid);
+
+  url = g_strdup_printf ("dvb://%u", uid);
+  service->in_flight--;
+  g_dbus_method_invocation_return_value (invocation,
+                                         g_variant_new ("(sb)", url, TRUE));
+  g_free (url);
+
+  return FALSE;
+}
+
+static void
+handle_method_call (GDBusConnection       *connection,
+                    const gchar           *sender,
+                    const gchar           *object_path,
+                    const gchar           *interface_name,
+                    const gchar           *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data)
+{
+  Service *service = user_data;
+
+  if (g_strcmp0 (method_name, "GetChannelInfos") == 0)
+    {
+      GVariantBuilder builder;
+      guint i;
+
+      g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(usb)"));
+      for (i = 0; i < N_CHANNELS; i++)
+        {
+          guint32 uid = channel_uid (i);
+          gchar *name = g_strdup_printf ("Channel %u", uid);
+
+          g_variant_builder_add (&builder, "(usb)", uid, name, uid % 10 == 0);
+          g_free (name);
+        }
+
+      g_dbus_method_invocation_return_value (invocation,
+                                             g_variant_new ("(a(usb))",
+                                                            &builder));
+    }
+  else if (g_strcmp0 (method_name, "GetChannelURL") == 0)
+    {
+      service->n_url_calls++;
+      service->in_flight++;
+      service->max_in_flight = MAX (service->max_in_flight,
+                                    service->in_flight);
+
+      g_object_set_data (G_OBJECT (invocation), "service", service);
+      g_idle_add ((GSourceFunc) reply_url_cb, invocation);
+    }
+}
+
+static const GDBusInterfaceVTable interface_vtable =
+{
+  handle_method_call,
+  NULL,
+  NULL
+};
+
+static void
+on_server_connection (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  Service *service = user_data;
+  GError *error = NULL;
+
+  service->server = g_dbus_connection_new_finish (res, &error);
+  g_assert_no_error (error);
+}
+
+static GIOStream *
+stream_new_from_fd (gint fd)
+{
+  GSocketConnection *connection;
+  GError *error = NULL;
+  GSocket *socket;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  connection = g_socket_connection_factory_create_connection (socket);
+  g_object_unref (socket);
+
+  return G_IO_STREAM (connection);
+}
+
+static void
+service_start (Service *service)
+{
+  GDBusNodeInfo *introspection;
+  GIOStream *server_stream, *client_stream;
+  GError *error = NULL;
+  gchar *guid;
+  gint fds[2];
+
+  g_assert (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  server_stream = stream_new_from_fd (fds[0]);
+  client_stream = stream_new_from_fd (fds[1]);
+
+  /* the authentication of both ends needs to run at the same time */
+  guid = g_dbus_generate_guid ();
+  g_dbus_connection_new (server_stream, guid,
+                         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                         NULL, NULL, on_server_connection, service);
+  service->client =
+    g_dbus_connection_new_sync (client_stream, NULL,
+                                G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  while (service->server == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  introspection = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (service->server, CHANNEL_LIST_PATH,
+                                     introspection->interfaces[0],
+                                     &interface_vtable, service, NULL,
+                                     &error);
+  g_assert_no_error (error);
+
+  g_dbus_node_info_unref (introspection);
+  g_free (guid);
+  g_object_unref (server_stream);
+  g_object_unref (client_stream);
+}
+
+static void
+service_stop (Service *service)
+{
+  g_dbus_connection_close_sync (service->client, NULL, NULL);
+  g_object_unref (service->client);
+  g_object_unref (service->server);
+}
+
+static void
+on_changed (GController          *controller,
+            GControllerAction     action,
+            GControllerReference *reference,
+            guint                *n_changes)
+{
+  (*n_changes)++;
+}
+
+static void
+on_channels_fetched (GObject      *proxy,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+  GError *error = NULL;
+
+  g_assert (mex_gnome_dvb_channels_fetch_finish (G_DBUS_PROXY (proxy), res,
+                                                 &error));
+  g_assert_no_error (error);
+
+  g_main_loop_quit (user_data);
+}
+
+static void
+test_channels_fetch (void)
+{
+  Service service = { 0, };
+  GDBusProxy *proxy;
+  GMainLoop *loop;
+  MexModel *model;
+  GError *error = NULL;
+  guint n_changes = 0, i, n_tv = 0;
+  guint32 previous = 0;
+
+  service_start (&service);
+
+  proxy = g_dbus_proxy_new_sync (service.client,
+                                 G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                                 G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                                 NULL, NULL, CHANNEL_LIST_PATH,
+                                 "org.gnome.DVB.ChannelList", NULL, &error);
+  g_assert_no_error (error);
+
+  model = mex_generic_model_new ("TV", "icon-panelheader-tv");
+  g_signal_connect (mex_model_get_controller (model), "changed",
+                    G_CALLBACK (on_changed), &n_changes);
+
+  loop = g_main_loop_new (NULL, FALSE);
+  mex_gnome_dvb_channels_fetch (proxy, model, on_channels_fetched, loop);
+  g_main_loop_run (loop);
+
+  for (i = 1; i <= N_CHANNELS; i++)
+    if (i % 10)
+      n_tv++;
+
+  /* one URL call per TV channel, never too many at once */
+  g_assert_cmpuint (service.n_url_calls, ==, n_tv);
+  g_assert_cmpuint (service.max_in_flight, <=, MEX_GNOME_DVB_MAX_URL_CALLS);
+  g_assert_cmpuint (service.in_flight, ==, 0);
+
+  /* the channels landed at once, sorted, with their URL */
+  g_assert_cmpuint (n_changes, ==, 1);
+  g_assert_cmpuint (mex_model_get_length (model), ==, n_tv);
+
+  for (i = 0; i < n_tv; i++)
+    {
+      MexContent *content = mex_model_get_content (model, i);
+      guint32 uid;
+      gchar *url;
+
+      uid = atoi (mex_content_get_metadata (content, MEX_CONTENT_METADATA_ID));
+      g_assert_cmpuint (uid, >, previous);
+      g_assert_cmpuint (uid % 10, !=, 0);
+      previous = uid;
+
+      url = g_strdup_printf ("dvb://%u", uid);
+      g_assert_cmpstr (mex_content_get_metadata (content,
+                                                 MEX_CONTENT_METADATA_STREAM),
+                       ==, url);
+      g_free (url);
+    }
+
+  g_main_loop_unref (loop);
+  g_object_unref (model);
+  g_object_unref (proxy);
+  service_stop (&service);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  mex_init (&argc, &argv);
+
+  g_test_add_func ("/gnome-dvb/channels/fetch", test_channels_fetch);
+
+  return g_test_run ();
+}
@@ -0,0 +1,392 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2012 sleep(5) Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <mex.h>
+
+#include "mex-library-index.h"
+
+#define WAIT_TIMEOUT 10 /* seconds */
+
+typedef struct
+{
+  gchar           *tmp;
+  gchar           *root;
+  gchar           *cache_file;
+  MexLibraryIndex *index;
+  GMainLoop       *loop;
+  GString         *added;
+  GString         *removed;
+  guint            n_changed;
+} Fixture;
+
+static gchar *
+make_path (Fixture     *f,
+           const gchar *path)
+{
+  return g_build_filename (f->root, path, NULL);
+}
+
+static void
+make_file (Fixture     *f,
+           const gchar *path)
+{
+  gchar *filename = make_path (f, path);
+
+  g_assert (g_file_set_contents (filename, "", 0, NULL));
+  g_free (filename);
+}
+
+static void
+make_dir (Fixture     *f,
+          const gchar *path)
+{
+  gchar *filename = make_path (f, path);
+
+  g_assert_cmpint (g_mkdir (filename, 0755), ==, 0);
+  g_free (filename);
+}
+
+static void
+remove_path (Fixture     *f,
+             const gchar *path)
+{
+  gchar *filename = make_path (f, path);
+
+  g_assert_cmpint (g_remove (filename), ==, 0);
+  g_free (filename);
+}
+
+/* the index does not trust the times of directories changed just before
+ * being read, put them back in the past */
+static void
+age_dir (Fixture     *f,
+         const gchar *path)
+{
+  struct utimbuf times;
+  gchar *filename = make_path (f, path);
+
+  times.actime = times.modtime = time (NULL) - 60;
+  g_assert_cmpint (g_utime (filename, &times), ==, 0);
+  g_free (filename);
+}
+
+static void
+append_paths (Fixture   *f,
+              GString   *string,
+              GPtrArray *paths)
+{
+  gsize root_len = strlen (f->root);
+  guint i;
+
+  for (i = 0; i < paths->len; i++)
+    {
+      const gchar *path = g_ptr_array_index (paths, i);
+
+      g_assert (g_str_has_prefix (path, f->root));
+      if (string->len)
+        g_string_append_c (string, ' ');
+      g_string_append (string, path + root_len + 1);
+    }
+}
+
+static void
+changed_cb (MexLibraryIndex *index,
+            GPtrArray       *added,
+            GPtrArray       *removed,
+            Fixture         *f)
+{
+  append_paths (f, f->added, added);
+  append_paths (f, f->removed, removed);
+  f->n_changed++;
+}
+
+static gboolean
+check_scanned_cb (Fixture *f)
+{
+  if (mex_library_index_is_scanning (f->index))
+    return TRUE;
+
+  g_main_loop_quit (f->loop);
+
+  return FALSE;
+}
+
+static gboolean
+timeout_cb (gpointer data)
+{
+  g_assert_not_reached ();
+
+  return FALSE;
+}
+
+static void
+wait_for_scan (Fixture *f)
+{
+  guint timeout_id;
+
+  timeout_id = g_timeout_add_seconds (WAIT_TIMEOUT, timeout_cb, NULL);
+  g_timeout_add (50, (GSourceFunc) check_scanned_cb, f);
+
+  g_main_loop_run (f->loop);
+
+  g_source_remove (timeout_id);
+}
+
+static gboolean
+check_changed_cb (Fixture *f)
+{
+  if (f->n_changed == 0 || mex_library_index_is_scanning (f->index))
+    return TRUE;
+
+  g_main_loop_quit (f->loop);
+
+  return FALSE;
+}
+
+/* waits for the monitors to notice what was done */
+static void
+wait_for_changes (Fixture     *f,
+                  const gchar *added,
+                  const gchar *removed)
+{
+  guint timeout_id;
+
+  timeout_id = g_timeout_add_seconds (WAIT_TIMEOUT, timeout_cb, NULL);
+  g_timeout_add (50, (GSourceFunc) check_changed_cb, f);
+
+  g_main_loop_run (f->loop);
+
+  g_source_remove (timeout_id);
+
+  g_assert_cmpstr (f->added->str, ==, added);
+  g_assert_cmpstr (f->removed->str, ==, removed);
+
+  g_string_truncate (f->added, 0);
+  g_string_truncate (f->removed, 0);
+  f->n_changed = 0;
+}
+
+static void
+start_index (Fixture *f)
+{
+  f->index = mex_library_index_new (f->root, f->cache_file);
+  g_signal_connect (f->index, "changed", G_CALLBACK (changed_cb), f);
+  mex_library_index_start (f->index);
+
+  wait_for_scan (f);
+}
+
+static void
+stop_index (Fixture *f)
+{
+  g_object_unref (f->index);
+  f->index = NULL;
+}
+
+static void
+assert_stats (Fixture *f,
+              guint    n_directories,
+              guint    n_read,
+              guint    n_added,
+              guint    n_removed)
+{
+  MexLibraryIndexStats stats;
+
+  mex_library_index_get_stats (f->index, &stats);
+
+  g_assert_cmpuint (stats.n_directories, ==, n_directories);
+  g_assert_cmpuint (stats.n_read, ==, n_read);
+  g_assert_cmpuint (stats.n_added, ==, n_added);
+  g_assert_cmpuint (stats.n_removed, ==, n_removed);
+}
+
+static void
+fixture_setup (Fixture       *f,
+               gconstpointer  data)
+{
+  /* the cache is kept out of the tree, saving it would change the time
+   * of the root */
+  f->tmp = g_dir_make_tmp ("test-library-index-XXXXXX", NULL);
+  g_assert (f->tmp);
+  f->root = g_build_filename (f->tmp, "tree", NULL);
+  f->cache_file = g_build_filename (f->tmp, "cache", NULL);
+  g_assert_cmpint (g_mkdir (f->root, 0755), ==, 0);
+  f->loop = g_main_loop_new (NULL, FALSE);
+  f->added = g_string_new (NULL);
+  f->removed = g_string_new (NULL);
+
+  make_file (f, "a.avi");
+  make_file (f, "b.avi");
+  make_file (f, ".hidden.avi");
+  make_dir (f, "music");
+  make_file (f, "music/c.ogg");
+  make_dir (f, "music/old");
+  make_file (f, "music/old/d.ogg");
+  make_dir (f, "photos");
+  make_file (f, "photos/e.jpg");
+
+  age_dir (f, "music/old");
+  age_dir (f, "music");
+  age_dir (f, "photos");
+  age_dir (f, ".");
+}
+
+static void
+fixture_teardown (Fixture       *f,
+                  gconstpointer  data)
+{
+  gchar *argv[] = { "rm", "-rf", f->tmp, NULL };
+
+  if (f->index)
+    stop_index (f);
+
+  g_spawn_sync (NULL, argv, NULL, G_SPAWN_SEARCH_PATH, NULL, NULL,
+                NULL, NULL, NULL, NULL);
+
+  g_string_free (f->added, TRUE);
+  g_string_free (f->removed, TRUE);
+  g_main_loop_unref (f->loop);
+  g_free (f->cache_file);
+  g_free (f->root);
+  g_free (f->tmp);
+}
+
+static void
+test_startup (Fixture       *f,
+              gconstpointer  data)
+{
+  /* nothing to compare with, everything is read but nothing is changed */
+  start_index (f);
+  assert_stats (f, 4, 4, 8, 0);
+  g_assert_cmpuint (f->n_changed, ==, 0);
+  stop_index (f);
+
+  /* nothing changed, nothing is read */
+  start_index (f);
+  assert_stats (f, 4, 0, 0, 0);
+  g_assert_cmpuint (f->n_changed, ==, 0);
+  stop_index (f);
+
+  /* changed while we were not running, only the changed directories are
+   * read again */
+  make_file (f, "f.avi");
+  remove_path (f, "music/old/d.ogg");
+  remove_path (f, "music/old");
+  make_file (f, "music/g.ogg");
+
+  start_index (f);
+  assert_stats (f, 3, 2, 2, 2);
+  g_assert_cmpuint (f->n_changed, ==, 1);
+  g_assert_cmpstr (f->added->str, ==, "f.avi music/g.ogg");
+  g_assert_cmpstr (f->removed->str, ==, "music/old music/old/d.ogg");
+}
+
+static void
+test_other_root (Fixture       *f,
+                 gconstpointer  data)
+{
+  gchar *root;
+
+  start_index (f);
+  stop_index (f);
+
+  /* the cache of another tree is not used */
+  root = f->root;
+  f->root = make_path (f, "photos");
+
+  start_index (f);
+  assert_stats (f, 1, 1, 1, 0);
+  g_assert_cmpuint (f->n_changed, ==, 0);
+  stop_index (f);
+
+  g_free (f->root);
+  f->root = root;
+}
+
+static void
+test_symlinked_root (Fixture       *f,
+                     gconstpointer  data)
+{
+  gchar *root, *link;
+
+  /* the library is a link to the tree, only its root is followed */
+  link = g_build_filename (f->tmp, "link", NULL);
+  g_assert_cmpint (symlink (f->root, link), ==, 0);
+  root = f->root;
+  f->root = link;
+
+  start_index (f);
+  assert_stats (f, 4, 4, 8, 0);
+
+  make_file (f, "f.avi");
+  wait_for_changes (f, "f.avi", "");
+  stop_index (f);
+
+  f->root = root;
+  g_free (link);
+}
+
+static void
+test_monitor (Fixture       *f,
+              gconstpointer  data)
+{
+  start_index (f);
+
+  make_file (f, "f.avi");
+  wait_for_changes (f, "f.avi", "");
+
+  make_dir (f, "music/new");
+  make_file (f, "music/new/g.ogg");
+  wait_for_changes (f, "music/new music/new/g.ogg", "");
+
+  remove_path (f, "music/new/g.ogg");
+  remove_path (f, "music/new");
+  remove_path (f, "a.avi");
+  wait_for_changes (f, "", "a.avi music/new music/new/g.ogg");
+
+  remove_path (f, "photos/e.jpg");
+  remove_path (f, "photos");
+  wait_for_changes (f, "", "photos photos/e.jpg");
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  mex_init (&argc, &argv);
+
+  g_test_add ("/library-index/startup", Fixture, NULL,
+              fixture_setup, test_startup, fixture_teardown);
+  g_test_add ("/library-index/other-root", Fixture, NULL,
+              fixture_setup, test_other_root, fixture_teardown);
+  g_test_add ("/library-index/monitor", Fixture, NULL,
+              fixture_setup, test_monitor, fixture_teardown);
+  g_test_add ("/library-index/symlinked-root", Fixture, NULL,
+              fixture_setup, test_symlinked_root, fixture_teardown);
+
+  return g_test_run ();
+}
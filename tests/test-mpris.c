@@ -0,0 +1,377 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2012 sleep(5) Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#include <mex.h>
+
+#include "mex-mpris-properties.h"
+
+/*
+ * The player object is served over a peer to peer D-Bus connection, so
+ * that no session bus is needed, with its properties answered from a
+ * MexMprisProperties the way the plugin does.
+ */
+
+#define PLAYER_PATH "/org/mpris/MediaPlayer2"
+#define PLAYER_INTERFACE "org.mpris.MediaPlayer2.Player"
+
+static const gchar introspection_xml[] =
+  "<node>"
+  "  <interface name='org.mpris.MediaPlayer2.Player'>"
+  "    <property name='PlaybackStatus' type='s' access='read'/>"
+  "    <property name='Metadata' type='a{sv}' access='read'/>"
+  "    <property name='Volume' type='d' access='read'/>"
+  "  </interface>"
+  "</node>";
+
+typedef struct
+{
+  GDBusConnection *server;
+  GDBusConnection *client;
+
+  MexMprisProperties *properties;
+
+  guint     n_signals;
+  GVariant *changed;
+} Player;
+
+static GVariant *
+get_property_cb (GDBusConnection  *connection,
+                 const gchar      *sender,
+                 const gchar      *object_path,
+                 const gchar      *interface_name,
+                 const gchar      *property_name,
+                 GError          **error,
+                 gpointer          user_data)
+{
+  Player *player = user_data;
+  GVariant *value;
+
+  value = mex_mpris_properties_get (player->properties, property_name);
+  if (value == NULL)
+    g_set_error (error, G_DBUS_ERROR, G_DBUS_ERROR_NOT_SUPPORTED,
+                 "Property %s not supported", property_name);
+
+  return value;
+}
+
+static const GDBusInterfaceVTable interface_vtable =
+{
+  NULL,
+  get_property_cb,
+  NULL
+};
+
+static void
+on_server_connection (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  Player *player = user_data;
+  GError *error = NULL;
+
+  player->server = g_dbus_connection_new_finish (res, &error);
+  g_assert_no_error (error);
+}
+
+static GIOStream *
+stream_new_from_fd (gint fd)
+{
+  GSocketConnection *connection;
+  GError *error = NULL;
+  GSocket *socket;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  connection = g_socket_connection_factory_create_connection (socket);
+  g_object_unref (socket);
+
+  return G_IO_STREAM (connection);
+}
+
+static void
+on_properties_changed (GDBusConnection *connection,
+                       const gchar     *sender,
+                       const gchar     *object_path,
+                       const gchar     *interface_name,
+                       const gchar     *signal_name,
+                       GVariant        *parameters,
+                       gpointer         user_data)
+{
+  Player *player = user_data;
+  const gchar *changed_interface;
+
+  g_variant_get_child (parameters, 0, "&s", &changed_interface);
+  g_assert_cmpstr (changed_interface, ==, PLAYER_INTERFACE);
+
+  player->n_signals++;
+
+  if (player->changed)
+    g_variant_unref (player->changed);
+  player->changed = g_variant_get_child_value (parameters, 1);
+}
+
+static void
+player_start (Player *player)
+{
+  GDBusNodeInfo *introspection;
+  GIOStream *server_stream, *client_stream;
+  GError *error = NULL;
+  gchar *guid;
+  gint fds[2];
+
+  g_assert (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  server_stream = stream_new_from_fd (fds[0]);
+  client_stream = stream_new_from_fd (fds[1]);
+
+  /* the authentication of both ends needs to run at the same time */
+  guid = g_dbus_generate_guid ();
+  g_dbus_connection_new (server_stream, guid,
+                         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                         NULL, NULL, on_server_connection, player);
+  player->client =
+    g_dbus_connection_new_sync (client_stream, NULL,
+                                G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  while (player->server == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  introspection = g_dbus_node_info_new_for_xml (introspection_xml, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (player->server, PLAYER_PATH,
+                                     introspection->interfaces[0],
+                                     &interface_vtable, player, NULL,
+                                     &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_signal_subscribe (player->client, NULL,
+                                      "org.freedesktop.DBus.Properties",
+                                      "PropertiesChanged", PLAYER_PATH, NULL,
+                                      G_DBUS_SIGNAL_FLAGS_NONE,
+                                      on_properties_changed, player, NULL);
+
+  g_dbus_node_info_unref (introspection);
+  g_free (guid);
+  g_object_unref (server_stream);
+  g_object_unref (client_stream);
+}
+
+static void
+player_stop (Player *player)
+{
+  if (player->changed)
+    g_variant_unref (player->changed);
+
+  g_dbus_connection_close_sync (player->client, NULL, NULL);
+  g_object_unref (player->client);
+  g_object_unref (player->server);
+}
+
+static gboolean
+quit_cb (GMainLoop *loop)
+{
+  g_main_loop_quit (loop);
+
+  return FALSE;
+}
+
+/* runs the main loop long enough for any pending signal to arrive */
+static void
+wait_for_signals (void)
+{
+  GMainLoop *loop = g_main_loop_new (NULL, FALSE);
+
+  g_timeout_add (MEX_MPRIS_PROPERTIES_DELAY * 3, (GSourceFunc) quit_cb, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+}
+
+static MexContent *
+track_new (void)
+{
+  MexContent *content = g_object_new (MEX_TYPE_GENERIC_CONTENT, NULL);
+
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_TITLE, "Title");
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_ARTIST, "Artist");
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_ALBUM, "Album");
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_STILL,
+                            "file:///cover.jpg");
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_STREAM,
+                            "file:///track.ogg");
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_DURATION, "90");
+
+  return g_object_ref_sink (content);
+}
+
+static void
+test_metadata (void)
+{
+  MexContent *content = track_new ();
+  const gchar **artists;
+  const gchar *value;
+  GVariant *metadata;
+  gint64 length;
+
+  metadata = g_variant_ref_sink (mex_mpris_metadata_new (content,
+                                                         MEX_MPRIS_TRACK_PATH "/1",
+                                                         0));
+  g_assert (g_variant_is_of_type (metadata, G_VARIANT_TYPE ("a{sv}")));
+
+  g_assert (g_variant_lookup (metadata, "mpris:trackid", "&o", &value));
+  g_assert_cmpstr (value, ==, MEX_MPRIS_TRACK_PATH "/1");
+  g_assert (g_variant_lookup (metadata, "xesam:title", "&s", &value));
+  g_assert_cmpstr (value, ==, "Title");
+  g_assert (g_variant_lookup (metadata, "xesam:album", "&s", &value));
+  g_assert_cmpstr (value, ==, "Album");
+  g_assert (g_variant_lookup (metadata, "mpris:artUrl", "&s", &value));
+  g_assert_cmpstr (value, ==, "file:///cover.jpg");
+  g_assert (g_variant_lookup (metadata, "xesam:url", "&s", &value));
+  g_assert_cmpstr (value, ==, "file:///track.ogg");
+
+  g_assert (g_variant_lookup (metadata, "xesam:artist", "^a&s", &artists));
+  g_assert_cmpuint (g_strv_length ((gchar **) artists), ==, 1);
+  g_assert_cmpstr (artists[0], ==, "Artist");
+  g_free (artists);
+
+  /* the duration of the content stands in for the length of the stream */
+  g_assert (g_variant_lookup (metadata, "mpris:length", "x", &length));
+  g_assert_cmpint (length, ==, 90 * G_USEC_PER_SEC);
+  g_variant_unref (metadata);
+
+  metadata = g_variant_ref_sink (mex_mpris_metadata_new (content,
+                                                         MEX_MPRIS_TRACK_PATH "/1",
+                                                         5 * G_USEC_PER_SEC));
+  g_assert (g_variant_lookup (metadata, "mpris:length", "x", &length));
+  g_assert_cmpint (length, ==, 5 * G_USEC_PER_SEC);
+  g_variant_unref (metadata);
+
+  /* nothing playing */
+  metadata = g_variant_ref_sink (mex_mpris_metadata_new (NULL,
+                                                         MEX_MPRIS_NO_TRACK,
+                                                         0));
+  g_assert_cmpuint (g_variant_n_children (metadata), ==, 1);
+  g_assert (g_variant_lookup (metadata, "mpris:trackid", "&o", &value));
+  g_assert_cmpstr (value, ==, MEX_MPRIS_NO_TRACK);
+  g_variant_unref (metadata);
+
+  g_object_unref (content);
+}
+
+static void
+test_properties_changed (void)
+{
+  Player player = { 0, };
+  MexContent *content;
+  GVariant *reply, *value;
+  GError *error = NULL;
+  const gchar *status;
+
+  player_start (&player);
+
+  player.properties = mex_mpris_properties_new (PLAYER_INTERFACE);
+
+  /* not exported yet, nobody to tell */
+  mex_mpris_properties_set (player.properties, "Volume",
+                            g_variant_new_double (1.0));
+  mex_mpris_properties_set (player.properties, "PlaybackStatus",
+                            g_variant_new_string ("Stopped"));
+  mex_mpris_properties_export (player.properties, player.server, PLAYER_PATH);
+  wait_for_signals ();
+  g_assert_cmpuint (player.n_signals, ==, 0);
+
+  /* setting a value a property already has changes nothing */
+  mex_mpris_properties_set (player.properties, "Volume",
+                            g_variant_new_double (1.0));
+  wait_for_signals ();
+  g_assert_cmpuint (player.n_signals, ==, 0);
+
+  /* what a change of track does, in one signal */
+  content = track_new ();
+  mex_mpris_properties_set (player.properties, "PlaybackStatus",
+                            g_variant_new_string ("Playing"));
+  mex_mpris_properties_set (player.properties, "Metadata",
+                            mex_mpris_metadata_new (content,
+                                                    MEX_MPRIS_TRACK_PATH "/1",
+                                                    0));
+  mex_mpris_properties_set (player.properties, "PlaybackStatus",
+                            g_variant_new_string ("Paused"));
+  wait_for_signals ();
+
+  g_assert_cmpuint (player.n_signals, ==, 1);
+  g_assert_cmpuint (g_variant_n_children (player.changed), ==, 2);
+  g_assert (g_variant_lookup (player.changed, "PlaybackStatus", "&s",
+                              &status));
+  g_assert_cmpstr (status, ==, "Paused");
+  value = g_variant_lookup_value (player.changed, "Metadata",
+                                  G_VARIANT_TYPE ("a{sv}"));
+  g_assert (value != NULL);
+  g_variant_unref (value);
+  g_assert (g_variant_lookup_value (player.changed, "Volume", NULL) == NULL);
+
+  /* the cached values are what a Get answers */
+  reply = g_dbus_connection_call_sync (player.client, NULL, PLAYER_PATH,
+                                       "org.freedesktop.DBus.Properties",
+                                       "Get",
+                                       g_variant_new ("(ss)", PLAYER_INTERFACE,
+                                                      "PlaybackStatus"),
+                                       G_VARIANT_TYPE ("(v)"),
+                                       G_DBUS_CALL_FLAGS_NONE, -1, NULL,
+                                       &error);
+  g_assert_no_error (error);
+  g_variant_get (reply, "(v)", &value);
+  g_assert_cmpstr (g_variant_get_string (value, NULL), ==, "Paused");
+  g_variant_unref (value);
+  g_variant_unref (reply);
+
+  /* flushing sends the changes right away */
+  mex_mpris_properties_set (player.properties, "Volume",
+                            g_variant_new_double (0.5));
+  mex_mpris_properties_flush (player.properties);
+  while (player.n_signals < 2)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (g_variant_n_children (player.changed), ==, 1);
+
+  wait_for_signals ();
+  g_assert_cmpuint (player.n_signals, ==, 2);
+
+  g_object_unref (content);
+  g_object_unref (player.properties);
+  player_stop (&player);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  mex_init (&argc, &argv);
+
+  g_test_add_func ("/mpris/metadata", test_metadata);
+  g_test_add_func ("/mpris/properties-changed", test_properties_changed);
+
+  return g_test_run ();
+}
@@ -0,0 +1,246 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2012 sleep(5) Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <mex.h>
+
+#include "mex-suggest-index.h"
+
+#define N_TITLES  100000
+#define N_LOOKUPS 1000
+
+static void
+assert_suggestions (MexSuggestIndex *index,
+                    const gchar     *prefix,
+                    guint            max,
+                    ...)
+{
+  GPtrArray *suggestions;
+  const gchar *expected;
+  va_list args;
+  guint i = 0;
+
+  suggestions = mex_suggest_index_complete (index, prefix, max);
+
+  va_start (args, max);
+  while ((expected = va_arg (args, const gchar *)))
+    {
+      g_assert_cmpuint (i, <, suggestions->len);
+      g_assert_cmpstr (g_ptr_array_index (suggestions, i), ==, expected);
+      i++;
+    }
+  va_end (args);
+
+  g_assert_cmpuint (suggestions->len, ==, i);
+  g_ptr_array_free (suggestions, TRUE);
+}
+
+static MexContent *
+add_content (MexFeed     *feed,
+             const gchar *title,
+             const gchar *artist)
+{
+  MexContent *content = MEX_CONTENT (mex_program_new (feed));
+
+  mex_content_set_metadata (content, MEX_CONTENT_METADATA_TITLE, title);
+  if (artist)
+    mex_content_set_metadata (content, MEX_CONTENT_METADATA_ARTIST, artist);
+  mex_model_add_content (MEX_MODEL (feed), content);
+
+  return content;
+}
+
+static void
+test_ranking (void)
+{
+  MexSuggestIndex *index = mex_suggest_index_new ();
+
+  mex_suggest_index_add_term (index, "The Matrix");
+  mex_suggest_index_add_term (index, "Matrix Reloaded");
+  mex_suggest_index_add_term (index, "Matrix Reloaded");
+  mex_suggest_index_add_term (index, "Mad Max");
+
+  /* words are matched from their start, whatever their case */
+  assert_suggestions (index, "MAT", 10, "Matrix Reloaded", "The Matrix", NULL);
+  assert_suggestions (index, "ma", 2, "Matrix Reloaded", "Mad Max", NULL);
+  assert_suggestions (index, "atrix", 10, NULL);
+  assert_suggestions (index, "the mat", 10, "The Matrix", NULL);
+
+  /* a search weighs more than a few items */
+  mex_suggest_index_record_search (index, "the matrix");
+  assert_suggestions (index, "mat", 10, "The Matrix", "Matrix Reloaded", NULL);
+  assert_suggestions (index, "news", 10, NULL);
+
+  mex_suggest_index_record_search (index, "news");
+  assert_suggestions (index, "news", 10, "news", NULL);
+
+  /* terms go with the last item bearing them */
+  mex_suggest_index_remove_term (index, "Matrix Reloaded");
+  assert_suggestions (index, "rel", 10, "Matrix Reloaded", NULL);
+  mex_suggest_index_remove_term (index, "Matrix Reloaded");
+  assert_suggestions (index, "rel", 10, NULL);
+
+  g_object_unref (index);
+}
+
+static void
+test_models (void)
+{
+  MexSuggestIndex *index = mex_suggest_index_new ();
+  MexFeed *feed = mex_feed_new ("Videos", "Videos");
+  MexContent *content;
+
+  add_content (feed, "Brazil", "Terry Gilliam");
+
+  mex_suggest_index_add_model (index, MEX_MODEL (feed));
+  assert_suggestions (index, "bra", 10, "Brazil", NULL);
+  assert_suggestions (index, "gil", 10, "Terry Gilliam", NULL);
+
+  /* the index follows the changes of the model */
+  content = add_content (feed, "Brave", NULL);
+  assert_suggestions (index, "bra", 10, "Brave", "Brazil", NULL);
+
+  mex_model_remove_content (MEX_MODEL (feed), content);
+  assert_suggestions (index, "bra", 10, "Brazil", NULL);
+
+  mex_model_clear (MEX_MODEL (feed));
+  assert_suggestions (index, "bra", 10, NULL);
+  assert_suggestions (index, "gil", 10, NULL);
+
+  add_content (feed, "Brazil", NULL);
+  assert_suggestions (index, "bra", 10, "Brazil", NULL);
+
+  mex_suggest_index_remove_model (index, MEX_MODEL (feed));
+  assert_suggestions (index, "bra", 10, NULL);
+
+  add_content (feed, "Brave", NULL);
+  assert_suggestions (index, "bra", 10, NULL);
+
+  g_object_unref (feed);
+  g_object_unref (index);
+}
+
+static void
+test_persistence (void)
+{
+  MexSuggestIndex *index = mex_suggest_index_new ();
+  GError *error = NULL;
+  GList *history;
+  gchar *filename;
+  gint fd;
+
+  fd = g_file_open_tmp ("test-suggest-index-XXXXXX", &filename, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  mex_suggest_index_add_term (index, "Alien");
+  mex_suggest_index_record_search (index, "aliens");
+  mex_suggest_index_record_search (index, "blade runner");
+  mex_suggest_index_record_search (index, "Aliens");
+  mex_suggest_index_record_search (index, "cars");
+
+  mex_suggest_index_save (index, filename, &error);
+  g_assert_no_error (error);
+  g_object_unref (index);
+
+  /* only the searches are kept */
+  index = mex_suggest_index_new ();
+  mex_suggest_index_load (index, filename, &error);
+  g_assert_no_error (error);
+
+  history = mex_suggest_index_get_history (index, 2);
+  g_assert_cmpuint (g_list_length (history), ==, 2);
+  g_assert_cmpstr (history->data, ==, "cars");
+  g_assert_cmpstr (history->next->data, ==, "aliens");
+  g_list_free_full (history, g_free);
+
+  assert_suggestions (index, "ali", 10, "aliens", NULL);
+  assert_suggestions (index, "r", 10, "blade runner", NULL);
+
+  g_object_unref (index);
+  g_unlink (filename);
+  g_free (filename);
+}
+
+static void
+test_benchmark (void)
+{
+  MexSuggestIndex *index = mex_suggest_index_new ();
+  GPtrArray *suggestions;
+  gdouble elapsed;
+  guint i;
+
+  for (i = 0; i < N_TITLES; i++)
+    {
+      gchar *title = g_strdup_printf ("Title %u of %c%c%c collection",
+                                      i, 'a' + i % 26, 'a' + i / 26 % 26,
+                                      'a' + i / 676 % 26);
+
+      mex_suggest_index_add_term (index, title);
+      g_free (title);
+    }
+
+  g_test_timer_start ();
+  suggestions = mex_suggest_index_complete (index, "title", 10);
+  elapsed = g_test_timer_elapsed ();
+  g_assert_cmpuint (suggestions->len, ==, 10);
+  g_ptr_array_free (suggestions, TRUE);
+
+  g_test_message ("indexing %u titles took %.1f ms", N_TITLES,
+                  elapsed * 1000);
+
+  /* every title matches "title" and "col" */
+  g_test_timer_start ();
+  for (i = 0; i < N_LOOKUPS; i++)
+    {
+      static const gchar *prefixes[] = { "title", "col", "abc", "q", "zz" };
+
+      suggestions =
+        mex_suggest_index_complete (index,
+                                    prefixes[i % G_N_ELEMENTS (prefixes)],
+                                    10);
+      g_ptr_array_free (suggestions, TRUE);
+    }
+  elapsed = g_test_timer_elapsed () * 1000 / N_LOOKUPS;
+
+  g_test_minimized_result (elapsed, "%.3f ms per completion", elapsed);
+  g_assert_cmpfloat (elapsed, <, 1.0);
+
+  g_object_unref (index);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  mex_init (&argc, &argv);
+
+  g_test_add_func ("/suggest-index/ranking", test_ranking);
+  g_test_add_func ("/suggest-index/models", test_models);
+  g_test_add_func ("/suggest-index/persistence", test_persistence);
+
+  if (g_test_perf ())
+    g_test_add_func ("/suggest-index/benchmark", test_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,468 @@
+/*
+ * Mex - a media explorer
+ *
+ * Copyright © 2011 Intel Corporation.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses>
+ */
+
+#include <string.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <libsoup/soup.h>
+
+#include "mex-player-common.h"
+#include "dbus-client.h"
+#include "state-channel.h"
+
+/*
+ * Hundreds of pages wait on the state channel of the web remote while a
+ * stand-in player signals its changes over a peer to peer D-Bus connection.
+ * The only D-Bus messages the web remote side sees must be those signals.
+ */
+
+#define N_CLIENTS 300
+
+typedef struct
+{
+  GDBusConnection *player;
+  GDBusConnection *remote;
+  volatile gint n_messages;   /* counted from the D-Bus worker thread */
+
+  SoupServer *server;
+  StateChannel *channel;
+
+  SoupSession *session;
+  guint n_responses;
+  guint n_cancelled;
+  gchar *expected;
+} Remote;
+
+static void
+on_server_connection (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  Remote *remote = user_data;
+  GError *error = NULL;
+
+  remote->player = g_dbus_connection_new_finish (res, &error);
+  g_assert_no_error (error);
+}
+
+static GIOStream *
+stream_new_from_fd (gint fd)
+{
+  GSocketConnection *connection;
+  GError *error = NULL;
+  GSocket *socket;
+
+  socket = g_socket_new_from_fd (fd, &error);
+  g_assert_no_error (error);
+
+  connection = g_socket_connection_factory_create_connection (socket);
+  g_object_unref (socket);
+
+  return G_IO_STREAM (connection);
+}
+
+static GDBusMessage *
+count_messages_filter (GDBusConnection *connection,
+                       GDBusMessage    *message,
+                       gboolean         incoming,
+                       gpointer         user_data)
+{
+  Remote *remote = user_data;
+
+  if (incoming)
+    g_atomic_int_inc (&remote->n_messages);
+
+  return message;
+}
+
+static void
+on_uri_changed (GDBusConnection *connection,
+                const gchar     *sender_name,
+                const gchar     *object_path,
+                const gchar     *interface_name,
+                const gchar     *signal_name,
+                GVariant        *parameters,
+                gpointer         user_data)
+{
+  Remote *remote = user_data;
+  const gchar *uri;
+  gchar *state;
+
+  g_variant_get (parameters, "(&s)", &uri);
+
+  state = g_strdup_printf ("{\"uri\":\"%s\"}", uri);
+  state_channel_set_state (remote->channel, state);
+  g_free (state);
+}
+
+static void
+server_cb (SoupServer        *server,
+           SoupMessage       *msg,
+           const char        *path,
+           GHashTable        *query,
+           SoupClientContext *client,
+           gpointer           user_data)
+{
+  Remote *remote = user_data;
+
+  state_channel_handle (remote->channel, msg, query);
+}
+
+static void
+remote_start (Remote *remote)
+{
+  GIOStream *server_stream, *client_stream;
+  GError *error = NULL;
+  gchar *guid;
+  gint fds[2];
+
+  g_assert (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+  server_stream = stream_new_from_fd (fds[0]);
+  client_stream = stream_new_from_fd (fds[1]);
+
+  /* the authentication of both ends needs to run at the same time */
+  guid = g_dbus_generate_guid ();
+  g_dbus_connection_new (server_stream, guid,
+                         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER,
+                         NULL, NULL, on_server_connection, remote);
+  remote->remote =
+    g_dbus_connection_new_sync (client_stream, NULL,
+                                G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT,
+                                NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  while (remote->player == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_dbus_connection_add_filter (remote->remote, count_messages_filter,
+                                remote, NULL);
+  g_dbus_connection_signal_subscribe (remote->remote, NULL,
+                                      MEX_PLAYER_INTERFACE_NAME, "UriChanged",
+                                      MEX_PLAYER_OBJECT_PATH, NULL,
+                                      G_DBUS_SIGNAL_FLAGS_NONE,
+                                      on_uri_changed, remote, NULL);
+
+  remote->server = soup_server_new (SOUP_SERVER_PORT, 0, NULL);
+  g_assert (remote->server != NULL);
+  soup_server_add_handler (remote->server, "/state", server_cb, remote, NULL);
+  soup_server_run_async (remote->server);
+
+  remote->channel = state_channel_new (remote->server);
+
+  remote->session =
+    soup_session_async_new_with_options (SOUP_SESSION_MAX_CONNS,
+                                         N_CLIENTS + 10,
+                                         SOUP_SESSION_MAX_CONNS_PER_HOST,
+                                         N_CLIENTS + 10,
+                                         NULL);
+
+  g_free (guid);
+  g_object_unref (server_stream);
+  g_object_unref (client_stream);
+}
+
+static void
+remote_stop (Remote *remote)
+{
+  soup_session_abort (remote->session);
+  g_object_unref (remote->session);
+
+  state_channel_free (remote->channel);
+  soup_server_quit (remote->server);
+  g_object_unref (remote->server);
+
+  g_dbus_connection_close_sync (remote->remote, NULL, NULL);
+  g_object_unref (remote->remote);
+  g_object_unref (remote->player);
+
+  g_free (remote->expected);
+}
+
+static void
+player_set_uri (Remote      *remote,
+                const gchar *uri)
+{
+  guint serial = state_channel_get_serial (remote->channel);
+
+  g_dbus_connection_emit_signal (remote->player, NULL,
+                                 MEX_PLAYER_OBJECT_PATH,
+                                 MEX_PLAYER_INTERFACE_NAME, "UriChanged",
+                                 g_variant_new ("(s)", uri), NULL);
+
+  while (state_channel_get_serial (remote->channel) == serial)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+on_response (SoupSession *session,
+             SoupMessage *msg,
+             gpointer     user_data)
+{
+  Remote *remote = user_data;
+
+  if (msg->status_code == SOUP_STATUS_CANCELLED)
+    {
+      remote->n_cancelled++;
+      return;
+    }
+
+  g_assert_cmpuint (msg->status_code, ==, SOUP_STATUS_OK);
+  g_assert_cmpstr (msg->response_body->data, ==, remote->expected);
+
+  remote->n_responses++;
+}
+
+static void
+get_state (Remote      *remote,
+           const gchar *query)
+{
+  SoupMessage *msg;
+  gchar *url;
+
+  url = g_strdup_printf ("http://127.0.0.1:%u/state%s",
+                         soup_server_get_port (remote->server), query);
+  msg = soup_message_new ("GET", url);
+  soup_session_queue_message (remote->session, msg, on_response, remote);
+  g_free (url);
+}
+
+static gboolean
+quit_cb (GMainLoop *loop)
+{
+  g_main_loop_quit (loop);
+
+  return FALSE;
+}
+
+static void
+run_for (guint ms)
+{
+  GMainLoop *loop = g_main_loop_new (NULL, FALSE);
+
+  g_timeout_add (ms, (GSourceFunc) quit_cb, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+}
+
+static void
+test_state_channel (void)
+{
+  Remote remote = { 0, };
+  guint i;
+
+  remote_start (&remote);
+
+  player_set_uri (&remote, "file:///a");
+  g_assert_cmpint (g_atomic_int_get (&remote.n_messages), ==, 1);
+
+  /* a page that does not have the state yet gets it straight away */
+  remote.expected = g_strdup ("{\"serial\":1,\"state\":{\"uri\":\"file:///a\"}}");
+  get_state (&remote, "");
+  get_state (&remote, "?since=0");
+  while (remote.n_responses < 2)
+    g_main_context_iteration (NULL, TRUE);
+
+  /* pages that have it wait, costing nothing */
+  remote.n_responses = 0;
+  for (i = 0; i < N_CLIENTS; i++)
+    get_state (&remote, "?since=1");
+
+  while (state_channel_get_n_waiting (remote.channel) < N_CLIENTS)
+    g_main_context_iteration (NULL, TRUE);
+
+  run_for (500);
+  g_assert_cmpuint (remote.n_responses, ==, 0);
+  g_assert_cmpuint (state_channel_get_n_waiting (remote.channel), ==, N_CLIENTS);
+  g_assert_cmpint (g_atomic_int_get (&remote.n_messages), ==, 1);
+
+  /* one change reaches all of them, with one signal */
+  g_free (remote.expected);
+  remote.expected = g_strdup ("{\"serial\":2,\"state\":{\"uri\":\"file:///b\"}}");
+  player_set_uri (&remote, "file:///b");
+
+  while (remote.n_responses < N_CLIENTS)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (state_channel_get_n_waiting (remote.channel), ==, 0);
+  g_assert_cmpint (g_atomic_int_get (&remote.n_messages), ==, 2);
+
+  /* the same state again is not a change */
+  state_channel_set_state (remote.channel, "{\"uri\":\"file:///b\"}");
+  g_assert_cmpuint (state_channel_get_serial (remote.channel), ==, 2);
+
+  /* pages going away stop waiting */
+  for (i = 0; i < 10; i++)
+    get_state (&remote, "?since=2");
+
+  while (state_channel_get_n_waiting (remote.channel) < 10)
+    g_main_context_iteration (NULL, TRUE);
+
+  soup_session_abort (remote.session);
+  g_assert_cmpuint (remote.n_cancelled, ==, 10);
+
+  while (state_channel_get_n_waiting (remote.channel) > 0)
+    g_main_context_iteration (NULL, TRUE);
+
+  remote_stop (&remote);
+}
+
+/* a player that was already playing when the web remote started, it answers
+ * from its own thread: the client asks it for its state synchronously */
+
+static const gchar player_xml[] =
+  "<node>"
+  "  <interface name='" MEX_PLAYER_INTERFACE_NAME "'>"
+  "    <method name='GetUri'>"
+  "      <arg name='uri' type='s' direction='out' />"
+  "    </method>"
+  "    <method name='GetPlaying'>"
+  "      <arg name='playing' type='b' direction='out' />"
+  "    </method>"
+  "    <method name='GetDuration'>"
+  "      <arg name='duration' type='d' direction='out' />"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+typedef struct
+{
+  GDBusConnection *connection;
+  GMainContext    *context;
+  GMainLoop       *loop;
+  GDBusNodeInfo   *info;
+  guint            registration_id;
+} Player;
+
+static void
+player_method_call (GDBusConnection       *connection,
+                    const gchar           *sender,
+                    const gchar           *object_path,
+                    const gchar           *interface_name,
+                    const gchar           *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data)
+{
+  if (g_str_equal (method_name, "GetUri"))
+    g_dbus_method_invocation_return_value (invocation,
+                                           g_variant_new ("(s)",
+                                                          "file:///movie.mkv"));
+  else if (g_str_equal (method_name, "GetPlaying"))
+    g_dbus_method_invocation_return_value (invocation,
+                                           g_variant_new ("(b)", TRUE));
+  else if (g_str_equal (method_name, "GetDuration"))
+    g_dbus_method_invocation_return_value (invocation,
+                                           g_variant_new ("(d)", 5400.0));
+}
+
+static const GDBusInterfaceVTable player_vtable = { player_method_call, };
+
+static gpointer
+player_thread (Player *player)
+{
+  g_main_context_push_thread_default (player->context);
+  g_main_loop_run (player->loop);
+  g_main_context_pop_thread_default (player->context);
+
+  return NULL;
+}
+
+static void
+player_changed_cb (DBusClient *dbus_client,
+                   guint      *n_changes)
+{
+  (*n_changes)++;
+}
+
+static void
+test_started_while_playing (void)
+{
+  Remote remote = { 0, };
+  Player player = { 0, };
+  DBusClient *dbus_client;
+  GError *error = NULL;
+  guint n_changes = 0;
+  GThread *thread;
+
+  remote_start (&remote);
+
+  player.connection = remote.player;
+  player.context = g_main_context_new ();
+  player.loop = g_main_loop_new (player.context, FALSE);
+  player.info = g_dbus_node_info_new_for_xml (player_xml, &error);
+  g_assert_no_error (error);
+
+  /* the calls are dispatched to the context the object is registered in */
+  g_main_context_push_thread_default (player.context);
+  player.registration_id =
+    g_dbus_connection_register_object (player.connection,
+                                       MEX_PLAYER_OBJECT_PATH,
+                                       player.info->interfaces[0],
+                                       &player_vtable, &player, NULL, &error);
+  g_assert_no_error (error);
+  g_main_context_pop_thread_default (player.context);
+  thread = g_thread_new ("player", (GThreadFunc) player_thread, &player);
+
+  /* the state is known before any signal */
+  dbus_client = dbus_client_new_for_connection (remote.remote);
+  g_assert_cmpstr (dbus_client->current_playing_uri, ==, "file:///movie.mkv");
+  g_assert (dbus_client->playing);
+  g_assert_cmpfloat (dbus_client->duration, ==, 5400.0);
+
+  /* and the signals keep it up to date */
+  dbus_client_set_player_changed_func (dbus_client,
+                                       (DBusClientPlayerChangedFunc)
+                                       player_changed_cb,
+                                       &n_changes);
+  g_dbus_connection_emit_signal (remote.player, NULL,
+                                 MEX_PLAYER_OBJECT_PATH,
+                                 MEX_PLAYER_INTERFACE_NAME, "PlayingChanged",
+                                 g_variant_new ("(b)", FALSE), NULL);
+  while (n_changes == 0)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (!dbus_client->playing);
+
+  dbus_client_free (dbus_client);
+
+  g_main_loop_quit (player.loop);
+  g_thread_join (thread);
+  g_dbus_connection_unregister_object (player.connection,
+                                       player.registration_id);
+  g_main_loop_unref (player.loop);
+  g_main_context_unref (player.context);
+  g_dbus_node_info_unref (player.info);
+
+  remote_stop (&remote);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/webremote/state-channel", test_state_channel);
+  g_test_add_func ("/webremote/started-while-playing",
+                   test_started_while_playing);
+
+  return g_test_run ();
+}